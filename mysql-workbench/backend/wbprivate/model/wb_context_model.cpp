@@ -233,14 +233,16 @@ bool WBContextModel::auto_save_document()
   
   workbench_DocumentRef doc(wb->get_document());
     
+  // changes made without undo actions (or still in an open undo group) need an auto-save as well
+  grt::UndoManager *um= wb->get_grt()->get_undo_manager();
   mdc::Timestamp now= mdc::get_time();
   if (now - _last_auto_save_time > interval
       && _file
       && doc.is_valid() 
       && !wb->get_grt_manager()->get_dispatcher()->get_busy()
-      && wb->get_grt()->get_undo_manager()->get_latest_closed_undo_action() != _auto_save_point)
+      && (um->get_latest_closed_undo_action() != _auto_save_point || um->has_changes_to_take()))
   {
-    _auto_save_point = wb->get_grt()->get_undo_manager()->get_latest_closed_undo_action();
+    _auto_save_point = um->get_latest_closed_undo_action();
     _last_auto_save_time = now;
     try
     {
@@ -290,7 +292,8 @@ void WBContextModel::detect_auto_save_files(const std::string &autosave_dir)
     if (base::LockFile::check(bec::make_path(*d, ModelFile::lock_filename.c_str())) != base::LockFile::NotLocked)
       continue;
     
-    if (g_file_test(bec::make_path(*d, MAIN_DOCUMENT_AUTOSAVE_NAME).c_str(), G_FILE_TEST_EXISTS))
+    if (g_file_test(bec::make_path(*d, MAIN_DOCUMENT_AUTOSAVE_SNAPSHOT_NAME).c_str(), G_FILE_TEST_EXISTS)
+        || g_file_test(bec::make_path(*d, MAIN_DOCUMENT_AUTOSAVE_NAME).c_str(), G_FILE_TEST_EXISTS))
     {
       std::string path = bec::make_path(*d, "real_path");
       gchar *orig_path;
@@ -71,6 +71,7 @@ namespace wb
     std::string string_filter() { return _tree->_filter; }
     GPatternSpec* schema_filter() { return _tree->_schema_pattern; }
     GPatternSpec* object_filter() { return _tree->_object_pattern; }
+    void set_max_eager_nodes(size_t count) { _tree->_max_eager_nodes = count; }
   };
 }
 
@@ -4380,4 +4381,75 @@ public:
     deleg_filtered->check_and_reset("TF036CHK001");
   }
 
+  // Tests the lazy creation of the nodes for big schema collections
+  TEST_FUNCTION(37)
+  {
+    base::StringListPtr schemas(new std::list<std::string>());
+    mforms::TreeNodeRef schema_node;
+    mforms::TreeNodeRef schema_node_f;
+    mforms::TreeNodeRef tables_node;
+    mforms::TreeNodeRef tables_node_f;
+    LiveSchemaTree::SchemaData *pdata;
+
+    _tester.set_max_eager_nodes(2);
+    _tester_filtered.set_max_eager_nodes(2);
+    _tester.enable_events(true);
+
+    schemas->push_back("schema1");
+    _lst.update_schemata(schemas);
+    schema_node = _lst.get_node_for_object("schema1", LiveSchemaTree::Schema, "");
+
+    deleg->expect_fetch_schema_contents_call();
+    deleg->_mock_table_list->push_back("table3");
+    deleg->_mock_table_list->push_back("table1");
+    deleg->_mock_table_list->push_back("table2");
+    deleg->_mock_view_list->push_back("view1");
+    deleg->_mock_call_back_slot = true;
+    deleg->_mock_schema_name = "schema1";
+    deleg->_check_id = "TF037CHK001";
+    _tester.load_schema_content(schema_node);
+    deleg->check_and_reset("TF037CHK001");
+
+    // Only the store has the tables, the collection has a placeholder...
+    pdata = dynamic_cast<LiveSchemaTree::SchemaData*>(schema_node->get_data());
+    ensure_equals("TF037CHK002: Unexpected number of stored tables", pdata->objects[LiveSchemaTree::TABLES_NODE_INDEX].size(), 3U);
+    ensure_equals("TF037CHK002: Unexpected first stored table", pdata->objects[LiveSchemaTree::TABLES_NODE_INDEX][0], "table1");
+
+    tables_node = schema_node->get_child(LiveSchemaTree::TABLES_NODE_INDEX);
+    ensure_equals("TF037CHK003: Unexpected number of table nodes", tables_node->count(), 1);
+    ensure("TF037CHK003: Unexpected table node", tables_node->get_child(0)->get_data() == NULL);
+    ensure_equals("TF037CHK003: Unexpected number of view nodes", schema_node->get_child(LiveSchemaTree::VIEWS_NODE_INDEX)->count(), 1);
+
+    // Filtering only creates a view on the stored tables...
+    _lst_filtered.set_base(&_lst);
+    _tester_filtered.enable_events(true);
+    _lst_filtered.set_filter("schema1.table*");
+    _lst_filtered.filter_data();
+
+    schema_node_f = _lst_filtered.get_node_for_object("schema1", LiveSchemaTree::Schema, "");
+    tables_node_f = schema_node_f->get_child(LiveSchemaTree::TABLES_NODE_INDEX);
+    ensure_equals("TF037CHK004: Unexpected number of filtered table nodes", tables_node_f->count(), 1);
+    ensure_equals("TF037CHK004: Unexpected number of filtered view nodes", schema_node_f->get_child(LiveSchemaTree::VIEWS_NODE_INDEX)->count(), 0);
+
+    // ... whose nodes are created on expansion, without creating them in the base tree.
+    _tester_filtered.expand_toggled(tables_node_f, true);
+    ensure_equals("TF037CHK005: Unexpected number of filtered table nodes", tables_node_f->count(), 3);
+    ensure_equals("TF037CHK005: Unexpected filtered table node", tables_node_f->get_child(1)->get_string(0), "table2");
+    ensure("TF037CHK005: Unexpected filtered table data", dynamic_cast<LiveSchemaTree::TableData*>(tables_node_f->get_child(1)->get_data()) != NULL);
+    ensure_equals("TF037CHK005: Unexpected number of table nodes", tables_node->count(), 1);
+
+    // Expanding the collection in the base tree creates all the table nodes.
+    _tester.expand_toggled(tables_node, true);
+    ensure_equals("TF037CHK006: Unexpected number of table nodes", tables_node->count(), 3);
+    ensure_equals("TF037CHK006: Unexpected table node", tables_node->get_child(2)->get_string(0), "table3");
+
+    // Objects created or dropped are kept in the store.
+    _lst.update_live_object_state(LiveSchemaTree::Table, "schema1", "", "table0");
+    _lst.update_live_object_state(LiveSchemaTree::Table, "schema1", "table2", "");
+    ensure_equals("TF037CHK007: Unexpected number of stored tables", pdata->objects[LiveSchemaTree::TABLES_NODE_INDEX].size(), 3U);
+    ensure_equals("TF037CHK007: Unexpected first stored table", pdata->objects[LiveSchemaTree::TABLES_NODE_INDEX][0], "table0");
+    ensure_equals("TF037CHK007: Unexpected number of table nodes", tables_node->count(), 3);
+    ensure_equals("TF037CHK007: Unexpected table node", tables_node->get_child(2)->get_string(0), "table3");
+  }
+
   END_TESTS
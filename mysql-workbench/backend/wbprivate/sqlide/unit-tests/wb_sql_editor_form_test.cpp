@@ -81,6 +81,16 @@ public:
     _form->get_live_tree()->fetch_foreign_key_data(schema_name, obj_name, object_type, updater_slot);
   }
 
+  void fetch_object_details(const std::string &schema_name, const std::string &obj_name, wb::LiveSchemaTree::ObjectType object_type, short flags)
+  {
+    _form->get_live_tree()->fetch_object_details(schema_name, obj_name, object_type, flags, updater_slot);
+  }
+
+  bool has_schema_details(const std::string &schema_name)
+  {
+    return _form->get_live_tree()->_schema_details.count(schema_name) > 0;
+  }
+
   void fetch_schema_contents(const std::string &schema_name)
   {
     _form->get_live_tree()->fetch_schema_contents(schema_name, schema_content_arrived_slot);
@@ -695,6 +705,40 @@ TEST_FUNCTION(6)
   ensure_equals("TF006CHK005 : Unexpected foreign key delete rule", pchild_data->referenced_table, "language");
 }
 
+// Testing for SqlEditorForm::fetch_object_details, which takes the data from the bulk fetched schema details.
+TEST_FUNCTION(7)
+{
+  mforms::TreeNodeRef table_node;
+  mforms::TreeNodeRef collection_node;
+  wb::LiveSchemaTree::TableData *pdata;
+
+  // Loads the schema list into the tree...
+  form_tester.tree_refresh();
+
+  // Loads a specific schema contents...
+  form_tester._check_id = "TF007CHK001";
+  form_tester.load_schema_data("wb_sql_editor_form_test");
+
+  // Loads the index data from the film table.
+  form_tester._expect_update_node_children = true;
+  form_tester._mock_propagate_update_node_children = true;
+  form_tester._check_id = "TF007CHK002";
+  form_tester.fetch_object_details("wb_sql_editor_form_test", "film", wb::LiveSchemaTree::Table, wb::LiveSchemaTree::INDEX_DATA);
+
+  ensure("TF007CHK003 : Schema details were not fetched", form_tester.has_schema_details("wb_sql_editor_form_test"));
+
+  table_node = form->get_live_tree()->get_schema_tree()->get_node_for_object("wb_sql_editor_form_test", wb::LiveSchemaTree::Table, "film");
+  pdata = dynamic_cast<wb::LiveSchemaTree::TableData*>(table_node->get_data());
+
+  ensure("TF007CHK004 : Indexes were not loaded", pdata->is_data_loaded(wb::LiveSchemaTree::INDEX_DATA));
+
+  // Same indexes in the same order as from SHOW INDEX.
+  collection_node = table_node->get_child(1);
+  ensure_equals("TF007CHK005 : Unexpected number of indexes", collection_node->count(), 4);
+  ensure_equals("TF007CHK006 : Unexpected index name", collection_node->get_child(0)->get_string(0), "PRIMARY");
+  ensure_equals("TF007CHK007 : Unexpected index name", collection_node->get_child(3)->get_string(0), "idx_fk_original_language_id");
+}
+
 TEST_FUNCTION(100)
 {
   // cleanup
@@ -28,6 +28,8 @@
 
 #include "mforms/app.h"
 #include <boost/make_shared.hpp>
+#include <algorithm>
+#include <iterator>
 
 using namespace wb;
 using namespace bec;
@@ -36,6 +38,9 @@ using namespace grt;
 
 DEFAULT_LOG_DOMAIN("SqlEditorSchemaTree");
 
+// Schema collections with more objects than this get their nodes only when they are expanded.
+#define MAX_EAGER_COLLECTION_NODES 1000
+
 const std::string LiveSchemaTree::SCHEMA_TAG = "_SCHEMA_";
 const std::string LiveSchemaTree::TABLES_TAG = "_TABLES_";
 const std::string LiveSchemaTree::VIEWS_TAG = "_VIEWS_";
@@ -476,7 +481,8 @@ std::string LiveSchemaTree::FunctionData::get_details(bool full, const mforms::T
 
 LiveSchemaTree::LiveSchemaTree(grt::GRT* grt)
 : _grt(grt), _model_view(NULL), _case_sensitive_identifiers(false), 
-_is_schema_contents_enabled(true), _enabled_events(false), _base(0), _filter_type(Any), _schema_pattern(0), _object_pattern(0)
+_is_schema_contents_enabled(true), _enabled_events(false), _base(0), _filter_type(Any), _schema_pattern(0), _object_pattern(0),
+_max_eager_nodes(MAX_EAGER_COLLECTION_NODES)
 {
   fill_node_icons();
   
@@ -846,10 +852,14 @@ bool LiveSchemaTree::update_node_children(mforms::TreeNodeRef parent, base::Stri
 {
   bool ret_val = false;
 
+  // Objects of a lazy collection in the base tree have no node there yet, their children
+  // are then only kept in this tree.
+  mforms::TreeNodeRef base_parent;
   if (_base)
+    base_parent = _base->get_node_from_path(get_node_path(parent), false);
+
+  if (base_parent)
   {
-    std::vector<std::string> path = get_node_path(parent);
-    mforms::TreeNodeRef base_parent = _base->get_node_from_path(path);
     ret_val = _base->update_node_children(base_parent, children, type, sorted, just_append);
 
     // Filters the arrived data
@@ -976,6 +986,228 @@ bool LiveSchemaTree::update_node_children(mforms::TreeNodeRef parent, base::Stri
   return ret_val;
 }
 
+//--------------------------------------------------------------------------------------------------
+
+/*
+ * The objects of a schema are kept in the flat store of its SchemaData. Nodes for them are only created
+ * for collections with few objects, or once a collection is expanded or one of its objects is looked up.
+ * Until then a lazy collection holds a single placeholder node (without data) so it can be expanded.
+ */
+int LiveSchemaTree::get_collection_index(const std::string& tag)
+{
+  if (tag == TABLES_TAG)
+    return TABLES_NODE_INDEX;
+  if (tag == VIEWS_TAG)
+    return VIEWS_NODE_INDEX;
+  if (tag == PROCEDURES_TAG)
+    return PROCEDURES_NODE_INDEX;
+  if (tag == FUNCTIONS_TAG)
+    return FUNCTIONS_NODE_INDEX;
+  return -1;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+LiveSchemaTree::ObjectType LiveSchemaTree::get_collection_object_type(int index)
+{
+  if (index == TABLES_NODE_INDEX)
+    return Table;
+  if (index == VIEWS_NODE_INDEX)
+    return View;
+  if (index == PROCEDURES_NODE_INDEX)
+    return Procedure;
+  if (index == FUNCTIONS_NODE_INDEX)
+    return Function;
+  return NoneType;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool LiveSchemaTree::is_lazy_collection(const mforms::TreeNodeRef& collection)
+{
+  return collection->count() == 1 && collection->get_child(0)->get_data() == NULL &&
+    get_collection_index(collection->get_tag()) >= 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/*
+ * Function: materialize_collection
+ * Description: Replaces the placeholder of a lazy collection by the nodes for its objects. A filtered
+ *              tree only creates nodes for the objects in the view computed on filtering.
+ */
+void LiveSchemaTree::materialize_collection(mforms::TreeNodeRef collection)
+{
+  if (!is_lazy_collection(collection))
+    return;
+
+  int index = get_collection_index(collection->get_tag());
+  mforms::TreeNodeRef schema_node = collection->get_parent();
+  SchemaData *pdata = dynamic_cast<SchemaData*>(schema_node->get_data());
+  if (!pdata)
+    return;
+
+  collection->remove_children();
+
+  ObjectType type = get_collection_object_type(index);
+  const std::vector<std::string> &objects = pdata->objects[index];
+  std::string schema_name = schema_node->get_string(0);
+
+  std::map<std::string, std::vector<std::vector<size_t> > >::const_iterator views = _object_views.find(schema_name);
+  if (_base && views != _object_views.end() && (size_t)index < views->second.size())
+  {
+    // Doesn't materialize the base collection, objects without base node get their own data.
+    mforms::TreeNodeRef source;
+    if (_base->_model_view)
+    {
+      mforms::TreeNodeRef base_schema_node = _base->get_child_node(_base->_model_view->root_node(), schema_name);
+      if (base_schema_node)
+        source = base_schema_node->get_child(index);
+    }
+    add_filtered_objects(type, source, collection, objects, views->second[index]);
+  }
+  else
+  {
+    _node_collections[type].captions.assign(objects.begin(), objects.end());
+    std::vector<mforms::TreeNodeRef> added_nodes = collection->add_node_collection(_node_collections[type]);
+    for (size_t node_index = 0; node_index < added_nodes.size(); node_index++)
+      setup_node(added_nodes[node_index], type);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/*
+ * Function: update_schema_collection
+ * Description: Stores the received object names for a schema collection and updates its nodes. Nodes
+ *              are only created if the collection has them already, is small or is expanded.
+ */
+void LiveSchemaTree::update_schema_collection(mforms::TreeNodeRef& schema_node, int index,
+  base::StringListPtr objects, bool just_append)
+{
+  SchemaData *pdata = dynamic_cast<SchemaData*>(schema_node->get_data());
+  mforms::TreeNodeRef collection = schema_node->get_child(index);
+
+  // The store is kept in the same order as the nodes.
+  boost::function<bool (const std::string&, const std::string&)> less =
+    boost::bind(base::stl_string_compare, _1, _2, _case_sensitive_identifiers);
+  std::vector<std::string> names(objects->begin(), objects->end());
+  std::sort(names.begin(), names.end(), less);
+
+  std::vector<std::string> &stored = pdata->objects[index];
+  if (just_append)
+  {
+    std::vector<std::string> merged;
+    merged.reserve(stored.size() + names.size());
+    std::set_union(stored.begin(), stored.end(), names.begin(), names.end(), std::back_inserter(merged), less);
+    stored.swap(merged);
+  }
+  else
+    stored.swap(names);
+
+  bool lazy = is_lazy_collection(collection);
+  if (!lazy && (collection->count() > 0 || stored.size() <= _max_eager_nodes))
+  {
+    //We need to duplicate the data, because it's being changed inside update_node_children
+    //and we can't do this because it's shared between threads
+    update_node_children(collection, boost::make_shared<StringList>(*objects), get_collection_object_type(index),
+      true, just_append);
+  }
+  else
+  {
+    if (!lazy && !stored.empty())
+      collection->add_child()->set_string(0, FETCHING_CAPTION);
+    else if (lazy && stored.empty())
+      collection->remove_children();
+
+    if (stored.size() <= _max_eager_nodes || collection->is_expanded())
+      materialize_collection(collection);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/*
+ * Function: update_schema_objects
+ * Description: Applies the creation (no old name), drop (no new name) or rename of an object to the
+ *              object store of its schema.
+ */
+void LiveSchemaTree::update_schema_objects(const mforms::TreeNodeRef& schema_node, ObjectType type,
+  const std::string& old_name, const std::string& new_name)
+{
+  int index;
+  switch (type)
+  {
+  case Table:
+    index = TABLES_NODE_INDEX;
+    break;
+  case View:
+    index = VIEWS_NODE_INDEX;
+    break;
+  case Procedure:
+    index = PROCEDURES_NODE_INDEX;
+    break;
+  case Function:
+    index = FUNCTIONS_NODE_INDEX;
+    break;
+  default:
+    return;
+  }
+
+  SchemaData *pdata = dynamic_cast<SchemaData*>(schema_node->get_data());
+  if (!pdata)
+    return;
+
+  boost::function<bool (const std::string&, const std::string&)> less =
+    boost::bind(base::stl_string_compare, _1, _2, _case_sensitive_identifiers);
+  std::vector<std::string> &objects = pdata->objects[index];
+
+  if (!old_name.empty())
+  {
+    std::vector<std::string>::iterator position = std::lower_bound(objects.begin(), objects.end(), old_name, less);
+    if (position != objects.end() && identifiers_equal(*position, old_name))
+      objects.erase(position);
+  }
+
+  if (!new_name.empty())
+  {
+    std::vector<std::string>::iterator position = std::lower_bound(objects.begin(), objects.end(), new_name, less);
+    if (position == objects.end() || !identifiers_equal(*position, new_name))
+      objects.insert(position, new_name);
+  }
+
+  // A lazy collection without objects must not be expandable anymore.
+  mforms::TreeNodeRef collection = schema_node->get_child(index);
+  if (objects.empty() && is_lazy_collection(collection))
+    collection->remove_children();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void LiveSchemaTree::enable_events(bool enable)
+{
+  _enabled_events = enable;
+
+  // Collections expanded while the events were disabled (e.g. from the filtered tree) get their nodes now.
+  if (enable && _model_view)
+  {
+    mforms::TreeNodeRef root = _model_view->root_node();
+    for (int schema_index = 0; schema_index < root->count(); schema_index++)
+    {
+      mforms::TreeNodeRef schema_node = root->get_child(schema_index);
+      if (!dynamic_cast<SchemaData*>(schema_node->get_data()))
+        continue;
+
+      for (int index = TABLES_NODE_INDEX; index <= FUNCTIONS_NODE_INDEX && index < schema_node->count(); index++)
+      {
+        mforms::TreeNodeRef collection = schema_node->get_child(index);
+        if (collection->is_expanded())
+          materialize_collection(collection);
+      }
+    }
+  }
+}
+
 std::string LiveSchemaTree::get_field_description(const mforms::TreeNodeRef& node)
 {
   std::string text("");
@@ -1084,6 +1316,16 @@ void LiveSchemaTree::set_active_schema(const std::string &schema)
 
 void LiveSchemaTree::update_live_object_state(ObjectType type, const std::string &schema_name, const std::string &old_obj_name, const std::string &new_obj_name)
 {
+  // A filtered tree shares the object store with the base tree, so the change is done there
+  // and the filter applied again.
+  if (_base)
+  {
+    _base->update_live_object_state(type, schema_name, old_obj_name, new_obj_name);
+    if (_model_view)
+      filter_data();
+    return;
+  }
+
   if (_model_view)
   {
     mforms::TreeNodeRef schema_node;
@@ -1109,6 +1351,9 @@ void LiveSchemaTree::update_live_object_state(ObjectType type, const std::string
 
       if (schema_node)
       {
+        // Lazy collections have no object nodes, for them only the store is updated.
+        update_schema_objects(schema_node, type, old_obj_name, new_obj_name);
+
         mforms::TreeNodeRef object_node;
         if (!created)
         {
@@ -1168,7 +1413,7 @@ void LiveSchemaTree::update_live_object_state(ObjectType type, const std::string
               break;
             }
             
-            if (parent_node)
+            if (parent_node && !is_lazy_collection(parent_node))
               insert_node(parent_node, new_obj_name, type);
           }
           else
@@ -1212,12 +1457,10 @@ void LiveSchemaTree::schema_contents_arrived(const std::string &schema_name,
           int old_table_count = tables_node->count();
           int old_view_count = tables_node->count();
           
-          //We need to duplicate the data, because it's being changed inside update_node_children
-          //and we can't do this because it's shared between threads
-          update_node_children(tables_node, boost::make_shared<StringList>(*tables), Table, true, just_append);
-          update_node_children(views_node, boost::make_shared<StringList>(*views), View, true, just_append);
-          update_node_children(procedures_node, boost::make_shared<StringList>(*procedures), Procedure,true, just_append);
-          update_node_children(functions_node, boost::make_shared<StringList>(*functions), Function, true, just_append);
+          update_schema_collection(schema_node, TABLES_NODE_INDEX, tables, just_append);
+          update_schema_collection(schema_node, VIEWS_NODE_INDEX, views, just_append);
+          update_schema_collection(schema_node, PROCEDURES_NODE_INDEX, procedures, just_append);
+          update_schema_collection(schema_node, FUNCTIONS_NODE_INDEX, functions, just_append);
           
 
           // If there were nodes that means this is a refresh, in such case loaded tables
@@ -1399,23 +1642,30 @@ mforms::TreeNodeRef LiveSchemaTree::get_node_for_object(const std::string &schem
         object_node = schema_node;
       else
       {
+        mforms::TreeNodeRef collection_node;
         switch(type)
         {
         case Table:
-          object_node = get_child_node(schema_node->get_child(TABLES_NODE_INDEX), name);
+          collection_node = schema_node->get_child(TABLES_NODE_INDEX);
           break;
         case View:
-          object_node = get_child_node(schema_node->get_child(VIEWS_NODE_INDEX), name);
+          collection_node = schema_node->get_child(VIEWS_NODE_INDEX);
           break;
         case Procedure:
-          object_node = get_child_node(schema_node->get_child(PROCEDURES_NODE_INDEX), name, type);
+          collection_node = schema_node->get_child(PROCEDURES_NODE_INDEX);
           break;
         case Function:
-          object_node = get_child_node(schema_node->get_child(FUNCTIONS_NODE_INDEX), name, type);
+          collection_node = schema_node->get_child(FUNCTIONS_NODE_INDEX);
           break;
         default:
           break;
         }
+
+        if (collection_node)
+        {
+          materialize_collection(collection_node);
+          object_node = get_child_node(collection_node, name, is_object_type(RoutineObject, type) ? type : Any);
+        }
       }
     }
   }
@@ -1460,7 +1710,12 @@ mforms::TreeNodeRef LiveSchemaTree::create_node_for_object(const std::string &sc
     }
 
     if (parent_node)
+    {
+      materialize_collection(parent_node);
       object_node = insert_node(parent_node, name, type);
+      if (object_node && !_base)
+        update_schema_objects(schema_node, type, "", name);
+    }
     else if (created_schema)
       schema_node->remove_from_parent();
   }
@@ -1697,6 +1952,19 @@ bec::MenuItemList LiveSchemaTree::get_popup_items_for_nodes(const std::list<mfor
       view_item.name= "select_data";
       view_item.enabled= !nodes.empty() && (nodes.size() == 1 || (type == TableColumn || type == ViewColumn));
       items.push_back(view_item);
+
+      bec::MenuItem export_item;
+      export_item.caption= _("Export Data to File...");
+      export_item.name= "export_data";
+      export_item.enabled= !nodes.empty();
+      for (std::list<mforms::TreeNodeRef>::const_iterator node = nodes.begin(); node != nodes.end(); ++node)
+      {
+        LSTData* pdata = dynamic_cast<LSTData*>((*node)->get_data());
+        if (!pdata || (pdata->get_type() != Table && pdata->get_type() != View))
+          export_item.enabled= false;
+      }
+      items.push_back(export_item);
+
       bec::MenuItem item;
       item.type= MenuSeparator;
       item.name = "builtins_separator"; // this indicates where plugins should start adding their menu items
@@ -1751,6 +2019,20 @@ bool LiveSchemaTree::activate_popup_item_for_nodes(const std::string &name, cons
       delegate->tree_activate_objects("filter", changes);
       return true;
     }
+    else if (name == "export_data")
+    {
+      for (std::list<mforms::TreeNodeRef>::const_iterator node = unsorted_nodes.begin(); node != unsorted_nodes.end(); ++node)
+      {
+        LSTData* pdata = dynamic_cast<LSTData*>((*node)->get_data());
+        if (pdata && (pdata->get_type() == Table || pdata->get_type() == View))
+        {
+          ChangeRecord record = { pdata->get_type(), get_schema_name(*node), (*node)->get_string(0), "" };
+          changes.push_back(record);
+        }
+      }
+      delegate->tree_activate_objects(name, changes);
+      return true;
+    }
     else if (name == "select_data")
     {
       std::list<mforms::TreeNodeRef>::const_iterator index, end = unsorted_nodes.end();
@@ -1893,6 +2175,7 @@ void LiveSchemaTree::filter_data()
 
   // Removes all the objects on the target tree
   _model_view->clear();
+  _object_views.clear();
 
   mforms::TreeNodeRef base_root = _base->_model_view->root_node();
   mforms::TreeNodeRef this_root = _model_view->root_node();
@@ -1923,21 +2206,11 @@ void LiveSchemaTree::filter_children_collection(mforms::TreeNodeRef& source, mfo
     {
     case Schema:
       {
-        source_collection = source->get_child(TABLES_NODE_INDEX);
-        target_collection = target->get_child(TABLES_NODE_INDEX);
-        bool found_tables   = filter_children(Table,   source_collection, target_collection, _object_pattern);
-
-        source_collection = source->get_child(VIEWS_NODE_INDEX);
-        target_collection = target->get_child(VIEWS_NODE_INDEX);
-        bool found_views    = filter_children(View,    source_collection, target_collection, _object_pattern);
-
-        source_collection = source->get_child(PROCEDURES_NODE_INDEX);
-        target_collection = target->get_child(PROCEDURES_NODE_INDEX);
-        bool found_procedures = filter_children(Procedure, source_collection, target_collection, _object_pattern);
-
-        source_collection = source->get_child(FUNCTIONS_NODE_INDEX);
-        target_collection = target->get_child(FUNCTIONS_NODE_INDEX);
-        bool found_functions = filter_children(Function, source_collection, target_collection, _object_pattern);
+        // The schema objects are filtered from the object store, not from the source nodes.
+        bool found_tables = filter_schema_collection(TABLES_NODE_INDEX, source, target);
+        bool found_views = filter_schema_collection(VIEWS_NODE_INDEX, source, target);
+        bool found_procedures = filter_schema_collection(PROCEDURES_NODE_INDEX, source, target);
+        bool found_functions = filter_schema_collection(FUNCTIONS_NODE_INDEX, source, target);
 
         if (_object_pattern && !(found_tables || found_views || found_procedures || found_functions))
           target->remove_from_parent();
@@ -1968,6 +2241,99 @@ void LiveSchemaTree::filter_children_collection(mforms::TreeNodeRef& source, mfo
     }
   }
 }
+/*
+*  filter_schema_collection: computes the positions of the objects matching the object filter in the store of
+*                            the schema for the given collection. Nodes are created for them right away only
+*                            if there are few or the source collection is expanded.
+*/
+bool LiveSchemaTree::filter_schema_collection(int index, mforms::TreeNodeRef& source, mforms::TreeNodeRef& target)
+{
+  SchemaData* pdata = dynamic_cast<SchemaData*>(source->get_data());
+  mforms::TreeNodeRef source_collection = source->get_child(index);
+  mforms::TreeNodeRef target_collection = target->get_child(index);
+
+  std::vector<std::vector<size_t> > &views = _object_views[source->get_string(0)];
+  views.resize(FUNCTIONS_NODE_INDEX + 1);
+  std::vector<size_t> &view = views[index];
+  view.clear();
+
+  if (pdata)
+  {
+    const std::vector<std::string> &objects = pdata->objects[index];
+    for (size_t position = 0; position < objects.size(); position++)
+    {
+      if (!_object_pattern || g_pattern_match_string(_object_pattern, base::toupper(objects[position]).c_str()))
+        view.push_back(position);
+    }
+
+    target_collection->remove_children();
+    if (!view.empty())
+    {
+      if (view.size() <= _max_eager_nodes || source_collection->is_expanded())
+        add_filtered_objects(get_collection_object_type(index), source_collection, target_collection, objects, view);
+      else
+        target_collection->add_child()->set_string(0, FETCHING_CAPTION);
+    }
+  }
+
+  if (source_collection->is_expanded() != target_collection->is_expanded())
+  {
+    if (source_collection->is_expanded())
+      target_collection->expand();
+    else
+      target_collection->collapse();
+  }
+
+  return !view.empty();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/*
+*  add_filtered_objects: creates the nodes for the objects in the view, sharing the data and copying the
+*                        contents of the source nodes where the source collection has nodes already
+*/
+void LiveSchemaTree::add_filtered_objects(ObjectType type, const mforms::TreeNodeRef& source, mforms::TreeNodeRef& target,
+  const std::vector<std::string>& objects, const std::vector<size_t>& view)
+{
+  _node_collections[type].captions.clear();
+  for (std::vector<size_t>::const_iterator position = view.begin(); position != view.end(); ++position)
+  {
+    if (*position < objects.size())
+      _node_collections[type].captions.push_back(objects[*position]);
+  }
+
+  std::vector<mforms::TreeNodeRef> added_nodes = target->add_node_collection(_node_collections[type]);
+
+  bool source_materialized = source && !is_lazy_collection(source);
+  for (size_t index = 0; index < added_nodes.size(); index++)
+  {
+    mforms::TreeNodeRef source_node;
+    if (source_materialized)
+      source_node = get_child_node(source, added_nodes[index]->get_string(0), type);
+
+    if (!source_node)
+    {
+      setup_node(added_nodes[index], type);
+      continue;
+    }
+
+    setup_node(added_nodes[index], type, source_node->get_data(), true);
+    if (type == Table || type == View)
+      filter_children_collection(source_node, added_nodes[index]);
+
+    if (source_node->is_expanded() != added_nodes[index]->is_expanded())
+    {
+      if (source_node->is_expanded())
+        added_nodes[index]->expand();
+      else
+        added_nodes[index]->collapse();
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
 /*
 *  filter_children: will create duplicate objects in target for the children in source matching the given pattern
 *                   if no pattern is specified, all the children will be cuplicated
@@ -2256,6 +2622,8 @@ void LiveSchemaTree::expand_toggled(mforms::TreeNodeRef node, bool value)
           load_table_details(parent, TRIGGER_DATA);
         else if (node_tag == FOREIGN_KEYS_TAG)
           load_table_details(parent, FK_DATA);
+        else
+          materialize_collection(node);
       }
     }
 
@@ -2264,11 +2632,14 @@ void LiveSchemaTree::expand_toggled(mforms::TreeNodeRef node, bool value)
     if (_base)
     {
       std::vector<std::string> path = get_node_path(node);
-      mforms::TreeNodeRef base_node = _base->get_node_from_path(path);
-      if (value)
-        base_node->expand();
-      else
-        base_node->collapse();
+      mforms::TreeNodeRef base_node = _base->get_node_from_path(path, false);
+      if (base_node)
+      {
+        if (value)
+          base_node->expand();
+        else
+          base_node->collapse();
+      }
     }
   }
 }
@@ -2446,8 +2817,9 @@ std::vector<std::string> LiveSchemaTree::get_node_path(const mforms::TreeNodeRef
 * TODO: This will not work in the case of the routines, as there's no way to know if the path is
 *       for a procedure or for a function, on this case a sequential search will be done so
 *       procedures will be searched first all the time
+*       Lazy collections on the way are materialized unless materialize is false.
 */
-mforms::TreeNodeRef LiveSchemaTree::get_node_from_path(std::vector<std::string> path)
+mforms::TreeNodeRef LiveSchemaTree::get_node_from_path(std::vector<std::string> path, bool materialize)
 {
   mforms::TreeNodeRef temp_node = _model_view->root_node();
   size_t index = 0;
@@ -2464,6 +2836,10 @@ mforms::TreeNodeRef LiveSchemaTree::get_node_from_path(std::vector<std::string>
       
       // Uses binary search only on the db object collection nodes
       std::string tag = temp_node->get_tag();
+
+      // Objects in lazy collections only have nodes after materializing the collection
+      if (materialize && index < path.size())
+        materialize_collection(temp_node);
       
       use_binary_search = (tag == TABLES_TAG ||
                            tag == VIEWS_TAG );
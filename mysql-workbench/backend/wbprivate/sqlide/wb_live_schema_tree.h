@@ -295,6 +295,10 @@ namespace wb
       bool fetched;
       bool fetching;
 
+      // Flat store of the schema objects: the sorted names for each collection (TABLES_NODE_INDEX...).
+      // Nodes are created from it only when needed, see LiveSchemaTree::materialize_collection.
+      std::vector<std::string> objects[4];
+
       virtual void copy(LSTData* other);
       virtual ObjectType get_type() {return LiveSchemaTree::Schema; }
       virtual std::string get_object_name() { return _("Schema"); }
@@ -359,7 +363,20 @@ namespace wb
     void filter_children_collection(mforms::TreeNodeRef& source, mforms::TreeNodeRef& target);
     bool filter_children(ObjectType type, mforms::TreeNodeRef& source, mforms::TreeNodeRef& target,
       GPatternSpec* pattern = NULL);
+    bool filter_schema_collection(int index, mforms::TreeNodeRef& source, mforms::TreeNodeRef& target);
+    void add_filtered_objects(ObjectType type, const mforms::TreeNodeRef& source, mforms::TreeNodeRef& target,
+      const std::vector<std::string>& objects, const std::vector<size_t>& view);
     bool is_object_type(ObjectTypeValidation validation, ObjectType type);
+
+    // Lazy schema collections (tables, views, procedures, functions)
+    static int get_collection_index(const std::string& tag);
+    static ObjectType get_collection_object_type(int index);
+    bool is_lazy_collection(const mforms::TreeNodeRef& collection);
+    void materialize_collection(mforms::TreeNodeRef collection);
+    void update_schema_collection(mforms::TreeNodeRef& schema_node, int index, base::StringListPtr objects,
+      bool just_append);
+    void update_schema_objects(const mforms::TreeNodeRef& schema_node, ObjectType type,
+      const std::string& old_name, const std::string& new_name);
   public:
     LiveSchemaTree(grt::GRT* grtm);
     virtual ~LiveSchemaTree();
@@ -419,8 +436,8 @@ namespace wb
     void set_case_sensitive_identifiers(bool flag);
     std::string get_schema_name(const mforms::TreeNodeRef& node);
     std::vector<std::string> get_node_path(const mforms::TreeNodeRef& node);
-    mforms::TreeNodeRef get_node_from_path(std::vector<std::string> path);
-    void enable_events(bool enable) { _enabled_events = enable; }
+    mforms::TreeNodeRef get_node_from_path(std::vector<std::string> path, bool materialize = true);
+    void enable_events(bool enable);
 
 
   private:
@@ -434,6 +451,12 @@ namespace wb
     GPatternSpec* _object_pattern;
     LSTData *notify_on_reload_data;
 
+    // Collections with more objects than this only get their nodes when expanded.
+    size_t _max_eager_nodes;
+
+    // For each filtered schema the positions of the matching objects in SchemaData::objects, by collection.
+    std::map<std::string, std::vector<std::vector<size_t> > > _object_views;
+
     static const char* _schema_tokens[16];
     
     std::map<ObjectType, std::string> _icon_paths;
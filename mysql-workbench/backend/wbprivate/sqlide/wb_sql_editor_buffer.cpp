@@ -751,10 +751,7 @@ void SqlEditorForm::open_file(const std::string &path, bool in_new_tab, bool ask
     {
       if (in_new_tab)
         remove_sql_editor(panel);
-      grt::BaseListRef args(_grtm->get_grt());
-      args.ginsert(grtobj());
-      args.ginsert(grt::StringRef(file_path));
-      _grtm->get_grt()->call_module_function("SQLIDEUtils", "runSQLScriptFile", args);
+      run_sql_script_file(file_path);
       return;
     }
   }
@@ -28,6 +28,7 @@
 
 #include "sqlide/recordset_be.h"
 #include "sqlide/recordset_cdbc_storage.h"
+#include "sqlide/recordset_text_storage.h"
 #include "sqlide/wb_sql_editor_snippets.h"
 #include "sqlide/wb_sql_editor_panel.h"
 #include "sqlide/wb_sql_editor_result_panel.h"
@@ -70,8 +71,11 @@
 #include "mforms/code_editor.h"
 
 #include "grtsqlparser/mysql_parser_services.h"
+#include "mysql-statement-splitter.h"
+#include "mysql-scanner.h"
 
 #include <math.h>
+#include <set>
 
 using namespace bec;
 using namespace grt;
@@ -266,6 +270,7 @@ SqlEditorForm::SqlEditorForm(wb::WBContextSQLIDE *wbsql)
   _column_width_cache(NULL),
   exec_sql_task(GrtThreadedTask::create(_grtm)),
   _is_running_query(false),
+  _abort_script_file_run(false),
   _live_tree(SqlEditorTreeController::create(this)),
   _side_palette_host(NULL),
   _side_palette(NULL),
@@ -592,6 +597,7 @@ grt::StringRef SqlEditorForm::do_disconnect(grt::GRT *grt)
       _aux_dbc_conn->ref.reset();
     }
   }
+  close_export_connections();
 
   return grt::StringRef();
 }
@@ -675,6 +681,9 @@ void SqlEditorForm::close()
   _grtm->replace_status_text("Closing SQL Editor...");
   wbsql()->editor_will_close(this);
 
+  cancel_data_export();
+  wait_for_data_export();
+
   exec_sql_task->exec(true, boost::bind(&SqlEditorForm::do_disconnect, this, _1));
   exec_sql_task->disconnect_callbacks();
   reset_keep_alive_thread();
@@ -1684,6 +1693,327 @@ RecMutexLock SqlEditorForm::ensure_valid_dbc_connection(sql::Dbc_connection_hand
 }
 
 
+//--------------------------------------------------------------------------------------------------
+
+struct SqlEditorForm::DataExport
+{
+  std::vector<DataExportJob> jobs;
+  std::string format;
+  std::string schema; // Default schema for new export connections.
+  bool compress;
+  bool treat_binary_as_text; // App options are read here, not in the export threads.
+  double start_time;
+  std::vector<GThread*> threads;
+
+  base::Mutex mutex; // Protects the members below, they are changed by the export threads.
+  size_t next_job;
+  size_t running_threads;
+  size_t exported_rows;
+  std::set<boost::int64_t> busy_connections; // Ids of the connections running an export query.
+  std::vector<std::string> errors;
+  bool cancelled;
+
+  DataExport()
+  : compress(false), treat_binary_as_text(false), start_time(0), next_job(0), running_threads(0), exported_rows(0), cancelled(false)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Starts exporting the results of the given queries to their files, in background threads. Up to
+ * DbSqlEditor:DataExportConnections queries are exported at the same time, each on its own connection.
+ * The outcome is shown in the status bar and the output log once all of them are done.
+ */
+void SqlEditorForm::export_data(const std::vector<DataExportJob> &jobs, const std::string &format, bool compress)
+{
+  if (_data_export)
+    throw std::runtime_error(_("Another data export is still running, please wait until it has finished."));
+  if (!Recordset_text_storage::supports_direct_export(_grtm, format))
+    throw std::invalid_argument(strfmt(_("Data can't be exported as %s directly from the server."), format.c_str()));
+  if (jobs.empty())
+    return;
+
+  _data_export.reset(new DataExport());
+  _data_export->jobs = jobs;
+  _data_export->format = format;
+  _data_export->schema = active_schema();
+  _data_export->compress = compress;
+  _data_export->treat_binary_as_text = _grtm->get_app_option_int("DbSqlEditor:MySQL:TreatBinaryAsText", 0) != 0;
+  _data_export->start_time = timestamp();
+
+  // Done here once, as ctemplate doesn't protect its modifier registry against the export threads.
+  Recordset_text_storage::register_template_modifiers();
+
+  long max_connections = std::max(_grtm->get_app_option_int("DbSqlEditor:DataExportConnections", 4), 1L);
+  size_t thread_count = std::min(jobs.size(), (size_t)max_connections);
+  _data_export->running_threads = thread_count;
+  for (size_t i = 0; i < thread_count; ++i)
+  {
+    GError *error = NULL;
+    GThread *thread = base::create_thread(&SqlEditorForm::data_export_thread, this, &error, "Data Export");
+    if (thread)
+    {
+      _data_export->threads.push_back(thread);
+      continue;
+    }
+
+    log_error("Could not create data export thread: %s\n", error ? error->message : "unknown error");
+    if (error)
+      g_error_free(error);
+
+    bool finished;
+    {
+      MutexLock lock(_data_export->mutex);
+      finished = --_data_export->running_threads == 0;
+    }
+    if (finished)
+    {
+      if (_data_export->threads.empty())
+      {
+        _data_export.reset();
+        throw std::runtime_error(_("Could not start the data export."));
+      }
+      _grtm->run_once_when_idle(this, boost::bind(&SqlEditorForm::data_export_finished, this));
+    }
+  }
+
+  _grtm->replace_status_text(strfmt(_("Exporting data of %i queries..."), (int)jobs.size()));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Stops the running data export. Queries which are still running or sending rows are killed.
+ */
+void SqlEditorForm::cancel_data_export()
+{
+  if (!_data_export)
+    return;
+
+  std::set<boost::int64_t> busy_connections;
+  {
+    MutexLock lock(_data_export->mutex);
+    _data_export->cancelled = true;
+    busy_connections = _data_export->busy_connections;
+  }
+
+  db_mgmt_RdbmsRef rdbms= db_mgmt_RdbmsRef::cast_from(_connection->driver()->owner());
+  Sql_specifics::Ref sql_specifics= SqlFacade::instance_for_rdbms(rdbms)->sqlSpecifics();
+  BOOST_FOREACH (boost::int64_t id, busy_connections)
+  {
+    std::string query_kill_query= sql_specifics->query_kill_query(id);
+    if (query_kill_query.empty())
+      continue;
+    try
+    {
+      RecMutexLock aux_dbc_conn_mutex(ensure_valid_aux_connection());
+      std::auto_ptr<sql::Statement> stmt(_aux_dbc_conn->ref->createStatement());
+      stmt->execute(query_kill_query);
+    }
+    catch (std::exception &exc)
+    {
+      log_warning("Could not stop data export query on connection %li: %s\n", (long)id, exc.what());
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+gpointer SqlEditorForm::data_export_thread(gpointer data)
+{
+  static_cast<SqlEditorForm*>(data)->export_data_w();
+  return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Worker thread part of the data export. Takes jobs until there are none left. The export state stays
+ * alive until all threads have been joined (in data_export_finished() or on close).
+ */
+void SqlEditorForm::export_data_w()
+{
+  DataExport &state(*_data_export);
+  for (;;)
+  {
+    DataExportJob job;
+    {
+      MutexLock lock(state.mutex);
+      if (state.cancelled || state.next_job >= state.jobs.size())
+        break;
+      job = state.jobs[state.next_job++];
+    }
+
+    sql::Dbc_connection_handler::Ref conn;
+    bool reusable = false;
+    try
+    {
+      conn = acquire_export_connection(state.schema);
+      {
+        MutexLock lock(state.mutex);
+        state.busy_connections.insert(conn->id);
+      }
+
+      Recordset_text_storage::Ref storage(Recordset_text_storage::create(_grtm));
+      storage->data_format(state.format);
+      storage->file_path(job.file_path);
+      storage->compress_output(state.compress);
+      storage->parameter_value("GENERATE_DATE", base::fmttime(time(NULL), DATETIME_FMT));
+      storage->parameter_value("TABLE_NAME", job.table_name.empty() ? "TABLE" : job.table_name);
+
+      {
+        std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
+        // unbuffered result (mysql_use_result), rows are passed on to the writer as they arrive
+        stmt->setResultSetType(sql::ResultSet::TYPE_FORWARD_ONLY);
+        std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery(job.query));
+
+        size_t reported_rows = 0;
+        size_t rows = storage->serialize_result_set(rs.get(), job.query, state.treat_binary_as_text,
+          boost::bind(&SqlEditorForm::data_export_progress, this, &reported_rows, _1));
+        data_export_progress(&reported_rows, rows);
+      }
+      reusable = true;
+    }
+    catch (grt::user_cancelled &)
+    {
+    }
+    catch (std::exception &exc)
+    {
+      MutexLock lock(state.mutex);
+      if (!state.cancelled)
+      {
+        log_error("Data export to %s failed: %s\n", job.file_path.c_str(), exc.what());
+        state.errors.push_back(strfmt("%s: %s", job.file_path.c_str(), exc.what()));
+      }
+    }
+
+    if (conn)
+    {
+      {
+        MutexLock lock(state.mutex);
+        state.busy_connections.erase(conn->id);
+      }
+
+      // A connection whose export failed or was cancelled might still have rows pending.
+      if (reusable)
+        release_export_connection(conn);
+      else
+        close_connection(conn);
+    }
+  }
+
+  bool finished;
+  {
+    MutexLock lock(state.mutex);
+    finished = --state.running_threads == 0;
+  }
+  if (finished)
+    _grtm->run_once_when_idle(this, boost::bind(&SqlEditorForm::data_export_finished, this));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool SqlEditorForm::data_export_progress(size_t *reported_rows, size_t rows)
+{
+  MutexLock lock(_data_export->mutex);
+  _data_export->exported_rows += rows - *reported_rows;
+  *reported_rows = rows;
+  return !_data_export->cancelled;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void SqlEditorForm::data_export_finished()
+{
+  if (!_data_export)
+    return;
+
+  boost::shared_ptr<DataExport> state(_data_export);
+  wait_for_data_export();
+
+  double duration = timestamp() - state->start_time;
+  std::string message;
+  if (state->cancelled)
+    message = strfmt(_("Data export cancelled after %lu rows"), (unsigned long)state->exported_rows);
+  else
+    message = strfmt(_("Exported %lu rows of %i queries in %.1fs (%.0f rows/s)"), (unsigned long)state->exported_rows,
+      (int)(state->jobs.size() - state->errors.size()), duration, duration > 0 ? state->exported_rows / duration : 0.0);
+  _grtm->replace_status_text(message);
+
+  if (!state->errors.empty())
+    message.append(strfmt(_(", %i failed:\n"), (int)state->errors.size())).append(base::join(state->errors, "\n"));
+  add_log_message(state->errors.empty() ? DbSqlEditorLog::OKMsg : DbSqlEditorLog::ErrorMsg, message,
+    _("Export data to files"), strfmt("%.3f sec", duration));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void SqlEditorForm::wait_for_data_export()
+{
+  if (!_data_export)
+    return;
+
+  BOOST_FOREACH (GThread *thread, _data_export->threads)
+    g_thread_join(thread);
+  _data_export.reset();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns an idle export connection or opens a new one.
+ */
+sql::Dbc_connection_handler::Ref SqlEditorForm::acquire_export_connection(const std::string &schema)
+{
+  // Also serializes opening new connections, which isn't meant to be done from several threads at once.
+  MutexLock lock(_export_connections_mutex);
+  while (!_export_connections.empty())
+  {
+    sql::Dbc_connection_handler::Ref conn(_export_connections.front());
+    _export_connections.pop_front();
+    try
+    {
+      if (conn->ref->isValid())
+        return conn;
+    }
+    catch (std::exception &exc)
+    {
+      log_debug("Dropping stale export connection: %s\n", exc.what());
+    }
+  }
+
+  sql::Dbc_connection_handler::Ref conn(new sql::Dbc_connection_handler());
+  conn->active_schema = schema;
+  create_connection(conn, _connection, sql::DriverManager::getDriverManager()->getTunnel(_connection), _dbc_auth,
+    true, false);
+  return conn;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void SqlEditorForm::release_export_connection(const sql::Dbc_connection_handler::Ref &conn)
+{
+  MutexLock lock(_export_connections_mutex);
+  _export_connections.push_back(conn);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void SqlEditorForm::close_export_connections()
+{
+  std::list<sql::Dbc_connection_handler::Ref> connections;
+  {
+    MutexLock lock(_export_connections_mutex);
+    connections.swap(_export_connections);
+  }
+  BOOST_FOREACH (sql::Dbc_connection_handler::Ref &conn, connections)
+    close_connection(conn);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 bool SqlEditorForm::auto_commit()
 {
   if (_usr_dbc_conn)
@@ -1979,6 +2309,9 @@ grt::StringRef SqlEditorForm::do_exec_sql(grt::GRT *grt, Ptr self_ptr, boost::sh
   int limit_rows = 0;
   if (_grtm->get_app_option_int("SqlEditor:LimitRows") != 0)
     limit_rows = _grtm->get_app_option_int("SqlEditor:LimitRowsCount", 0);
+  // results shown in an editor can be displayed while they are still being fetched,
+  // callers waiting for the complete result list get them at once
+  bool allow_streaming_fetch = (editor != NULL) && !result_list && (_grtm->get_app_option_int("SqlEditor:StreamingFetch", 1) != 0);
 
   _grtm->replace_status_text(_("Executing Query..."));
 
@@ -2067,11 +2400,18 @@ grt::StringRef SqlEditorForm::do_exec_sql(grt::GRT *grt, Ptr self_ptr, boost::sh
           _history->add_entry(statements);
         }
 
+        if (_auto_completion_cache != NULL)
+          _auto_completion_cache->add_recent_names(statement);
+
         Recordset_cdbc_storage::Ref data_storage;
+        bool streaming_fetch = false;
 
         // for select queries add limit clause if specified by global option
         if (!is_multiple_statement && (Sql_syntax_check::sql_select == statement_type))
         {
+          // performance schema stats are queried on the same connection before the rows are read
+          streaming_fetch = allow_streaming_fetch && !query_ps_stats;
+
           data_storage= Recordset_cdbc_storage::create(_grtm);
           data_storage->set_gather_field_info(true);
           data_storage->rdbms(rdbms());
@@ -2111,6 +2451,10 @@ grt::StringRef SqlEditorForm::do_exec_sql(grt::GRT *grt, Ptr self_ptr, boost::sh
           boost::shared_ptr<sql::Statement> dbc_statement(_usr_dbc_conn->ref->createStatement());
           bool is_result_set_first= false;
 
+          // unbuffered result (mysql_use_result), rows are read from the server as the grid is being filled
+          if (streaming_fetch)
+            dbc_statement->setResultSetType(sql::ResultSet::TYPE_FORWARD_ONLY);
+
           if (_usr_dbc_conn->is_stop_query_requested)
             throw std::runtime_error(_("Query execution has been stopped, the connection to the DB server was not restarted, any open transaction remains open"));
 
@@ -2300,6 +2644,7 @@ grt::StringRef SqlEditorForm::do_exec_sql(grt::GRT *grt, Ptr self_ptr, boost::sh
                     data_storage->dbc_statement(dbc_statement);
                     data_storage->dbc_resultset(dbc_resultset);
                     data_storage->reloadable(!is_multiple_statement && (Sql_syntax_check::sql_select == statement_type));
+                    data_storage->streaming_fetch(streaming_fetch);
 
                     Recordset::Ref rs= Recordset::create(exec_sql_task);
                     rs->is_field_value_truncation_enabled(true);
@@ -2317,17 +2662,32 @@ grt::StringRef SqlEditorForm::do_exec_sql(grt::GRT *grt, Ptr self_ptr, boost::sh
                     }
 
                     rs->data_storage(data_storage);
-                    rs->reset(true);
+                    if (streaming_fetch && editor)
+                      rs->fetch_started_cb = boost::bind(&SqlEditorPanel::add_panel_for_recordset_from_main, editor, rs);
+                    try
+                    {
+                      rs->reset(true);
+                    }
+                    catch (...)
+                    {
+                      rs->fetch_started_cb.clear();
+                      throw;
+                    }
+                    // the callback is consumed once the streaming fetch started showing rows
+                    bool panel_added = streaming_fetch && editor && rs->fetch_started_cb.empty();
+                    rs->fetch_started_cb.clear();
 
                     if (data_storage->valid()) // query statement
                     {
                       if (result_list)
                         result_list->push_back(rs);
 
-                      if (editor)
+                      if (editor && !panel_added)
                         editor->add_panel_for_recordset_from_main(rs);
 
                       std::string statement_res_msg = base::to_string(rs->row_count()) + _(" row(s) returned");
+                      if (data_storage->fetch_interrupted())
+                        statement_res_msg.append(_(", fetching was stopped by the user"));
                       if (!last_statement_info->empty())
                         statement_res_msg.append("\n").append(last_statement_info);
 
@@ -2825,6 +3185,117 @@ void SqlEditorForm::apply_object_alter_script(const std::string &alter_script, b
   }
 }
 
+
+/**
+ * Supplies the statements of a script file to the batch executor, reporting progress by bytes read.
+ */
+bool SqlEditorForm::next_script_file_statement(MySQLScriptReader *reader, std::string &statement, float &progress)
+{
+  if (_abort_script_file_run || !reader->next(statement))
+    return false;
+
+  if (reader->file_size() > 0)
+    progress = (float)((double)reader->bytes_consumed() / reader->file_size());
+  return true;
+}
+
+
+/**
+ * Statements sent together with others in one request must be complete single statements without
+ * a result set, so only plain DML qualifies.
+ */
+static bool is_batchable_statement(boost::shared_ptr<MySQLQueryIdentifier> identifier, const std::string &statement)
+{
+  if (!MySQLStatementSplitter::is_single_statement(statement.c_str(), statement.size()))
+    return false;
+
+  switch (identifier->getQueryType(statement.c_str(), statement.size(), true))
+  {
+    case QtInsert:
+    case QtUpdate:
+    case QtDelete:
+    case QtReplace:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+
+/**
+ * Executes the statements in the given script file. Statements are read, split and executed one by one,
+ * so memory use doesn't depend on the size of the file. Called by the script run wizard in a worker thread.
+ * A non-empty default schema is created if needed and selected before the script runs, a non-empty default
+ * character set is used for the connection while the script runs.
+ */
+void SqlEditorForm::apply_sql_script_file(const std::string &path, const std::string &default_schema,
+  const std::string &default_charset, boost::shared_ptr<MySQLQueryIdentifier> identifier, RowId log_id)
+{
+  set_log_message(log_id, DbSqlEditorLog::BusyMsg, "", strfmt(_("Running SQL script file %s..."), path.c_str()), "");
+
+  _abort_script_file_run = false;
+
+  sql::SqlBatchExec sql_batch_exec;
+  sql_batch_exec.stop_on_error(true);
+  sql_batch_exec.sql_log_enabled(false);
+  sql_batch_exec.multi_statement_batching(boost::bind(is_batchable_statement, identifier, _1));
+
+  sql_batch_exec.error_cb(boost::ref(on_sql_script_run_error));
+  sql_batch_exec.batch_exec_progress_cb(boost::ref(on_sql_script_run_progress));
+  sql_batch_exec.batch_exec_stat_cb(boost::ref(on_sql_script_run_statistics));
+
+  try
+  {
+    MySQLScriptReader reader(path);
+
+    RecMutexLock usr_dbc_conn_mutex(ensure_valid_usr_connection(true));
+    std::auto_ptr<sql::Statement> stmt(_usr_dbc_conn->ref->createStatement());
+
+    if (!default_schema.empty())
+    {
+      stmt->execute(std::string(base::sqlstring("CREATE SCHEMA IF NOT EXISTS !", 0) << default_schema));
+      _usr_dbc_conn->ref->setSchema(default_schema);
+    }
+
+    std::string previous_charset;
+    if (!default_charset.empty())
+    {
+      std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery("SELECT @@character_set_client"));
+      if (rs->next())
+        previous_charset = rs->getString(1);
+      stmt->execute(std::string(base::sqlstring("SET NAMES ?", 0) << default_charset));
+    }
+
+    {
+      // The script can change the default schema, so always update our copy of it, like USE in an editor does.
+      ScopeExitTrigger schedule_schema_update(boost::bind(&SqlEditorForm::cache_active_schema_name, this));
+      sql_batch_exec(stmt.get(), boost::bind(&SqlEditorForm::next_script_file_statement, this, &reader, _1, _2));
+    }
+
+    if (!previous_charset.empty())
+      stmt->execute(std::string(base::sqlstring("SET NAMES ?", 0) << previous_charset));
+  }
+  catch (sql::SQLException &e)
+  {
+    log_error("Exception running SQL script file: %s\n", e.what());
+    set_log_message(log_id, DbSqlEditorLog::ErrorMsg, strfmt(SQL_EXCEPTION_MSG_FORMAT, e.getErrorCode(), e.what()), strfmt(_("Run SQL script file %s"), path.c_str()), "");
+    throw;
+  }
+  catch (base::mutex_busy_error &)
+  {
+    log_error("usr connection busy running SQL script file\n");
+    set_log_message(log_id, DbSqlEditorLog::ErrorMsg, strfmt(EXCEPTION_MSG_FORMAT, "Your connection to MySQL is currently busy. Please retry later."), strfmt(_("Run SQL script file %s"), path.c_str()), "");
+    throw std::runtime_error("Connection to MySQL currently busy.");
+  }
+  catch (std::exception &e)
+  {
+    log_error("Exception running SQL script file: %s\n", e.what());
+    set_log_message(log_id, DbSqlEditorLog::ErrorMsg, strfmt(EXCEPTION_MSG_FORMAT, e.what()), strfmt(_("Run SQL script file %s"), path.c_str()), "");
+    throw;
+  }
+}
+
 void SqlEditorForm::apply_data_changes_commit(const std::string &sql_script_text, Recordset::Ptr rs_ptr, bool skip_commit)
 {
   RETURN_IF_FAIL_TO_RETAIN_WEAK_PTR (Recordset, rs_ptr, rs);
@@ -2874,14 +3345,12 @@ void SqlEditorForm::schema_meta_data_refreshed(const std::string &schema_name,
     _auto_completion_cache->update_tables(schema_name, tables);
     _auto_completion_cache->update_views(schema_name, views);
 
-    // Schedule a refresh of column info for all tables/views.
-    for (std::list<std::string>::const_iterator i = tables->begin(); i != tables->end(); ++i)
-      _auto_completion_cache->refresh_columns(schema_name, *i);
-    for (std::list<std::string>::const_iterator i = views->begin(); i != views->end(); ++i)
-      _auto_completion_cache->refresh_columns(schema_name, *i);
-
     _auto_completion_cache->update_procedures(schema_name, procedures);
     _auto_completion_cache->update_functions(schema_name, functions);
+
+    // Schedule a refresh of column info etc. for all tables/views. This is done in bulk and skipped
+    // if nothing changed in the schema.
+    _auto_completion_cache->refresh_schema_objects(schema_name);
   }
 }
 
@@ -62,6 +62,8 @@ class QuerySidePalette;
 class SqlEditorTreeController;
 class AutoCompleteCache;
 class ColumnWidthCache;
+class MySQLScriptReader;
+class MySQLQueryIdentifier;
 class SqlEditorPanel;
 class SqlEditorResult;
 
@@ -351,6 +353,36 @@ public:
   bool is_running_query();
 
   sql::Authentication::Ref dbc_auth_data() { return _dbc_auth; }
+
+public:
+  // Export of query results straight from the server to files: rows are read with an unbuffered cursor
+  // and passed on to the export writer, without a recordset in between. The queries of an export run in
+  // parallel, each on its own connection, taken from a pool of export connections.
+  struct DataExportJob
+  {
+    std::string query;
+    std::string table_name; // For the SQL INSERTs format.
+    std::string file_path;
+  };
+  void export_data(const std::vector<DataExportJob> &jobs, const std::string &format, bool compress);
+  bool is_exporting_data() const { return _data_export.get() != NULL; }
+  void cancel_data_export();
+
+private:
+  struct DataExport;
+  boost::shared_ptr<DataExport> _data_export;
+  std::list<sql::Dbc_connection_handler::Ref> _export_connections; // Idle ones.
+  base::Mutex _export_connections_mutex;
+
+  static gpointer data_export_thread(gpointer data);
+  void export_data_w();
+  bool data_export_progress(size_t *reported_rows, size_t rows);
+  void data_export_finished();
+  void wait_for_data_export();
+  sql::Dbc_connection_handler::Ref acquire_export_connection(const std::string &schema);
+  void release_export_connection(const sql::Dbc_connection_handler::Ref &conn);
+  void close_export_connections();
+
 private:
   enum ExecFlags { 
     NeedNonStdDelimiter = 1 << 1,
@@ -371,6 +403,7 @@ private:
   int on_exec_sql_finished();
   bool _is_running_query;
   bool _continue_on_error;
+  bool _abort_script_file_run;
   
 public:
   bool continue_on_error() { return _continue_on_error; }
@@ -392,9 +425,15 @@ private:
   int sql_script_stats(long, long);
 
   void abort_apply_object_alter_script();
+  void abort_sql_script_file();
+  bool next_script_file_statement(MySQLScriptReader *reader, std::string &statement, float &progress);
 public:
   void apply_object_alter_script(const std::string &alter_script, bec::DBObjectEditorBE* obj_editor, RowId log_id);
   bool run_live_object_alteration_wizard(const std::string &alter_script, bec::DBObjectEditorBE* obj_editor, RowId log_id, const std::string &log_context);
+  void apply_sql_script_file(const std::string &path, const std::string &default_schema,
+    const std::string &default_charset, boost::shared_ptr<MySQLQueryIdentifier> identifier, RowId log_id);
+  bool run_sql_script_file(const std::string &path);
+  void run_sql_script();
 
 private:
   void apply_changes_to_recordset(Recordset::Ptr rs_ptr);
@@ -37,11 +37,12 @@
 
 #include "base/log.h"
 
-//DEFAULT_LOG_DOMAIN("SqlEditor");
+DEFAULT_LOG_DOMAIN("SqlEditor");
 
 #include "mforms/menubar.h"
 #include "mforms/toolbar.h"
 #include "mforms/code_editor.h"
+#include "mforms/filechooser.h"
 
 using namespace bec;
 using namespace grt;
@@ -516,6 +517,95 @@ void SqlEditorForm::abort_apply_object_alter_script()
 }
 
 
+/**
+ * Runs a script file through the script run wizard without loading it into an editor, which is meant
+ * for files too large to edit (like big dumps).
+ */
+bool SqlEditorForm::run_sql_script_file(const std::string &path)
+{
+  on_sql_script_run_error.disconnect_all_slots();
+  on_sql_script_run_progress.disconnect_all_slots();
+  on_sql_script_run_statistics.disconnect_all_slots();
+
+  SqlScriptRunWizard wizard(_grtm, rdbms_version(), "", "");
+  scoped_connection c1(on_sql_script_run_error.connect(boost::bind(&SqlScriptApplyPage::on_error, wizard.apply_page, _1, _2, _3)));
+  scoped_connection c2(on_sql_script_run_progress.connect(boost::bind(&SqlScriptApplyPage::on_exec_progress, wizard.apply_page, _1)));
+  scoped_connection c3(on_sql_script_run_statistics.connect(boost::bind(&SqlScriptApplyPage::on_exec_stat, wizard.apply_page, _1, _2)));
+
+  std::string errors;
+  scoped_connection c4(on_sql_script_run_error.connect(boost::bind(&SqlEditorForm::sql_script_apply_error, this, _1, _2, _3, boost::ref(errors))));
+  scoped_connection c5(on_sql_script_run_progress.connect(boost::bind(&SqlEditorForm::sql_script_apply_progress, this, _1)));
+  scoped_connection c6(on_sql_script_run_statistics.connect(boost::bind(&SqlEditorForm::sql_script_stats, this, _1, _2)));
+
+  std::string log_context = strfmt(_("Run SQL script file %s"), path.c_str());
+  RowId log_id = add_log_message(DbSqlEditorLog::BusyMsg, _("Preparing..."), log_context, "");
+
+  std::vector<std::string> schemas;
+  try
+  {
+    sql::Dbc_connection_handler::Ref conn;
+    RecMutexLock aux_dbc_conn_mutex(ensure_valid_aux_connection(conn));
+    std::auto_ptr<sql::ResultSet> rs(conn->ref->getMetaData()->getSchemata());
+    while (rs->next())
+    {
+      std::string name = rs->getString(1);
+      if (name != "information_schema" && name != "performance_schema" && name != "mysql")
+        schemas.push_back(name);
+    }
+    std::sort(schemas.begin(), schemas.end());
+  }
+  catch (std::exception &exc)
+  {
+    // Not fatal, the schema name can still be typed in.
+    log_warning("Could not fetch schema list for running script file: %s\n", exc.what());
+  }
+
+  std::vector<std::string> charsets;
+  grt::ListRef<db_CharacterSet> charset_list = rdbms()->characterSets();
+  for (size_t i = 0; i < charset_list.count(); i++)
+    charsets.push_back(charset_list[i]->name());
+  std::sort(charsets.begin(), charsets.end());
+
+  wizard.set_script_file(path, schemas, charsets);
+  // The script runs in a background thread, where the work parser context must not be used.
+  boost::shared_ptr<MySQLQueryIdentifier> identifier = _work_parser_context->createQueryIdentifier();
+  wizard.apply_page->apply_sql_script_file = boost::bind(&SqlEditorForm::apply_sql_script_file, this, _1, _2, _3,
+    identifier, log_id);
+  wizard.abort_apply = boost::bind(&SqlEditorForm::abort_sql_script_file, this);
+  wizard.run_modal();
+
+  if (!wizard.applied())
+    set_log_message(log_id, DbSqlEditorLog::NoteMsg, _("Cancelled"), log_context, "");
+  else if (!wizard.has_errors())
+    set_log_message(log_id, DbSqlEditorLog::OKMsg, _("SQL script file executed"), log_context, "");
+  else
+    set_log_message(log_id, DbSqlEditorLog::ErrorMsg, errors, log_context, "");
+
+  return wizard.applied() && !wizard.has_errors();
+}
+
+
+/**
+ * Asks for a script file and runs it like run_sql_script_file does (File > Run SQL Script).
+ */
+void SqlEditorForm::run_sql_script()
+{
+  mforms::FileChooser chooser(mforms::OpenFile);
+  chooser.set_title(_("Run SQL Script"));
+  chooser.set_extensions("SQL Scripts (*.sql)|*.sql", "sql");
+  if (chooser.run_modal())
+    run_sql_script_file(chooser.get_path());
+}
+
+
+void SqlEditorForm::abort_sql_script_file()
+{
+  // Stop reading further statements and cancel the one currently running.
+  _abort_script_file_run = true;
+  cancel_query();
+}
+
+
 
 int SqlEditorForm::sql_script_apply_error(long long code, const std::string& msg, const std::string& stmt, std::string &errors)
 {
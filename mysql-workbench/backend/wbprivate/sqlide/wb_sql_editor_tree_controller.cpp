@@ -44,6 +44,8 @@
 #include "grtdb/editor_table.h"
 #include "grtdb/db_helpers.h"
 #include "grtsqlparser/sql_facade.h"
+#include "sqlide/autocomplete_object_name_cache.h"
+#include "sqlide/recordset_text_storage.h"
 
 #include "workbench/wb_db_schema.h"
 
@@ -58,6 +60,7 @@
 #include "mforms/panel.h"
 #include "mforms/menubar.h"
 #include "mforms/utilities.h"
+#include "mforms/filechooser.h"
 
 using namespace grt;
 using namespace bec;
@@ -105,6 +108,37 @@ catch (std::exception &e)\
 _grtm->get_grt()->send_error(strfmt(EXCEPTION_MSG_FORMAT, e.what()), statement);\
 }
 
+// Details of the tables and views in a schema are fetched in bulk and kept this long (in seconds),
+// unless the schema is refreshed earlier.
+#define SCHEMA_DETAILS_LIFETIME 60
+
+// Schemas with more tables and views than this get their details fetched per object.
+#define MAX_BULK_DETAILS_OBJECTS 5000
+
+/**
+ * Columns, indexes, triggers and foreign keys of all tables and views in a schema, read with a few
+ * information_schema queries instead of several SHOW statements per object.
+ * Only objects with columns are listed. Others (e.g. broken views or objects created after the fetch)
+ * are loaded singly.
+ */
+struct SqlEditorTreeController::SchemaDetails
+{
+  struct ObjectDetails
+  {
+    std::list<std::string> columns;
+    std::map<std::string, LiveSchemaTree::ColumnData> column_data;
+    std::list<std::string> indexes;
+    std::map<std::string, LiveSchemaTree::IndexData> index_data;
+    std::list<std::string> triggers;
+    std::map<std::string, LiveSchemaTree::TriggerData> trigger_data;
+    std::list<std::string> foreign_keys;
+    std::map<std::string, LiveSchemaTree::FKData> fk_data;
+  };
+
+  double timestamp;
+  std::map<std::string, ObjectDetails> objects;
+};
+
 
 boost::shared_ptr<SqlEditorTreeController> SqlEditorTreeController::create(SqlEditorForm *owner)
 {
@@ -134,6 +168,7 @@ SqlEditorTreeController::SqlEditorTreeController(SqlEditorForm *owner)
     _is_refreshing_schema_tree(false),
     _unified_mode(false),
     _use_show_procedure(false),
+    _last_schema_details_fetch(0),
     _side_splitter(NULL),
     _info_tabview(NULL),
     _object_info(NULL),
@@ -475,6 +510,8 @@ void SqlEditorTreeController::refresh_live_object_in_overview(wb::LiveSchemaTree
 {
   try
   {
+    invalidate_schema_details(schema_name);
+
     // update schema tree even if no object was added/dropped, to clear details attribute which contents might to be changed
     _schema_tree->update_live_object_state(type, schema_name, old_obj_name, new_obj_name);
   }
@@ -576,6 +613,13 @@ grt::StringRef SqlEditorTreeController::do_fetch_live_schema_contents(grt::GRT *
       _grtm->run_once_when_idle(this, schema_contents_arrived);
     }
 
+    // Object details loaded so far may be outdated now.
+    invalidate_schema_details(schema_name);
+    {
+      MutexLock lock(_schema_details_mutex);
+      _schema_object_counts[schema_name] = tables->size() + views->size();
+    }
+
     // Let the owner form know we got fresh schema meta data. Can be used to update caches.
     _owner->schema_meta_data_refreshed(schema_name, tables, views, procedures, functions);
   }
@@ -683,14 +727,6 @@ grt::StringRef SqlEditorTreeController::do_fetch_data_for_filter(grt::GRT *grt,
 
 void SqlEditorTreeController::fetch_column_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot)
 {
-
-  // Searches for the target node...
-  mforms::TreeNodeRef node = _schema_tree->get_node_for_object(schema_name, type, obj_name);
-  LiveSchemaTree::ViewData *pdata = NULL;
-
-  if (node)
-    pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
-
   // Loads the information...
   StringListPtr columns(new std::list<std::string>);
   std::map<std::string, LiveSchemaTree::ColumnData> column_data;
@@ -736,60 +772,18 @@ void SqlEditorTreeController::fetch_column_data(const std::string& schema_name,
       column_data[column_name] = col_node;
     }
 
-
-    // If information was found, creates the TreeNode structure for it
-    if (columns->size())
-    {
-      // Creates the node if it didn't exist...
-      if (!node)
-      {
-        node = _schema_tree->create_node_for_object(schema_name, type, obj_name);
-
-        if (node)
-          pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
-        else
-          log_warning("Error fetching column information for '%s'.'%s'", schema_name.c_str(), obj_name.c_str());
-      }
-
-      if (pdata)
-      {
-        // Identifies the node that will be the parent for the loaded columns...
-        mforms::TreeNodeRef target_parent;
-        if (pdata->get_type() == LiveSchemaTree::Table)
-        {
-          target_parent = node->get_child(wb::LiveSchemaTree::TABLE_COLUMNS_NODE_INDEX);
-          type = LiveSchemaTree::TableColumn;
-        }
-        else if (pdata->get_type() == LiveSchemaTree::View)
-        {
-          target_parent = node;
-          type = LiveSchemaTree::ViewColumn;
-        }
-
-        if (target_parent)
-        {
-          updater_slot(target_parent, columns, type, false, false);
-
-          for(int index = 0; index < target_parent->count(); index++)
-          {
-            mforms::TreeNodeRef child = target_parent->get_child(index);
-            LiveSchemaTree::LSTData *pchilddata = dynamic_cast<LiveSchemaTree::LSTData*>(child->get_data());
-            LiveSchemaTree::LSTData *psource = &column_data[child->get_string(0)];
-            pchilddata->copy(psource);
-          }
-
-          pdata->columns_load_error = false;
-          pdata->set_loaded_data(LiveSchemaTree::COLUMN_DATA);
-          _schema_tree->notify_on_reload(target_parent);
-        }
-      }
-    }
+    show_column_data(schema_name, obj_name, type, columns, column_data, updater_slot);
   }
   catch (const sql::SQLException& exc)
   {
     log_warning("Error fetching column information for '%s'.'%s': %s", schema_name.c_str(), obj_name.c_str(), exc.what());
 
     // Sets flag indicating error loading columns ( Used for broken views )
+    mforms::TreeNodeRef node = _schema_tree->get_node_for_object(schema_name, type, obj_name);
+    LiveSchemaTree::ViewData *pdata = NULL;
+    if (node)
+      pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
+
     if (pdata)
     {
       if (exc.getErrorCode() == 1356)
@@ -802,6 +796,69 @@ void SqlEditorTreeController::fetch_column_data(const std::string& schema_name,
   }
 }
 
+/**
+ * Puts the loaded columns of a table or view into the tree.
+ */
+void SqlEditorTreeController::show_column_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type,
+                                               StringListPtr columns, std::map<std::string, LiveSchemaTree::ColumnData> &column_data,
+                                               const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot)
+{
+  // Searches for the target node...
+  mforms::TreeNodeRef node = _schema_tree->get_node_for_object(schema_name, type, obj_name);
+  LiveSchemaTree::ViewData *pdata = NULL;
+
+  if (node)
+    pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
+
+  // If information was found, creates the TreeNode structure for it
+  if (columns->size())
+  {
+    // Creates the node if it didn't exist...
+    if (!node)
+    {
+      node = _schema_tree->create_node_for_object(schema_name, type, obj_name);
+
+      if (node)
+        pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
+      else
+        log_warning("Error fetching column information for '%s'.'%s'", schema_name.c_str(), obj_name.c_str());
+    }
+
+    if (pdata)
+    {
+      // Identifies the node that will be the parent for the loaded columns...
+      mforms::TreeNodeRef target_parent;
+      if (pdata->get_type() == LiveSchemaTree::Table)
+      {
+        target_parent = node->get_child(wb::LiveSchemaTree::TABLE_COLUMNS_NODE_INDEX);
+        type = LiveSchemaTree::TableColumn;
+      }
+      else if (pdata->get_type() == LiveSchemaTree::View)
+      {
+        target_parent = node;
+        type = LiveSchemaTree::ViewColumn;
+      }
+
+      if (target_parent)
+      {
+        updater_slot(target_parent, columns, type, false, false);
+
+        for(int index = 0; index < target_parent->count(); index++)
+        {
+          mforms::TreeNodeRef child = target_parent->get_child(index);
+          LiveSchemaTree::LSTData *pchilddata = dynamic_cast<LiveSchemaTree::LSTData*>(child->get_data());
+          LiveSchemaTree::LSTData *psource = &column_data[child->get_string(0)];
+          pchilddata->copy(psource);
+        }
+
+        pdata->columns_load_error = false;
+        pdata->set_loaded_data(LiveSchemaTree::COLUMN_DATA);
+        _schema_tree->notify_on_reload(target_parent);
+      }
+    }
+  }
+}
+
 
 void SqlEditorTreeController::fetch_trigger_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot)
 {
@@ -831,35 +888,45 @@ void SqlEditorTreeController::fetch_trigger_data(const std::string& schema_name,
       trigger_data_dict[name] = trigger_node;
     }
 
-    // If information was found, creates the TreeNode structure for it
-    // Searches for the target node...
-    mforms::TreeNodeRef node = _schema_tree->get_node_for_object(schema_name, type, obj_name);
+    show_trigger_data(schema_name, obj_name, type, triggers, trigger_data_dict, updater_slot);
+  }
+  catch (const sql::SQLException& exc)
+  {
+    g_warning("Error fetching trigger information for '%s'.'%s': %s", schema_name.c_str(), obj_name.c_str(), exc.what());
+  }
+}
 
-    // Creates the node if it didn't exist...
-    if (!node)
-      node = _schema_tree->create_node_for_object(schema_name, type, obj_name);
 
-    // Identifies the node that will be the parent for the loaded columns...
-    mforms::TreeNodeRef target_parent = node->get_child(wb::LiveSchemaTree::TABLE_TRIGGERS_NODE_INDEX);
-    updater_slot(target_parent, triggers, LiveSchemaTree::Trigger, false, false);
+/**
+ * Puts the loaded triggers of a table into the tree.
+ */
+void SqlEditorTreeController::show_trigger_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type,
+                                                StringListPtr triggers, std::map<std::string, LiveSchemaTree::TriggerData> &trigger_data_dict,
+                                                const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot)
+{
+  // Searches for the target node...
+  mforms::TreeNodeRef node = _schema_tree->get_node_for_object(schema_name, type, obj_name);
 
-    for(int index = 0; index < target_parent->count(); index++)
-    {
-      mforms::TreeNodeRef child = target_parent->get_child(index);
-      LiveSchemaTree::LSTData *pchilddata = dynamic_cast<LiveSchemaTree::LSTData*>(child->get_data());
-      LiveSchemaTree::LSTData *psource = &trigger_data_dict[child->get_string(0)];
-      pchilddata->copy(psource);
-    }
+  // Creates the node if it didn't exist...
+  if (!node)
+    node = _schema_tree->create_node_for_object(schema_name, type, obj_name);
 
-    // Where there data or not the triggers were loaded
-    LiveSchemaTree::ViewData *pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
-    pdata->set_loaded_data(LiveSchemaTree::TRIGGER_DATA);
-    _schema_tree->notify_on_reload(target_parent);
-  }
-  catch (const sql::SQLException& exc)
+  // Identifies the node that will be the parent for the loaded columns...
+  mforms::TreeNodeRef target_parent = node->get_child(wb::LiveSchemaTree::TABLE_TRIGGERS_NODE_INDEX);
+  updater_slot(target_parent, triggers, LiveSchemaTree::Trigger, false, false);
+
+  for(int index = 0; index < target_parent->count(); index++)
   {
-    g_warning("Error fetching trigger information for '%s'.'%s': %s", schema_name.c_str(), obj_name.c_str(), exc.what());
+    mforms::TreeNodeRef child = target_parent->get_child(index);
+    LiveSchemaTree::LSTData *pchilddata = dynamic_cast<LiveSchemaTree::LSTData*>(child->get_data());
+    LiveSchemaTree::LSTData *psource = &trigger_data_dict[child->get_string(0)];
+    pchilddata->copy(psource);
   }
+
+  // Where there data or not the triggers were loaded
+  LiveSchemaTree::ViewData *pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
+  pdata->set_loaded_data(LiveSchemaTree::TRIGGER_DATA);
+  _schema_tree->notify_on_reload(target_parent);
 }
 
 
@@ -899,33 +966,44 @@ void SqlEditorTreeController::fetch_index_data(const std::string& schema_name, c
       index_data_dict[name].columns.push_back(rs->getString(5));
     }
 
-    // Searches for the target node...
-    mforms::TreeNodeRef node = _schema_tree->get_node_for_object(schema_name, type, obj_name);
+    show_index_data(schema_name, obj_name, type, indexes, index_data_dict, updater_slot);
+  }
+  catch (const sql::SQLException& exc)
+  {
+    g_warning("Error fetching index information for '%s'.'%s': %s", schema_name.c_str(), obj_name.c_str(), exc.what());
+  }
+}
 
-    // Creates the node if it didn't exist...
-    if (!node)
-      node = _schema_tree->create_node_for_object(schema_name, type, obj_name);
 
-    // Identifies the node that will be the parent for the loaded indexes...
-    mforms::TreeNodeRef target_parent = node->get_child(wb::LiveSchemaTree::TABLE_INDEXES_NODE_INDEX);
-    updater_slot(target_parent, indexes, LiveSchemaTree::Index, false, false);
+/**
+ * Puts the loaded indexes of a table into the tree.
+ */
+void SqlEditorTreeController::show_index_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type,
+                                              StringListPtr indexes, std::map<std::string, LiveSchemaTree::IndexData> &index_data_dict,
+                                              const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot)
+{
+  // Searches for the target node...
+  mforms::TreeNodeRef node = _schema_tree->get_node_for_object(schema_name, type, obj_name);
+
+  // Creates the node if it didn't exist...
+  if (!node)
+    node = _schema_tree->create_node_for_object(schema_name, type, obj_name);
 
-    for(int index = 0; index < target_parent->count(); index++)
-    {
-      mforms::TreeNodeRef child = target_parent->get_child(index);
-      LiveSchemaTree::LSTData *pchilddata = dynamic_cast<LiveSchemaTree::LSTData*>(child->get_data());
-      LiveSchemaTree::LSTData *psource = &index_data_dict[child->get_string(0)];
-      pchilddata->copy(psource);
-    }
+  // Identifies the node that will be the parent for the loaded indexes...
+  mforms::TreeNodeRef target_parent = node->get_child(wb::LiveSchemaTree::TABLE_INDEXES_NODE_INDEX);
+  updater_slot(target_parent, indexes, LiveSchemaTree::Index, false, false);
 
-    LiveSchemaTree::ViewData *pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
-    pdata->set_loaded_data(LiveSchemaTree::INDEX_DATA);
-    _schema_tree->notify_on_reload(target_parent);
-  }
-  catch (const sql::SQLException& exc)
+  for(int index = 0; index < target_parent->count(); index++)
   {
-    g_warning("Error fetching index information for '%s'.'%s': %s", schema_name.c_str(), obj_name.c_str(), exc.what());
+    mforms::TreeNodeRef child = target_parent->get_child(index);
+    LiveSchemaTree::LSTData *pchilddata = dynamic_cast<LiveSchemaTree::LSTData*>(child->get_data());
+    LiveSchemaTree::LSTData *psource = &index_data_dict[child->get_string(0)];
+    pchilddata->copy(psource);
   }
+
+  LiveSchemaTree::ViewData *pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
+  pdata->set_loaded_data(LiveSchemaTree::INDEX_DATA);
+  _schema_tree->notify_on_reload(target_parent);
 }
 
 
@@ -1062,33 +1140,291 @@ void SqlEditorTreeController::fetch_foreign_key_data(const std::string& schema_n
       }
     }
 
-    // Searches for the target node...
-    mforms::TreeNodeRef node = _schema_tree->get_node_for_object(schema_name, type, obj_name);
+    show_foreign_key_data(schema_name, obj_name, type, foreign_keys, fk_data_dict, updater_slot);
+  }
+  catch (const sql::SQLException& exc)
+  {
+    g_warning("Error fetching foreign key information for '%s'.'%s': %s", schema_name.c_str(), obj_name.c_str(), exc.what());
+  }
+}
 
-    // Creates the node if it didn't exist...
-    if (!node)
-      node = _schema_tree->create_node_for_object(schema_name, type, obj_name);
 
-    // Identifies the node that will be the parent for the loaded columns...
-    mforms::TreeNodeRef target_parent = node->get_child(wb::LiveSchemaTree::TABLE_FOREIGN_KEYS_NODE_INDEX);
-    updater_slot(target_parent, foreign_keys, LiveSchemaTree::ForeignKey, false, false);
+/**
+ * Puts the loaded foreign keys of a table into the tree.
+ */
+void SqlEditorTreeController::show_foreign_key_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type,
+                                                    StringListPtr foreign_keys, std::map<std::string, LiveSchemaTree::FKData> &fk_data_dict,
+                                                    const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot)
+{
+  // Searches for the target node...
+  mforms::TreeNodeRef node = _schema_tree->get_node_for_object(schema_name, type, obj_name);
+
+  // Creates the node if it didn't exist...
+  if (!node)
+    node = _schema_tree->create_node_for_object(schema_name, type, obj_name);
+
+  // Identifies the node that will be the parent for the loaded columns...
+  mforms::TreeNodeRef target_parent = node->get_child(wb::LiveSchemaTree::TABLE_FOREIGN_KEYS_NODE_INDEX);
+  updater_slot(target_parent, foreign_keys, LiveSchemaTree::ForeignKey, false, false);
+
+  for(int index = 0; index < target_parent->count(); index++)
+  {
+    mforms::TreeNodeRef child = target_parent->get_child(index);
+    LiveSchemaTree::LSTData *pchilddata = dynamic_cast<LiveSchemaTree::LSTData*>(child->get_data());
+    LiveSchemaTree::LSTData *psource = &fk_data_dict[child->get_string(0)];
+    pchilddata->copy(psource);
+  }
+
+  LiveSchemaTree::ViewData *pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
+  pdata->set_loaded_data(LiveSchemaTree::FK_DATA);
+  _schema_tree->notify_on_reload(target_parent);
+}
+
+
+/**
+ * Returns the cached details of all tables and views in the schema. If they are not cached (or outdated)
+ * a bulk fetch is started in the background and an empty ref is returned, so the caller falls back to
+ * querying just the object it needs. Also returns an empty ref if the schema is too big for a bulk fetch.
+ */
+SqlEditorTreeController::SchemaDetailsRef SqlEditorTreeController::get_schema_details(const std::string &schema_name)
+{
+  MutexLock lock(_schema_details_mutex);
+
+  std::map<std::string, SchemaDetailsRef>::const_iterator entry = _schema_details.find(schema_name);
+  if (entry != _schema_details.end() && timestamp() - entry->second->timestamp < SCHEMA_DETAILS_LIFETIME)
+    return entry->second;
+
+  std::map<std::string, size_t>::const_iterator count = _schema_object_counts.find(schema_name);
+  if (count != _schema_object_counts.end() && count->second > MAX_BULK_DETAILS_OBJECTS)
+    return SchemaDetailsRef();
+
+  // This is called from the UI thread, so never wait for the server here (and never with the lock held).
+  if (_schema_details_fetches.find(schema_name) == _schema_details_fetches.end())
+  {
+    int fetch_id = ++_last_schema_details_fetch;
+    _schema_details_fetches[schema_name] = fetch_id;
+    live_schema_fetch_task->exec(false, boost::bind(&SqlEditorTreeController::do_fetch_schema_details, this, _1,
+      weak_ptr_from(this), schema_name, fetch_id));
+  }
+  return SchemaDetailsRef();
+}
+
+
+grt::StringRef SqlEditorTreeController::do_fetch_schema_details(grt::GRT *grt, boost::weak_ptr<SqlEditorTreeController> self_ptr, const std::string &schema_name, int fetch_id)
+{
+  RETVAL_IF_FAIL_TO_RETAIN_WEAK_PTR (SqlEditorTreeController, self_ptr, self, grt::StringRef(""))
+
+  SchemaDetailsRef details = fetch_schema_details(schema_name);
+
+  MutexLock lock(_schema_details_mutex);
+
+  // Drop the result if the schema was invalidated while fetching, it may be outdated already.
+  std::map<std::string, int>::iterator fetch = _schema_details_fetches.find(schema_name);
+  if (fetch != _schema_details_fetches.end() && fetch->second == fetch_id)
+  {
+    // A failed fetch is cached too (without objects), so we don't retry it for every object.
+    _schema_details[schema_name] = details;
+    _schema_details_fetches.erase(fetch);
+  }
+  return grt::StringRef("");
+}
+
+
+/**
+ * Removes cached details of the given schema (or all schemas if none is given), so they are fetched
+ * again when next needed.
+ */
+void SqlEditorTreeController::invalidate_schema_details(const std::string &schema_name)
+{
+  MutexLock lock(_schema_details_mutex);
+  if (schema_name.empty())
+  {
+    _schema_details.clear();
+    _schema_details_fetches.clear();
+  }
+  else
+  {
+    _schema_details.erase(schema_name);
+    _schema_details_fetches.erase(schema_name);
+  }
+}
+
+
+SqlEditorTreeController::SchemaDetailsRef SqlEditorTreeController::fetch_schema_details(const std::string &schema_name)
+{
+  SchemaDetailsRef details(new SchemaDetails());
+  details->timestamp = timestamp();
+
+  log_debug3("Fetching details of all tables and views in %s\n", schema_name.c_str());
+
+  try
+  {
+    sql::Dbc_connection_handler::Ref conn;
+
+    RecMutexLock aux_dbc_conn_mutex(_owner->ensure_valid_aux_connection(conn));
+
+    std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
+
+    {
+      std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery(std::string(base::sqlstring("SELECT TABLE_NAME, COLUMN_NAME, "
+        "COLUMN_TYPE, COLLATION_NAME, IS_NULLABLE, COLUMN_KEY, COLUMN_DEFAULT, EXTRA FROM information_schema.COLUMNS "
+        "WHERE TABLE_SCHEMA = ? ORDER BY TABLE_NAME, ORDINAL_POSITION", 0) << schema_name)));
+
+      while (rs->next())
+      {
+        SchemaDetails::ObjectDetails &object = details->objects[rs->getString(1)];
+
+        LiveSchemaTree::ColumnData col_node;
+        std::string column_name = rs->getString(2);
+        std::string type = rs->getString(3);
+        std::string collation = rs->isNull(4) ? "" : rs->getString(4);
+        std::string nullable = rs->getString(5);
+        std::string key = rs->getString(6);
+        std::string default_value = rs->getString(7);
+        std::string extra = rs->getString(8);
+
+        // Same conversions as for SHOW FULL COLUMNS in fetch_column_data().
+        base::replace(type, "unsigned", "UN");
+
+        if (extra == "auto_increment")
+          type += " AI";
+
+        col_node.name = column_name;
+        col_node.type = type;
+        col_node.charset_collation = collation;
+        col_node.is_pk = key == "PRI";
+        col_node.is_id = (col_node.is_pk || (nullable == "NO" && key == "UNI"));
+        col_node.is_idx = key != "";
+        col_node.default_value = default_value;
+
+        object.columns.push_back(column_name);
+        object.column_data[column_name] = col_node;
+      }
+    }
+
+    {
+      std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery(std::string(base::sqlstring("SELECT TABLE_NAME, NON_UNIQUE, "
+        "INDEX_NAME, COLUMN_NAME, INDEX_TYPE FROM information_schema.STATISTICS WHERE TABLE_SCHEMA = ? "
+        "ORDER BY TABLE_NAME, INDEX_NAME, SEQ_IN_INDEX", 0) << schema_name)));
+
+      // Index columns come in key order, but indexes are sorted by name (unlike SHOW INDEX, which lists the
+      // primary key first), so the primary key is moved to the front below.
+      while (rs->next())
+      {
+        std::map<std::string, SchemaDetails::ObjectDetails>::iterator object = details->objects.find(rs->getString(1));
+        if (object == details->objects.end())
+          continue;
+
+        std::string name = rs->getString(3);
+        if (!object->second.index_data.count(name))
+        {
+          LiveSchemaTree::IndexData index_data;
+          index_data.type = wb::LiveSchemaTree::internalize_token(rs->getString(5));
+          index_data.unique = (rs->getInt(2) == 0);
+
+          object->second.indexes.push_back(name);
+          object->second.index_data[name] = index_data;
+        }
+        object->second.index_data[name].columns.push_back(rs->getString(4));
+      }
+
+      for (std::map<std::string, SchemaDetails::ObjectDetails>::iterator object = details->objects.begin();
+        object != details->objects.end(); ++object)
+      {
+        std::list<std::string> &indexes = object->second.indexes;
+        std::list<std::string>::iterator primary = std::find(indexes.begin(), indexes.end(), "PRIMARY");
+        if (primary != indexes.end())
+          indexes.splice(indexes.begin(), indexes, primary);
+      }
+    }
 
-    for(int index = 0; index < target_parent->count(); index++)
     {
-      mforms::TreeNodeRef child = target_parent->get_child(index);
-      LiveSchemaTree::LSTData *pchilddata = dynamic_cast<LiveSchemaTree::LSTData*>(child->get_data());
-      LiveSchemaTree::LSTData *psource = &fk_data_dict[child->get_string(0)];
-      pchilddata->copy(psource);
+      std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery(std::string(base::sqlstring("SELECT EVENT_OBJECT_TABLE, "
+        "TRIGGER_NAME, EVENT_MANIPULATION, ACTION_TIMING FROM information_schema.TRIGGERS WHERE TRIGGER_SCHEMA = ?", 0)
+        << schema_name)));
+
+      while (rs->next())
+      {
+        std::map<std::string, SchemaDetails::ObjectDetails>::iterator object = details->objects.find(rs->getString(1));
+        if (object == details->objects.end())
+          continue;
+
+        LiveSchemaTree::TriggerData trigger_node;
+        std::string name = rs->getString(2);
+        trigger_node.event_manipulation = wb::LiveSchemaTree::internalize_token(rs->getString(3));
+        trigger_node.timing = wb::LiveSchemaTree::internalize_token(rs->getString(4));
+
+        object->second.triggers.push_back(name);
+        object->second.trigger_data[name] = trigger_node;
+      }
     }
 
-    LiveSchemaTree::ViewData *pdata = dynamic_cast<LiveSchemaTree::ViewData*>(node->get_data());
-    pdata->set_loaded_data(LiveSchemaTree::FK_DATA);
-    _schema_tree->notify_on_reload(target_parent);
+    {
+      std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery(std::string(base::sqlstring("SELECT k.TABLE_NAME, "
+        "k.CONSTRAINT_NAME, k.COLUMN_NAME, k.REFERENCED_TABLE_SCHEMA, k.REFERENCED_TABLE_NAME, k.REFERENCED_COLUMN_NAME, "
+        "r.UPDATE_RULE, r.DELETE_RULE FROM information_schema.KEY_COLUMN_USAGE k "
+        "JOIN information_schema.REFERENTIAL_CONSTRAINTS r ON r.CONSTRAINT_SCHEMA = k.CONSTRAINT_SCHEMA "
+        "AND r.CONSTRAINT_NAME = k.CONSTRAINT_NAME AND r.TABLE_NAME = k.TABLE_NAME "
+        "WHERE k.TABLE_SCHEMA = ? AND k.REFERENCED_TABLE_NAME IS NOT NULL "
+        "ORDER BY k.TABLE_NAME, k.CONSTRAINT_NAME, k.ORDINAL_POSITION", 0) << schema_name)));
+
+      while (rs->next())
+      {
+        std::map<std::string, SchemaDetails::ObjectDetails>::iterator object = details->objects.find(rs->getString(1));
+        if (object == details->objects.end())
+          continue;
+
+        std::string name = rs->getString(2);
+        std::map<std::string, LiveSchemaTree::FKData>::iterator fk = object->second.fk_data.find(name);
+        if (fk == object->second.fk_data.end())
+        {
+          LiveSchemaTree::FKData new_fk;
+          std::string referenced_schema = rs->getString(4);
+          new_fk.referenced_table = rs->getString(5);
+          if (referenced_schema != schema_name)
+            new_fk.referenced_table = referenced_schema + "." + new_fk.referenced_table;
+          new_fk.update_rule = wb::LiveSchemaTree::internalize_token(rs->getString(7));
+          new_fk.delete_rule = wb::LiveSchemaTree::internalize_token(rs->getString(8));
+
+          object->second.foreign_keys.push_back(name);
+          fk = object->second.fk_data.insert(std::make_pair(name, new_fk)).first;
+        }
+        else
+        {
+          fk->second.from_cols.append(", ");
+          fk->second.to_cols.append(", ");
+        }
+        fk->second.from_cols.append(rs->getString(3));
+        fk->second.to_cols.append(rs->getString(6));
+      }
+    }
   }
   catch (const sql::SQLException& exc)
   {
-    g_warning("Error fetching foreign key information for '%s'.'%s': %s", schema_name.c_str(), obj_name.c_str(), exc.what());
+    log_warning("Error fetching details of all objects in '%s', falling back to single object queries: %s\n",
+      schema_name.c_str(), exc.what());
+    details->objects.clear();
+    return details;
   }
+
+  // The auto completion cache gets the names too, so it need not fetch them itself.
+  AutoCompleteCache *cache = _owner->auto_completion_cache();
+  if (cache != NULL)
+  {
+    std::map<std::string, std::vector<std::string> > columns;
+    std::map<std::string, std::vector<std::string> > triggers;
+    for (std::map<std::string, SchemaDetails::ObjectDetails>::const_iterator object = details->objects.begin();
+      object != details->objects.end(); ++object)
+    {
+      columns[object->first].assign(object->second.columns.begin(), object->second.columns.end());
+      if (!object->second.triggers.empty())
+        triggers[object->first].assign(object->second.triggers.begin(), object->second.triggers.end());
+    }
+    cache->update_columns(schema_name, columns);
+    cache->update_triggers(schema_name, triggers);
+  }
+
+  return details;
 }
 
 
@@ -1103,17 +1439,58 @@ bool SqlEditorTreeController::fetch_object_details(const std::string& schema_nam
 
   if (type != wb::LiveSchemaTree::Any)
   {
+    // Use the bulk loaded details of the schema if the object is in there.
+    SchemaDetails::ObjectDetails object;
+    bool have_details = false;
+    if (type == wb::LiveSchemaTree::Table || type == wb::LiveSchemaTree::View)
+    {
+      SchemaDetailsRef details = get_schema_details(schema_name);
+      if (details)
+      {
+        std::map<std::string, SchemaDetails::ObjectDetails>::const_iterator entry = details->objects.find(object_name);
+        if (entry != details->objects.end())
+        {
+          object = entry->second;
+          have_details = true;
+        }
+      }
+    }
+
     if (flags & wb::LiveSchemaTree::COLUMN_DATA)
-      fetch_column_data(schema_name, object_name, type, updater_slot);
+    {
+      if (have_details)
+        show_column_data(schema_name, object_name, type, StringListPtr(new std::list<std::string>(object.columns)),
+          object.column_data, updater_slot);
+      else
+        fetch_column_data(schema_name, object_name, type, updater_slot);
+    }
 
     if (flags & wb::LiveSchemaTree::INDEX_DATA)
-      fetch_index_data(schema_name, object_name, type, updater_slot);
+    {
+      if (have_details)
+        show_index_data(schema_name, object_name, type, StringListPtr(new std::list<std::string>(object.indexes)),
+          object.index_data, updater_slot);
+      else
+        fetch_index_data(schema_name, object_name, type, updater_slot);
+    }
 
     if (flags & wb::LiveSchemaTree::TRIGGER_DATA)
-      fetch_trigger_data(schema_name, object_name, type, updater_slot);
+    {
+      if (have_details)
+        show_trigger_data(schema_name, object_name, type, StringListPtr(new std::list<std::string>(object.triggers)),
+          object.trigger_data, updater_slot);
+      else
+        fetch_trigger_data(schema_name, object_name, type, updater_slot);
+    }
 
     if (flags & wb::LiveSchemaTree::FK_DATA)
-      fetch_foreign_key_data(schema_name, object_name, type, updater_slot);
+    {
+      if (have_details)
+        show_foreign_key_data(schema_name, object_name, type, StringListPtr(new std::list<std::string>(object.foreign_keys)),
+          object.fk_data, updater_slot);
+      else
+        fetch_foreign_key_data(schema_name, object_name, type, updater_slot);
+    }
   }
 
   return false;
@@ -1326,6 +1703,11 @@ void SqlEditorTreeController::tree_activate_objects(const std::string& action,
 
     _owner->run_sql_in_scratch_tab(text, false, true);
   }
+  else if (real_action == "export_data")
+  {
+    export_objects_data(changes);
+    return;
+  }
 
   try
   {
@@ -1397,6 +1779,87 @@ void SqlEditorTreeController::tree_activate_objects(const std::string& action,
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Exports the data of the given tables and views directly from the server (see SqlEditorForm::export_data).
+ * A single object goes to a file, several objects go into a folder, one file per object.
+ */
+void SqlEditorTreeController::export_objects_data(const std::vector<wb::LiveSchemaTree::ChangeRecord> &changes)
+{
+  if (changes.empty())
+    return;
+
+  if (_owner->is_exporting_data())
+  {
+    mforms::Utilities::show_message(_("Export Data"),
+      _("Another data export is still running, please wait until it has finished."), _("OK"));
+    return;
+  }
+
+  std::map<std::string, Recordset_storage_info> formats; // Description -> format.
+  std::string format_options;
+  BOOST_FOREACH (const Recordset_storage_info &info, Recordset_text_storage::storage_types(_grtm))
+  {
+    if (Recordset_text_storage::supports_direct_export(_grtm, info.name))
+    {
+      formats[info.description] = info;
+      format_options.append("|").append(info.description).append("|").append(info.extension);
+    }
+  }
+  if (formats.empty())
+    return;
+
+  bool single_object = changes.size() == 1;
+  mforms::FileChooser chooser(single_object ? mforms::SaveFile : mforms::OpenDirectory);
+  if (single_object)
+    chooser.set_title(strfmt(_("Export Data of %s"), changes[0].name.c_str()));
+  else
+    chooser.set_title(_("Export Data to Folder"));
+  chooser.add_selector_option("format", _("Format:"), format_options.substr(1));
+  if (!chooser.run_modal())
+    return;
+
+  std::string path = chooser.get_path();
+  std::map<std::string, Recordset_storage_info>::const_iterator format =
+    formats.find(chooser.get_selector_option_value("format"));
+  if (format == formats.end())
+    format = formats.begin();
+
+  std::string objects = single_object ? changes[0].name : strfmt(_("%i tables and views"), (int)changes.size());
+  int result = mforms::Utilities::show_message(_("Export Data"),
+    strfmt(_("The data of %s will be exported as %s to %s, directly from the server."),
+      objects.c_str(), format->second.description.c_str(), path.c_str()),
+    _("Export"), _("Cancel"), _("Export gzip Compressed"));
+  if (result == mforms::ResultCancel)
+    return;
+  bool compress = result == mforms::ResultOther;
+
+  std::vector<SqlEditorForm::DataExportJob> jobs;
+  BOOST_FOREACH (const wb::LiveSchemaTree::ChangeRecord &change, changes)
+  {
+    SqlEditorForm::DataExportJob job;
+    job.query = sqlstring("SELECT * FROM !.!", 0) << change.schema << change.name;
+    job.table_name = change.name;
+    if (single_object)
+      job.file_path = path;
+    else
+      job.file_path = make_path(path, sanitize_file_name(change.schema + "." + change.name) + "." + format->second.extension);
+    if (compress && !g_str_has_suffix(job.file_path.c_str(), ".gz"))
+      job.file_path.append(".gz");
+    jobs.push_back(job);
+  }
+
+  try
+  {
+    _owner->export_data(jobs, format->second.name, compress);
+  }
+  catch (std::exception &exc)
+  {
+    mforms::Utilities::show_error(_("Export Data"), exc.what(), _("OK"));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
 /**
  * Convenience API for the activation interface.
  */
@@ -2649,6 +3112,7 @@ grt::StringRef SqlEditorTreeController::do_refresh_schema_tree_safe(grt::GRT *gr
 
   std::list<std::string> fsl = fetch_schema_list();
   schema_list->assign(fsl.begin(), fsl.end());
+  invalidate_schema_details("");
   _grtm->run_once_when_idle(this, boost::bind(&LiveSchemaTree::update_schemata, _schema_tree, schema_list));
   _grtm->run_once_when_idle(this, boost::bind(&SqlEditorForm::schema_tree_did_populate, _owner));
 
@@ -89,6 +89,14 @@ private:
 
   bool _use_show_procedure;
 
+  struct SchemaDetails;
+  typedef boost::shared_ptr<SchemaDetails> SchemaDetailsRef;
+  base::Mutex _schema_details_mutex; // Protects the details, pending fetches and object counts.
+  std::map<std::string, SchemaDetailsRef> _schema_details;
+  std::map<std::string, int> _schema_details_fetches; // Id of the background fetch running per schema.
+  int _last_schema_details_fetch;
+  std::map<std::string, size_t> _schema_object_counts; // Number of tables and views per schema.
+
   mforms::Splitter *_side_splitter;
   mforms::TabView *_info_tabview;
   mforms::HyperText *_object_info;
@@ -118,10 +126,20 @@ public:
 private:
   grt::StringRef do_fetch_live_schema_contents(grt::GRT *grt, boost::weak_ptr<SqlEditorTreeController> self_ptr, const std::string &schema_name, wb::LiveSchemaTree::NewSchemaContentArrivedSlot arrived_slot);
   wb::LiveSchemaTree::ObjectType fetch_object_type(const std::string& schema_name, const std::string& obj_name);
+  void export_objects_data(const std::vector<wb::LiveSchemaTree::ChangeRecord> &changes);
   void fetch_column_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot);
   void fetch_trigger_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot);
   void fetch_index_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot);
   void fetch_foreign_key_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot);
+  void show_column_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, base::StringListPtr columns, std::map<std::string, wb::LiveSchemaTree::ColumnData> &column_data, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot);
+  void show_trigger_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, base::StringListPtr triggers, std::map<std::string, wb::LiveSchemaTree::TriggerData> &trigger_data_dict, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot);
+  void show_index_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, base::StringListPtr indexes, std::map<std::string, wb::LiveSchemaTree::IndexData> &index_data_dict, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot);
+  void show_foreign_key_data(const std::string& schema_name, const std::string& obj_name, wb::LiveSchemaTree::ObjectType type, base::StringListPtr foreign_keys, std::map<std::string, wb::LiveSchemaTree::FKData> &fk_data_dict, const wb::LiveSchemaTree::NodeChildrenUpdaterSlot &updater_slot);
+
+  SchemaDetailsRef get_schema_details(const std::string &schema_name);
+  SchemaDetailsRef fetch_schema_details(const std::string &schema_name);
+  grt::StringRef do_fetch_schema_details(grt::GRT *grt, boost::weak_ptr<SqlEditorTreeController> self_ptr, const std::string &schema_name, int fetch_id);
+  void invalidate_schema_details(const std::string &schema_name);
 
   grt::StringRef do_fetch_data_for_filter(grt::GRT *grt, boost::weak_ptr<SqlEditorTreeController> self_ptr, const std::string &schema_filter, const std::string &object_filter, wb::LiveSchemaTree::NewSchemaContentArrivedSlot arrived_slot);
 
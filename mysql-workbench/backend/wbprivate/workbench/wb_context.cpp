@@ -1647,6 +1647,7 @@ void WBContext::set_default_options(grt::DictRef options)
   set_default(options, "workbench:AutoSaveModelInterval", AUTO_SAVE_MODEL_INTERVAL);
   set_default(options, "workbench:AutoSaveSQLEditorInterval", AUTO_SAVE_SQLEDITOR_INTERVAL);
   set_default(options, "workbench.AutoReopenLastModel", 0);
+  set_default(options, "workbench:ModelSnapshotCache", 0);
   set_default(options, "workbench:SaveSQLWorkspaceOnClose", 1);
   set_default(options, "workbench:InternalSchema", ".mysqlworkbench");
   
@@ -1681,6 +1682,7 @@ void WBContext::set_default_options(grt::DictRef options)
   set_default(options, "DbSqlEditor:CodeCompletionEnabled", 1);
   set_default(options, "DbSqlEditor:AutoStartCodeCompletion", 1);
   set_default(options, "DbSqlEditor:CodeCompletionUpperCaseKeywords", 0);
+  set_default(options, "DbSqlEditor:CodeCompletionFuzzyMatching", 1);
   set_default(options, "DbSqlEditor:ProgressStatusUpdateInterval", 500); // in ms
   set_default(options, "DbSqlEditor:KeepAliveInterval", 600); // in seconds
   set_default(options, "DbSqlEditor:ReadTimeOut", 600); // in seconds
@@ -1714,8 +1716,10 @@ void WBContext::set_default_options(grt::DictRef options)
   // Recordset
   set_default(options, "Recordset:FloatingPointVisibleScale", 3);
   set_default(options, "Recordset:FieldValueTruncationThreshold", 256);
+  set_default(options, "Recordset:ColumnStoreMemoryLimit", 256); // in MB, 0 keeps all fetched data in the data swap db
   set_default(options, "SqlEditor:LimitRows", 1);
   set_default(options, "SqlEditor:LimitRowsCount", 1000);
+  set_default(options, "SqlEditor:StreamingFetch", 1); // show result rows while they are being fetched
 
   // Name templates
   set_default(options, "PkColumnNameTemplate", "id%table%");
@@ -2949,6 +2953,8 @@ bool WBContext::open_document(const std::string &file)
 
   _model_context->model_loaded(_file, doc);
 
+  log_debug("Loaded %s, %s\n", file.c_str(), grt::get_value_memory_stats().description().c_str());
+
   _filename= file;
   _save_point= get_grt()->get_undo_manager()->get_latest_undo_action();
 
@@ -3122,6 +3128,7 @@ grt::ValueRef WBContext::save_grt(grt::GRT *grt)
     workbench_DocumentRef doc(get_document());
     GrtObjectRef owner(doc->owner());
     doc->owner(GrtObjectRef()); // temporarily clear non-persistent owner
+    _file->set_snapshot_cache_enabled(get_wb_options().get_int("workbench:ModelSnapshotCache", 0) != 0);
     _file->store_document(grt, doc);
     doc->owner(owner);
 
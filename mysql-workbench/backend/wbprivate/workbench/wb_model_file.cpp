@@ -29,6 +29,8 @@
 #include <errno.h>
 
 #include "grtpp.h"
+#include "grtpp_undo_manager.h"
+#include "grtpp_snapshot_journal.h"
 
 #include "base/log.h"
 #include "base/string_utilities.h"
@@ -72,11 +74,21 @@
 
 /* Auto-saving
  *
- * Auto-saving works by saving the model document file (the XML) to the expanded document folder
- * from time to time, named as document-autosave.mwb.xml. The expanded document folder is 
- * automatically deleted when it is closed normally.
+ * Auto-saving works by saving a binary snapshot of the model document to the expanded document folder
+ * from time to time, named as document-autosave.mwb.snapshot (older versions saved the XML, as
+ * document-autosave.mwb.xml). The expanded document folder is automatically deleted when it is
+ * closed normally.
+ * Once the snapshot is written, further auto-saves only append the objects changed since then
+ * (as reported by the undo manager) to document-autosave.mwb.journal. A new snapshot is written
+ * when the journal gets too big compared to the snapshot or when changes could not be tracked.
  * When a document is opened, it will check if there already is a document folder for that file
- * and if so, the recovery function will kick in, using the autosave XML file.
+ * and if so, the recovery function will kick in, using the autosave file.
+ *
+ * Snapshot cache
+ *
+ * If enabled, saving a model also stores a snapshot of it next to the model file (<file>.snapshot),
+ * together with a digest of the document XML it was created with. Opening the model loads the
+ * snapshot instead of the XML as long as the digest still matches.
  */
 
 DEFAULT_LOG_DOMAIN("model")
@@ -118,6 +130,29 @@ void ModelFile::copy_file(const std::string &srcfile, const std::string &destfil
 }
 
 
+/**
+ * Returns a digest of the file contents, used to check if a snapshot matches the document XML.
+ */
+static std::string file_digest(const std::string &path)
+{
+  FILE *f= base_fopen(path.c_str(), "rb");
+  if (!f)
+    return "";
+
+  GChecksum *checksum= g_checksum_new(G_CHECKSUM_SHA1);
+  char buffer[65536];
+  size_t c;
+  while ((c= fread(buffer, 1, sizeof(buffer), f)) > 0)
+    g_checksum_update(checksum, (const guchar*)buffer, c);
+  fclose(f);
+
+  std::string digest= g_checksum_get_string(checksum);
+  g_checksum_free(checksum);
+
+  return digest;
+}
+
+
 static int rmdir_recursively(const char *path)
 {
   int res= 0;
@@ -194,7 +229,7 @@ std::string ModelFile::create_document_dir(const std::string &dir, const std::st
 
 
 ModelFile::ModelFile(const std::string &tmpdir)
-: _temp_dir_lock(0), _dirty(false)
+: _temp_dir_lock(0), _autosave_journal(0), _dirty(false), _snapshot_cache(false)
 {
   _temp_dir= tmpdir;
 }
@@ -261,6 +296,8 @@ void ModelFile::open(const std::string &path, GRTManager *grtm)
     throw std::runtime_error("Invalid path "+path);
   }
 
+  _snapshot_cache_path = file_is_zip ? path + SNAPSHOT_CACHE_SUFFIX : "";
+
   std::string auto_save_dir = file_is_autosave ? path : bec::make_path(_temp_dir, basename).append("d"); // default
   std::list<std::string> possible_autosaves = base::scan_for_files_matching(auto_save_dir+"*");
   for (std::list<std::string>::const_iterator d = possible_autosaves.begin(); d != possible_autosaves.end(); ++d)
@@ -309,7 +346,9 @@ void ModelFile::open(const std::string &path, GRTManager *grtm)
     time_t file_ts;
     base::file_mtime(path, file_ts);
     time_t autosave_ts;
-    base::file_mtime(bec::make_path(auto_save_dir, MAIN_DOCUMENT_NAME), autosave_ts);
+    base::file_mtime(bec::make_path(auto_save_dir, MAIN_DOCUMENT_AUTOSAVE_SNAPSHOT_NAME), autosave_ts);
+    if (autosave_ts == 0)
+      base::file_mtime(bec::make_path(auto_save_dir, MAIN_DOCUMENT_NAME), autosave_ts);
     if (autosave_ts == 0)
       base::file_mtime(auto_save_dir, autosave_ts);
     
@@ -328,7 +367,37 @@ void ModelFile::open(const std::string &path, GRTManager *grtm)
       recover= true;
       _content_dir = auto_save_dir;
 
-      if (g_file_test((auto_save_dir+"/"+MAIN_DOCUMENT_AUTOSAVE_NAME).c_str(), G_FILE_TEST_EXISTS))
+      std::string autosave_snapshot = auto_save_dir+"/"+MAIN_DOCUMENT_AUTOSAVE_SNAPSHOT_NAME;
+      if (g_file_test(autosave_snapshot.c_str(), G_FILE_TEST_EXISTS))
+      {
+        // retrieve_document() loads the committed snapshot instead of the document XML
+        g_warning("Committing autosaved document snapshot: %s", autosave_snapshot.c_str());
+        g_remove((auto_save_dir+"/"+MAIN_DOCUMENT_SNAPSHOT_NAME).c_str());
+        g_remove((auto_save_dir+"/"+MAIN_DOCUMENT_JOURNAL_NAME).c_str());
+        // a journal that can't be renamed is simply not applied, the snapshot is still usable
+        if (g_file_test((auto_save_dir+"/"+MAIN_DOCUMENT_AUTOSAVE_JOURNAL_NAME).c_str(), G_FILE_TEST_EXISTS)
+            && g_rename((auto_save_dir+"/"+MAIN_DOCUMENT_AUTOSAVE_JOURNAL_NAME).c_str(),
+                        (auto_save_dir+"/"+MAIN_DOCUMENT_JOURNAL_NAME).c_str()) < 0)
+          g_warning("Failed renaming autosave journal: %s", g_strerror(errno));
+        if (g_rename(autosave_snapshot.c_str(), (auto_save_dir+"/"+MAIN_DOCUMENT_SNAPSHOT_NAME).c_str()) < 0)
+        {
+          g_warning("Failed renaming autosaved snapshot: %s", g_strerror(errno));
+          try
+          {
+            copy_file(autosave_snapshot, auto_save_dir+"/"+MAIN_DOCUMENT_SNAPSHOT_NAME);
+          }
+          catch (const std::exception &exc)
+          {
+            g_warning("Failed copying autosaved snapshot: %s", exc.what());
+            mforms::Utilities::show_error("Error recovering file",
+                                          base::strfmt("There was an error recovering the document: %s\n", exc.what()),
+                                          "OK", "", "");
+            g_rename(auto_save_dir.c_str(), (auto_save_dir+".cantrecover").c_str());
+            recover= false;
+          }
+        }
+      }
+      else if (g_file_test((auto_save_dir+"/"+MAIN_DOCUMENT_AUTOSAVE_NAME).c_str(), G_FILE_TEST_EXISTS))
       {
         g_warning("Committing autosaved document XML file: %s",
                   (auto_save_dir+"/"+MAIN_DOCUMENT_AUTOSAVE_NAME).c_str());
@@ -455,6 +524,74 @@ workbench_DocumentRef ModelFile::retrieve_document(grt::GRT *grt)
 {
   RecMutexLock lock(_mutex);
 
+  // A recovered autosave is more recent than the document XML. Otherwise use the snapshot cache
+  // of the model file, if it was made from the same XML data.
+  std::string snapshot_path = get_path_for(MAIN_DOCUMENT_SNAPSHOT_NAME);
+  std::string journal_path = get_path_for(MAIN_DOCUMENT_JOURNAL_NAME);
+  if (!g_file_test(snapshot_path.c_str(), G_FILE_TEST_EXISTS))
+  {
+    snapshot_path.clear();
+    journal_path.clear();
+    std::string doctype, version, digest;
+    if (!_snapshot_cache_path.empty() && g_file_test(_snapshot_cache_path.c_str(), G_FILE_TEST_EXISTS)
+        && grt->get_snapshot_metainfo(_snapshot_cache_path, doctype, version, digest)
+        && !digest.empty() && digest == file_digest(get_path_for(MAIN_DOCUMENT_NAME)))
+      snapshot_path = _snapshot_cache_path;
+  }
+
+  // Only a recovered autosave holds changes that are lost when falling back to the XML data.
+  bool recovering = !journal_path.empty();
+  std::string snapshot_error;
+  if (!snapshot_path.empty())
+  {
+    try
+    {
+      workbench_DocumentRef doc(load_snapshot_document(grt, snapshot_path, journal_path));
+      if (semantic_check(doc))
+        return doc;
+      snapshot_error = _("Invalid model file content.");
+      log_warning("Document snapshot %s failed the semantic check, loading the XML data\n", snapshot_path.c_str());
+    }
+    catch (std::exception &exc)
+    {
+      snapshot_error = exc.what();
+      log_warning("Could not load document snapshot %s, loading the XML data: %s\n", snapshot_path.c_str(), exc.what());
+    }
+  }
+
+  workbench_DocumentRef doc(retrieve_xml_document(grt));
+
+  // loading the XML data resets the load warnings, so the failed recovery is added afterwards
+  if (recovering && !snapshot_error.empty())
+    _load_warnings.push_back(strfmt(_("The auto-saved changes could not be recovered (%s), the model was opened "
+                                      "as it was last saved."), snapshot_error.c_str()));
+  return doc;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+workbench_DocumentRef ModelFile::retrieve_xml_document(grt::GRT *grt)
+{
+  // Documents in the current format need no XML level upgrade, so they are read in a single pass
+  // without building a DOM tree first. Anything unexpected makes us go the DOM route, which can fix
+  // broken documents at the XML level.
+  std::string doctype, version;
+  if (grt->get_xml_metainfo(get_path_for(MAIN_DOCUMENT_NAME), doctype, version)
+      && doctype == DOCUMENT_FORMAT && version == DOCUMENT_VERSION)
+  {
+    try
+    {
+      workbench_DocumentRef doc(stream_document(grt, get_path_for(MAIN_DOCUMENT_NAME)));
+      if (semantic_check(doc))
+        return doc;
+      log_warning("Streamed document failed the semantic check, loading it again\n");
+    }
+    catch (std::exception &exc)
+    {
+      log_warning("Could not stream in document, loading it again: %s\n", exc.what());
+    }
+  }
+
   xmlDocPtr xmldoc= grt->load_xml(get_path_for(MAIN_DOCUMENT_NAME));
 
 retry:
@@ -826,6 +963,80 @@ workbench_DocumentRef ModelFile::unserialize_document(grt::GRT *grt, xmlDocPtr x
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Loads a document of the current version with the streaming unserializer. The checks that are
+ * done on the XML data of older documents are done on the GRT objects instead.
+ */
+workbench_DocumentRef ModelFile::stream_document(grt::GRT *grt, const std::string &path)
+{
+  std::string doctype, version;
+
+  _load_warnings.clear();
+
+  grt::ValueRef value(grt->unserialize(path, doctype, version));
+
+  _loaded_version= version;
+
+  if (!value.is_valid())
+    throw std::runtime_error("Error unserializing document data.");
+
+  if (!workbench_DocumentRef::can_wrap(value))
+    throw std::runtime_error("Loaded file does not contain a valid Workbench document.");
+
+  workbench_DocumentRef doc(workbench_DocumentRef::cast_from(value));
+
+  // the GRT level upgrade steps still apply to current documents, none of them needs the XML data
+  doc= attempt_document_upgrade(doc, NULL, version);
+
+  cleanup_upgrade_data();
+
+  check_and_fix_inconsistencies(doc, version);
+
+  return doc;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Loads a document from a binary snapshot, applying the changes from the journal if one is given.
+ * Snapshots are only written for the current document version, so only the upgrade steps and
+ * checks on the GRT objects apply.
+ */
+workbench_DocumentRef ModelFile::load_snapshot_document(grt::GRT *grt, const std::string &path,
+                                                        const std::string &journal_path)
+{
+  std::string doctype, version;
+
+  _load_warnings.clear();
+
+  grt::ValueRef value;
+  if (!journal_path.empty() && g_file_test(journal_path.c_str(), G_FILE_TEST_EXISTS))
+    value = grt::SnapshotJournal::load(grt, path, journal_path, doctype, version);
+  else
+    value = grt->unserialize_snapshot(path, doctype, version);
+
+  if (doctype != DOCUMENT_FORMAT || version != DOCUMENT_VERSION)
+    throw std::runtime_error("The snapshot is not for a document of the current version.");
+
+  _loaded_version= version;
+
+  if (!workbench_DocumentRef::can_wrap(value))
+    throw std::runtime_error("The snapshot does not contain a valid Workbench document.");
+
+  workbench_DocumentRef doc(workbench_DocumentRef::cast_from(value));
+
+  // as for streamed documents, the GRT level upgrade steps apply to the current version too
+  doc= attempt_document_upgrade(doc, NULL, version);
+
+  cleanup_upgrade_data();
+
+  check_and_fix_inconsistencies(doc, version);
+
+  return doc;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 /**
  * Core save routine for model files. It does a backup of the existing model file of the given name
  * (if there is one). Checks are performed to ensure existing backup files can be removed and existing
@@ -893,8 +1104,31 @@ bool ModelFile::save_to(const std::string &path, const std::string &comment)
   _delete_queue.clear();
 
   // saving the file for real can delete the autosave
-  g_remove(get_path_for("document-autosave.mwb.xml").c_str());
+  g_remove(get_path_for(MAIN_DOCUMENT_AUTOSAVE_NAME).c_str());
+  g_remove(get_path_for(MAIN_DOCUMENT_AUTOSAVE_SNAPSHOT_NAME).c_str());
+  g_remove(get_path_for(MAIN_DOCUMENT_AUTOSAVE_JOURNAL_NAME).c_str());
   g_remove(get_path_for("real_path").c_str());
+  if (_autosave_journal)
+    _autosave_journal->reset();
+
+  // the snapshot is kept next to the model file, not inside of it
+  std::string snapshot_path = get_path_for(MAIN_DOCUMENT_SNAPSHOT_NAME);
+  std::string cache_path = path + SNAPSHOT_CACHE_SUFFIX;
+  g_remove(cache_path.c_str());
+  if (_snapshot_cache && g_file_test(snapshot_path.c_str(), G_FILE_TEST_EXISTS))
+  {
+    try
+    {
+      copy_file(snapshot_path, cache_path);
+    }
+    catch (std::exception &exc)
+    {
+      log_warning("Could not store snapshot cache %s: %s\n", cache_path.c_str(), exc.what());
+      g_remove(cache_path.c_str());
+    }
+  }
+  g_remove(snapshot_path.c_str());
+  g_remove(get_path_for(MAIN_DOCUMENT_JOURNAL_NAME).c_str());
 
   if (g_path_is_absolute(path.c_str()))
     pack_zip(path, _content_dir, comment);
@@ -918,6 +1152,9 @@ void ModelFile::cleanup()
   delete _temp_dir_lock;
   _temp_dir_lock = 0;
 
+  delete _autosave_journal;
+  _autosave_journal = 0;
+
   rmdir_recursively(_content_dir.c_str());
 }
 
@@ -1070,14 +1307,63 @@ std::string ModelFile::get_file_contents(const std::string &path)
 void ModelFile::store_document(grt::GRT *grt, const workbench_DocumentRef &doc)
 {
   grt->serialize(doc, get_path_for(MAIN_DOCUMENT_NAME), DOCUMENT_FORMAT, DOCUMENT_VERSION);
+
+  // a recovered snapshot is outdated now, a new one is only needed for the snapshot cache
+  std::string snapshot_path= get_path_for(MAIN_DOCUMENT_SNAPSHOT_NAME);
+  g_remove(snapshot_path.c_str());
+  g_remove(get_path_for(MAIN_DOCUMENT_JOURNAL_NAME).c_str());
+  if (_snapshot_cache)
+  {
+    try
+    {
+      grt->serialize_snapshot(doc, snapshot_path, DOCUMENT_FORMAT, DOCUMENT_VERSION,
+                              file_digest(get_path_for(MAIN_DOCUMENT_NAME)));
+    }
+    catch (std::exception &exc)
+    {
+      log_warning("Could not store document snapshot: %s\n", exc.what());
+      g_remove(snapshot_path.c_str());
+    }
+  }
   
   _dirty= true;
 }
 
 
+/**
+ * Auto-saves the document. The first call writes a full snapshot, later ones only append the
+ * objects changed since the previous call to the autosave journal.
+ */
 void ModelFile::store_document_autosave(grt::GRT *grt, const workbench_DocumentRef &doc)
 {
-  grt->serialize(doc, get_path_for("document-autosave.mwb.xml"), DOCUMENT_FORMAT, DOCUMENT_VERSION);
+  RecMutexLock lock(_mutex);
+
+  if (!_autosave_journal)
+    _autosave_journal= new grt::SnapshotJournal(grt, get_path_for(MAIN_DOCUMENT_AUTOSAVE_SNAPSHOT_NAME),
+                                                get_path_for(MAIN_DOCUMENT_AUTOSAVE_JOURNAL_NAME));
+
+  grt::UndoManager *um= grt->get_undo_manager();
+  std::map<std::string, grt::ObjectRef> changes;
+  bool complete= um->is_tracking_changes() && um->take_changed_objects(changes);
+
+  if (!complete || !_autosave_journal->has_checkpoint() || _autosave_journal->needs_compaction())
+  {
+    // changes made while the snapshot is written are picked up by the next auto-save
+    um->set_change_tracking(true);
+    _autosave_journal->checkpoint(doc, DOCUMENT_FORMAT, DOCUMENT_VERSION);
+  }
+  else if (!changes.empty())
+  {
+    std::vector<grt::ObjectRef> objects;
+    objects.reserve(changes.size());
+    for (std::map<std::string, grt::ObjectRef>::const_iterator iter= changes.begin(); iter != changes.end(); ++iter)
+      objects.push_back(iter->second);
+
+    _autosave_journal->append(objects);
+  }
+
+  // left over from a previous version
+  g_remove(get_path_for(MAIN_DOCUMENT_AUTOSAVE_NAME).c_str());
 }
 
 void ModelFile::delete_file(const std::string &path)
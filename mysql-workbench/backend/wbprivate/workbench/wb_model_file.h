@@ -34,6 +34,11 @@
 
 #define MAIN_DOCUMENT_NAME "document.mwb.xml"
 #define MAIN_DOCUMENT_AUTOSAVE_NAME "document-autosave.mwb.xml"
+#define MAIN_DOCUMENT_SNAPSHOT_NAME "document.mwb.snapshot"
+#define MAIN_DOCUMENT_AUTOSAVE_SNAPSHOT_NAME "document-autosave.mwb.snapshot"
+#define MAIN_DOCUMENT_JOURNAL_NAME "document.mwb.journal"
+#define MAIN_DOCUMENT_AUTOSAVE_JOURNAL_NAME "document-autosave.mwb.journal"
+#define SNAPSHOT_CACHE_SUFFIX ".snapshot"
 
 
 namespace bec
@@ -41,6 +46,11 @@ namespace bec
   class GRTManager;
 }
 
+namespace grt
+{
+  class SnapshotJournal;
+}
+
 namespace wb {
   class MYSQLWBBACKEND_PUBLIC_FUNC ModelFile : public base::trackable
   {
@@ -59,6 +69,9 @@ namespace wb {
 
     bool has_unsaved_changes() { return _dirty; }
 
+    // Keep a binary snapshot of the document next to the model file when saving it.
+    void set_snapshot_cache_enabled(bool flag) { _snapshot_cache= flag; }
+
 
     workbench_DocumentRef retrieve_document(grt::GRT *grt);
     
@@ -110,10 +123,13 @@ namespace wb {
     std::string _content_dir; //< path for directory where document contents are stored in disk
     std::list<std::string> _delete_queue; //< files marked for deletion
     std::string _loaded_version; //< version of the model file as stored in disk
+    std::string _snapshot_cache_path; //< snapshot cache of the opened model file
+    grt::SnapshotJournal *_autosave_journal; //< changes since the last full autosave snapshot
     
     std::list<std::string> _load_warnings; //< warnings from loaded model
     
     bool _dirty;
+    bool _snapshot_cache;
     
     typedef std::map<std::string, std::string> TableInsertsSqlScripts; // table guid -> sql script (inserts)
     TableInsertsSqlScripts table_inserts_sql_scripts; // for model upgrade only: move insert sql scripts from xml to sqlite db
@@ -121,6 +137,10 @@ namespace wb {
     boost::signals2::signal<void ()> _changed_signal;
 
     workbench_DocumentRef unserialize_document(grt::GRT *grt, xmlDocPtr xmldoc, const std::string &path);
+    workbench_DocumentRef retrieve_xml_document(grt::GRT *grt);
+    workbench_DocumentRef stream_document(grt::GRT *grt, const std::string &path);
+    workbench_DocumentRef load_snapshot_document(grt::GRT *grt, const std::string &path,
+                                                 const std::string &journal_path= "");
 
     
   private:    
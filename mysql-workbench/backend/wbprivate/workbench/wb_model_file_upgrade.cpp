@@ -1082,7 +1082,7 @@ static void check_schema_objects(db_SchemaRef schema, std::list<std::string> &lo
       }
     }
 
-    /* this is not done in the FK check
+    // fix_broken_foreign_keys does this at XML level, but streamed documents never get there
     GRTLIST_FOREACH(db_ForeignKey, (*table)->foreignKeys(), fk)
     {
       if ((*fk)->columns().count() != (*fk)->referencedColumns().count())
@@ -1096,7 +1096,6 @@ static void check_schema_objects(db_SchemaRef schema, std::list<std::string> &lo
           (*fk)->referencedColumns().remove((*fk)->referencedColumns().count()-1);
       }
     }
-     */
   }
 }
 
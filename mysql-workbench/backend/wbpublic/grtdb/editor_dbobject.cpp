@@ -101,8 +101,8 @@ void DBObjectEditorBE::handle_grt_notification(const std::string &name, grt::Obj
     if (name == "GRNPreferencesDidClose")
     {
       // We want to see changes for the server version.
+      // The editor shares our parser context and updates it in sync with its background checks.
       GrtVersionRef version = get_catalog()->version();
-      _parser_context->use_server_version(version);
       get_sql_editor()->set_server_version(version);
     }
   }
@@ -75,6 +75,27 @@ ParserContext::~ParserContext()
 {
   delete _recognizer;
   delete _syntax_checker;
+
+  for (std::vector<MySQLSyntaxChecker *>::iterator iterator = _checker_pool.begin(); iterator != _checker_pool.end(); ++iterator)
+    delete *iterator;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns an additional syntax checker with the same settings as the main one, creating it if needed.
+ * Each thread taking part in a parallel syntax check uses its own checker. The pool must not be
+ * used concurrently with changes to the context (use_sql_mode, use_server_version), so callers
+ * running checks in the background have to serialize both.
+ */
+MySQLSyntaxChecker *ParserContext::pooled_syntax_checker(size_t index)
+{
+  while (_checker_pool.size() <= index)
+  {
+    MySQLSyntaxChecker *checker = new MySQLSyntaxChecker(short_version(_version), _sql_mode, _filtered_charsets);
+    _checker_pool.push_back(checker);
+  }
+  return _checker_pool[index];
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -120,6 +141,8 @@ void ParserContext::use_sql_mode(const std::string &mode)
   _sql_mode = mode;
   _recognizer->set_sql_mode(mode);
   _syntax_checker->set_sql_mode(mode);
+  for (std::vector<MySQLSyntaxChecker *>::iterator iterator = _checker_pool.begin(); iterator != _checker_pool.end(); ++iterator)
+    (*iterator)->set_sql_mode(mode);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -143,6 +166,11 @@ void ParserContext::use_server_version(GrtVersionRef version)
 
   _recognizer->set_server_version(server_version);
   _syntax_checker->set_server_version(server_version);
+
+  // Charsets are only passed in on creation, so pooled checkers are recreated when needed.
+  for (std::vector<MySQLSyntaxChecker *>::iterator iterator = _checker_pool.begin(); iterator != _checker_pool.end(); ++iterator)
+    delete *iterator;
+  _checker_pool.clear();
 }
 
 //--------------------------------------------------------------------------------------------------
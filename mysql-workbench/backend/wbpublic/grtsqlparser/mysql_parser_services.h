@@ -48,6 +48,7 @@ namespace parser {
   private:
     MySQLRecognizer *_recognizer;
     MySQLSyntaxChecker *_syntax_checker;
+    std::vector<MySQLSyntaxChecker *> _checker_pool; // Additional checkers for parallel syntax checks.
 
     GrtVersionRef _version;
     bool _case_sensitive;
@@ -63,6 +64,7 @@ namespace parser {
 
     MySQLRecognizer *recognizer() { return _recognizer; };
     MySQLSyntaxChecker *syntax_checker() { return _syntax_checker; };
+    MySQLSyntaxChecker *pooled_syntax_checker(size_t index);
     boost::shared_ptr<MySQLScanner> createScanner(const std::string &text); // The scanner uses the same version etc as the other recognizers.
     boost::shared_ptr<MySQLQueryIdentifier> createQueryIdentifier();
 
@@ -111,6 +113,9 @@ namespace parser {
       const std::string &sql, grt::DictRef options) = 0;
 
     virtual size_t checkSqlSyntax(ParserContext::Ref context, const char *sql, size_t length, MySQLQueryType type) = 0;
+    virtual size_t checkSqlSyntaxBatch(ParserContext::Ref context, const char *sql,
+      const std::vector<std::pair<size_t, size_t> > &ranges, MySQLQueryType type,
+      std::vector<ParserErrorEntry> &errors) = 0;
     virtual size_t renameSchemaReferences(parser::ParserContext::Ref context, db_mysql_CatalogRef catalog,
       const std::string old_name, const std::string new_name) = 0;
 
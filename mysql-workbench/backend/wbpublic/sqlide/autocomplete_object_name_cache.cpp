@@ -21,8 +21,10 @@
 #include <sqlite/query.hpp>
 #include <sqlite/database_exception.hpp>
 #include <glib.h>
+#include <algorithm>
 
 #include "autocomplete_object_name_cache.h"
+#include "fuzzy_matcher.h"
 #include "base/string_utilities.h"
 #include "base/log.h"
 #include "base/file_utilities.h"
@@ -38,13 +40,147 @@ DEFAULT_LOG_DOMAIN("AutoCCache");
 //  and when queried (for the others). After that no fetch is performed anymore until an explicit
 //  refresh is requested by the application (via any of the refresh_* functions).
 
+// The number of entries a fuzzy lookup returns at most (the best ones).
+#define MAX_FUZZY_MATCHES 500
+
+// The number of names taken from executed statements which are remembered for ranking.
+#define MAX_RECENT_NAMES 1000
+
+// Only the start of big statements (e.g. long INSERTs) is scanned for recent names.
+#define MAX_RECENT_SCAN_LENGTH 65536
+
+// Cache tables that consist only of a single column (name).
+static const char *single_param_caches[] = {"variables", "engines", "tablespaces", "logfile_groups", "udfs",
+  "charsets", "collations"};
+
+// Cache tables that consist of a name and a schema column.
+static const char *dual_param_caches[] = {"tables", "views", "functions", "procedures", "events"};
+
+// Cache tables that consist of a name, a schema and a table column.
+static const char *triple_param_caches[] = {"columns", "triggers"};
+
+// Names fetched by a bulk refresh, per schema (and table).
+struct AutoCompleteCache::SchemaObjects
+{
+  typedef std::map<std::string, std::vector<std::string> > Names;
+  typedef std::map<std::string, Names> TableNames;
+
+  std::vector<std::string> schemas; // The schemas that were refreshed.
+  std::map<std::string, std::string> change_markers;
+  Names tables;
+  Names views;
+  Names procedures;
+  Names functions;
+  Names events;
+  TableNames columns;
+  TableNames triggers;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Names are compared case insensitively for ASCII letters only, which is what sqlite's LIKE did
+ * when the lookups still went to the cache db.
+ */
+static std::string fold_name(const std::string &name)
+{
+  std::string result(name);
+  for (std::string::iterator i = result.begin(); i != result.end(); ++i)
+    if (*i >= 'A' && *i <= 'Z')
+      *i += 'a' - 'A';
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Replaces the names in the index. Empty names are skipped, as the cache db uses them to mark a fetch
+ * that is underway and they must never show up in lookups.
+ */
+void AutoCompleteCache::NameIndex::assign(const std::vector<std::string> &names)
+{
+  _entries.clear();
+  _entries.reserve(names.size());
+  for (std::vector<std::string>::const_iterator i = names.begin(); i != names.end(); ++i)
+  {
+    if (i->empty())
+      continue;
+
+    Entry entry;
+    entry.folded_name = fold_name(*i);
+    entry.name = *i;
+    entry.mask = FuzzyMatcher::char_mask(*i);
+    _entries.push_back(entry);
+  }
+  std::sort(_entries.begin(), _entries.end());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void AutoCompleteCache::NameIndex::get_matching(const std::string &folded_prefix,
+  std::vector<std::string> &result) const
+{
+  Entry key;
+  key.folded_name = folded_prefix;
+  std::vector<Entry>::const_iterator i = std::lower_bound(_entries.begin(), _entries.end(), key);
+  for (; i != _entries.end() && i->folded_name.compare(0, folded_prefix.size(), folded_prefix) == 0; ++i)
+    result.push_back(i->name);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void AutoCompleteCache::NameIndex::get_fuzzy_matching(const FuzzyMatcher &matcher,
+  std::vector<std::pair<int, std::string> > &result) const
+{
+  for (std::vector<Entry>::const_iterator i = _entries.begin(); i != _entries.end(); ++i)
+  {
+    if (!matcher.might_match(i->mask))
+      continue;
+
+    int score = matcher.score(i->name);
+    if (score != FuzzyMatcher::NO_MATCH)
+      result.push_back(std::make_pair(score, i->name));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool AutoCompleteCache::NameIndex::Entry::operator < (const Entry &other) const
+{
+  int result = folded_name.compare(other.folded_name);
+  if (result == 0)
+    result = name.compare(other.name);
+  return result < 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+AutoCompleteCache::NameIndexKey::NameIndexKey(const std::string &schema_, const std::string &table_)
+  : folded_schema(fold_name(schema_)), folded_table(fold_name(table_)), schema(schema_), table(table_)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool AutoCompleteCache::NameIndexKey::operator < (const NameIndexKey &other) const
+{
+  int result = folded_schema.compare(other.folded_schema);
+  if (result == 0)
+    result = folded_table.compare(other.folded_table);
+  if (result == 0)
+    result = schema.compare(other.schema);
+  if (result == 0)
+    result = table.compare(other.table);
+  return result < 0;
+}
+
 //--------------------------------------------------------------------------------------------------
 
 AutoCompleteCache::AutoCompleteCache(const std::string &connection_id,
   boost::function<base::RecMutexLock (sql::Dbc_connection_handler::Ref &)> get_connection,
   const std::string &cache_dir, boost::function<void (bool)> feedback)
-  : _refresh_thread(NULL), _cache_working(1), _connection_id(connection_id),
-    _get_connection(get_connection), _shutdown(false)
+  : _fuzzy_matching(false), _recent_stamp(0), _refresh_thread(NULL), _cache_working(1),
+    _connection_id(connection_id), _get_connection(get_connection), _shutdown(false)
 {
   _feedback = feedback;
   std::string path = make_path(cache_dir, _connection_id) + ".cache";
@@ -60,6 +196,8 @@ AutoCompleteCache::AutoCompleteCache(const std::string &connection_id,
   // is open already that uses this cache.
   if (newDb)
     init_db();
+  else
+    load_indexes();
 
   log_debug2("Using autocompletion cache file %s\n", (make_path(cache_dir, _connection_id) + ".cache").c_str());
 
@@ -238,7 +376,19 @@ std::vector<std::string> AutoCompleteCache::get_matching_events(const std::strin
 //--------------------------------------------------------------------------------------------------
 
 /**
- * Core object retrieval function.
+ * Sort order for fuzzy matches: best score first, names with equal score alphabetically.
+ */
+static bool is_better_match(const std::pair<int, std::string> &left, const std::pair<int, std::string> &right)
+{
+  if (left.first != right.first)
+    return left.first > right.first;
+  return left.second < right.second;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Core object retrieval function. Lookups only use the in-memory indexes.
  */
 std::vector<std::string> AutoCompleteCache::get_matching_objects(const std::string &cache,
   const std::string &schema, const std::string &table, const std::string &prefix, RetrievalType type)
@@ -247,50 +397,193 @@ std::vector<std::string> AutoCompleteCache::get_matching_objects(const std::stri
   if (_shutdown)
     return std::vector<std::string>();
 
+  bool any_schema = type == RetrieveWithNoQualifier || schema.empty();
+  bool any_table = type != RetrieveWithFullQualifier || table.empty();
+
+  // Start at the first entry for the schema (and table), whatever the letter case of their names.
+  NameIndexKey first(any_schema ? "" : schema, any_table ? "" : table);
+  first.schema.clear();
+  first.table.clear();
+
+  std::vector<const NameIndex *> name_indexes;
+  CacheIndex &index = cache_index(cache);
+  CacheIndex::const_iterator i = any_schema ? index.begin() : index.lower_bound(first);
+  for (; i != index.end(); ++i)
+  {
+    if (!any_schema && i->first.folded_schema != first.folded_schema)
+      break;
+    if (!any_table && i->first.folded_table != first.folded_table)
+    {
+      if (!any_schema)
+        break;
+      continue;
+    }
+    name_indexes.push_back(&i->second);
+  }
+
   std::vector<std::string> items;
-  std::string sql;
-  switch (type)
+  if (_fuzzy_matching && !prefix.empty())
   {
-  case RetrieveWithNoQualifier:
-    sql = "SELECT name FROM " + cache + " WHERE name LIKE ? ESCAPE '\\'";
-    break;
-  case RetrieveWithSchemaQualifier:
-    sql = "SELECT name FROM " + cache + " WHERE schema_id LIKE ? ESCAPE '\\' "
-      "AND name LIKE ? ESCAPE '\\'";
-    break;
-  default: // RetrieveWithFullQualifier
-    sql = "SELECT name FROM " + cache + " WHERE schema_id LIKE ? ESCAPE '\\' "
-      "AND table_id LIKE ? ESCAPE '\\' AND name LIKE ? ESCAPE '\\'";
-    break;
+    FuzzyMatcher matcher(prefix);
+    std::vector<std::pair<int, std::string> > matches;
+    for (std::vector<const NameIndex *>::const_iterator j = name_indexes.begin(); j != name_indexes.end(); ++j)
+      (*j)->get_fuzzy_matching(matcher, matches);
+
+    size_t count = std::min(matches.size(), (size_t)MAX_FUZZY_MATCHES);
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), is_better_match);
+    items.reserve(count);
+    for (size_t j = 0; j < count; ++j)
+      items.push_back(matches[j].second);
   }
+  else
+  {
+    std::string folded_prefix = fold_name(prefix);
+    for (std::vector<const NameIndex *>::const_iterator j = name_indexes.begin(); j != name_indexes.end(); ++j)
+      (*j)->get_matching(folded_prefix, items);
+  }
+
+  return items;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void AutoCompleteCache::set_fuzzy_matching(bool flag)
+{
+  base::RecMutexLock lock(_sqconn_mutex);
+  _fuzzy_matching = flag;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static inline bool is_identifier_char(unsigned char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$'
+    || c >= 0x80;
+}
 
-  sqlite::query q(*_sqconn, sql);
-  switch (type)
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Remembers the identifiers (and keywords, which doesn't matter) used in the given statement.
+ * Quoted strings and comments are skipped. Names used more recently get a higher recency_score().
+ */
+void AutoCompleteCache::add_recent_names(const std::string &statement)
+{
+  std::vector<std::string> names;
+  const char *head = statement.c_str();
+  const char *end = head + std::min(statement.size(), (size_t)MAX_RECENT_SCAN_LENGTH);
+  while (head < end)
   {
-  case RetrieveWithNoQualifier:
-    q.bind(1, base::escape_sql_string(prefix, true) + "%");
-    break;
-  case RetrieveWithSchemaQualifier:
-    q.bind(1, schema.empty() ? "%" : base::escape_sql_string(schema, true));
-    q.bind(2, base::escape_sql_string(prefix, true) + "%");
-    break;
-  default: // RetrieveWithFullQualifier
-    q.bind(1, schema.empty() ? "%" : base::escape_sql_string(schema, true));
-    q.bind(2, table.empty() ? "%" : base::escape_sql_string(table, true));
-    q.bind(3, base::escape_sql_string(prefix, true) + "%");
-    break;
+    unsigned char c = *head;
+    switch (c)
+    {
+    case '\'':
+    case '"':
+    case '`':
+    {
+      const char *start = ++head;
+      while (head < end && *head != (char)c)
+      {
+        if (*head == '\\' && c != '`' && head + 1 < end)
+          ++head;
+        ++head;
+      }
+      if (c == '`' && head > start)
+        names.push_back(std::string(start, head));
+      ++head;
+      break;
+    }
+
+    case '#':
+      while (head < end && *head != '\n')
+        ++head;
+      break;
+
+    case '-':
+      if (head + 1 < end && head[1] == '-')
+      {
+        while (head < end && *head != '\n')
+          ++head;
+      }
+      else
+        ++head;
+      break;
+
+    case '/':
+      if (head + 1 < end && head[1] == '*')
+      {
+        head += 2;
+        while (head + 1 < end && !(head[0] == '*' && head[1] == '/'))
+          ++head;
+        head = std::min(head + 2, end);
+      }
+      else
+        ++head;
+      break;
+
+    default:
+      if (is_identifier_char(c))
+      {
+        const char *start = head;
+        bool is_number = true;
+        while (head < end && is_identifier_char(*head))
+        {
+          if (*head < '0' || *head > '9')
+            is_number = false;
+          ++head;
+        }
+        if (!is_number)
+          names.push_back(std::string(start, head));
+      }
+      else
+        ++head;
+      break;
+    }
   }
 
-  if (q.emit())
+  if (names.empty())
+    return;
+
+  base::RecMutexLock lock(_recent_mutex);
+  for (std::vector<std::string>::const_iterator name = names.begin(); name != names.end(); ++name)
+    _recent_names[fold_name(*name)] = ++_recent_stamp;
+
+  // Forget names not used within the last MAX_RECENT_NAMES names.
+  if (_recent_names.size() > MAX_RECENT_NAMES)
   {
-    boost::shared_ptr<sqlite::result> matches(q.get_result());
-    do
+    for (std::map<std::string, size_t>::iterator i = _recent_names.begin(); i != _recent_names.end();)
     {
-      items.push_back(matches->get_string(0));
-    } while (matches->next_row());
+      if (_recent_stamp - i->second >= MAX_RECENT_NAMES)
+        _recent_names.erase(i++);
+      else
+        ++i;
+    }
   }
+}
 
-  return items;
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns a value between 0 (not used recently) and 100 (used in the last statement) for the name.
+ */
+int AutoCompleteCache::recency_score(const std::string &name)
+{
+  base::RecMutexLock lock(_recent_mutex);
+  std::map<std::string, size_t>::const_iterator i = _recent_names.find(fold_name(name));
+  if (i == _recent_names.end())
+    return 0;
+
+  size_t age = _recent_stamp - i->second;
+  if (age >= MAX_RECENT_NAMES)
+    return 0;
+  return (int)(100 * (MAX_RECENT_NAMES - age) / MAX_RECENT_NAMES);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+AutoCompleteCache::CacheIndex &AutoCompleteCache::cache_index(const std::string &cache)
+{
+  return _indexes[cache];
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -334,12 +627,8 @@ bool AutoCompleteCache::refresh_schema_cache_if_needed(const std::string &schema
   // Add tasks to load various schema objects. They will then update the last_refresh value.
   log_debug3("schema %s is not cached, populating cache...\n", schema.c_str());
 
-  // Refreshing a schema implicitly refreshs its local objects too.
-  add_pending_refresh(RefreshTask::RefreshTables, schema);
-  add_pending_refresh(RefreshTask::RefreshViews, schema);
-  add_pending_refresh(RefreshTask::RefreshProcedures, schema);
-  add_pending_refresh(RefreshTask::RefreshFunctions, schema);
-  add_pending_refresh(RefreshTask::RefreshEvents, schema);
+  // Refreshing a schema implicitly refreshs its local objects too, all in one go.
+  add_pending_refresh(RefreshTask::RefreshSchemaObjects, schema);
 
   return true;
 }
@@ -388,6 +677,18 @@ void AutoCompleteCache::refresh_events()
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Schedules a refresh of all objects in the given schema (all schemas if empty), using a few set based
+ * queries instead of one per object type and table. Schemas whose objects did not change since the last
+ * bulk refresh are skipped.
+ */
+void AutoCompleteCache::refresh_schema_objects(const std::string &schema)
+{
+  add_pending_refresh(RefreshTask::RefreshSchemaObjects, schema);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void AutoCompleteCache::refresh_cache_thread()
 {
   log_debug2("entering worker thread\n");
@@ -465,6 +766,15 @@ void AutoCompleteCache::refresh_cache_thread()
           refreshEvents_w(task.schema_name);
 
         break;
+
+        case RefreshTask::RefreshSchemaObjects:
+        {
+          // Other schemas waiting for a bulk refresh are handled with the same queries.
+          std::vector<std::string> schemas(1, task.schema_name);
+          take_pending_refreshes(RefreshTask::RefreshSchemaObjects, schemas);
+          refresh_schema_objects_w(schemas);
+          break;
+        }
       }
     }
     catch (std::exception &exc)
@@ -956,6 +1266,144 @@ void AutoCompleteCache::refreshEvents_w(const std::string &schema)
 
 //--------------------------------------------------------------------------------------------------
 
+static std::string schema_filter(const char *column, const std::vector<std::string> &schemas)
+{
+  if (schemas.empty())
+    return "";
+
+  std::string list;
+  for (std::vector<std::string>::const_iterator i = schemas.begin(); i != schemas.end(); ++i)
+  {
+    if (!list.empty())
+      list += ", ";
+    list += base::sqlstring("?", 0) << *i;
+  }
+  return std::string(" WHERE ") + column + " IN (" + list + ")";
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Bulk refresh of tables, views, columns, routines, triggers and events for the given schemas (or all
+ * schemas if one of them is empty). First a fingerprint of the object names is computed on the server
+ * for each schema and compared to the one stored with the last refresh, so that unchanged schemas
+ * need no further work. The objects of the other schemas are then fetched with one query per object type.
+ */
+void AutoCompleteCache::refresh_schema_objects_w(const std::vector<std::string> &schemas)
+{
+  bool all_schemas = std::find(schemas.begin(), schemas.end(), "") != schemas.end();
+  std::map<std::string, std::string> stored_markers = load_change_markers();
+
+  SchemaObjects objects;
+  {
+    sql::Dbc_connection_handler::Ref conn;
+    base::RecMutexLock lock(_get_connection(conn));
+
+    std::auto_ptr<sql::Statement> statement(conn->ref->createStatement());
+    std::vector<std::string> filter_schemas;
+    if (!all_schemas)
+      filter_schemas = schemas;
+
+    std::string sql =
+      "SELECT TABLE_SCHEMA, 'T', COUNT(*), SUM(CRC32(CONCAT(TABLE_NAME, '/', TABLE_TYPE))) FROM information_schema.TABLES"
+      + schema_filter("TABLE_SCHEMA", filter_schemas) + " GROUP BY TABLE_SCHEMA UNION ALL "
+      "SELECT TABLE_SCHEMA, 'C', COUNT(*), SUM(CRC32(CONCAT(TABLE_NAME, '/', COLUMN_NAME))) FROM information_schema.COLUMNS"
+      + schema_filter("TABLE_SCHEMA", filter_schemas) + " GROUP BY TABLE_SCHEMA UNION ALL "
+      "SELECT ROUTINE_SCHEMA, 'R', COUNT(*), SUM(CRC32(CONCAT(ROUTINE_NAME, '/', ROUTINE_TYPE))) FROM information_schema.ROUTINES"
+      + schema_filter("ROUTINE_SCHEMA", filter_schemas) + " GROUP BY ROUTINE_SCHEMA UNION ALL "
+      "SELECT TRIGGER_SCHEMA, 'G', COUNT(*), SUM(CRC32(CONCAT(EVENT_OBJECT_TABLE, '/', TRIGGER_NAME))) FROM information_schema.TRIGGERS"
+      + schema_filter("TRIGGER_SCHEMA", filter_schemas) + " GROUP BY TRIGGER_SCHEMA UNION ALL "
+      "SELECT EVENT_SCHEMA, 'E', COUNT(*), SUM(CRC32(EVENT_NAME)) FROM information_schema.EVENTS"
+      + schema_filter("EVENT_SCHEMA", filter_schemas) + " GROUP BY EVENT_SCHEMA ORDER BY 1, 2";
+
+    std::map<std::string, std::string> markers;
+    {
+      std::auto_ptr<sql::ResultSet> rs(statement->executeQuery(sql));
+      while (rs.get() && rs->next() && !_shutdown)
+        markers[rs->getString(1)] += rs->getString(2) + rs->getString(3) + ":" + rs->getString(4) + ";";
+    }
+
+    // Schemas without any object have no marker. They might have had objects before, though.
+    if (!all_schemas)
+      for (std::vector<std::string>::const_iterator i = schemas.begin(); i != schemas.end(); ++i)
+        markers[*i];
+
+    for (std::map<std::string, std::string>::const_iterator i = markers.begin(); i != markers.end(); ++i)
+    {
+      std::map<std::string, std::string>::const_iterator stored = stored_markers.find(i->first);
+      if (stored == stored_markers.end() || stored->second != i->second)
+      {
+        objects.schemas.push_back(i->first);
+        objects.change_markers[i->first] = i->second;
+      }
+    }
+
+    log_debug2("Bulk refresh: %li of %li schemas changed\n", (long)objects.schemas.size(), (long)markers.size());
+    if (objects.schemas.empty() || _shutdown)
+      return;
+
+    // The list of schemas is only needed if some of those requested are unchanged.
+    if (all_schemas && objects.schemas.size() == markers.size())
+      filter_schemas.clear();
+    else
+      filter_schemas = objects.schemas;
+
+    {
+      sql = "SELECT TABLE_SCHEMA, TABLE_NAME, TABLE_TYPE FROM information_schema.TABLES"
+        + schema_filter("TABLE_SCHEMA", filter_schemas);
+      std::auto_ptr<sql::ResultSet> rs(statement->executeQuery(sql));
+      while (rs.get() && rs->next() && !_shutdown)
+      {
+        if (rs->getString(3) == "VIEW")
+          objects.views[rs->getString(1)].push_back(rs->getString(2));
+        else
+          objects.tables[rs->getString(1)].push_back(rs->getString(2));
+      }
+    }
+
+    {
+      sql = "SELECT TABLE_SCHEMA, TABLE_NAME, COLUMN_NAME FROM information_schema.COLUMNS"
+        + schema_filter("TABLE_SCHEMA", filter_schemas) + " ORDER BY TABLE_SCHEMA, TABLE_NAME, ORDINAL_POSITION";
+      std::auto_ptr<sql::ResultSet> rs(statement->executeQuery(sql));
+      while (rs.get() && rs->next() && !_shutdown)
+        objects.columns[rs->getString(1)][rs->getString(2)].push_back(rs->getString(3));
+    }
+
+    {
+      sql = "SELECT ROUTINE_SCHEMA, ROUTINE_NAME, ROUTINE_TYPE FROM information_schema.ROUTINES"
+        + schema_filter("ROUTINE_SCHEMA", filter_schemas);
+      std::auto_ptr<sql::ResultSet> rs(statement->executeQuery(sql));
+      while (rs.get() && rs->next() && !_shutdown)
+      {
+        if (rs->getString(3) == "FUNCTION")
+          objects.functions[rs->getString(1)].push_back(rs->getString(2));
+        else
+          objects.procedures[rs->getString(1)].push_back(rs->getString(2));
+      }
+    }
+
+    {
+      sql = "SELECT TRIGGER_SCHEMA, EVENT_OBJECT_TABLE, TRIGGER_NAME FROM information_schema.TRIGGERS"
+        + schema_filter("TRIGGER_SCHEMA", filter_schemas);
+      std::auto_ptr<sql::ResultSet> rs(statement->executeQuery(sql));
+      while (rs.get() && rs->next() && !_shutdown)
+        objects.triggers[rs->getString(1)][rs->getString(2)].push_back(rs->getString(3));
+    }
+
+    {
+      sql = "SELECT EVENT_SCHEMA, EVENT_NAME FROM information_schema.EVENTS" + schema_filter("EVENT_SCHEMA", filter_schemas);
+      std::auto_ptr<sql::ResultSet> rs(statement->executeQuery(sql));
+      while (rs.get() && rs->next() && !_shutdown)
+        objects.events[rs->getString(1)].push_back(rs->getString(2));
+    }
+  }
+
+  if (!_shutdown)
+    update_schema_objects(objects);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void AutoCompleteCache::init_db()
 {
   log_info("Initializing autocompletion cache for %s\n", _connection_id.c_str());
@@ -980,47 +1428,38 @@ void AutoCompleteCache::init_db()
     log_error("Error creating cache db.schemas: %s\n", exc.what());
   }
 
-  // Creation of cache tables that consist only of a single column (name).
-  std::string single_param_caches[] = {"variables", "engines", "tablespaces", "logfile_groups", "udfs", "charsets", "collations"};
-
   for (size_t i = 0; i < sizeof(single_param_caches) / sizeof(single_param_caches[0]); ++i)
   {
     try
     {
-      std::string sql = "create table " + single_param_caches[i] + " (name varchar(64) primary key)";
+      std::string sql = std::string("create table ") + single_param_caches[i] + " (name varchar(64) primary key)";
       sqlite::execute(*_sqconn, sql, true);
     }
     catch (std::exception &exc)
     {
-      log_error("Error creating cache db.%s: %s\n", single_param_caches[i].c_str(), exc.what());
+      log_error("Error creating cache db.%s: %s\n", single_param_caches[i], exc.what());
     }
   }
 
-  // Creation of cache tables that consist of a name and a schema column.
-  std::string dual_param_caches[] = {"tables", "views", "functions", "procedures", "events"};
-
   for (size_t i = 0; i < sizeof(dual_param_caches) / sizeof(dual_param_caches[0]); ++i)
   {
     try
     {
-      std::string sql = "create table " + dual_param_caches[i] + " (schema_id varchar(64) NOT NULL, "
+      std::string sql = std::string("create table ") + dual_param_caches[i] + " (schema_id varchar(64) NOT NULL, "
         " name varchar(64) NOT NULL, primary key (schema_id, name))";
       sqlite::execute(*_sqconn, sql, true);
     }
     catch (std::exception &exc)
     {
-      log_error("Error creating cache db.%s: %s\n", dual_param_caches[i].c_str(), exc.what());
+      log_error("Error creating cache db.%s: %s\n", dual_param_caches[i], exc.what());
     }
   }
 
-  // Creation of cache tables that consist of a name, a schema and a table column.
-  std::string triple_param_caches[] = {"columns", "triggers"};
-
   for (size_t i = 0; i < sizeof(triple_param_caches) / sizeof(triple_param_caches[0]); ++i)
   {
     try
     {
-      std::string sql = "create table " + triple_param_caches[i] + " (schema_id varchar(64) NOT NULL, "
+      std::string sql = std::string("create table ") + triple_param_caches[i] + " (schema_id varchar(64) NOT NULL, "
         "table_id varchar(64) NOT NULL, name varchar(64) NOT NULL, "
         "primary key (schema_id, table_id, name), "
         "foreign key (schema_id, table_id) references tables (schema_id, name) on delete cascade)";
@@ -1028,7 +1467,7 @@ void AutoCompleteCache::init_db()
     }
     catch (std::exception &exc)
     {
-      log_error("Error creating cache db.%s: %s\n", triple_param_caches[i].c_str(), exc.what());
+      log_error("Error creating cache db.%s: %s\n", triple_param_caches[i], exc.what());
     }
   }
 
@@ -1036,6 +1475,60 @@ void AutoCompleteCache::init_db()
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Fills the in-memory indexes from an existing cache db.
+ */
+void AutoCompleteCache::load_indexes()
+{
+  std::vector<std::string> caches;
+  caches.push_back("schemas");
+  caches.insert(caches.end(), single_param_caches,
+    single_param_caches + sizeof(single_param_caches) / sizeof(single_param_caches[0]));
+  size_t dual_start = caches.size();
+  caches.insert(caches.end(), dual_param_caches,
+    dual_param_caches + sizeof(dual_param_caches) / sizeof(dual_param_caches[0]));
+  size_t triple_start = caches.size();
+  caches.insert(caches.end(), triple_param_caches,
+    triple_param_caches + sizeof(triple_param_caches) / sizeof(triple_param_caches[0]));
+
+  for (size_t i = 0; i < caches.size(); ++i)
+  {
+    try
+    {
+      std::string sql;
+      if (i < dual_start)
+        sql = "select '', '', name from " + caches[i];
+      else if (i < triple_start)
+        sql = "select schema_id, '', name from " + caches[i];
+      else
+        sql = "select schema_id, table_id, name from " + caches[i];
+
+      std::map<std::pair<std::string, std::string>, std::vector<std::string> > names;
+      sqlite::query q(*_sqconn, sql);
+      if (q.emit())
+      {
+        boost::shared_ptr<sqlite::result> rows(q.get_result());
+        do
+        {
+          names[std::make_pair(rows->get_string(0), rows->get_string(1))].push_back(rows->get_string(2));
+        }
+        while (rows->next_row());
+      }
+
+      CacheIndex &index = cache_index(caches[i]);
+      for (std::map<std::pair<std::string, std::string>, std::vector<std::string> >::const_iterator j = names.begin();
+        j != names.end(); ++j)
+        index[NameIndexKey(j->first.first, j->first.second)].assign(j->second);
+    }
+    catch (std::exception &exc)
+    {
+      log_error("Error loading cache db.%s: %s\n", caches[i].c_str(), exc.what());
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
 bool AutoCompleteCache::is_schema_list_fetch_done()
 {
   // TODO: optimize this.
@@ -1118,6 +1611,10 @@ void AutoCompleteCache::update_schemas(const std::vector<std::string> &schemas)
     if (_shutdown)
       return;
 
+    CacheIndex &index = cache_index("schemas");
+    index.clear();
+    index[NameIndexKey("", "")].assign(schemas);
+
     std::map<std::string, int> old_schema_update_times;
     {
       sqlite::query q(*_sqconn, "select name, last_refresh from schemas");
@@ -1204,6 +1701,28 @@ void AutoCompleteCache::update_events(const std::string &schema, base::StringLis
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Replaces the columns of all tables and views in the schema (e.g. after a bulk fetch done elsewhere).
+ */
+void AutoCompleteCache::update_columns(const std::string &schema,
+  const std::map<std::string, std::vector<std::string> > &columns)
+{
+  update_table_object_names("columns", schema, columns);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Replaces the triggers of all tables in the schema.
+ */
+void AutoCompleteCache::update_triggers(const std::string &schema,
+  const std::map<std::string, std::vector<std::string> > &triggers)
+{
+  update_table_object_names("triggers", schema, triggers);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 /**
  * Central update routine for cache tables that have a single column "name".
  */
@@ -1215,6 +1734,10 @@ void AutoCompleteCache::update_object_names(const std::string &cache, const std:
     if (_shutdown)
       return;
 
+    CacheIndex &index = cache_index(cache);
+    index.clear();
+    index[NameIndexKey("", "")].assign(objects);
+
     sqlide::Sqlite_transaction_guarder trans(_sqconn, false);
     {
       sqlite::execute del(*_sqconn, "delete from " + cache);
@@ -1252,29 +1775,186 @@ void AutoCompleteCache::update_object_names(const std::string &cache, const std:
       return;
 
     sqlide::Sqlite_transaction_guarder trans(_sqconn, false); // Will be committed when we go out of the scope.
+    store_object_names(cache, schema, std::vector<std::string>(objects->begin(), objects->end()));
+  }
+  catch (std::exception &exc)
+  {
+    log_error("Exception caught while updating %s name cache for schema %s: %s\n", cache.c_str(),
+      schema.c_str(), exc.what());
+  }
+}
 
-    sqlite::execute del(*_sqconn, "delete from " + cache + " where schema_id = ?");
-    del.bind(1, schema);
-    del.emit();
+//--------------------------------------------------------------------------------------------------
 
-    sqlite::query insert(*_sqconn, "insert into " + cache + " (schema_id, name) values (?, ?)");
-    insert.bind(1, schema);
-    for (std::list<std::string>::const_iterator i = objects->begin(); i != objects->end(); ++i)
+void AutoCompleteCache::update_table_object_names(const std::string &cache, const std::string &schema,
+  const std::map<std::string, std::vector<std::string> > &objects)
+{
+  try
+  {
+    base::RecMutexLock lock(_sqconn_mutex);
+    if (_shutdown)
+      return;
+
+    sqlide::Sqlite_transaction_guarder trans(_sqconn, false);
+    store_table_object_names(cache, schema, objects);
+  }
+  catch (std::exception &exc)
+  {
+    log_error("Exception caught while updating %s name cache for schema %s: %s\n", cache.c_str(),
+      schema.c_str(), exc.what());
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Replaces the objects of a schema in the index and the cache db. The caller must hold the sqlite lock
+ * and a transaction.
+ */
+void AutoCompleteCache::store_object_names(const std::string &cache, const std::string &schema,
+  const std::vector<std::string> &objects)
+{
+  cache_index(cache)[NameIndexKey(schema, "")].assign(objects);
+
+  sqlite::execute del(*_sqconn, "delete from " + cache + " where schema_id = ?");
+  del.bind(1, schema);
+  del.emit();
+
+  sqlite::query insert(*_sqconn, "insert into " + cache + " (schema_id, name) values (?, ?)");
+  insert.bind(1, schema);
+  for (std::vector<std::string>::const_iterator i = objects.begin(); i != objects.end(); ++i)
+  {
+    insert.bind(2, *i);
+    insert.emit();
+    insert.clear();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Replaces the table local objects of all tables in a schema. The caller must hold the sqlite lock
+ * and a transaction.
+ */
+void AutoCompleteCache::store_table_object_names(const std::string &cache, const std::string &schema,
+  const std::map<std::string, std::vector<std::string> > &objects)
+{
+  CacheIndex &index = cache_index(cache);
+  NameIndexKey first(schema, "");
+  first.schema.clear();
+  for (CacheIndex::iterator i = index.lower_bound(first); i != index.end() && i->first.folded_schema == first.folded_schema;)
+  {
+    if (i->first.schema == schema)
+      index.erase(i++);
+    else
+      ++i;
+  }
+
+  sqlite::execute del(*_sqconn, "delete from " + cache + " where schema_id = ?");
+  del.bind(1, schema);
+  del.emit();
+
+  sqlite::query insert(*_sqconn, "insert into " + cache + " (schema_id, table_id, name) values (?, ?, ?)");
+  insert.bind(1, schema);
+  for (std::map<std::string, std::vector<std::string> >::const_iterator table = objects.begin(); table != objects.end();
+    ++table)
+  {
+    index[NameIndexKey(schema, table->first)].assign(table->second);
+
+    insert.bind(2, table->first);
+    for (std::vector<std::string>::const_iterator i = table->second.begin(); i != table->second.end(); ++i)
     {
-      insert.bind(2, *i);
+      insert.bind(3, *i);
       insert.emit();
       insert.clear();
     }
   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Stores the result of a bulk refresh, all schemas in a single transaction.
+ */
+void AutoCompleteCache::update_schema_objects(const SchemaObjects &objects)
+{
+  static const std::vector<std::string> no_names;
+  static const std::map<std::string, std::vector<std::string> > no_table_names;
+
+  try
+  {
+    base::RecMutexLock lock(_sqconn_mutex);
+    if (_shutdown)
+      return;
+
+    sqlide::Sqlite_transaction_guarder trans(_sqconn, false);
+    sqlite::execute store_marker(*_sqconn, "insert or replace into meta (name, value) values (?, ?)");
+    for (std::vector<std::string>::const_iterator schema = objects.schemas.begin(); schema != objects.schemas.end();
+      ++schema)
+    {
+      SchemaObjects::Names::const_iterator names;
+      names = objects.tables.find(*schema);
+      store_object_names("tables", *schema, names == objects.tables.end() ? no_names : names->second);
+      names = objects.views.find(*schema);
+      store_object_names("views", *schema, names == objects.views.end() ? no_names : names->second);
+      names = objects.procedures.find(*schema);
+      store_object_names("procedures", *schema, names == objects.procedures.end() ? no_names : names->second);
+      names = objects.functions.find(*schema);
+      store_object_names("functions", *schema, names == objects.functions.end() ? no_names : names->second);
+      names = objects.events.find(*schema);
+      store_object_names("events", *schema, names == objects.events.end() ? no_names : names->second);
+
+      SchemaObjects::TableNames::const_iterator table_names;
+      table_names = objects.columns.find(*schema);
+      store_table_object_names("columns", *schema, table_names == objects.columns.end() ? no_table_names : table_names->second);
+      table_names = objects.triggers.find(*schema);
+      store_table_object_names("triggers", *schema, table_names == objects.triggers.end() ? no_table_names : table_names->second);
+
+      touch_schema_record(*schema);
+
+      store_marker.bind(1, "marker:" + *schema);
+      store_marker.bind(2, objects.change_markers.find(*schema)->second);
+      store_marker.emit();
+      store_marker.clear();
+    }
+  }
   catch (std::exception &exc)
   {
-    log_error("Exception caught while updating %s name cache for schema %s: %s\n", cache.c_str(),
-      schema.c_str(), exc.what());
+    log_error("Exception caught while storing bulk refresh results: %s\n", exc.what());
   }
 }
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Returns the schema change markers stored by previous bulk refreshes.
+ */
+std::map<std::string, std::string> AutoCompleteCache::load_change_markers()
+{
+  std::map<std::string, std::string> markers;
+  try
+  {
+    base::RecMutexLock lock(_sqconn_mutex);
+    sqlite::query q(*_sqconn, "select substr(name, 8), value from meta where name like 'marker:%'");
+    if (q.emit())
+    {
+      boost::shared_ptr<sqlite::result> rows(q.get_result());
+      do
+      {
+        markers[rows->get_string(0)] = rows->get_string(1);
+      }
+      while (rows->next_row());
+    }
+  }
+  catch (std::exception &exc)
+  {
+    log_error("Exception caught while loading schema change markers: %s\n", exc.what());
+  }
+  return markers;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void AutoCompleteCache::update_object_names(const std::string &cache, const std::string &schema,
   const std::string &table, const std::vector<std::string> &objects)
 {
@@ -1284,6 +1964,8 @@ void AutoCompleteCache::update_object_names(const std::string &cache, const std:
     if (_shutdown)
       return;
 
+    cache_index(cache)[NameIndexKey(schema, table)].assign(objects);
+
     sqlide::Sqlite_transaction_guarder trans(_sqconn, false);
 
     // Clear records for this schema/table.
@@ -1342,6 +2024,7 @@ void AutoCompleteCache::add_pending_refresh(RefreshTask::RefreshType type, const
       case RefreshTask::RefreshProcedures:
       case RefreshTask::RefreshFunctions:
       case RefreshTask::RefreshEvents:
+      case RefreshTask::RefreshSchemaObjects:
         found = i->schema_name == schema;
         break;
 
@@ -1386,6 +2069,26 @@ bool AutoCompleteCache::get_pending_refresh(RefreshTask &task)
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Removes all pending tasks of the given type and adds their schemas to the list.
+ */
+void AutoCompleteCache::take_pending_refreshes(RefreshTask::RefreshType type, std::vector<std::string> &schemas)
+{
+  base::RecMutexLock lock(_pending_mutex);
+  for (std::list<RefreshTask>::iterator i = _pending_tasks.begin(); i != _pending_tasks.end();)
+  {
+    if (i->type == type)
+    {
+      schemas.push_back(i->schema_name);
+      i = _pending_tasks.erase(i);
+    }
+    else
+      ++i;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void AutoCompleteCache::create_worker_thread()
 {
   // Fire up thread to start caching.
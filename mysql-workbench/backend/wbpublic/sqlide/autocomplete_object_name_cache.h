@@ -28,6 +28,11 @@
 
 #include "cppdbc.h"
 
+#include <map>
+#include <boost/cstdint.hpp>
+
+class FuzzyMatcher;
+
 class WBPUBLICBACKEND_PUBLIC_FUNC AutoCompleteCache
 {
 public:
@@ -79,6 +84,7 @@ public:
   void refresh_tablespaces();    // Logfile groups and tablespaces are unqualified,
   void refresh_logfile_groups(); // even though they belong to a specific table.
   void refresh_events();
+  void refresh_schema_objects(const std::string &schema = ""); // Bulk refresh, all schemas if none is given.
 
   // Update functions that can also be called from outside.
   void update_schemas(const std::vector<std::string> &schemas);
@@ -87,6 +93,16 @@ public:
   void update_procedures(const std::string &schema, base::StringListPtr tables);
   void update_functions(const std::string &schema, base::StringListPtr tables);
   void update_events(const std::string &schema, base::StringListPtr events);
+  void update_columns(const std::string &schema, const std::map<std::string, std::vector<std::string> > &columns);
+  void update_triggers(const std::string &schema, const std::map<std::string, std::vector<std::string> > &triggers);
+
+  // Fuzzy matching makes the data retrieval functions return all names containing the typed chars
+  // in order, best matches first (see FuzzyMatcher), instead of only names starting with them.
+  void set_fuzzy_matching(bool flag);
+
+  // Names used in recently executed statements, for ranking completion entries.
+  void add_recent_names(const std::string &statement);
+  int recency_score(const std::string &name);
 
   // Status functions.
   bool is_schema_list_fetch_done();
@@ -115,7 +131,8 @@ private:
       RefreshTableSpaces,
       RefreshCharsets,
       RefreshCollations,
-      RefreshEvents
+      RefreshEvents,
+      RefreshSchemaObjects
     } type;
     std::string schema_name;
     std::string table_name;
@@ -139,7 +156,46 @@ private:
     RetrieveWithFullQualifier
   };
 
+  // In-memory copy of the names in a cache table, used for all lookups. The sqlite db only persists them.
+  // Names are kept sorted by their case folded form, so a prefix lookup is a binary search. The char mask
+  // of each name allows to skip most non-matching names quickly in a fuzzy lookup.
+  class NameIndex
+  {
+  public:
+    void assign(const std::vector<std::string> &names);
+    void get_matching(const std::string &folded_prefix, std::vector<std::string> &result) const;
+    void get_fuzzy_matching(const FuzzyMatcher &matcher, std::vector<std::pair<int, std::string> > &result) const;
+    bool empty() const { return _entries.empty(); }
+
+  private:
+    struct Entry
+    {
+      std::string folded_name;
+      std::string name;
+      boost::uint64_t mask;
+
+      bool operator < (const Entry &other) const;
+    };
+    std::vector<Entry> _entries;
+  };
+
+  // Names are grouped by their qualifier. Schema and table are stored case folded (for lookup, which
+  // ignores case like the old LIKE queries did) and as is (for updates, which replace exact matches).
+  struct NameIndexKey
+  {
+    std::string folded_schema;
+    std::string folded_table;
+    std::string schema;
+    std::string table;
+
+    NameIndexKey(const std::string &schema_, const std::string &table_);
+    bool operator < (const NameIndexKey &other) const;
+  };
+  typedef std::map<NameIndexKey, NameIndex> CacheIndex;
+
   void init_db();
+  void load_indexes();
+  CacheIndex &cache_index(const std::string &cache);
 
   static void *_refresh_cache_thread(void *);
   void refresh_cache_thread();
@@ -158,6 +214,7 @@ private:
   void refresh_logfile_groups_w();
   void refresh_tablespaces_w();
   void refreshEvents_w(const std::string &schema);
+  void refresh_schema_objects_w(const std::vector<std::string> &schemas);
 
   void update_object_names(const std::string &cache, const std::vector<std::string> &objects);
   void update_object_names(const std::string &cache,
@@ -167,6 +224,15 @@ private:
                            const std::string &schema,
                            const std::string &table,
                            const std::vector<std::string> &objects);
+  void update_table_object_names(const std::string &cache, const std::string &schema,
+    const std::map<std::string, std::vector<std::string> > &objects);
+
+  struct SchemaObjects;
+  void update_schema_objects(const SchemaObjects &objects);
+  void store_object_names(const std::string &cache, const std::string &schema, const std::vector<std::string> &objects);
+  void store_table_object_names(const std::string &cache, const std::string &schema,
+    const std::map<std::string, std::vector<std::string> > &objects);
+  std::map<std::string, std::string> load_change_markers();
 
   std::vector<std::string> get_matching_objects(const std::string &cache,
                                                 const std::string &schema,
@@ -177,12 +243,19 @@ private:
   bool is_fetch_done(const std::string &cache, const std::string &schema);
 
   bool get_pending_refresh(RefreshTask &task);
+  void take_pending_refreshes(RefreshTask::RefreshType type, std::vector<std::string> &schemas);
   void add_pending_refresh(RefreshTask::RefreshType type, const std::string &schema = "",
                            const std::string &table = "");
   void create_worker_thread();
   
-  base::RecMutex _sqconn_mutex;
+  base::RecMutex _sqconn_mutex; // Also protects the indexes.
   sqlite::connection *_sqconn;
+  std::map<std::string, CacheIndex> _indexes;
+  bool _fuzzy_matching;
+
+  base::RecMutex _recent_mutex; // Protects the recent names.
+  std::map<std::string, size_t> _recent_names; // Case folded name + stamp of its last use.
+  size_t _recent_stamp;
 
   GThread *_refresh_thread;
   base::Semaphore _cache_working;
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "fuzzy_matcher.h"
+
+#include <algorithm>
+
+// Score parts. A matched char is worth MATCH_SCORE plus bonuses, skipped chars cost one point each
+// (limited per gap, so a single big gap doesn't outweigh everything else).
+#define MATCH_SCORE        16
+#define WORD_START_BONUS   10
+#define RUN_BONUS           6
+#define MAX_GAP_PENALTY     4
+#define MAX_LEADING_PENALTY 8
+#define PREFIX_BONUS       48
+#define EXACT_BONUS        48
+
+//--------------------------------------------------------------------------------------------------
+
+static inline unsigned char fold_char(unsigned char c)
+{
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static inline int char_bit(unsigned char c)
+{
+  c = fold_char(c);
+  if (c >= 'a' && c <= 'z')
+    return c - 'a';
+  if (c >= '0' && c <= '9')
+    return 26 + c - '0';
+  if (c == '_')
+    return 36;
+  if (c == '$')
+    return 37;
+  return 38 + c % 26; // Anything else (incl. bytes of UTF-8 sequences) shares a few bits.
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static inline bool is_lower(unsigned char c)
+{
+  return c >= 'a' && c <= 'z';
+}
+
+static inline bool is_upper(unsigned char c)
+{
+  return c >= 'A' && c <= 'Z';
+}
+
+static inline bool is_digit(unsigned char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+/**
+ * A word starts at the begin of the name, after a separator, where letters and digits change
+ * and at an upper case letter following a lower case one.
+ */
+static bool is_word_start(const std::string &name, size_t position)
+{
+  if (position == 0)
+    return true;
+
+  unsigned char previous = name[position - 1];
+  unsigned char c = name[position];
+  if (previous >= 0x80 || c >= 0x80)
+    return false;
+
+  bool previous_alnum = is_lower(previous) || is_upper(previous) || is_digit(previous);
+  if (!previous_alnum)
+    return true;
+  if (is_digit(c) != is_digit(previous))
+    return true;
+  return is_upper(c) && is_lower(previous);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+FuzzyMatcher::FuzzyMatcher(const std::string &pattern)
+  : _pattern(pattern), _mask(char_mask(pattern))
+{
+  for (std::string::iterator i = _pattern.begin(); i != _pattern.end(); ++i)
+    *i = fold_char(*i);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns a bit set of the (case folded) chars in the text. A name can only match if its mask contains
+ * all bits of the pattern mask.
+ */
+boost::uint64_t FuzzyMatcher::char_mask(const std::string &text)
+{
+  boost::uint64_t mask = 0;
+  for (std::string::const_iterator i = text.begin(); i != text.end(); ++i)
+    mask |= (boost::uint64_t)1 << char_bit(*i);
+  return mask;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns the match score of the name (0 or more, higher is better) or NO_MATCH.
+ * An empty pattern matches everything with a score of 0.
+ */
+int FuzzyMatcher::score(const std::string &name) const
+{
+  size_t pattern_length = _pattern.size();
+  size_t name_length = name.size();
+  if (pattern_length == 0)
+    return 0;
+  if (pattern_length > name_length)
+    return NO_MATCH;
+
+  // Find the end of the leftmost match.
+  size_t p = 0;
+  size_t end = 0;
+  for (size_t i = 0; i < name_length; ++i)
+  {
+    if (fold_char(name[i]) == (unsigned char)_pattern[p] && ++p == pattern_length)
+    {
+      end = i;
+      break;
+    }
+  }
+  if (p < pattern_length)
+    return NO_MATCH;
+
+  // Going back from there gives the shortest match ending at that position.
+  size_t start = end;
+  for (size_t i = end + 1; i-- > 0;)
+  {
+    if (fold_char(name[i]) == (unsigned char)_pattern[p - 1] && --p == 0)
+    {
+      start = i;
+      break;
+    }
+  }
+
+  int result = 0;
+  size_t last = 0;
+  p = 0;
+  for (size_t i = start; i <= end && p < pattern_length; ++i)
+  {
+    if (fold_char(name[i]) != (unsigned char)_pattern[p])
+      continue;
+
+    result += MATCH_SCORE;
+    if (is_word_start(name, i))
+      result += WORD_START_BONUS;
+    if (p > 0)
+    {
+      if (i == last + 1)
+        result += RUN_BONUS;
+      else
+        result -= (int)std::min(i - last - 1, (size_t)MAX_GAP_PENALTY);
+    }
+    last = i;
+    ++p;
+  }
+
+  result -= (int)std::min(start, (size_t)MAX_LEADING_PENALTY);
+  if (start == 0 && end + 1 == pattern_length)
+  {
+    result += PREFIX_BONUS;
+    if (name_length == pattern_length)
+      result += EXACT_BONUS;
+  }
+
+  // Among otherwise equal matches prefer shorter names.
+  result -= (int)std::min((name_length - pattern_length) / 4, (size_t)MATCH_SCORE);
+
+  return std::max(result, 0);
+}
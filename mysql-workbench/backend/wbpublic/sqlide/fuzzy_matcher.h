@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#pragma once
+
+#include "wbpublic_public_interface.h"
+
+#include <string>
+#include <boost/cstdint.hpp>
+
+/**
+ * Fuzzy matching of names for code completion. A name matches the typed text if it contains all its
+ * characters in the same order (ignoring case for ASCII letters), e.g. "fsq1" matches "fact_sales_2019_q1".
+ *
+ * Matches are scored by quality: an exact match or a prefix match rank highest, then matches where the
+ * typed characters fall on word starts (after '_', digit/letter changes, camel case) and come in runs.
+ * Gaps and longer names lower the score.
+ *
+ * For scanning many names, a character mask of each name can be computed once (char_mask()) and checked
+ * with might_match() before the more expensive score().
+ */
+class WBPUBLICBACKEND_PUBLIC_FUNC FuzzyMatcher
+{
+public:
+  static const int NO_MATCH = -1;
+
+  FuzzyMatcher(const std::string &pattern);
+
+  static boost::uint64_t char_mask(const std::string &text);
+
+  bool might_match(boost::uint64_t name_mask) const { return (name_mask & _mask) == _mask; };
+  int score(const std::string &name) const;
+
+  const std::string &pattern() const { return _pattern; };
+
+private:
+  std::string _pattern; // Case folded.
+  boost::uint64_t _mask;
+};
@@ -39,6 +39,7 @@
 #include <sstream>
 
 #include "recordset_text_storage.h"
+#include "recordset_row_index.h"
 
 DEFAULT_LOG_DOMAIN("Recordset")
 
@@ -90,6 +91,7 @@ Recordset::Recordset(GRTManager *grtm)
   _toolbar = NULL;
   _client_data = NULL;
   _context_menu = 0;
+  _columns_prepared = false;
   _id = g_atomic_int_get(&next_id);
   g_atomic_int_inc(&next_id);
 
@@ -107,6 +109,7 @@ Recordset::Recordset(GrtThreadedTask::Ref parent_task)
   _toolbar = NULL;
   _client_data = NULL;
   _context_menu = 0;
+  _columns_prepared = false;
   _id = g_atomic_int_get(&next_id);
   g_atomic_int_inc(&next_id);
 
@@ -140,6 +143,8 @@ bool Recordset::reset(Recordset_data_storage::Ptr data_storage_ptr, bool rethrow
   _sort_columns.clear();
   _column_filter_expr_map.clear();
   _data_search_string.clear();
+  _row_index.reset();
+  _columns_prepared= false;
 
   RETAIN_WEAK_PTR (Recordset_data_storage, data_storage_ptr, data_storage)
   if (data_storage)
@@ -149,18 +154,16 @@ bool Recordset::reset(Recordset_data_storage::Ptr data_storage_ptr, bool rethrow
       data_storage->do_unserialize(this, data_swap_db.get());
       rebuild_data_index(data_swap_db.get(), false, false);
 
-      _column_count= _column_names.size();
-      _aux_column_count= data_storage->aux_column_count();
-
-      // add aux `id` column required by 2-level caching
-      ++_aux_column_count;
-      ++_column_count;
-      _rowid_column= _column_count - 1;
-      _column_names.push_back("id");
-      _column_types.push_back(int());
-      _real_column_types.push_back(int());
-      _column_flags.push_back(0);
+      prepare_columns(data_storage);
 
+      if (has_column_store())
+      {
+        // ids are going to be assigned starting from 1 when the rows are moved to the data swap db
+        RowId stored_row_count= column_store()->row_count();
+        _min_new_rowid= (stored_row_count > 0) ? stored_row_count + 1 : 0;
+        _next_new_rowid= _min_new_rowid;
+      }
+      else
       {
         sqlite::query q(*data_swap_db, "select coalesce(max(id)+1, 0) from `data`");
         if (q.emit())
@@ -192,6 +195,97 @@ bool Recordset::reset(Recordset_data_storage::Ptr data_storage_ptr, bool rethrow
 }
 
 
+void Recordset::prepare_columns(Recordset_data_storage *data_storage)
+{
+  // a streaming fetch needs the columns before unserialization is complete
+  if (_columns_prepared)
+    return;
+  _columns_prepared= true;
+
+  _column_count= _column_names.size();
+  _aux_column_count= data_storage->aux_column_count();
+
+  // add aux `id` column required by 2-level caching
+  ++_aux_column_count;
+  ++_column_count;
+  _rowid_column= _column_count - 1;
+  _column_names.push_back("id");
+  _column_types.push_back(int());
+  _real_column_types.push_back(int());
+  _column_flags.push_back(0);
+}
+
+
+void Recordset::begin_fetch(Recordset_data_storage *data_storage)
+{
+  {
+    base::RecMutexLock data_mutex(_data_mutex);
+    prepare_columns(data_storage);
+    g_atomic_int_set(&_is_fetching, 1);
+    _readonly= true;
+    _readonly_reason= _("The result set is still being fetched");
+  }
+
+  if (fetch_started_cb)
+  {
+    boost::function<void ()> fetch_started= fetch_started_cb;
+    fetch_started_cb.clear();
+    fetch_started();
+  }
+}
+
+
+void Recordset::append_fetched_rows(const std::vector<std::vector<sqlite::variant_t> > &rows)
+{
+  if (rows.empty())
+    return;
+
+  {
+    base::RecMutexLock data_mutex(_data_mutex);
+    boost::shared_ptr<Recordset_column_store> column_store= this->column_store();
+    if (!column_store)
+      return;
+    for (std::vector<std::vector<sqlite::variant_t> >::const_iterator row= rows.begin(); row != rows.end(); ++row)
+      column_store->add_row(*row);
+    _row_count= _real_row_count= column_store->row_count();
+  }
+
+  // coalesce notifications, the UI doesn't need to know about every single batch
+  if (!_rows_fetched_connection.connected())
+    _rows_fetched_connection= _grtm->run_once_when_idle(this, boost::bind(&Recordset::rows_fetched, this));
+}
+
+
+void Recordset::end_fetch()
+{
+  {
+    base::RecMutexLock data_mutex(_data_mutex);
+    g_atomic_int_set(&_is_fetching, 0);
+    _readonly_reason.clear();
+  }
+  _rows_fetched_connection= _grtm->run_once_when_idle(this, boost::bind(&Recordset::rows_fetched, this));
+}
+
+
+void Recordset::rows_fetched()
+{
+  if (rows_changed)
+    rows_changed();
+  refresh_ui();
+}
+
+
+bool Recordset::check_not_fetching(const std::string &context)
+{
+  if (is_fetching())
+  {
+    task->send_msg(grt::WarningMsg, _("The result set is still being fetched, please wait until it's complete or stop the query."), context);
+    return false;
+  }
+  return true;
+}
+
+
 void Recordset::reset()
 {
   reset(false);
@@ -246,6 +340,9 @@ bool Recordset::close()
 
 void Recordset::refresh()
 {
+  if (!check_not_fetching(_("Refresh Recordset")))
+    return;
+
   if (has_pending_changes())
   {
     task->send_msg(grt::ErrorMsg, ERRMSG_PENDING_CHANGES, _("Refresh Recordset"));
@@ -292,6 +389,15 @@ RowId Recordset::real_row_count() const
 
 void Recordset::recalc_row_count(sqlite::connection *data_swap_db)
 {
+  // data kept in memory is filtered by the column store index
+  if (has_column_store())
+  {
+    boost::shared_ptr<std::vector<size_t> > stored_rows= column_store_rows();
+    _real_row_count= column_store()->row_count();
+    _row_count= stored_rows ? stored_rows->size() : _real_row_count;
+    return;
+  }
+
   // row count (visible rows only, some can be filtered out by applied column filters)
   {
     sqlite::query q(*data_swap_db, "select count(*) from `data_index`");
@@ -525,6 +631,10 @@ bool Recordset::delete_nodes(std::vector<bec::NodeId> &nodes)
 
 bool Recordset::has_pending_changes()
 {
+  // any change would have moved the data to the data swap db
+  if (has_column_store())
+    return false;
+
   boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
   if (data_swap_db)
   {
@@ -541,6 +651,12 @@ bool Recordset::has_pending_changes()
 
 void Recordset::pending_changes(int &upd_count, int &ins_count, int &del_count) const
 {
+  if (has_column_store())
+  {
+    upd_count= ins_count= del_count= 0;
+    return;
+  }
+
   boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
 
   std::string count_pending_changes_statement_sql=
@@ -742,6 +858,7 @@ bool Recordset::limit_rows_applicable()
 Recordset_data_storage::Ref Recordset::data_storage_for_export(const std::string &format)
 {
   _data_storage_for_export.reset();
+  Recordset_text_storage::register_template_modifiers();
 
   {
     std::vector<Recordset_storage_info> storage_types(Recordset_text_storage::storage_types(_grtm));
@@ -776,7 +893,7 @@ std::vector<Recordset_storage_info> Recordset::data_storages_for_export()
 
 void Recordset::sort_by(ColumnId column, int direction, bool retaining)
 {
-  if (_column_count == 0)
+  if (_column_count == 0 || !check_not_fetching(_("Sort Recordset")))
     return;
 
   if (!retaining)
@@ -784,8 +901,7 @@ void Recordset::sort_by(ColumnId column, int direction, bool retaining)
     _sort_columns.clear();
     if (!(direction))
     {
-      boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
-      rebuild_data_index(data_swap_db.get(), true, true);
+      rebuild_data_index(true, true);
 
       refresh_ui(); // refresh the sort indicators in column headers
       return;
@@ -818,8 +934,7 @@ void Recordset::sort_by(ColumnId column, int direction, bool retaining)
   if (!is_resort_needed || _sort_columns.empty())
     return;
 
-  boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
-  rebuild_data_index(data_swap_db.get(), true, true);
+  rebuild_data_index(true, true);
 }
 
 
@@ -847,36 +962,37 @@ bool Recordset::has_column_filter(ColumnId column) const
 
 void Recordset::reset_column_filters()
 {
+  if (!check_not_fetching(_("Filter Recordset")))
+    return;
   _column_filter_expr_map.clear();
 
-  boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
-  rebuild_data_index(data_swap_db.get(), true, true);
+  rebuild_data_index(true, true);
 }
 
 
 void Recordset::reset_column_filter(ColumnId column)
 {
+  if (!check_not_fetching(_("Filter Recordset")))
+    return;
   Column_filter_expr_map::iterator i= _column_filter_expr_map.find(column);
   if (i == _column_filter_expr_map.end())
     return;
   _column_filter_expr_map.erase(i);
 
-  boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
-  rebuild_data_index(data_swap_db.get(), true, true);
+  rebuild_data_index(true, true);
 }
 
 
 void Recordset::set_column_filter(ColumnId column, const std::string &filter_expr)
 {
-  if (column >= get_column_count())
+  if (column >= get_column_count() || !check_not_fetching(_("Filter Recordset")))
     return;
   Column_filter_expr_map::const_iterator i= _column_filter_expr_map.find(column);
   if ((i != _column_filter_expr_map.end()) && (i->second == filter_expr))
     return;
   _column_filter_expr_map[column]= filter_expr;
 
-  boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
-  rebuild_data_index(data_swap_db.get(), true, true);
+  rebuild_data_index(true, true);
 }
 
 
@@ -895,23 +1011,31 @@ const std::string & Recordset::data_search_string() const
 
 void Recordset::set_data_search_string(const std::string &value)
 {
-  if (value == _data_search_string)
+  if (value == _data_search_string || !check_not_fetching(_("Search Recordset")))
     return;
   _data_search_string= value;
 
-  boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
-  rebuild_data_index(data_swap_db.get(), true, true);
+  rebuild_data_index(true, true);
 }
 
 
 void Recordset::reset_data_search_string()
 {
-  if (_data_search_string.empty())
+  if (_data_search_string.empty() || !check_not_fetching(_("Search Recordset")))
     return;
   _data_search_string.clear();
 
-  boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
-  rebuild_data_index(data_swap_db.get(), true, true);
+  rebuild_data_index(true, true);
+}
+
+
+void Recordset::rebuild_data_index(bool do_cache_data_frame, bool do_refresh_ui)
+{
+  // asking for the data swap db would move data kept in memory there
+  boost::shared_ptr<sqlite::connection> data_swap_db;
+  if (!has_column_store())
+    data_swap_db= this->data_swap_db();
+  rebuild_data_index(data_swap_db.get(), do_cache_data_frame, do_refresh_ui);
 }
 
 
@@ -920,126 +1044,186 @@ void Recordset::rebuild_data_index(sqlite::connection *data_swap_db, bool do_cac
   {
     base::RecMutexLock data_mutex(_data_mutex);
 
-    std::string where_clause;
+    if (has_column_store())
+      rebuild_column_store_index();
+    else
+      rebuild_data_swap_db_index(data_swap_db);
+
+    recalc_row_count(data_swap_db);
+
+    if (do_cache_data_frame && _column_count > 0)
+      cache_data_frame(0, true);
+  }
+
+  if (do_refresh_ui)
+    refresh_ui();
+}
+
+
+/**
+ * Sorts and filters the rows kept in the column store in memory (see Recordset_row_index), the data
+ * swap db isn't involved.
+ */
+void Recordset::rebuild_column_store_index()
+{
+  if (!_row_index)
+    _row_index.reset(new Recordset_row_index());
+
+  std::vector<Recordset_row_index::Sort_column> sort_columns;
+  BOOST_FOREACH (SortColumns::value_type &sort_column, _sort_columns)
+  {
+    Recordset_row_index::Sort_column column;
+    column.column= sort_column.first;
+    column.direction= (sort_column.second < 0) ? -1 : 1;
+    switch (get_real_column_type(sort_column.first))
     {
-      sqlide::QuoteVar qv;
-      {
-        qv.escape_string= boost::bind(sqlide::QuoteVar::escape_ansi_sql_string, _1);
-        qv.store_unknown_as_string= true;
-        qv.allow_func_escaping= false;
-      }
-      sqlite::variant_t var_string_type= std::string();
-      sqlite::variant_t var_string;
-      std::string sql_string;
+    case NumericType:
+    case FloatType:
+    case DatetimeType:
+      column.kind= Recordset_row_index::NumericCompare;
+      break;
+    case StringType:
+      column.kind= Recordset_row_index::NocaseTextCompare;
+      break;
 
-      // column filters subclause
-      std::string where_subclause1;
-      {
-        BOOST_FOREACH (Column_filter_expr_map::value_type &column_filter_expr, _column_filter_expr_map)
-        {
-          var_string= column_filter_expr.second;
-          sql_string= boost::apply_visitor(qv, var_string_type, var_string);
-          where_subclause1+= strfmt("_%u like %s and ", (unsigned int) column_filter_expr.first, sql_string.c_str());
-        }
-        if (!where_subclause1.empty())
-        {
-          where_subclause1.resize(where_subclause1.size()-std::string(" and ").size());
-          where_subclause1.insert(0, "(");
-          where_subclause1.append(")");
-        }
-      }
+    default:
+      column.kind= Recordset_row_index::BinaryCompare;
+      break;
+    }
+    sort_columns.push_back(column);
+  }
+
+  std::map<size_t, std::string> column_filters(_column_filter_expr_map.begin(), _column_filter_expr_map.end());
+
+  _row_index->set_sort_columns(sort_columns);
+  _row_index->set_column_filters(column_filters);
+  _row_index->set_search_string(_data_search_string);
+
+  if (_row_index->is_identity())
+  {
+    set_column_store_rows(boost::shared_ptr<std::vector<size_t> >());
+    return;
+  }
+
+  boost::shared_ptr<std::vector<size_t> > rows(new std::vector<size_t>());
+  _row_index->build(column_store(), *rows);
+  set_column_store_rows(rows);
+}
+
+
+void Recordset::rebuild_data_swap_db_index(sqlite::connection *data_swap_db)
+{
+  std::string where_clause;
+  {
+    sqlide::QuoteVar qv;
+    {
+      qv.escape_string= boost::bind(sqlide::QuoteVar::escape_ansi_sql_string, _1);
+      qv.store_unknown_as_string= true;
+      qv.allow_func_escaping= false;
+    }
+    sqlite::variant_t var_string_type= std::string();
+    sqlite::variant_t var_string;
+    std::string sql_string;
 
-      // data search subclause
-      std::string where_subclause2;
-      if (!_data_search_string.empty())
+    // column filters subclause
+    std::string where_subclause1;
+    {
+      BOOST_FOREACH (Column_filter_expr_map::value_type &column_filter_expr, _column_filter_expr_map)
       {
-        var_string= "%" + _data_search_string + "%";
+        var_string= column_filter_expr.second;
         sql_string= boost::apply_visitor(qv, var_string_type, var_string);
-        for (ColumnId column= 0, column_count= get_column_count(); column < column_count; ++column)
-        {
-          where_subclause2+= strfmt("_%u like %s or ", (unsigned int) column, sql_string.c_str());
-        }
-        if (!where_subclause2.empty())
-        {
-          where_subclause2.resize(where_subclause2.size()-std::string(" or ").size());
-          where_subclause2.insert(0, "(");
-          where_subclause2.append(")");
-        }
+        where_subclause1+= strfmt("_%u like %s and ", (unsigned int) column_filter_expr.first, sql_string.c_str());
       }
-
-      if (!where_subclause1.empty() || !where_subclause2.empty())
+      if (!where_subclause1.empty())
       {
-        std::string subclauses_mediator= (!where_subclause1.empty() && !where_subclause2.empty()) ? " and " : "";
-        where_clause= strfmt("where %s%s%s", where_subclause1.c_str(), subclauses_mediator.c_str(), where_subclause2.c_str());
+        where_subclause1.resize(where_subclause1.size()-std::string(" and ").size());
+        where_subclause1.insert(0, "(");
+        where_subclause1.append(")");
       }
     }
 
-    std::string orderby_clause;
+    // data search subclause
+    std::string where_subclause2;
+    if (!_data_search_string.empty())
     {
-      BOOST_FOREACH (SortColumns::value_type &sort_column, _sort_columns)
+      var_string= "%" + _data_search_string + "%";
+      sql_string= boost::apply_visitor(qv, var_string_type, var_string);
+      for (ColumnId column= 0, column_count= get_column_count(); column < column_count; ++column)
       {
-        std::string column_expr;
-        switch (get_real_column_type(sort_column.first))
-        {
-        case NumericType:
-        case FloatType:
-        case DatetimeType:
-          column_expr= strfmt("cast(_%u as numeric)", (unsigned int) sort_column.first);
-          break;
-        case StringType:
-          column_expr= strfmt("_%u COLLATE NOCASE", (unsigned int) sort_column.first);
-          break;
-
-        default:
-          column_expr= strfmt("_%u", (unsigned int) sort_column.first);
-          break;
-        }
-        const char *dir;
-        switch (sort_column.second)
-        {
-        case 1: dir= "ASC"; break;
-        case -1: dir= "DESC"; break;
-        default: dir= ""; break;
-        }
-        orderby_clause += strfmt("%s %s, ", column_expr.c_str(), dir);
+        where_subclause2+= strfmt("_%u like %s or ", (unsigned int) column, sql_string.c_str());
       }
-      if (!orderby_clause.empty())
+      if (!where_subclause2.empty())
       {
-        orderby_clause.resize(orderby_clause.size()-std::string(", ").size());
-        orderby_clause.insert(0, "order by ");
+        where_subclause2.resize(where_subclause2.size()-std::string(" or ").size());
+        where_subclause2.insert(0, "(");
+        where_subclause2.append(")");
       }
     }
 
-    std::string tables_join= "`data`";
+    if (!where_subclause1.empty() || !where_subclause2.empty())
     {
-      for (size_t partition= 1, partition_count= data_swap_db_partition_count(); partition < partition_count; ++partition)
+      std::string subclauses_mediator= (!where_subclause1.empty() && !where_subclause2.empty()) ? " and " : "";
+      where_clause= strfmt("where %s%s%s", where_subclause1.c_str(), subclauses_mediator.c_str(), where_subclause2.c_str());
+    }
+  }
+
+  std::string orderby_clause;
+  {
+    BOOST_FOREACH (SortColumns::value_type &sort_column, _sort_columns)
+    {
+      std::string column_expr;
+      switch (get_real_column_type(sort_column.first))
       {
-        std::string partition_suffix= data_swap_db_partition_suffix(partition);
-        tables_join+= strfmt(" inner join `data%s` on (`data`.id=`data%s`.id)", partition_suffix.c_str(), partition_suffix.c_str());
+      case NumericType:
+      case FloatType:
+      case DatetimeType:
+        column_expr= strfmt("cast(_%u as numeric)", (unsigned int) sort_column.first);
+        break;
+      case StringType:
+        column_expr= strfmt("_%u COLLATE NOCASE", (unsigned int) sort_column.first);
+        break;
+
+      default:
+        column_expr= strfmt("_%u", (unsigned int) sort_column.first);
+        break;
       }
+      const char *dir;
+      switch (sort_column.second)
+      {
+      case 1: dir= "ASC"; break;
+      case -1: dir= "DESC"; break;
+      default: dir= ""; break;
+      }
+      orderby_clause += strfmt("%s %s, ", column_expr.c_str(), dir);
     }
-
+    if (!orderby_clause.empty())
     {
-      sqlide::Sqlite_transaction_guarder transaction_guarder(data_swap_db);
+      orderby_clause.resize(orderby_clause.size()-std::string(", ").size());
+      orderby_clause.insert(0, "order by ");
+    }
+  }
 
-      std::string temp_table_name= "`data_index_" + grt::get_guid() + "`";
+  std::string tables_join= "`data`";
+  {
+    for (size_t partition= 1, partition_count= data_swap_db_partition_count(); partition < partition_count; ++partition)
+    {
+      std::string partition_suffix= data_swap_db_partition_suffix(partition);
+      tables_join+= strfmt(" inner join `data%s` on (`data`.id=`data%s`.id)", partition_suffix.c_str(), partition_suffix.c_str());
+    }
+  }
 
-      sqlite::execute(*data_swap_db, strfmt("create table if not exists %s (`id` integer)", temp_table_name.c_str()), true);
-      sqlite::execute(*data_swap_db, strfmt("insert into %s select `data`.`id` from %s %s %s", temp_table_name.c_str(), tables_join.c_str(), where_clause.c_str(), orderby_clause.c_str()), true);
-      sqlite::execute(*data_swap_db, "drop table if exists `data_index`", true);
-      sqlite::execute(*data_swap_db, strfmt("alter table %s rename to `data_index`", temp_table_name.c_str()), true);
+  {
+    sqlide::Sqlite_transaction_guarder transaction_guarder(data_swap_db);
 
-      transaction_guarder.commit();
-    }
+    std::string temp_table_name= "`data_index_" + grt::get_guid() + "`";
 
-    recalc_row_count(data_swap_db);
+    sqlite::execute(*data_swap_db, strfmt("create table if not exists %s (`id` integer)", temp_table_name.c_str()), true);
+    sqlite::execute(*data_swap_db, strfmt("insert into %s select `data`.`id` from %s %s %s", temp_table_name.c_str(), tables_join.c_str(), where_clause.c_str(), orderby_clause.c_str()), true);
+    sqlite::execute(*data_swap_db, "drop table if exists `data_index`", true);
+    sqlite::execute(*data_swap_db, strfmt("alter table %s rename to `data_index`", temp_table_name.c_str()), true);
 
-    if (do_cache_data_frame && _column_count > 0)
-      cache_data_frame(0, true);
+    transaction_guarder.commit();
   }
-
-  if (do_refresh_ui)
-    refresh_ui();
 }
 
 
@@ -30,6 +30,7 @@
 
 class Recordset_data_storage;
 class BinaryDataEditor;
+class Recordset_row_index;
 
 namespace mforms 
 {
@@ -91,7 +92,21 @@ public:
   boost::signals2::signal<void ()> data_edited_signal;
 private:
   bool reset(Recordset_data_storage_Ptr data_storage_ptr, bool rethrow);
+  void prepare_columns(Recordset_data_storage *data_storage);
   void data_edited();
+  bool _columns_prepared;
+
+public:
+  // Set before reset() to be notified (in the fetching thread) as soon as the first rows of a
+  // streamed result set are available. Called once.
+  boost::function<void ()> fetch_started_cb;
+private:
+  void begin_fetch(Recordset_data_storage *data_storage);
+  void append_fetched_rows(const std::vector<std::vector<sqlite::variant_t> > &rows);
+  void end_fetch();
+  void rows_fetched();
+  bool check_not_fetching(const std::string &context);
+  boost::signals2::connection _rows_fetched_connection;
 
 public:
   RowId real_row_count() const;
@@ -223,6 +238,10 @@ private:
 
 private:
   void rebuild_data_index(sqlite::connection *data_swap_db, bool do_cache_data_frame, bool do_refresh_ui);
+  void rebuild_data_index(bool do_cache_data_frame, bool do_refresh_ui);
+  void rebuild_data_swap_db_index(sqlite::connection *data_swap_db);
+  void rebuild_column_store_index();
+  boost::shared_ptr<Recordset_row_index> _row_index; // sorts and filters data kept in the column store
 
 public:
   void caption(const std::string &val) { _caption= val; }
@@ -25,6 +25,7 @@
 #include "grtsqlparser/sql_facade.h"
 #include "base/string_utilities.h"
 #include "base/sqlstring.h"
+#include "base/util_functions.h"
 #include <sqlite/query.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/foreach.hpp>
@@ -37,11 +38,18 @@ using namespace grt;
 using namespace base;
 
 
+const size_t Recordset_cdbc_storage::FIRST_FETCH_BATCH_SIZE= 100;
+const size_t Recordset_cdbc_storage::FETCH_BATCH_SIZE= 10000;
+const double Recordset_cdbc_storage::FETCH_PUBLISH_INTERVAL= 0.5; // in seconds
+
+
 Recordset_cdbc_storage::Recordset_cdbc_storage(GRTManager *grtm)
 :
 Recordset_sql_storage(grtm),
 _reloadable(true),
-_gather_field_info(false)
+_gather_field_info(false),
+_streaming_fetch(false),
+_fetch_interrupted(false)
 {
 }
 
@@ -280,8 +288,13 @@ void Recordset_cdbc_storage::do_unserialize(Recordset *recordset, sqlite::connec
   
   boost::shared_ptr<sql::Statement> stmt;
   boost::shared_ptr<sql::ResultSet> rs;
+  bool streaming_fetch= false;
+  _fetch_interrupted= false;
   if (_dbc_resultset)
   {
+    // only the result set handed over by the caller can be streamed, reloads are always fetched at once
+    streaming_fetch= _streaming_fetch;
+    _streaming_fetch= false;
     rs= _dbc_resultset;
     _dbc_resultset.reset(); // handover memory management to scope shared_ptr because resultset can be read 1 time only
     // same about statement
@@ -467,31 +480,141 @@ void Recordset_cdbc_storage::do_unserialize(Recordset *recordset, sqlite::connec
     FetchVar fetch_var(rs.get());
     Var_vector row_values(editable_col_count + rowid_col_count);
 
-    std::list<boost::shared_ptr<sqlite::command> > insert_commands= prepare_data_swap_record_add_statement(data_swap_db, column_names);
-    // XXX this will fetch all records before displaying them, which will result in a huge unnecessary lag in the UI
-    while (rs->next())
+    // rows are collected in memory as long as they fit into the configured limit, otherwise
+    // everything goes to the data swap db
+    size_t column_store_memory_limit= recordset->column_store_memory_limit();
+    Recordset_column_store::Ref column_store;
+    if (column_store_memory_limit > 0)
+      column_store.reset(new Recordset_column_store(column_types));
+
+    // a streamed result set is handed to the recordset in batches while it's being read, so the
+    // first rows can be shown right away. That needs the column store to publish rows to.
+    bool streaming= streaming_fetch && column_store;
+    bool publishing= streaming; // rows still go to the recordset's column store
+    std::vector<Var_vector> fetched_rows;
+    size_t fetch_batch_size= FIRST_FETCH_BATCH_SIZE;
+    double last_publish_time= base::timestamp();
+    if (streaming)
+    {
+      // the table structure must be visible to other connections before anybody can look at the data
+      transaction_guarder.commit_and_start_new_transaction();
+      set_column_store(recordset, column_store);
+      begin_fetch(recordset);
+    }
+
+    try
     {
-      for (ColumnId n= 0; editable_col_count > n; ++n)
+      std::list<boost::shared_ptr<sqlite::command> > insert_commands= prepare_data_swap_record_add_statement(data_swap_db, column_names.size());
+      while (true)
       {
-        if (rs->isNull((int)n + 1) || null_value_columns[n])
+        try
+        {
+          if (!rs->next())
+            break;
+        }
+        catch (sql::SQLException &)
         {
-          row_values[n]= sqlite::null_t();
+          // killing the query makes the server cut the stream, whatever was fetched so far is kept
+          if (streaming && _dbms_conn->is_stop_query_requested)
+          {
+            _fetch_interrupted= true;
+            break;
+          }
+          throw;
+        }
+
+        for (ColumnId n= 0; editable_col_count > n; ++n)
+        {
+          if (rs->isNull((int)n + 1) || null_value_columns[n])
+          {
+            row_values[n]= sqlite::null_t();
+          }
+          else
+          {
+            sqlite::variant_t index= (int)n+1;
+            row_values[n]= boost::apply_visitor(fetch_var, column_types[n], index);
+          }
+        }
+        for (ColumnId n= 0; rowid_col_count > n; ++n) // copy original value of pk field(s)
+          row_values[editable_col_count+n]= row_values[_pkey_columns[n]];
+
+        if (publishing)
+        {
+          fetched_rows.push_back(row_values);
+          if ((fetched_rows.size() >= fetch_batch_size) || (base::timestamp() - last_publish_time > FETCH_PUBLISH_INTERVAL))
+          {
+            append_fetched_rows(recordset, fetched_rows);
+            fetched_rows.clear();
+            fetch_batch_size= FETCH_BATCH_SIZE;
+            last_publish_time= base::timestamp();
+
+            // once the limit is reached the rows published so far are moved to disk (the grid keeps showing
+            // them from there) and the rest of the result goes directly to the data swap db
+            if (column_store->memory_usage() > column_store_memory_limit)
+            {
+              spill_column_store(recordset, data_swap_db, false);
+              transaction_guarder.commit_and_start_new_transaction();
+              column_store.reset();
+              publishing= false;
+            }
+          }
+        }
+        else if (column_store)
+        {
+          column_store->add_row(row_values);
+          if ((column_store->row_count() % 1024 == 0) && (column_store->memory_usage() > column_store_memory_limit))
+          {
+            add_data_swap_records(insert_commands, *column_store);
+            column_store.reset();
+          }
         }
         else
+          add_data_swap_record(insert_commands, row_values);
+
+        if (_dbms_conn->is_stop_query_requested)
         {
-          sqlite::variant_t index= (int)n+1;
-          row_values[n]= boost::apply_visitor(fetch_var, column_types[n], index);
+          if (!streaming)
+            throw std::runtime_error(_("Query execution has been stopped, the connection to the DB server was not restarted, any open transaction remains open"));
+
+          // keep what we have and skip the rest of the result, so that the connection stays usable
+          _fetch_interrupted= true;
+          try
+          {
+            while (rs->next())
+              ;
+          }
+          catch (sql::SQLException &)
+          {
+          }
+          break;
         }
       }
-      for (ColumnId n= 0; rowid_col_count > n; ++n) // copy original value of pk field(s)
-        row_values[editable_col_count+n]= row_values[_pkey_columns[n]];
-      add_data_swap_record(insert_commands, row_values);
 
-      if (_dbms_conn->is_stop_query_requested)
-        throw std::runtime_error(_("Query execution has been stopped, the connection to the DB server was not restarted, any open transaction remains open"));
+      if (publishing)
+      {
+        append_fetched_rows(recordset, fetched_rows);
+        fetched_rows.clear();
+      }
+    }
+    catch (...)
+    {
+      if (streaming)
+        end_fetch(recordset);
+      throw;
     }
 
     transaction_guarder.commit();
+
+    if (streaming)
+    {
+      end_fetch(recordset);
+
+      // the last batch might have exceeded the limit too
+      if (column_store && column_store->memory_usage() > column_store_memory_limit)
+        spill_column_store(recordset, data_swap_db);
+    }
+    else
+      set_column_store(recordset, column_store);
   }
 
   // remap rowid columns to duplicated columns
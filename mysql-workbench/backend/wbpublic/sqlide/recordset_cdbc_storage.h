@@ -67,6 +67,16 @@ public:
 
   void set_gather_field_info(bool flag) { _gather_field_info = flag; }
   std::vector<FieldInfo> &field_info() { return _field_info; }
+
+  // Streaming fetch: rows of the handed over result set (ideally an unbuffered one) are published to
+  // the recordset in batches while they are being read, instead of after the whole set was read.
+  void streaming_fetch(bool flag) { _streaming_fetch= flag; }
+  bool streaming_fetch() const { return _streaming_fetch; }
+  bool fetch_interrupted() const { return _fetch_interrupted; } // stop was requested while streaming, rows fetched so far are kept
+
+  static const size_t FIRST_FETCH_BATCH_SIZE;
+  static const size_t FETCH_BATCH_SIZE;
+  static const double FETCH_PUBLISH_INTERVAL;
 protected:
   sql::Dbc_connection_handler::ConnectionRef dbms_conn_ref();
   sql::Dbc_connection_handler::ConnectionRef aux_dbms_conn_ref();
@@ -78,6 +88,8 @@ private:
   std::vector<FieldInfo> _field_info;
   bool _reloadable; // whether can be reloaded using stored sql query
   bool _gather_field_info;
+  bool _streaming_fetch;
+  bool _fetch_interrupted;
 
   size_t determine_pkey_columns(Recordset::Column_names &column_names, Recordset::Column_types &column_types, Recordset::Column_types &real_column_types);
   size_t determine_pkey_columns_alt(Recordset::Column_names &column_names, Recordset::Column_types &column_types, Recordset::Column_types &real_column_types);
@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "recordset_column_store.h"
+#include <stdexcept>
+#include <string.h>
+
+
+//--------------------------------------------------------------------------------------------------
+
+class StorageKindOfVar : public boost::static_visitor<Recordset_column_store::StorageKind>
+{
+public:
+  result_type operator()(const sqlite::unknown_t &) const { return Recordset_column_store::TextStorage; }
+  result_type operator()(const sqlite::null_t &) const { return Recordset_column_store::NullStorage; }
+  result_type operator()(const int &) const { return Recordset_column_store::IntStorage; }
+  result_type operator()(const boost::int64_t &) const { return Recordset_column_store::Int64Storage; }
+  result_type operator()(const long double &) const { return Recordset_column_store::RealStorage; }
+  result_type operator()(const std::string &) const { return Recordset_column_store::TextStorage; }
+  result_type operator()(const sqlite::blob_ref_t &) const { return Recordset_column_store::BlobStorage; }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Appends a value to a column. Values that don't fit the typed buffers of the column turn it into
+ * a variant column, so nothing is ever converted (and possibly altered) on the way in.
+ */
+class Recordset_column_store::AppendVar : public boost::static_visitor<void>
+{
+public:
+  AppendVar(Recordset_column_store *store, Column &column) : _store(store), _column(column) {}
+
+  result_type operator()(const sqlite::null_t &) const
+  {
+    _store->append_default(_column);
+    _store->set_null_bit(_column, _store->_row_count, true);
+  }
+
+  result_type operator()(const int &v) const
+  {
+    if (_column.kind == IntStorage || _column.kind == Int64Storage)
+      _column.ints.push_back(v);
+    else
+      append_variant(v);
+  }
+
+  result_type operator()(const boost::int64_t &v) const
+  {
+    if (_column.kind == Int64Storage)
+      _column.ints.push_back(v);
+    else
+      append_variant(v);
+  }
+
+  result_type operator()(const long double &v) const
+  {
+    if (_column.kind == RealStorage)
+      _column.reals.push_back(v);
+    else
+      append_variant(v);
+  }
+
+  result_type operator()(const std::string &v) const
+  {
+    if (_column.kind == TextStorage)
+      append_bytes(v.data(), v.size());
+    else
+      append_variant(v);
+  }
+
+  result_type operator()(const sqlite::blob_ref_t &v) const
+  {
+    if (_column.kind == BlobStorage && v)
+      append_bytes(v->empty() ? NULL : (const char*)&(*v)[0], v->size());
+    else
+      append_variant(v);
+  }
+
+  template<typename T>
+  result_type operator()(const T &v) const
+  {
+    append_variant(v);
+  }
+
+private:
+  void append_bytes(const char *data, size_t size) const
+  {
+    if (size > 0)
+      _column.arena.insert(_column.arena.end(), data, data + size);
+    _column.offsets.push_back(_column.arena.size());
+  }
+
+  void append_variant(const sqlite::variant_t &v) const
+  {
+    if (_column.kind != VariantStorage)
+      _store->demote_to_variants(_column);
+    _column.variants.push_back(v);
+  }
+
+  Recordset_column_store *_store;
+  Column &_column;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+Recordset_column_store::Recordset_column_store(const std::vector<sqlite::variant_t> &column_types)
+:
+_row_count(0)
+{
+  static const StorageKindOfVar storage_kind_of_var;
+
+  _columns.resize(column_types.size());
+  for (size_t n= 0; n < column_types.size(); ++n)
+  {
+    Column &column= _columns[n];
+    column.kind= boost::apply_visitor(storage_kind_of_var, column_types[n]);
+    if (column.kind == TextStorage || column.kind == BlobStorage)
+      column.offsets.push_back(0);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Recordset_column_store::~Recordset_column_store()
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_column_store::clear()
+{
+  for (std::vector<Column>::iterator column= _columns.begin(); column != _columns.end(); ++column)
+  {
+    reinit(column->nulls);
+    reinit(column->ints);
+    reinit(column->reals);
+    reinit(column->arena);
+    reinit(column->offsets);
+    reinit(column->variants);
+    if (column->kind == TextStorage || column->kind == BlobStorage)
+      column->offsets.push_back(0);
+  }
+  _row_count= 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_column_store::add_row(const Var_vector &values)
+{
+  if (values.size() < _columns.size())
+    throw std::logic_error("Recordset_column_store: row has less values than there are columns");
+
+  for (size_t n= 0; n < _columns.size(); ++n)
+  {
+    Column &column= _columns[n];
+    if (column.kind == VariantStorage)
+    {
+      column.variants.push_back(values[n]);
+      continue;
+    }
+    if (column.kind == NullStorage)
+    {
+      // columns of null type stay empty as long as only nulls come in
+      if (sqlide::is_var_null(values[n]))
+        continue;
+      demote_to_variants(column);
+      column.variants.push_back(values[n]);
+      continue;
+    }
+    AppendVar append_var(this, column);
+    boost::apply_visitor(append_var, values[n]);
+  }
+  ++_row_count;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_column_store::set_null_bit(Column &column, size_t row, bool is_null)
+{
+  size_t byte= row / 8;
+  if (column.nulls.size() <= byte)
+  {
+    if (!is_null)
+      return;
+    column.nulls.resize(byte + 1, 0);
+  }
+  if (is_null)
+    column.nulls[byte]|= (boost::uint8_t)(1 << (row % 8));
+  else
+    column.nulls[byte]&= (boost::uint8_t)~(1 << (row % 8));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Fills the slot of a null value so that row numbers keep addressing fixed width buffers directly.
+ */
+void Recordset_column_store::append_default(Column &column)
+{
+  switch (column.kind)
+  {
+    case IntStorage:
+    case Int64Storage:
+      column.ints.push_back(0);
+      break;
+    case RealStorage:
+      column.reals.push_back(0);
+      break;
+    case TextStorage:
+    case BlobStorage:
+      column.offsets.push_back(column.arena.size());
+      break;
+    case VariantStorage:
+      column.variants.push_back(sqlite::null_t());
+      break;
+    case NullStorage:
+      break;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_column_store::demote_to_variants(Column &column)
+{
+  std::vector<sqlite::variant_t> variants;
+  variants.reserve(_row_count + 1);
+  for (size_t row= 0; row < _row_count; ++row)
+    variants.push_back(get_(column, row));
+
+  column.kind= VariantStorage;
+  column.variants.swap(variants);
+  reinit(column.nulls);
+  reinit(column.ints);
+  reinit(column.reals);
+  reinit(column.arena);
+  reinit(column.offsets);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+size_t Recordset_column_store::memory_usage() const
+{
+  size_t res= sizeof(*this) + _columns.capacity() * sizeof(Column);
+  for (std::vector<Column>::const_iterator column= _columns.begin(); column != _columns.end(); ++column)
+  {
+    res+= column->nulls.capacity();
+    res+= column->ints.capacity() * sizeof(boost::int64_t);
+    res+= column->reals.capacity() * sizeof(long double);
+    res+= column->arena.capacity();
+    res+= column->offsets.capacity() * sizeof(size_t);
+    res+= column->variants.capacity() * sizeof(sqlite::variant_t);
+  }
+  return res;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool Recordset_column_store::is_null(size_t row, size_t column) const
+{
+  const Column &c= _columns[column];
+  switch (c.kind)
+  {
+    case NullStorage:
+      return true;
+    case VariantStorage:
+      return sqlide::is_var_null(c.variants[row]);
+    default:
+    {
+      size_t byte= row / 8;
+      return (byte < c.nulls.size()) && (c.nulls[byte] & (1 << (row % 8)));
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+sqlite::variant_t Recordset_column_store::get_(const Column &column, size_t row) const
+{
+  if (column.kind == VariantStorage)
+    return column.variants[row];
+
+  if (column.kind == NullStorage)
+    return sqlite::null_t();
+
+  size_t byte= row / 8;
+  if ((byte < column.nulls.size()) && (column.nulls[byte] & (1 << (row % 8))))
+    return sqlite::null_t();
+
+  switch (column.kind)
+  {
+    case IntStorage:
+      return (int)column.ints[row];
+    case Int64Storage:
+      return column.ints[row];
+    case RealStorage:
+      return column.reals[row];
+    case TextStorage:
+    {
+      size_t begin= column.offsets[row];
+      size_t end= column.offsets[row + 1];
+      return (begin == end) ? std::string() : std::string(&column.arena[begin], end - begin);
+    }
+    case BlobStorage:
+    {
+      size_t begin= column.offsets[row];
+      size_t end= column.offsets[row + 1];
+      sqlite::blob_ref_t blob(new sqlite::blob_t(end - begin));
+      if (end > begin)
+        memcpy(&(*blob)[0], &column.arena[begin], end - begin);
+      return blob;
+    }
+    default:
+      return sqlite::null_t();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+sqlite::variant_t Recordset_column_store::get(size_t row, size_t column) const
+{
+  if (row >= _row_count || column >= _columns.size())
+    return sqlite::null_t();
+  return get_(_columns[column], row);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_column_store::get_row(size_t row, Var_vector &values) const
+{
+  values.resize(_columns.size());
+  for (size_t n= 0; n < _columns.size(); ++n)
+    values[n]= get(row, n);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const char *Recordset_column_store::bytes_value(size_t row, size_t column, size_t &length) const
+{
+  const Column &c= _columns[column];
+  size_t begin= c.offsets[row];
+  length= c.offsets[row + 1] - begin;
+  return (length > 0) ? &c.arena[begin] : "";
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+
+#ifndef _RECORDSET_COLUMN_STORE_BE_H_
+#define _RECORDSET_COLUMN_STORE_BE_H_
+
+
+#include "wbpublic_public_interface.h"
+#include "sqlide/sqlide_generics.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+
+
+/**
+ * In-memory, column oriented storage for fetched recordset data.
+ *
+ * Values are kept in typed, contiguous per-column buffers: integers and floating point values in
+ * fixed width arrays, text and blob values in a byte arena addressed by offsets. Nulls are tracked
+ * in a bitmap per column. Used by the recordset as an alternative to the sqlite data swap db for
+ * data that has not been edited yet (see VarGridModel::cache_data_frame). Sorting and filtering
+ * that data is done by Recordset_row_index.
+ */
+class WBPUBLICBACKEND_PUBLIC_FUNC Recordset_column_store
+{
+public:
+  typedef boost::shared_ptr<Recordset_column_store> Ref;
+  typedef std::vector<sqlite::variant_t> Var_vector;
+
+  Recordset_column_store(const std::vector<sqlite::variant_t> &column_types);
+  ~Recordset_column_store();
+
+public:
+  void add_row(const Var_vector &values);
+  void clear();
+
+  size_t row_count() const { return _row_count; }
+  size_t column_count() const { return _columns.size(); }
+  size_t memory_usage() const;
+
+  bool is_null(size_t row, size_t column) const;
+  sqlite::variant_t get(size_t row, size_t column) const;
+  void get_row(size_t row, Var_vector &values) const;
+
+  // direct access to the typed buffers (e.g. for sorting), the storage kind of the column must fit
+  // and the value must not be null
+  boost::int64_t int_value(size_t row, size_t column) const { return _columns[column].ints[row]; }
+  long double real_value(size_t row, size_t column) const { return _columns[column].reals[row]; }
+  const char *bytes_value(size_t row, size_t column, size_t &length) const;
+  const sqlite::variant_t &variant_value(size_t row, size_t column) const { return _columns[column].variants[row]; }
+
+public:
+  enum StorageKind
+  {
+    NullStorage,    // column of unknown/null type, values are not kept
+    IntStorage,     // int values
+    Int64Storage,   // boost::int64_t values
+    RealStorage,    // long double values
+    TextStorage,    // std::string values in the arena
+    BlobStorage,    // blob values in the arena
+    VariantStorage  // mixed value types, fallback for columns whose values don't match their declared type
+  };
+
+  StorageKind storage_kind(size_t column) const { return _columns[column].kind; }
+
+private:
+  struct Column
+  {
+    StorageKind kind;
+    std::vector<boost::uint8_t> nulls; // bitmap, 1 bit per row
+    std::vector<boost::int64_t> ints;
+    std::vector<long double> reals;
+    std::vector<char> arena;
+    std::vector<size_t> offsets; // offsets[row] .. offsets[row + 1] is the arena range of a row, first entry is 0
+    std::vector<sqlite::variant_t> variants;
+
+    Column() : kind(NullStorage) {}
+  };
+
+  class AppendVar;
+  friend class AppendVar;
+
+  void set_null_bit(Column &column, size_t row, bool is_null);
+  void append_default(Column &column);
+  void demote_to_variants(Column &column);
+  sqlite::variant_t get_(const Column &column, size_t row) const;
+
+  std::vector<Column> _columns;
+  size_t _row_count;
+};
+
+
+#endif /* _RECORDSET_COLUMN_STORE_BE_H_ */
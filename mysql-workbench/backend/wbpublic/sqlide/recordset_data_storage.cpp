@@ -66,6 +66,8 @@ void Recordset_data_storage::apply_changes(Recordset::Ptr recordset_ptr, bool sk
 void Recordset_data_storage::serialize(Recordset::Ptr recordset_ptr)
 {
   RETURN_IF_FAIL_TO_RETAIN_WEAK_PTR (Recordset, recordset_ptr, recordset)
+  if (recordset->is_fetching())
+    throw std::runtime_error(_("The result set is still being fetched, please wait until it's complete or stop the query."));
   boost::shared_ptr<sqlite::connection> data_swap_db= recordset->data_swap_db();
   do_serialize(recordset, data_swap_db.get());
 }
@@ -152,18 +154,18 @@ void Recordset_data_storage::create_data_swap_tables(sqlite::connection *data_sw
 }
 
 
-std::list<boost::shared_ptr<sqlite::command> > Recordset_data_storage::prepare_data_swap_record_add_statement(sqlite::connection *data_swap_db, Recordset::Column_names &column_names)
+std::list<boost::shared_ptr<sqlite::command> > Recordset_data_storage::prepare_data_swap_record_add_statement(sqlite::connection *data_swap_db, ColumnId column_count)
 {
   std::list<boost::shared_ptr<sqlite::command> > res;
 
-  for (size_t partition= 0, partition_count= Recordset::data_swap_db_partition_count(column_names.size()); partition < partition_count; ++partition)
+  for (size_t partition= 0, partition_count= Recordset::data_swap_db_partition_count(column_count); partition < partition_count; ++partition)
   {
     std::string partition_suffix= Recordset::data_swap_db_partition_suffix(partition);
     std::ostringstream sql;
     sql << strfmt("insert into `data%s` (", partition_suffix.c_str());
     std::string col_delim;
     for (ColumnId col= partition * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT,
-      col_end= std::min<ColumnId>(column_names.size(), (partition + 1) * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT); col < col_end; ++col)
+      col_end= std::min<ColumnId>(column_count, (partition + 1) * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT); col < col_end; ++col)
     {
       sql << col_delim << "`_" << col << "`";
       col_delim= ", ";
@@ -171,7 +173,7 @@ std::list<boost::shared_ptr<sqlite::command> > Recordset_data_storage::prepare_d
     sql << ") values (";
     col_delim.clear();
     for (ColumnId col= partition * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT,
-      col_count= std::min<ColumnId>(column_names.size(), (partition + 1) * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT); col < col_count; ++col)
+      col_end= std::min<ColumnId>(column_count, (partition + 1) * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT); col < col_end; ++col)
     {
       sql << col_delim << "?";
       col_delim= ", ";
@@ -204,6 +206,17 @@ void Recordset_data_storage::add_data_swap_record(std::list<boost::shared_ptr<sq
 }
 
 
+void Recordset_data_storage::add_data_swap_records(std::list<boost::shared_ptr<sqlite::command> > &insert_commands, const Recordset_column_store &column_store)
+{
+  Var_vector row_values(column_store.column_count());
+  for (RowId row= 0, row_count= column_store.row_count(); row < row_count; ++row)
+  {
+    column_store.get_row(row, row_values);
+    add_data_swap_record(insert_commands, row_values);
+  }
+}
+
+
 void Recordset_data_storage::update_data_swap_record(sqlite::connection *data_swap_db, RowId rowid, ColumnId column, const sqlite::variant_t &value)
 {
   size_t partition= Recordset::data_swap_db_column_partition(column);
@@ -24,6 +24,7 @@
 
 #include "wbpublic_public_interface.h"
 #include "sqlide/recordset_be.h"
+#include "sqlide/recordset_column_store.h"
 
 namespace sqlite
 {
@@ -80,9 +81,10 @@ public:
 
 public:
   static void create_data_swap_tables(sqlite::connection *data_swap_db, Recordset::Column_names &column_names, Recordset::Column_types &column_types);
+  static std::list<boost::shared_ptr<sqlite::command> > prepare_data_swap_record_add_statement(sqlite::connection *data_swap_db, ColumnId column_count);
+  static void add_data_swap_record(std::list<boost::shared_ptr<sqlite::command> > &insert_commands, const Var_vector &values);
+  static void add_data_swap_records(std::list<boost::shared_ptr<sqlite::command> > &insert_commands, const Recordset_column_store &column_store);
 protected:
-  std::list<boost::shared_ptr<sqlite::command> > prepare_data_swap_record_add_statement(sqlite::connection *data_swap_db, Recordset::Column_names &column_names);
-  void add_data_swap_record(std::list<boost::shared_ptr<sqlite::command> > &insert_commands, const Var_vector &values);
   void update_data_swap_record(sqlite::connection *data_swap_db, RowId rowid, ColumnId column, const sqlite::variant_t &value);
 
 protected:
@@ -94,6 +96,16 @@ protected:
   static const Recordset::Column_types & get_column_types(const Recordset *recordset) { return recordset->_column_types; }
   static const Recordset::Column_types & get_real_column_types(const Recordset *recordset) { return recordset->_real_column_types; }
   static const Recordset::Column_flags & get_column_flags(const Recordset *recordset) { return recordset->_column_flags; }
+  static void set_column_store(Recordset *recordset, const Recordset_column_store::Ref &column_store) { recordset->_column_store= column_store; }
+  static void spill_column_store(Recordset *recordset, sqlite::connection *data_swap_db, bool use_transaction= true)
+  {
+    static_cast<VarGridModel*>(recordset)->spill_column_store(data_swap_db, use_transaction);
+  }
+
+  // streaming fetch, rows are published to the recordset's column store while still being fetched
+  void begin_fetch(Recordset *recordset) { recordset->begin_fetch(this); }
+  void append_fetched_rows(Recordset *recordset, const std::vector<Var_vector> &rows) { recordset->append_fetched_rows(rows); }
+  void end_fetch(Recordset *recordset) { recordset->end_fetch(); }
   
 public:
   bool limit_rows() { return _limit_rows; }
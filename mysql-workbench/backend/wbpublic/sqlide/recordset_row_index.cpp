@@ -0,0 +1,804 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "recordset_row_index.h"
+#include "base/threading.h"
+
+#include <glib.h>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+
+
+// Rows each thread should get at least, to make starting it worth the effort.
+#define MIN_ROWS_PER_INDEX_THREAD 50000
+#define MAX_INDEX_THREADS 8
+
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+  /**
+   * A task of a parallel index operation. Exceptions can't leave a thread, so they are kept and
+   * rethrown in the calling thread once all tasks are done.
+   */
+  struct Index_task
+  {
+    boost::function<void ()> run;
+    std::string error;
+  };
+
+  gpointer run_index_task(gpointer data)
+  {
+    Index_task *task= (Index_task *)data;
+    try
+    {
+      task->run();
+    }
+    catch (std::exception &exc)
+    {
+      task->error= exc.what();
+    }
+    return NULL;
+  }
+
+  /**
+   * Runs the tasks in parallel, each in its own thread except the first one, which is run by the
+   * calling thread. Tasks for which no thread could be created are run by the calling thread too.
+   */
+  void run_index_tasks(std::vector<Index_task> &tasks)
+  {
+    std::vector<GThread *> threads;
+    std::vector<Index_task *> unstarted_tasks;
+    for (size_t n= 1; n < tasks.size(); ++n)
+    {
+      GError *error= NULL;
+      GThread *thread= base::create_thread(run_index_task, &tasks[n], &error, "Recordset index");
+      if (thread == NULL)
+      {
+        if (error != NULL)
+          g_error_free(error);
+        unstarted_tasks.push_back(&tasks[n]);
+        continue;
+      }
+      threads.push_back(thread);
+    }
+
+    if (!tasks.empty())
+      run_index_task(&tasks[0]);
+    for (std::vector<Index_task *>::iterator task= unstarted_tasks.begin(); task != unstarted_tasks.end(); ++task)
+      run_index_task(*task);
+    for (std::vector<GThread *>::iterator thread= threads.begin(); thread != threads.end(); ++thread)
+      g_thread_join(*thread);
+
+    for (std::vector<Index_task>::iterator task= tasks.begin(); task != tasks.end(); ++task)
+      if (!task->error.empty())
+        throw std::runtime_error(task->error);
+  }
+
+  inline unsigned char fold_char(unsigned char c)
+  {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+  }
+
+  // Position of the character following the (UTF-8) one at the given position.
+  inline size_t next_char(const char *text, size_t position, size_t length)
+  {
+    ++position;
+    while (position < length && ((unsigned char)text[position] & 0xC0) == 0x80)
+      ++position;
+    return position;
+  }
+
+  int compare_texts(const char *a, size_t a_length, const char *b, size_t b_length, bool nocase)
+  {
+    size_t length= std::min(a_length, b_length);
+    for (size_t n= 0; n < length; ++n)
+    {
+      unsigned char ca= a[n];
+      unsigned char cb= b[n];
+      if (nocase)
+      {
+        ca= fold_char(ca);
+        cb= fold_char(cb);
+      }
+      if (ca != cb)
+        return (ca < cb) ? -1 : 1;
+    }
+    return (a_length == b_length) ? 0 : ((a_length < b_length) ? -1 : 1);
+  }
+
+  // Leading number of the text, 0 if there is none (like sqlite's cast(x as numeric)).
+  long double text_to_number(const char *text, size_t length, std::string &buffer)
+  {
+    buffer.assign(text, length);
+    return g_ascii_strtod(buffer.c_str(), NULL);
+  }
+
+  class Var_text : public boost::static_visitor<const char *>
+  {
+  public:
+    Var_text(std::string &buffer, size_t &length) : _buffer(buffer), _length(length) {}
+
+    result_type operator()(const sqlite::unknown_t &) const { return NULL; }
+    result_type operator()(const sqlite::null_t &) const { return NULL; }
+    result_type operator()(const int &v) const { return format("%i", v); }
+    result_type operator()(const boost::int64_t &v) const { return format("%lld", (long long)v); }
+    result_type operator()(const long double &v) const { return format("%.15g", (double)v); }
+    result_type operator()(const std::string &v) const
+    {
+      _length= v.size();
+      return v.c_str();
+    }
+    result_type operator()(const sqlite::blob_ref_t &v) const
+    {
+      if (!v)
+        return NULL;
+      _length= v->size();
+      return v->empty() ? "" : (const char *)&(*v)[0];
+    }
+
+  private:
+    template<typename T>
+    const char *format(const char *fmt, T v) const
+    {
+      char text[64];
+      int length= snprintf(text, sizeof(text), fmt, v);
+      _buffer.assign(text, (length > 0) ? std::min((size_t)length, sizeof(text) - 1) : 0);
+      _length= _buffer.size();
+      return _buffer.c_str();
+    }
+
+    std::string &_buffer;
+    size_t &_length;
+  };
+
+  class Var_number : public boost::static_visitor<long double>
+  {
+  public:
+    Var_number(std::string &buffer) : _buffer(buffer) {}
+
+    result_type operator()(const int &v) const { return v; }
+    result_type operator()(const boost::int64_t &v) const { return (long double)v; }
+    result_type operator()(const long double &v) const { return v; }
+    result_type operator()(const std::string &v) const { return text_to_number(v.data(), v.size(), _buffer); }
+    result_type operator()(const sqlite::blob_ref_t &v) const
+    {
+      return (v && !v->empty()) ? text_to_number((const char *)&(*v)[0], v->size(), _buffer) : 0;
+    }
+    template<typename T>
+    result_type operator()(const T &) const { return 0; }
+
+  private:
+    std::string &_buffer;
+  };
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Sort key values of one sort column for all rows of the store.
+ */
+struct Recordset_row_index::Sort_key
+{
+  Sort_column column;
+  bool int_keys; // numeric keys of integer columns are compared as integers, all others as reals
+  std::vector<char> nulls;
+  std::vector<boost::int64_t> ints;
+  std::vector<long double> reals;
+  std::vector<const char *> texts;
+  std::vector<size_t> lengths;
+  std::vector<std::string> owned_texts; // texts that are not kept as such by the store
+  size_t common_prefix; // length of the text start shared by all values, not worth comparing
+
+  int compare(size_t a, size_t b) const
+  {
+    if (nulls[a] || nulls[b])
+      return nulls[b] - nulls[a]; // null is the smallest value, as in sqlite
+    switch (column.kind)
+    {
+      case NumericCompare:
+        if (int_keys)
+          return (ints[a] == ints[b]) ? 0 : ((ints[a] < ints[b]) ? -1 : 1);
+        return (reals[a] == reals[b]) ? 0 : ((reals[a] < reals[b]) ? -1 : 1);
+      case NocaseTextCompare:
+        return compare_texts(texts[a], lengths[a], texts[b], lengths[b], true);
+      default:
+        return compare_texts(texts[a], lengths[a], texts[b], lengths[b], false);
+    }
+  }
+
+  /**
+   * Order preserving 64 bit digest of the key in sort direction: if the prefix of a row is smaller than
+   * that of another row, so is its key. Rows with equal prefixes need a full comparison.
+   */
+  boost::uint64_t prefix(size_t row) const
+  {
+    boost::uint64_t result= 0; // also for nulls, the smallest value
+    if (!nulls[row])
+    {
+      if (column.kind == NumericCompare && int_keys)
+        result= (boost::uint64_t)ints[row] ^ ((boost::uint64_t)1 << 63);
+      else if (column.kind == NumericCompare)
+      {
+        double value= (double)reals[row];
+        if (value == 0)
+          value= 0; // no negative zero
+        boost::uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        result= (bits & ((boost::uint64_t)1 << 63)) ? ~bits : (bits | ((boost::uint64_t)1 << 63));
+      }
+      else
+      {
+        for (size_t n= common_prefix; n < common_prefix + 8; ++n)
+        {
+          unsigned char c= (n < lengths[row]) ? texts[row][n] : 0;
+          result= (result << 8) | ((column.kind == NocaseTextCompare) ? fold_char(c) : c);
+        }
+      }
+    }
+    return (column.direction < 0) ? ~result : result;
+  }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Row to sort together with the prefix of its first sort key. Most comparisons can be decided by
+ * the prefixes, which are right at hand, without looking up the keys.
+ */
+struct Recordset_row_index::Sort_entry
+{
+  boost::uint64_t prefix;
+  size_t row;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+class Recordset_row_index::Row_less
+{
+public:
+  Row_less(const std::vector<Sort_key> &keys) : _keys(keys) {}
+
+  bool operator()(size_t a, size_t b) const
+  {
+    for (std::vector<Sort_key>::const_iterator key= _keys.begin(); key != _keys.end(); ++key)
+    {
+      int result= key->compare(a, b);
+      if (result != 0)
+        return (key->column.direction < 0) ? (result > 0) : (result < 0);
+    }
+    return a < b;
+  }
+
+private:
+  const std::vector<Sort_key> &_keys;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+class Recordset_row_index::Entry_less
+{
+public:
+  Entry_less(const Row_less &less) : _less(less) {}
+
+  bool operator()(const Sort_entry &a, const Sort_entry &b) const
+  {
+    if (a.prefix != b.prefix)
+      return a.prefix < b.prefix;
+    return _less(a.row, b.row);
+  }
+
+private:
+  const Row_less &_less;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_row_index::fill_sort_entries(const Sort_key *key, const Rows *rows, std::pair<size_t, size_t> run,
+  Sort_entries *entries)
+{
+  for (size_t n= run.first; n < run.second; ++n)
+  {
+    Sort_entry &entry= (*entries)[n];
+    entry.row= (*rows)[n];
+    entry.prefix= key->prefix(entry.row);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_row_index::sort_run(Sort_entries *entries, std::pair<size_t, size_t> run, const Entry_less &less)
+{
+  std::sort(entries->begin() + run.first, entries->begin() + run.second, less);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_row_index::merge_runs(const Sort_entries *entries, std::pair<size_t, size_t> run1, std::pair<size_t, size_t> run2,
+  Sort_entries *merged, const Entry_less &less)
+{
+  std::merge(entries->begin() + run1.first, entries->begin() + run1.second, entries->begin() + run2.first,
+    entries->begin() + run2.second, merged->begin() + run1.first, less);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_row_index::copy_run(const Sort_entries *entries, std::pair<size_t, size_t> run, Sort_entries *merged)
+{
+  std::copy(entries->begin() + run.first, entries->begin() + run.second, merged->begin() + run.first);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Recordset_row_index::Recordset_row_index()
+:
+_store(NULL),
+_max_thread_count(MAX_INDEX_THREADS)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool Recordset_row_index::is_identity() const
+{
+  return _sort_columns.empty() && _column_filters.empty() && _search_string.empty();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Fills rows with the numbers of all rows of the store passing the column filters and the search string,
+ * in sort order.
+ */
+void Recordset_row_index::build(const Recordset_column_store::Ref &store, Rows &rows)
+{
+  if (_bitmaps_store.lock() != store)
+  {
+    _filter_bitmaps.clear();
+    _search_bitmap_text.clear();
+    Bitmap().swap(_search_bitmap);
+    _bitmaps_store= store;
+  }
+  _store= store.get();
+  const size_t row_count= _store->row_count();
+
+  // bitmaps of filters no longer set are dropped, the others are kept for the next build
+  std::map<std::pair<size_t, std::string>, Bitmap> filter_bitmaps;
+  for (std::map<size_t, std::string>::const_iterator filter= _column_filters.begin(); filter != _column_filters.end(); ++filter)
+  {
+    std::pair<size_t, std::string> key(filter->first, filter->second);
+    std::map<std::pair<size_t, std::string>, Bitmap>::iterator bitmap= _filter_bitmaps.find(key);
+    if (bitmap != _filter_bitmaps.end())
+      filter_bitmaps[key].swap(bitmap->second);
+  }
+  _filter_bitmaps.swap(filter_bitmaps);
+  if (_search_string.empty())
+  {
+    _search_bitmap_text.clear();
+    Bitmap().swap(_search_bitmap);
+  }
+
+  Bitmap visible;
+  bool filtered= false;
+  for (std::map<size_t, std::string>::const_iterator filter= _column_filters.begin(); filter != _column_filters.end(); ++filter)
+  {
+    const Bitmap &bits= filter_bitmap(filter->first, filter->second);
+    if (!filtered)
+      visible= bits;
+    else
+      for (size_t n= 0; n < visible.size(); ++n)
+        visible[n]&= bits[n];
+    filtered= true;
+  }
+  if (!_search_string.empty())
+  {
+    const Bitmap &bits= search_bitmap();
+    if (!filtered)
+      visible= bits;
+    else
+      for (size_t n= 0; n < visible.size(); ++n)
+        visible[n]&= bits[n];
+    filtered= true;
+  }
+
+  rows.clear();
+  if (filtered)
+  {
+    for (size_t word= 0; word < visible.size(); ++word)
+    {
+      boost::uint64_t bits= visible[word];
+      for (size_t bit= 0; bits != 0; ++bit, bits>>= 1)
+        if (bits & 1)
+          rows.push_back(word * 64 + bit);
+    }
+  }
+  else
+  {
+    rows.reserve(row_count);
+    for (size_t row= 0; row < row_count; ++row)
+      rows.push_back(row);
+  }
+
+  if (!_sort_columns.empty())
+    sort_rows(rows);
+  _store= NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const Recordset_row_index::Bitmap &Recordset_row_index::filter_bitmap(size_t column, const std::string &pattern)
+{
+  Bitmap &bits= _filter_bitmaps[std::make_pair(column, pattern)];
+  const size_t row_count= _store->row_count();
+  if (bits.size() == (row_count + 63) / 64)
+    return bits;
+
+  bits.assign((row_count + 63) / 64, 0);
+  std::vector<size_t> columns(1, column);
+  std::vector<std::pair<size_t, size_t> > ranges= row_ranges(row_count, 64);
+  std::vector<Index_task> tasks(ranges.size());
+  for (size_t n= 0; n < ranges.size(); ++n)
+    tasks[n].run= boost::bind(&Recordset_row_index::match_rows, this, boost::cref(columns), boost::cref(pattern),
+      ranges[n].first, ranges[n].second, &bits);
+  run_index_tasks(tasks);
+  return bits;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Rows containing the search string in any of their (stored) columns.
+ */
+const Recordset_row_index::Bitmap &Recordset_row_index::search_bitmap()
+{
+  const size_t row_count= _store->row_count();
+  if (_search_bitmap_text == _search_string && _search_bitmap.size() == (row_count + 63) / 64)
+    return _search_bitmap;
+
+  _search_bitmap.assign((row_count + 63) / 64, 0);
+  _search_bitmap_text= _search_string;
+  std::string pattern= "%" + _search_string + "%";
+  std::vector<size_t> columns;
+  for (size_t column= 0; column < _store->column_count(); ++column)
+    columns.push_back(column);
+  std::vector<std::pair<size_t, size_t> > ranges= row_ranges(row_count, 64);
+  std::vector<Index_task> tasks(ranges.size());
+  for (size_t n= 0; n < ranges.size(); ++n)
+    tasks[n].run= boost::bind(&Recordset_row_index::match_rows, this, boost::cref(columns), boost::cref(pattern),
+      ranges[n].first, ranges[n].second, &_search_bitmap);
+  run_index_tasks(tasks);
+  return _search_bitmap;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Sets the bits of the rows in [begin, end) where any of the columns matches the pattern. Ranges of
+ * parallel calls must be aligned to 64 rows, so that they don't share bitmap words.
+ */
+void Recordset_row_index::match_rows(const std::vector<size_t> &columns, const std::string &pattern,
+  size_t begin, size_t end, Bitmap *bits) const
+{
+  std::string buffer;
+  for (size_t row= begin; row < end; ++row)
+  {
+    for (std::vector<size_t>::const_iterator column= columns.begin(); column != columns.end(); ++column)
+    {
+      size_t length= 0;
+      const char *text= text_value(row, *column, buffer, length);
+      if (text != NULL && like_match(pattern.data(), pattern.size(), text, length))
+      {
+        (*bits)[row / 64]|= (boost::uint64_t)1 << (row % 64);
+        break;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Text of a value as sqlite would see it for a LIKE, NULL for null values. The buffer is used for
+ * values that are not kept as text.
+ */
+const char *Recordset_row_index::text_value(size_t row, size_t column, std::string &buffer, size_t &length) const
+{
+  const Recordset_column_store &store= *_store;
+  if (column >= store.column_count())
+    return Var_text(buffer, length)((boost::int64_t)row + 1);
+  if (store.is_null(row, column))
+    return NULL;
+
+  switch (store.storage_kind(column))
+  {
+    case Recordset_column_store::IntStorage:
+    case Recordset_column_store::Int64Storage:
+      return Var_text(buffer, length)(store.int_value(row, column));
+    case Recordset_column_store::RealStorage:
+      return Var_text(buffer, length)(store.real_value(row, column));
+    case Recordset_column_store::TextStorage:
+    case Recordset_column_store::BlobStorage:
+      return store.bytes_value(row, column, length);
+    case Recordset_column_store::VariantStorage:
+    {
+      Var_text var_text(buffer, length);
+      return boost::apply_visitor(var_text, store.variant_value(row, column));
+    }
+    default:
+      return NULL;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Sorts the rows by the sort columns. Sort keys are extracted first, then the rows (as sort entries)
+ * are split into runs sorted by separate threads, which are then merged pairwise (also in parallel)
+ * until one is left.
+ */
+void Recordset_row_index::sort_rows(Rows &rows) const
+{
+  const Recordset_column_store &store= *_store;
+  const size_t row_count= store.row_count();
+  std::vector<std::pair<size_t, size_t> > key_ranges= row_ranges(row_count, 1);
+
+  std::vector<Sort_key> keys(_sort_columns.size());
+  for (size_t n= 0; n < _sort_columns.size(); ++n)
+  {
+    Sort_key &key= keys[n];
+    key.column= _sort_columns[n];
+    size_t column= key.column.column;
+    Recordset_column_store::StorageKind storage_kind= (column < store.column_count()) ?
+      store.storage_kind(column) : Recordset_column_store::Int64Storage;
+
+    key.nulls.resize(row_count, 0);
+    key.common_prefix= 0;
+    if (key.column.kind == NumericCompare)
+    {
+      key.int_keys= (storage_kind == Recordset_column_store::IntStorage || storage_kind == Recordset_column_store::Int64Storage);
+      if (key.int_keys)
+        key.ints.resize(row_count);
+      else
+        key.reals.resize(row_count);
+    }
+    else
+    {
+      key.int_keys= false;
+      key.texts.resize(row_count);
+      key.lengths.resize(row_count);
+      if (storage_kind != Recordset_column_store::TextStorage && storage_kind != Recordset_column_store::BlobStorage)
+        key.owned_texts.resize(row_count);
+    }
+
+    std::vector<Index_task> tasks(key_ranges.size());
+    for (size_t r= 0; r < key_ranges.size(); ++r)
+      tasks[r].run= boost::bind(&Recordset_row_index::fill_sort_key, this, &key, key_ranges[r].first, key_ranges[r].second);
+    run_index_tasks(tasks);
+  }
+
+  // values like URLs or codes often start the same, the prefix of the first key is taken after that part
+  Sort_key &first_key= keys[0];
+  if (first_key.column.kind != NumericCompare)
+  {
+    const char *first_text= NULL;
+    for (size_t row= 0; row < row_count; ++row)
+    {
+      if (first_key.nulls[row])
+        continue;
+      if (first_text == NULL)
+      {
+        first_text= first_key.texts[row];
+        first_key.common_prefix= first_key.lengths[row];
+        continue;
+      }
+      size_t length= std::min(first_key.common_prefix, first_key.lengths[row]);
+      size_t n= 0;
+      if (first_key.column.kind == NocaseTextCompare)
+        while (n < length && fold_char(first_text[n]) == fold_char(first_key.texts[row][n]))
+          ++n;
+      else
+        while (n < length && first_text[n] == first_key.texts[row][n])
+          ++n;
+      first_key.common_prefix= n;
+      if (n == 0)
+        break;
+    }
+  }
+
+  Row_less row_less(keys);
+  Entry_less less(row_less);
+  std::vector<std::pair<size_t, size_t> > runs= row_ranges(rows.size(), 1);
+  Sort_entries entries(rows.size());
+  {
+    std::vector<Index_task> tasks(runs.size());
+    for (size_t n= 0; n < runs.size(); ++n)
+      tasks[n].run= boost::bind(&fill_sort_entries, &first_key, &rows, runs[n], &entries);
+    run_index_tasks(tasks);
+  }
+  if (runs.size() > 1)
+  {
+    std::vector<Index_task> tasks(runs.size());
+    for (size_t n= 0; n < runs.size(); ++n)
+      tasks[n].run= boost::bind(&sort_run, &entries, runs[n], boost::cref(less));
+    run_index_tasks(tasks);
+  }
+  else
+    std::sort(entries.begin(), entries.end(), less);
+
+  Sort_entries merged(entries.size());
+  while (runs.size() > 1)
+  {
+    std::vector<std::pair<size_t, size_t> > merged_runs;
+    std::vector<Index_task> tasks;
+    for (size_t n= 0; n < runs.size(); n+= 2)
+    {
+      Index_task task;
+      if (n + 1 < runs.size())
+      {
+        task.run= boost::bind(&merge_runs, &entries, runs[n], runs[n + 1], &merged, boost::cref(less));
+        merged_runs.push_back(std::make_pair(runs[n].first, runs[n + 1].second));
+      }
+      else
+      {
+        task.run= boost::bind(&copy_run, &entries, runs[n], &merged);
+        merged_runs.push_back(runs[n]);
+      }
+      tasks.push_back(task);
+    }
+    run_index_tasks(tasks);
+    entries.swap(merged);
+    runs.swap(merged_runs);
+  }
+
+  for (size_t n= 0; n < entries.size(); ++n)
+    rows[n]= entries[n].row;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Recordset_row_index::fill_sort_key(Sort_key *key, size_t begin, size_t end) const
+{
+  const Recordset_column_store &store= *_store;
+  const size_t column= key->column.column;
+  const bool stored= column < store.column_count();
+  const Recordset_column_store::StorageKind storage_kind= stored ? store.storage_kind(column) : Recordset_column_store::Int64Storage;
+  std::string buffer;
+
+  for (size_t row= begin; row < end; ++row)
+  {
+    if (stored && store.is_null(row, column))
+    {
+      key->nulls[row]= 1;
+      continue;
+    }
+
+    if (key->column.kind == NumericCompare)
+    {
+      if (key->int_keys)
+        key->ints[row]= stored ? store.int_value(row, column) : (boost::int64_t)row + 1;
+      else if (storage_kind == Recordset_column_store::RealStorage)
+        key->reals[row]= store.real_value(row, column);
+      else if (storage_kind == Recordset_column_store::VariantStorage)
+      {
+        Var_number var_number(buffer);
+        key->reals[row]= boost::apply_visitor(var_number, store.variant_value(row, column));
+      }
+      else
+      {
+        size_t length= 0;
+        const char *text= store.bytes_value(row, column, length);
+        key->reals[row]= text_to_number(text, length, buffer);
+      }
+    }
+    else if (key->owned_texts.empty())
+    {
+      key->texts[row]= store.bytes_value(row, column, key->lengths[row]);
+    }
+    else
+    {
+      size_t length= 0;
+      const char *text= text_value(row, column, buffer, length);
+      if (text == NULL)
+      {
+        key->nulls[row]= 1;
+        continue;
+      }
+      key->owned_texts[row].assign(text, length);
+      key->texts[row]= key->owned_texts[row].data();
+      key->lengths[row]= length;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+size_t Recordset_row_index::thread_count(size_t row_count) const
+{
+  size_t count= std::min((size_t)g_get_num_processors(), row_count / MIN_ROWS_PER_INDEX_THREAD);
+  count= std::min(count, _max_thread_count);
+  return std::max(count, (size_t)1);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Splits [0, row_count) into one range per thread to use, with range boundaries at multiples of alignment.
+ */
+std::vector<std::pair<size_t, size_t> > Recordset_row_index::row_ranges(size_t row_count, size_t alignment) const
+{
+  std::vector<std::pair<size_t, size_t> > ranges;
+  size_t count= thread_count(row_count);
+  size_t range_size= (row_count + count - 1) / count;
+  range_size= ((range_size + alignment - 1) / alignment) * alignment;
+  for (size_t begin= 0; begin < row_count; begin+= range_size)
+    ranges.push_back(std::make_pair(begin, std::min(begin + range_size, row_count)));
+  return ranges;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Matches the text against a LIKE pattern (sqlite semantics, no escape character).
+ */
+bool Recordset_row_index::like_match(const char *pattern, size_t pattern_length, const char *text, size_t text_length)
+{
+  size_t p= 0;
+  size_t t= 0;
+  size_t wildcard_p= std::string::npos; // pattern position after the last '%' seen
+  size_t wildcard_t= 0; // text position that '%' is currently assumed to end at
+
+  while (t < text_length)
+  {
+    if (p < pattern_length && pattern[p] == '%')
+    {
+      wildcard_p= ++p;
+      wildcard_t= t;
+    }
+    else if (p < pattern_length && pattern[p] == '_')
+    {
+      ++p;
+      t= next_char(text, t, text_length);
+    }
+    else if (p < pattern_length && fold_char(pattern[p]) == fold_char(text[t]))
+    {
+      ++p;
+      ++t;
+    }
+    else if (wildcard_p != std::string::npos)
+    {
+      // let the last '%' take one more character and try again from there
+      p= wildcard_p;
+      wildcard_t= next_char(text, wildcard_t, text_length);
+      t= wildcard_t;
+    }
+    else
+      return false;
+  }
+
+  while (p < pattern_length && pattern[p] == '%')
+    ++p;
+  return p == pattern_length;
+}
+
+//--------------------------------------------------------------------------------------------------
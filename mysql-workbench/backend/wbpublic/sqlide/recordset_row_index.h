@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+
+#ifndef _RECORDSET_ROW_INDEX_BE_H_
+#define _RECORDSET_ROW_INDEX_BE_H_
+
+
+#include "wbpublic_public_interface.h"
+#include "sqlide/recordset_column_store.h"
+#include <boost/cstdint.hpp>
+#include <boost/weak_ptr.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/**
+ * Sorted and filtered view of the rows in a Recordset_column_store, as a permutation of row numbers.
+ *
+ * Column filters and the search string use LIKE patterns with the semantics of sqlite (which served
+ * them before): '%' matches any sequence, '_' a single character, ASCII letters are compared case
+ * insensitively. Each filter is evaluated into a row bitmap that is kept until the filter changes,
+ * so changing the sort order doesn't scan the data again.
+ *
+ * Sorting compares typed keys taken from the store and breaks ties by row number, which makes any
+ * multi column sort stable with respect to the fetch order. Bigger data sets are sorted and filtered
+ * by several threads (parallel merge sort).
+ *
+ * Columns beyond those kept in the store stand for the auxiliary row id (row number + 1).
+ */
+class WBPUBLICBACKEND_PUBLIC_FUNC Recordset_row_index
+{
+public:
+  typedef std::vector<size_t> Rows;
+
+  enum Compare_kind
+  {
+    NumericCompare,     // values as numbers, text is converted like sqlite's cast(x as numeric) does
+    NocaseTextCompare,  // values as text, ASCII letters case insensitive (sqlite's NOCASE collation)
+    BinaryCompare       // values as text, bytewise
+  };
+
+  struct Sort_column
+  {
+    size_t column;
+    int direction; // 1 - ascending, -1 - descending
+    Compare_kind kind;
+  };
+
+  Recordset_row_index();
+
+  void set_sort_columns(const std::vector<Sort_column> &sort_columns) { _sort_columns= sort_columns; }
+  void set_column_filters(const std::map<size_t, std::string> &filters) { _column_filters= filters; }
+  void set_search_string(const std::string &text) { _search_string= text; }
+  void set_max_thread_count(size_t count) { _max_thread_count= count; }
+
+  bool is_identity() const; // no sorting and no filtering
+  void build(const Recordset_column_store::Ref &store, Rows &rows);
+
+  static bool like_match(const char *pattern, size_t pattern_length, const char *text, size_t text_length);
+
+private:
+  typedef std::vector<boost::uint64_t> Bitmap; // 1 bit per row
+  struct Sort_key;
+  struct Sort_entry;
+  typedef std::vector<Sort_entry> Sort_entries;
+  class Row_less;
+  class Entry_less;
+
+  const Bitmap &filter_bitmap(size_t column, const std::string &pattern);
+  const Bitmap &search_bitmap();
+  void match_rows(const std::vector<size_t> &columns, const std::string &pattern, size_t begin, size_t end, Bitmap *bits) const;
+  const char *text_value(size_t row, size_t column, std::string &buffer, size_t &length) const;
+
+  void sort_rows(Rows &rows) const;
+  void fill_sort_key(Sort_key *key, size_t begin, size_t end) const;
+  static void fill_sort_entries(const Sort_key *key, const Rows *rows, std::pair<size_t, size_t> run, Sort_entries *entries);
+  static void sort_run(Sort_entries *entries, std::pair<size_t, size_t> run, const Entry_less &less);
+  static void merge_runs(const Sort_entries *entries, std::pair<size_t, size_t> run1, std::pair<size_t, size_t> run2,
+    Sort_entries *merged, const Entry_less &less);
+  static void copy_run(const Sort_entries *entries, std::pair<size_t, size_t> run, Sort_entries *merged);
+
+  size_t thread_count(size_t row_count) const;
+  std::vector<std::pair<size_t, size_t> > row_ranges(size_t row_count, size_t alignment) const;
+
+  const Recordset_column_store *_store; // only set during build()
+  std::vector<Sort_column> _sort_columns;
+  std::map<size_t, std::string> _column_filters;
+  std::string _search_string;
+  size_t _max_thread_count;
+
+  boost::weak_ptr<Recordset_column_store> _bitmaps_store; // store the cached bitmaps were made for
+  std::map<std::pair<size_t, std::string>, Bitmap> _filter_bitmaps;
+  std::string _search_bitmap_text;
+  Bitmap _search_bitmap;
+};
+
+
+#endif /* _RECORDSET_ROW_INDEX_BE_H_ */
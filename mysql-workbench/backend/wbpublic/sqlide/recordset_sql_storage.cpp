@@ -181,7 +181,7 @@ void Recordset_sql_storage::do_unserialize(Recordset *recordset, sqlite::connect
 
         create_data_swap_tables(data_swap_db, column_names, column_types);
         Var_vector row_values(column_names.size());
-        std::list<boost::shared_ptr<sqlite::command> > insert_commands= prepare_data_swap_record_add_statement(data_swap_db, column_names);
+        std::list<boost::shared_ptr<sqlite::command> > insert_commands= prepare_data_swap_record_add_statement(data_swap_db, column_names.size());
         Var_list::iterator var_list_iter= var_list.begin();
         for (size_t n= 0, count= var_list.size() / column_names.size(); n < count; ++n)
         {
@@ -160,7 +160,7 @@ void Recordset_sqlite_storage::do_unserialize(Recordset *recordset, sqlite::conn
     if (rs_contains_rows)
     {
       Var_vector row_values(col_count);
-      std::list<boost::shared_ptr<sqlite::command> > insert_commands= prepare_data_swap_record_add_statement(data_swap_db, column_names);
+      std::list<boost::shared_ptr<sqlite::command> > insert_commands= prepare_data_swap_record_add_statement(data_swap_db, column_names.size());
 
       do
       {
@@ -21,15 +21,19 @@
 
 #include "recordset_text_storage.h"
 #include "recordset_be.h"
+#include "cppdbc.h"
 #include "base/string_utilities.h"
 #include "base/file_functions.h"
 #include "base/file_utilities.h"
 #include "base/config_file.h"
+#include "base/util_functions.h"
+#include "base/log.h"
 
 #include <boost/foreach.hpp>
 #include <fstream>
 #include <memory>
 #include <errno.h>
+#include <zlib.h>
 
 #define WIN32 // required by ctemplate to compile on win
 
@@ -42,6 +46,14 @@ using namespace base;
 using ctemplate::Template;
 using ctemplate::TemplateDictionary;
 
+DEFAULT_LOG_DOMAIN("Recordset")
+
+// Output is collected in memory and written to the file in blocks of (at least) this size.
+#define EXPORT_BUFFER_SIZE (1024 * 1024)
+
+// Number of rows between progress reports in a direct export.
+#define DIRECT_EXPORT_PROGRESS_INTERVAL 10000
+
 typedef std::map<std::string, Recordset_text_storage::TemplateInfo> Templates;
 static Templates _templates; // data format name -> template
 
@@ -54,7 +66,7 @@ static const Recordset_text_storage::TemplateInfo &template_info(const std::stri
 
 
 
-static void process_templates(const std::list<std::string> &files)
+static void process_templates(const std::list<std::string> &files, bool builtin)
 {
   for (std::list<std::string>::const_iterator f = files.begin(); f != files.end(); ++f)
   {
@@ -71,6 +83,7 @@ static void process_templates(const std::list<std::string> &files)
       info.include_column_types = cf.get_value("include_column_types");
       info.null_syntax = cf.get_value("null_syntax");
       info.row_separator = cf.get_value("row_separator");
+      info.builtin = builtin;
       if (info.include_column_types != "xls")
         info.include_column_types = "";
       std::string args = cf.get_value("arguments");
@@ -92,11 +105,11 @@ static void scan_templates(GRTManager *grtm)
   {
     std::string template_dir = bec::make_path(grtm->get_basedir(), "modules/data/sqlide");
     std::list<std::string> files = base::scan_for_files_matching(template_dir+"/*.tpli");
-    process_templates(files);
+    process_templates(files, true);
     
     template_dir = bec::make_path(grtm->get_user_datadir(), "recordset_export_templates");
     files = base::scan_for_files_matching(template_dir+"/*.tpli");
-    process_templates(files);        
+    process_templates(files, false);
   }
 }
 
@@ -137,10 +150,163 @@ class CSVTokenQuote : public ctemplate::TemplateModifier {
 };
 CSVTokenQuote csv_quote;
 
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Same quoting as done by the x-csv_quote template modifier, for the native CSV writer.
+ * special_chars contains the chars that require quoting (incl. the separator).
+ */
+static void append_csv_token(std::string &out, const std::string &token, const std::string &special_chars)
+{
+  if (token.find_first_of(special_chars) == std::string::npos)
+  {
+    out.append(token);
+    return;
+  }
+
+  out.push_back('"');
+  for (std::string::const_iterator c = token.begin(); c != token.end(); ++c)
+  {
+    if (*c == '"')
+      out.append("\"\"");
+    else
+      out.push_back(*c);
+  }
+  out.push_back('"');
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Output file for the export. Text is appended to buffer() and written out in big blocks
+ * whenever flush_if_full() finds enough of it, instead of doing one write per row.
+ * If compression is requested the file is written in gzip format, which is always binary.
+ */
+class BufferedFileWriter
+{
+public:
+  BufferedFileWriter(const std::string &path, bool compress = false, bool binary = false)
+  : _path(path), _compress(compress)
+  {
+    _file = base_fopen(path.c_str(), (compress || binary) ? "wb" : "w+");
+    if (!_file)
+      throw std::runtime_error(strfmt("Could not create file `%s`: %s", path.c_str(), g_strerror(errno)));
+    _buffer.reserve(EXPORT_BUFFER_SIZE + EXPORT_BUFFER_SIZE / 4);
+
+    if (_compress)
+    {
+      memset(&_zstream, 0, sizeof(_zstream));
+      // Adding 16 to the window bits makes zlib write a gzip header and trailer instead of the zlib ones.
+      if (deflateInit2(&_zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+      {
+        fclose(_file);
+        throw std::runtime_error(strfmt("Could not initialize compression for `%s`", path.c_str()));
+      }
+      _compressed.resize(EXPORT_BUFFER_SIZE / 4);
+    }
+  }
+
+  ~BufferedFileWriter()
+  {
+    if (_file)
+    {
+      if (_compress)
+        deflateEnd(&_zstream);
+      fclose(_file);
+    }
+  }
+
+  std::string &buffer() { return _buffer; }
+
+  void flush_if_full()
+  {
+    if (_buffer.size() >= EXPORT_BUFFER_SIZE)
+      flush();
+  }
+
+  void flush()
+  {
+    if (_compress)
+      deflate_buffer(Z_NO_FLUSH);
+    else
+      write(_buffer.data(), _buffer.size());
+    _buffer.clear();
+  }
+
+  void close()
+  {
+    if (_compress)
+    {
+      deflate_buffer(Z_FINISH);
+      deflateEnd(&_zstream);
+      _compress = false;
+    }
+    else
+      write(_buffer.data(), _buffer.size());
+    _buffer.clear();
+
+    FILE *file = _file;
+    _file = NULL;
+    if (fclose(file) != 0)
+      throw std::runtime_error(strfmt("Failed to write to output file `%s`: %s", _path.c_str(), g_strerror(errno)));
+  }
+
+private:
+  std::string _path;
+  FILE *_file;
+  std::string _buffer;
+  bool _compress;
+  z_stream _zstream;
+  std::vector<char> _compressed;
+
+  void write(const char *data, size_t size)
+  {
+    if (size > 0 && fwrite(data, 1, size, _file) != size)
+      throw std::runtime_error(strfmt("Failed to write to output file `%s`: %s", _path.c_str(), g_strerror(errno)));
+  }
+
+  void deflate_buffer(int mode)
+  {
+    _zstream.next_in = (Bytef*)_buffer.data();
+    _zstream.avail_in = (uInt)_buffer.size();
+    int result;
+    do
+    {
+      _zstream.next_out = (Bytef*)&_compressed[0];
+      _zstream.avail_out = (uInt)_compressed.size();
+      result = deflate(&_zstream, mode);
+      if (result == Z_STREAM_ERROR)
+        throw std::runtime_error(strfmt("Failed to compress output file `%s`", _path.c_str()));
+      write(&_compressed[0], _compressed.size() - _zstream.avail_out);
+    }
+    while (_zstream.avail_out == 0 || (mode == Z_FINISH && result != Z_STREAM_END));
+  }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+static void log_export_statistics(const std::string &format, size_t row_count, double start_time)
+{
+  double duration = timestamp() - start_time;
+  log_info("Exported %lu rows as %s in %.2fs (%.0f rows/s)\n", (unsigned long)row_count, format.c_str(), duration,
+    duration > 0 ? row_count / duration : (double)row_count);
+}
+
 
 Recordset_text_storage::Recordset_text_storage(GRTManager *grtm)
 :
-Recordset_data_storage(grtm)
+Recordset_data_storage(grtm),
+_compress_output(false),
+_native_writers(true)
+{
+}
+
+
+/**
+ * Makes the custom modifiers known to ctemplate. Registering isn't thread safe, so this must be called
+ * from the main thread before any storage is used by a background thread.
+ */
+void Recordset_text_storage::register_template_modifiers()
 {
   static bool registered_csvquote = false;
   if (!registered_csvquote)
@@ -178,9 +344,348 @@ static std::string escape_json_string_(const std::string &s)
   return base::escape_json_string(s);
 }
 
+static void setup_quote_var(sqlide::QuoteVar &qv, const Recordset_text_storage::TemplateInfo &info)
+{
+  if (info.quote != "")
+    qv.quote = info.quote;
+  if (info.name == "JSON")
+    qv.escape_string= std::ptr_fun(escape_json_string_);
+  else
+    qv.escape_string= std::ptr_fun(escape_sql_string_);
+  // swap db (sqlite) stores unknown values as quoted strings
+  qv.store_unknown_as_string= true;
+  qv.allow_func_escaping= false;
+  qv.blob_to_string= (true) ? sqlide::QuoteVar::Blob_to_string() : std::ptr_fun(sqlide::QuoteVar::blob_to_hex_string);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+enum NativeFormat
+{
+  NoNativeFormat,
+  CSVNativeFormat,
+  JSONNativeFormat,
+  SQLInsertsNativeFormat
+};
+
+static NativeFormat native_format(const Recordset_text_storage::TemplateInfo &info, char &separator)
+{
+  // User templates may have replaced the built-in ones, those are always expanded with ctemplate.
+  if (!info.builtin)
+    return NoNativeFormat;
+
+  separator = ',';
+  if (info.name == "CSV")
+    return CSVNativeFormat;
+  if (info.name == "CSV_semicolon")
+  {
+    separator = ';';
+    return CSVNativeFormat;
+  }
+  if (info.name == "tab")
+  {
+    separator = '\t';
+    return CSVNativeFormat;
+  }
+  if (info.name == "JSON")
+    return JSONNativeFormat;
+  if (info.name == "SQL_inserts")
+    return SQLInsertsNativeFormat;
+  return NoNativeFormat;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Writes the simple built-in formats (CSV, tab separated, JSON and SQL INSERTs) without ctemplate.
+ * The output is the same as the one of the corresponding templates, but no dictionary is built per row:
+ * values are formatted right into the output buffer, which is written in big blocks, so memory use
+ * doesn't grow with the number of rows.
+ */
+class NativeTextWriter
+{
+public:
+  NativeTextWriter(const Recordset_text_storage::TemplateInfo &info, NativeFormat format, char separator,
+    BufferedFileWriter &file)
+  : _info(info), _format(format), _separator(separator), _file(file), _out(file.buffer()), _row_count(0)
+  {
+    setup_quote_var(_qv, info);
+    _special_chars = " \"\t\r\n";
+    _special_chars.push_back(separator);
+  }
+
+  void write_header(const Recordset::Column_names &column_names, const std::string &query, const std::string &date,
+    const std::string &table_name)
+  {
+    // Header and the parts of each row which only depend on the columns.
+    _field_starts.resize(column_names.size());
+    switch (_format)
+    {
+      case CSVNativeFormat:
+        for (size_t col= 0; col < column_names.size(); ++col)
+        {
+          if (col > 0)
+          {
+            _out.push_back(_separator);
+            _field_starts[col] = _separator;
+          }
+          append_csv_token(_out, column_names[col], _special_chars);
+        }
+        _out.push_back('\n');
+        break;
+
+      case JSONNativeFormat:
+        _out.append("[\n");
+        _row_start = "\t{";
+        for (size_t col= 0; col < column_names.size(); ++col)
+          _field_starts[col] = std::string(col > 0 ? "," : "") + "\n\t\t\"" + base::escape_json_string(column_names[col]) + "\" : ";
+        break;
+
+      case SQLInsertsNativeFormat:
+        _out.append("/*\n-- Query: ").append(query);
+        _out.append("\n-- Date: ").append(date).append("\n*/\n");
+        _row_start = "INSERT INTO `" + table_name + "` (";
+        for (size_t col= 0; col < column_names.size(); ++col)
+        {
+          if (col > 0)
+          {
+            _row_start.push_back(',');
+            _field_starts[col] = ",";
+          }
+          _row_start.append("`").append(column_names[col]).append("`");
+        }
+        _row_start.append(") VALUES (");
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  void begin_row()
+  {
+    // The JSON row separator goes only between rows, so it's written once the next row comes.
+    if (_format == JSONNativeFormat && _row_count > 0)
+      _out.append(_info.row_separator).push_back('\n');
+    _out.append(_row_start);
+  }
+
+  void write_value(ColumnId col, const sqlite::variant_t &value, const sqlite::variant_t &column_type, bool needs_quotes)
+  {
+    if (sqlide::is_var_null(value))
+      _value = _info.null_syntax;
+    else if (_info.pre_quote_strings && needs_quotes)
+      _value = boost::apply_visitor(_qv, column_type, value);
+    else
+      _value = boost::apply_visitor(_var_to_str, value);
+
+    _out.append(_field_starts[col]);
+    if (_format == CSVNativeFormat)
+      append_csv_token(_out, _value, _special_chars);
+    else
+      _out.append(_value);
+  }
+
+  void end_row()
+  {
+    switch (_format)
+    {
+      case CSVNativeFormat:
+        _out.push_back('\n');
+        break;
+      case JSONNativeFormat:
+        _out.append("\n\t}");
+        break;
+      case SQLInsertsNativeFormat:
+        _out.append(");\n");
+        break;
+      default:
+        break;
+    }
+    ++_row_count;
+    _file.flush_if_full();
+  }
+
+  void write_footer()
+  {
+    if (_format == JSONNativeFormat)
+    {
+      if (_row_count > 0)
+        _out.push_back('\n');
+      _out.append("]\n");
+    }
+  }
+
+  size_t row_count() const { return _row_count; }
+
+private:
+  const Recordset_text_storage::TemplateInfo &_info;
+  NativeFormat _format;
+  char _separator;
+  BufferedFileWriter &_file;
+  std::string &_out;
+  size_t _row_count;
+
+  std::string _special_chars; // Chars that make a CSV value need quotes.
+  std::string _row_start;
+  std::vector<std::string> _field_starts;
+  std::string _value;
+  sqlide::QuoteVar _qv;
+  sqlide::VarToStr _var_to_str;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Writes the recordset with the native writer if there's one for the format. Rows are read one by one
+ * from the swap db. Returns false if the format needs ctemplate.
+ */
+bool Recordset_text_storage::serialize_natively(const Recordset *recordset, sqlite::connection *data_swap_db,
+  const TemplateInfo &info)
+{
+  char separator;
+  NativeFormat format = native_format(info, separator);
+  if (format == NoNativeFormat || !_native_writers)
+    return false;
+
+  double start_time = timestamp();
+
+  const Recordset::Column_names *column_names= recordset->column_names();
+  const Recordset::Column_types &column_types= get_column_types(recordset);
+  const Recordset::Column_flags &column_flags= get_column_flags(recordset);
+  ColumnId visible_col_count= recordset->get_column_count();
+
+  BufferedFileWriter file(_file_path, _compress_output);
+  NativeTextWriter writer(info, format, separator, file);
+  writer.write_header(Recordset::Column_names(column_names->begin(), column_names->begin() + visible_col_count),
+    recordset->generator_query(), parameter_value("GENERATE_DATE"), parameter_value("TABLE_NAME"));
+
+  const size_t partition_count= recordset->data_swap_db_partition_count();
+  std::list<boost::shared_ptr<sqlite::query> > data_queries(partition_count);
+  Recordset::prepare_partition_queries(data_swap_db, "select * from `data%s`", data_queries);
+  std::vector<boost::shared_ptr<sqlite::result> > data_results(data_queries.size());
+  if (Recordset::emit_partition_queries(data_swap_db, data_queries, data_results))
+  {
+    bool next_row_exists= true;
+    do
+    {
+      writer.begin_row();
+      for (size_t partition= 0; partition < partition_count; ++partition)
+      {
+        boost::shared_ptr<sqlite::result> &data_rs= data_results[partition];
+        for (ColumnId col_begin= partition * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT, col= col_begin,
+             col_end= std::min<ColumnId>(visible_col_count, (partition + 1) * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT); col < col_end; ++col)
+          writer.write_value(col, data_rs->get_variant((int)(col - col_begin)), column_types[col],
+            (column_flags[col] & Recordset::NeedsQuoteFlag) != 0);
+      }
+      writer.end_row();
+
+      BOOST_FOREACH (boost::shared_ptr<sqlite::result> &data_rs, data_results)
+        next_row_exists= data_rs->next_row();
+    }
+    while (next_row_exists);
+  }
+
+  writer.write_footer();
+  file.close();
+
+  log_export_statistics(info.name, writer.row_count(), start_time);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool Recordset_text_storage::supports_direct_export(GRTManager *grtm, const std::string &format)
+{
+  scan_templates(grtm);
+
+  char separator;
+  Templates::const_iterator info = _templates.find(format);
+  return info != _templates.end() && native_format(info->second, separator) != NoNativeFormat;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Exports the rows of a result set directly as they come from the server, without a recordset
+ * and swap db in between. With an unbuffered result set (TYPE_FORWARD_ONLY) not even the client
+ * library holds more than the current row. Values are classified like Recordset_cdbc_storage does.
+ *
+ * BINARY and VARBINARY columns are exported like blobs unless treat_binary_as_text is set (the
+ * DbSqlEditor:MySQL:TreatBinaryAsText option, which the caller reads as app options are not thread safe).
+ *
+ * The progress slot is called every few thousand rows with the number of rows written so far,
+ * returning false from it cancels the export (which leaves an incomplete file behind).
+ *
+ * Returns the number of exported rows.
+ */
+size_t Recordset_text_storage::serialize_result_set(sql::ResultSet *rs, const std::string &query,
+  bool treat_binary_as_text, const boost::function<bool (size_t)> &progress_slot)
+{
+  const TemplateInfo &info(template_info(_data_format));
+  char separator;
+  NativeFormat format = native_format(info, separator);
+  if (format == NoNativeFormat)
+    throw std::runtime_error(strfmt("%s can't be used to export directly from the server", info.description.c_str()));
+
+  double start_time = timestamp();
+
+  sql::ResultSetMetaData *rs_meta = rs->getMetaData();
+  ColumnId column_count = rs_meta->getColumnCount();
+
+  Recordset::Column_names column_names;
+  Recordset::Column_types column_types;
+  std::vector<bool> needs_quotes;
+  for (ColumnId col= 0; col < column_count; ++col)
+  {
+    std::string type_name = base::toupper(rs_meta->getColumnTypeName((int)col + 1));
+    type_name = type_name.substr(0, type_name.find(' '));
+    bool is_blob = (type_name == "TINYBLOB" || type_name == "BLOB" || type_name == "MEDIUMBLOB" || type_name == "LONGBLOB"
+      || type_name == "GEOMETRY" || (!treat_binary_as_text && (type_name == "BINARY" || type_name == "VARBINARY")));
+
+    column_names.push_back(rs_meta->getColumnLabel((int)col + 1));
+    column_types.push_back(is_blob ? sqlite::variant_t(sqlite::blob_ref_t()) : sqlite::variant_t(std::string()));
+    needs_quotes.push_back(!rs_meta->isNumeric((int)col + 1) && (sql::DataType::DECIMAL != rs_meta->getColumnType((int)col + 1)));
+  }
+
+  BufferedFileWriter file(_file_path, _compress_output);
+  NativeTextWriter writer(info, format, separator, file);
+  writer.write_header(column_names, query, parameter_value("GENERATE_DATE"), parameter_value("TABLE_NAME"));
+
+  // Blob contents don't make it into the text formats (they are written as placeholders, like in
+  // an export from the grid), so they aren't fetched at all.
+  sqlite::variant_t blob_value = sqlite::blob_ref_t(new sqlite::blob_t());
+  while (rs->next())
+  {
+    writer.begin_row();
+    for (ColumnId col= 0; col < column_count; ++col)
+    {
+      if (rs->isNull((int)col + 1))
+        writer.write_value(col, sqlite::null_t(), column_types[col], needs_quotes[col]);
+      else if (sqlide::is_var_blob(column_types[col]))
+        writer.write_value(col, blob_value, column_types[col], needs_quotes[col]);
+      else
+        writer.write_value(col, std::string(rs->getString((int)col + 1)), column_types[col], needs_quotes[col]);
+    }
+    writer.end_row();
+
+    if (writer.row_count() % DIRECT_EXPORT_PROGRESS_INTERVAL == 0 && progress_slot && !progress_slot(writer.row_count()))
+      throw grt::user_cancelled("Export cancelled");
+  }
+
+  writer.write_footer();
+  file.close();
+
+  log_export_statistics(info.name, writer.row_count(), start_time);
+  return writer.row_count();
+}
+
 void Recordset_text_storage::do_serialize(const Recordset *recordset, sqlite::connection *data_swap_db)
 {
   const TemplateInfo &info(template_info(_data_format));
+  if (serialize_natively(recordset, data_swap_db, info))
+    return;
+
   std::string template_name(info.name);
   bool strings_are_pre_quoted(info.pre_quote_strings);
   std::string include_column_types(info.include_column_types);
@@ -240,18 +745,7 @@ void Recordset_text_storage::do_serialize(const Recordset *recordset, sqlite::co
   
   ColumnId visible_col_count= recordset->get_column_count();
   sqlide::QuoteVar qv;
-  {
-    if (info.quote != "")
-      qv.quote = info.quote;
-    if (_data_format == "JSON")
-      qv.escape_string= std::ptr_fun(escape_json_string_);
-    else
-      qv.escape_string= std::ptr_fun(escape_sql_string_);
-    // swap db (sqlite) stores unknown values as quoted strings
-    qv.store_unknown_as_string= true;
-    qv.allow_func_escaping= false;
-    qv.blob_to_string= (true) ? sqlide::QuoteVar::Blob_to_string() : std::ptr_fun(sqlide::QuoteVar::blob_to_hex_string);
-  }
+  setup_quote_var(qv, info);
 
   // global variables
   TemplateDictionary::SetGlobalValue("INDENT", "\t");
@@ -295,17 +789,12 @@ void Recordset_text_storage::do_serialize(const Recordset *recordset, sqlite::co
   // otherwise, the whole thing is dumped at once
   if (pre_tpl || post_tpl)
   {
-    FILE *outf = base_fopen(_file_path.c_str(), "w+");
-    if (!outf)
-      throw std::runtime_error(strfmt("Could not create file `%s`: %s", _file_path.c_str(), g_strerror(errno)));
+    double start_time = timestamp();
+    size_t row_count= 0;
+    BufferedFileWriter writer(_file_path, _compress_output);
 
     if (pre_tpl)
-    {
-      std::string result_text;
-      pre_tpl->Expand(&result_text, dict.get());
-
-      fprintf(outf, "%s", result_text.c_str());
-    }
+      pre_tpl->Expand(&writer.buffer(), dict.get());
     
     // data
     {
@@ -375,26 +864,20 @@ void Recordset_text_storage::do_serialize(const Recordset *recordset, sqlite::co
             row_dict->SetValue("ROW_SEPARATOR", "");
 
           // expand template & flush row
-          {
-            std::string result_text;
-            tpl->Expand(&result_text, &row_dict_base);
-            
-            fwrite(result_text.data(), 1, result_text.size(), outf);
-          }                  
+          tpl->Expand(&writer.buffer(), &row_dict_base);
+          ++row_count;
+          writer.flush_if_full();
         }
         while (next_row_exists);
       }
     }
 
     if (post_tpl)
-    {
-      std::string result_text;
-      post_tpl->Expand(&result_text, dict.get());
+      post_tpl->Expand(&writer.buffer(), dict.get());
 
-      fwrite(result_text.data(), 1, result_text.size(), outf);
-    }
+    writer.close();
 
-    fclose(outf);
+    log_export_statistics(info.name, row_count, start_time);
   }
   else // no pre/post separation
   {
@@ -442,17 +925,9 @@ void Recordset_text_storage::do_serialize(const Recordset *recordset, sqlite::co
     
     // expand tempalte & flush result
     {
-      std::string result_text;
-      tpl->Expand(&result_text, dict.get());
-      GError *error = 0;
-      
-      // use g_file_set because it can handle utf8 filenames
-      if (!g_file_set_contents(_file_path.c_str(), result_text.data(), (gssize)result_text.size(), &error))
-      {
-        std::string message = error->message;
-        g_free(error);
-        throw std::runtime_error(strfmt("Failed to write to output file `%s`: %s", _file_path.c_str(), message.c_str()));
-      }
+      BufferedFileWriter writer(_file_path, _compress_output, true);
+      tpl->Expand(&writer.buffer(), dict.get());
+      writer.close();
     }
   }
 }
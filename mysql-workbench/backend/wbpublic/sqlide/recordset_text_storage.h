@@ -25,6 +25,12 @@
 #include "wbpublic_public_interface.h"
 #include "recordset_data_storage.h"
 #include <map>
+#include <boost/function.hpp>
+
+namespace sql
+{
+  class ResultSet;
+}
 
 
 class WBPUBLICBACKEND_PUBLIC_FUNC Recordset_text_storage : public Recordset_data_storage
@@ -39,8 +45,11 @@ public:
     std::string row_separator;
     bool pre_quote_strings;
     std::string quote;
+    bool builtin; // Shipped with WB (not a user template), so the native writer can be used if there's one.
   };
   static std::vector<Recordset_storage_info> storage_types(bec::GRTManager *grtm);
+  static bool supports_direct_export(bec::GRTManager *grtm, const std::string &format);
+  static void register_template_modifiers();
 
 public:
   typedef boost::shared_ptr<Recordset_text_storage> Ref;
@@ -55,9 +64,15 @@ protected:
   virtual void do_unserialize(Recordset *recordset, sqlite::connection *data_swap_db);
   virtual void do_fetch_blob_value(Recordset *recordset, sqlite::connection *data_swap_db, RowId rowid, ColumnId column, sqlite::variant_t &blob_value);
 
+private:
+  bool serialize_natively(const Recordset *recordset, sqlite::connection *data_swap_db, const TemplateInfo &info);
+
 public:
   virtual ColumnId aux_column_count();
 
+  size_t serialize_result_set(sql::ResultSet *rs, const std::string &query, bool treat_binary_as_text,
+    const boost::function<bool (size_t)> &progress_slot);
+
 public:
   typedef std::map<std::string, std::string> Parameters;
 
@@ -73,9 +88,13 @@ public:
   void data_format(const std::string &val) { _data_format= val; }
   void file_path(const std::string &val) { _file_path= val; }
   const std::string & file_path() const { return _file_path; }
+  void compress_output(bool val) { _compress_output= val; } // gzip
+  void native_writers(bool val) { _native_writers= val; } // false expands all formats from their templates
 protected:
   std::string _data_format;
   std::string _file_path;
+  bool _compress_output;
+  bool _native_writers;
 };
 
 
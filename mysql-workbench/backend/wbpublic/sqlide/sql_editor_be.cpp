@@ -21,6 +21,10 @@
   #include <boost/foreach.hpp>
 #endif
 
+#include <algorithm>
+#include <limits>
+#include <boost/unordered_map.hpp>
+
 #include "base/boost_smart_ptr_helpers.h"
 #include "base/log.h"
 #include "base/string_utilities.h"
@@ -56,6 +60,22 @@ using namespace parser;
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * FNV-1a hash over a statement's text, used to find syntax check results of unchanged statements.
+ */
+static boost::uint64_t statement_hash(const char *text, size_t length)
+{
+  boost::uint64_t hash = 14695981039346656037ULL;
+  for (const unsigned char *run = (const unsigned char *)text, *end = run + length; run < end; ++run)
+  {
+    hash ^= *run;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 class MySQLEditor::Private
 {
 public:
@@ -96,6 +116,7 @@ public:
   std::set<size_t> _error_marker_lines;
 
   bool _splitting_required;
+  size_t _split_start; // Offset of the first change since the last splitter run.
   bool _updating_statement_markers;
   std::set<size_t> _statement_marker_lines;
   base::RecMutex _sql_statement_borders_mutex;
@@ -103,6 +124,11 @@ public:
   // Each entry is a pair of statement position (byte position) and statement length (also bytes).
   std::vector<std::pair<size_t, size_t> > _statement_ranges;
 
+  // Syntax errors (with positions relative to the statement) of the statements from the last check run,
+  // keyed by hash and length of the statement text. Unchanged statements are not checked again.
+  typedef boost::unordered_map<std::pair<boost::uint64_t, size_t>, std::vector<ParserErrorEntry> > StatementErrorCache;
+  StatementErrorCache _statement_errors;
+
   bool _is_refresh_enabled;   // whether FE control is permitted to replace its contents from BE
   bool _is_sql_check_enabled; // Enables automatic syntax checks.
   bool _stop_processing;      // To stop ongoing syntax checks (because of text changes etc.).
@@ -122,6 +148,7 @@ public:
     _sql_check_progress_msg_throttle = 500;
 
     _splitting_required = false;
+    _split_start = 0;
 
     _parser_context = syntaxcheck_context;
     _autocompletion_context = autocomplete_context;
@@ -142,7 +169,46 @@ public:
   //------------------------------------------------------------------------------------------------
 
   /**
-   * Determines ranges for all statements in the current text.
+   * Returns the offset from which the text has to be split again. Statements starting before the first
+   * change since the last run are kept, except for the one in which the change happened (or which
+   * precedes the change), as the change could extend it.
+   * Since DELIMITER commands are not part of the statement ranges the splitter state at a statement start
+   * is only known if none appeared before it, otherwise the entire text is split again.
+   */
+  size_t split_restart_index()
+  {
+    if (_split_start == 0 || _statement_ranges.empty())
+      return 0;
+
+    std::vector<std::pair<size_t, size_t> >::const_iterator first_changed = std::upper_bound(_statement_ranges.begin(),
+      _statement_ranges.end(), std::make_pair(_split_start, std::numeric_limits<size_t>::max()));
+    if (first_changed == _statement_ranges.begin())
+      return 0;
+    size_t index = (first_changed - _statement_ranges.begin()) - 1;
+
+    // Look for DELIMITER commands in the text between the kept statements.
+    static const char keyword[] = "delimiter";
+    size_t gap_start = 0;
+    for (size_t i = 0; i <= index; ++i)
+    {
+      size_t gap_end = _statement_ranges[i].first;
+      for (size_t position = gap_start; position + sizeof(keyword) - 1 <= gap_end; ++position)
+      {
+        if ((_text_info.first[position] | 0x20) == 'd'
+          && base::same_string(std::string(_text_info.first + position, sizeof(keyword) - 1), keyword, false))
+          return 0;
+      }
+      gap_start = _statement_ranges[i].first + _statement_ranges[i].second;
+    }
+
+    return index;
+  }
+
+  //------------------------------------------------------------------------------------------------
+
+  /**
+   * Determines ranges for all statements in the current text. Only the text after the first change since
+   * the previous run is split again.
    */
   void split_statements_if_required()
   {
@@ -151,24 +217,60 @@ public:
     if (_splitting_required)
     {
       log_debug3("Start splitting\n");
-      _splitting_required = false;
 
       base::RecMutexLock lock(_sql_statement_borders_mutex);
 
-      _statement_ranges.clear();
+      _splitting_required = false;
       if (_parse_unit == QtUnknown)
       {
         double start = timestamp();
-        _services->determineStatementRanges(_text_info.first, _text_info.second, ";", _statement_ranges);
-        log_debug3("Splitting ended after %f ticks\n", timestamp() - start);
+
+        size_t index = split_restart_index();
+        size_t offset = index > 0 ? _statement_ranges[index].first : 0;
+        _statement_ranges.resize(index);
+        _split_start = std::numeric_limits<size_t>::max();
+
+        std::vector<std::pair<size_t, size_t> > ranges;
+        _services->determineStatementRanges(_text_info.first + offset, _text_info.second - offset, ";", ranges);
+        _statement_ranges.reserve(index + ranges.size());
+        for (std::vector<std::pair<size_t, size_t> >::const_iterator iterator = ranges.begin();
+          iterator != ranges.end(); ++iterator)
+          _statement_ranges.push_back(std::make_pair(iterator->first + offset, iterator->second));
+
+        // An interrupted run leaves the ranges after the offset incomplete.
+        if (_stop_processing)
+        {
+          _splitting_required = true;
+          _split_start = offset;
+        }
+
+        log_debug3("Splitting from offset %lu ended after %f ticks\n", (unsigned long)offset, timestamp() - start);
       }
       else
+      {
+        _statement_ranges.clear();
         _statement_ranges.push_back(std::make_pair(0, _text_info.second));
+      }
     }
   }
 
   //------------------------------------------------------------------------------------------------
 
+  /**
+   * Forces a complete split and syntax check, e.g. if the text was replaced or the parser settings changed.
+   */
+  void reset_statement_cache()
+  {
+    base::RecMutexLock lock(_sql_statement_borders_mutex);
+    base::RecMutexLock checker_lock(_sql_checker_mutex);
+
+    _splitting_required = true;
+    _split_start = 0;
+    _statement_errors.clear();
+  }
+
+  //------------------------------------------------------------------------------------------------
+
   /**
   * One or more markers on that line where changed. We have to stay in sync with our statement markers list
   * to make the optimized add/remove algorithm working.
@@ -610,7 +712,7 @@ void MySQLEditor::append_text(const std::string &text)
 void MySQLEditor::sql(const char *sql)
 {
   _code_editor->set_text(sql);
-  d->_splitting_required = true;
+  d->reset_statement_cache();
   d->_statement_marker_lines.clear();
   _code_editor->set_eol_mode(mforms::EolLF, true);
 }
@@ -686,7 +788,12 @@ boost::signals2::signal<void ()>* MySQLEditor::text_change_signal()
 void MySQLEditor::set_sql_mode(const std::string &value)
 {
   _sql_mode = value;
-  d->_parser_context->use_sql_mode(value);
+  {
+    // The pooled syntax checkers of the context must not change while a batch check uses them.
+    base::RecMutexLock lock(d->_sql_checker_mutex);
+    d->_parser_context->use_sql_mode(value);
+  }
+  d->reset_statement_cache();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -696,7 +803,14 @@ void MySQLEditor::set_sql_mode(const std::string &value)
  */
 void MySQLEditor::set_server_version(GrtVersionRef version)
 {
-  d->_parser_context->use_server_version(version);
+  // Processing is restarted below anyway, so cancel any running check instead of waiting for it
+  // to finish before the context (and its pooled syntax checkers) can be changed.
+  stop_processing();
+  {
+    base::RecMutexLock lock(d->_sql_checker_mutex);
+    d->_parser_context->use_server_version(version);
+  }
+  d->reset_statement_cache();
   create_editor_config_for_version(version);
   start_sql_processing();
 }
@@ -724,6 +838,7 @@ void MySQLEditor::restrict_content_to(ContentType type)
     d->_parse_unit = QtUnknown;
     break;
   }
+  d->reset_statement_cache();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -747,7 +862,11 @@ void MySQLEditor::text_changed(int position, int length, int lines_changed, bool
     update_auto_completion(text);
   }
   
-  d->_splitting_required = true;
+  {
+    base::RecMutexLock lock(d->_sql_statement_borders_mutex);
+    d->_splitting_required = true;
+    d->_split_start = std::min(d->_split_start, (size_t)position);
+  }
   d->_text_info = _code_editor->get_text_ptr();
   if (d->_is_sql_check_enabled)
     d->_current_delay_timer = d->_grtm->run_every(boost::bind(&MySQLEditor::start_sql_processing, this), 0.001);
@@ -832,8 +951,6 @@ bool MySQLEditor::start_sql_processing()
 
 bool MySQLEditor::do_statement_split_and_check(int id)
 {
-  // TODO: there's no need always split and error-check all text in the editor.
-  //       Only split and scan from the current caret position.
   d->split_statements_if_required();
   
   // Start tasks that depend on the statement ranges (markers + auto completion).
@@ -845,21 +962,71 @@ bool MySQLEditor::do_statement_split_and_check(int id)
   base::RecMutexLock lock(d->_sql_checker_mutex);
 
   // Now do error checking for each of the statements, collecting error positions for later markup.
+  // Statements whose text didn't change since the last run reuse their previous result, all others
+  // are checked together in one batch (which the parser services can spread over several threads).
   d->_last_sql_check_progress_msg_timestamp = timestamp();
+  Private::StatementErrorCache results;
+  std::vector<Private::StatementErrorCache::key_type> keys;
+  std::vector<std::pair<size_t, size_t> > unchecked_ranges;
+  std::vector<Private::StatementErrorCache::key_type> unchecked_keys;
+  keys.reserve(d->_statement_ranges.size());
   for (std::vector<std::pair<size_t, size_t> >::const_iterator range_iterator = d->_statement_ranges.begin();
     range_iterator != d->_statement_ranges.end(); ++range_iterator)
   {
+    const char *statement = d->_text_info.first + range_iterator->first;
+    Private::StatementErrorCache::key_type key(statement_hash(statement, range_iterator->second), range_iterator->second);
+    keys.push_back(key);
+
+    if (results.find(key) != results.end())
+      continue;
+
+    Private::StatementErrorCache::iterator cached = d->_statement_errors.find(key);
+    if (cached != d->_statement_errors.end())
+      results.insert(*cached);
+    else
+    {
+      // Add an empty entry for now, so duplicate statements are checked only once.
+      results[key];
+      unchecked_ranges.push_back(*range_iterator);
+      unchecked_keys.push_back(key);
+    }
+  }
+
+  if (!unchecked_ranges.empty())
+  {
+    std::vector<ParserErrorEntry> errors;
+    d->_services->checkSqlSyntaxBatch(d->_parser_context, d->_text_info.first, unchecked_ranges, d->_parse_unit, errors);
+
     if (d->_stop_processing)
+    {
+      // We cannot tell which statements were checked before the stop, so keep only what was cached already.
       return false;
+    }
 
-    if (d->_services->checkSqlSyntax(d->_parser_context, d->_text_info.first + range_iterator->first,
-                                 range_iterator->second, d->_parse_unit) > 0)
+    // Errors are ordered by position, as are the ranges. Store them relative to their statement.
+    std::vector<std::pair<size_t, size_t> >::const_iterator range_iterator = unchecked_ranges.begin();
+    for (std::vector<ParserErrorEntry>::const_iterator error = errors.begin(); error != errors.end(); ++error)
     {
-      std::vector<ParserErrorEntry> errors = d->_parser_context->get_errors_with_offset(range_iterator->first, true);
-      d->_recognition_errors.insert(d->_recognition_errors.end(), errors.begin(), errors.end());
+      while (range_iterator + 1 != unchecked_ranges.end() && (range_iterator + 1)->first <= error->position)
+        ++range_iterator;
+
+      std::vector<ParserErrorEntry> &statement_errors = results[unchecked_keys[range_iterator - unchecked_ranges.begin()]];
+      statement_errors.push_back(*error);
+      statement_errors.back().position -= range_iterator->first;
     }
   }
 
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    const std::vector<ParserErrorEntry> &statement_errors = results[keys[i]];
+    for (std::vector<ParserErrorEntry>::const_iterator error = statement_errors.begin(); error != statement_errors.end(); ++error)
+    {
+      d->_recognition_errors.push_back(*error);
+      d->_recognition_errors.back().position += d->_statement_ranges[i].first;
+    }
+  }
+  d->_statement_errors.swap(results);
+
   d->_grtm->run_once_when_idle(this, boost::bind(&MySQLEditor::update_error_markers, this));
 
   return false;
@@ -1221,6 +1388,13 @@ bool MySQLEditor::make_keywords_uppercase()
 
 //--------------------------------------------------------------------------------------------------
 
+bool MySQLEditor::fuzzy_completion_enabled()
+{
+  return d->_grtm->get_app_option_int("DbSqlEditor:CodeCompletionFuzzyMatching") == 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 /**
  * Determines the start and end position of the current statement, that is, the statement
  * where the caret is in. For effective search in a large set binary search is used.
@@ -210,6 +210,7 @@ private:
   bool code_completion_enabled();
   bool auto_start_code_completion();
   bool make_keywords_uppercase();
+  bool fuzzy_completion_enabled();
 
   // These members are shared with sql_editor_autocomplete.cpp, so they cannot go into the private class.
 
@@ -38,6 +38,7 @@
 #include "mforms/code_editor.h"
 
 #include "autocomplete_object_name_cache.h"
+#include "fuzzy_matcher.h"
 #include "mysql-scanner.h"
 
 #include "grammar-parser/ANTLRv3Lexer.h"
@@ -1615,28 +1616,80 @@ void MySQLEditor::setup_auto_completion()
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Weight of an entry kind when ranking fuzzy matches. Objects the user most likely means get a bonus.
+ */
+static int completion_kind_weight(int image)
+{
+  switch (image)
+  {
+  case AC_COLUMN_IMAGE:
+    return 30;
+  case AC_TABLE_IMAGE:
+  case AC_VIEW_IMAGE:
+    return 25;
+  case AC_KEYWORD_IMAGE:
+    return 20;
+  case AC_SCHEMA_IMAGE:
+    return 15;
+  case AC_ROUTINE_IMAGE:
+  case AC_FUNCTION_IMAGE:
+    return 10;
+  default:
+    return 0;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
 /**
  * Updates the auto completion list by filtering the determined entries by the text the user
  * already typed. If auto completion is not yet active it becomes active here.
+ * With fuzzy matching enabled all entries containing the typed chars (in order) are kept and sorted
+ * by their rank (match quality, object kind and how recently the name was used in a query).
  * Returns the list sent to the editor for unit tests to validate them.
  */
 std::vector<std::pair<int, std::string> > MySQLEditor::update_auto_completion(const std::string &typed_part)
 {
   log_debug2("Updating auto completion popup in editor\n");
 
-  // Remove all entries that don't start with the typed text before showing the list.
+  // Remove all entries that don't match the typed text before showing the list.
   if (!typed_part.empty())
   {
     gchar *prefix = g_utf8_casefold(typed_part.c_str(), -1);
     
     std::vector<std::pair<int, std::string> > filtered_entries;
-    for (std::vector<std::pair<int, std::string> >::const_iterator iterator = _auto_completion_entries.begin();
-      iterator != _auto_completion_entries.end(); ++iterator)
+    if (fuzzy_completion_enabled())
+    {
+      FuzzyMatcher matcher(typed_part);
+      std::vector<std::pair<int, size_t> > ranking; // Negated rank + index, so sorting keeps the group order for equal ranks.
+      for (size_t i = 0; i < _auto_completion_entries.size(); ++i)
+      {
+        int score = matcher.score(_auto_completion_entries[i].second);
+        if (score == FuzzyMatcher::NO_MATCH)
+          continue;
+
+        score += completion_kind_weight(_auto_completion_entries[i].first);
+        if (_auto_completion_cache != NULL)
+          score += _auto_completion_cache->recency_score(_auto_completion_entries[i].second) / 2;
+        ranking.push_back(std::make_pair(-score, i));
+      }
+      std::sort(ranking.begin(), ranking.end());
+
+      filtered_entries.reserve(ranking.size());
+      for (std::vector<std::pair<int, size_t> >::const_iterator iterator = ranking.begin(); iterator != ranking.end(); ++iterator)
+        filtered_entries.push_back(_auto_completion_entries[iterator->second]);
+    }
+    else
     {
-      gchar *entry = g_utf8_casefold(iterator->second.c_str(), -1);
-      if (g_str_has_prefix(entry, prefix))
-        filtered_entries.push_back(*iterator);
-      g_free(entry);
+      for (std::vector<std::pair<int, std::string> >::const_iterator iterator = _auto_completion_entries.begin();
+        iterator != _auto_completion_entries.end(); ++iterator)
+      {
+        gchar *entry = g_utf8_casefold(iterator->second.c_str(), -1);
+        if (g_str_has_prefix(entry, prefix))
+          filtered_entries.push_back(*iterator);
+        g_free(entry);
+      }
     }
     
     switch (filtered_entries.size())
@@ -1959,6 +2012,13 @@ void MySQLEditor::show_auto_completion(bool auto_choose_single, ParserContext::R
 
   _code_editor->auto_completion_options(true, auto_choose_single, false, true, false);
 
+  // Fuzzy matches are listed by rank, not alphabetically. Custom order still lets the editor select
+  // the (best ranked) entry starting with the typed text.
+  bool fuzzy_matching = fuzzy_completion_enabled();
+  _code_editor->send_editor(SCI_AUTOCSETORDER, fuzzy_matching ? SC_ORDER_CUSTOM : SC_ORDER_PRESORTED, 0);
+  if (_auto_completion_cache != NULL)
+    _auto_completion_cache->set_fuzzy_matching(fuzzy_matching);
+
   AutoCompletionContext context;
   context.token_names = parser_context->get_token_name_list();
 
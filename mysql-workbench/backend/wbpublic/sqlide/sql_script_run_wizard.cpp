@@ -17,12 +17,16 @@
  * 02110-1301  USA
  */
 
+#include "base/file_functions.h"
+#include "base/string_utilities.h"
+
 #include "grtdb/db_helpers.h"
 #include "sql_script_run_wizard.h"
 
 #include "mforms/code_editor.h"
 #include "mforms/selector.h"
 #include "mforms/button.h"
+#include "mforms/table.h"
 
 //--------------------------------------------------------------------------------------------------
 
@@ -130,21 +134,109 @@ SqlScriptReviewPage::SqlScriptReviewPage(grtui::WizardForm *form, GrtVersionRef
     }
   }
   _box.add(_sql_editor, true, true);
+
+  _schema_selector = 0;
+  _charset_selector = 0;
 }
 
 //--------------------------------------------------------------------------------------------------
 
 SqlScriptReviewPage::~SqlScriptReviewPage()
 {
-  // No need to release _algorithm_selector and _lock_selector. They are managed with release_on_add.
+  // No need to release the selectors. They are managed with release_on_add.
   _sql_editor->release();
 };
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Adds the options for running a script file: a default schema (created if it doesn't exist yet)
+ * and a default character set, both used unless the script specifies them itself.
+ */
+void SqlScriptReviewPage::add_script_file_options(const std::vector<std::string> &schemas,
+  const std::vector<std::string> &charsets)
+{
+  if (_schema_selector != NULL)
+    return;
+
+  mforms::Panel *frame = mforms::manage(new mforms::Panel(mforms::TitledBoxPanel));
+  frame->set_title(_("Script Options"));
+  _box.add(frame, false, true);
+
+  mforms::Table *table = mforms::manage(new mforms::Table());
+  table->set_padding(20, 0, 20, 0);
+  table->set_row_count(2);
+  table->set_column_count(3);
+  table->set_row_spacing(8);
+  table->set_column_spacing(4);
+  frame->add(table);
+
+  table->add(mforms::manage(new mforms::Label(_("Default Schema Name:"))), 0, 1, 0, 1, 0);
+  _schema_selector = mforms::manage(new mforms::Selector(mforms::SelectorCombobox));
+  _schema_selector->add_item("");
+  for (std::vector<std::string>::const_iterator iterator = schemas.begin(); iterator != schemas.end(); ++iterator)
+    _schema_selector->add_item(*iterator);
+  table->add(_schema_selector, 1, 2, 0, 1, mforms::HFillFlag | mforms::HExpandFlag);
+
+  mforms::Label *help = mforms::manage(new mforms::Label(_(
+    "Schema to be used unless explicitly specified in the script.\n"
+    "Leave blank if the script already specified it,\n"
+    "pick a schema from the drop down or type a name to\n"
+    "create a new one.")));
+  help->set_style(mforms::SmallHelpTextStyle);
+  table->add(help, 2, 3, 0, 1, mforms::HFillFlag);
+
+  table->add(mforms::manage(new mforms::Label(_("Default Character Set:"))), 0, 1, 1, 2, 0);
+  _charset_selector = mforms::manage(new mforms::Selector());
+  _charset_selector->add_item("");
+  for (std::vector<std::string>::const_iterator iterator = charsets.begin(); iterator != charsets.end(); ++iterator)
+    _charset_selector->add_item(*iterator);
+  table->add(_charset_selector, 1, 2, 1, 2, mforms::HFillFlag | mforms::HExpandFlag);
+
+  help = mforms::manage(new mforms::Label(_(
+    "Default character set to use when executing the script,\n"
+    "unless specified in the script.")));
+  help->set_style(mforms::SmallHelpTextStyle);
+  table->add(help, 2, 3, 1, 2, mforms::HFillFlag);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+// Script files can be far too large for the editor, so only their start is shown.
+#define SCRIPT_FILE_PREVIEW_SIZE (256 * 1024)
+
+static std::string read_file_preview(const std::string &path)
+{
+  std::string preview;
+  FILE *file = base_fopen(path.c_str(), "rb");
+  if (file != NULL)
+  {
+    preview.resize(SCRIPT_FILE_PREVIEW_SIZE);
+    preview.resize(fread(&preview[0], 1, preview.size(), file));
+    fclose(file);
+  }
+  return preview;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void SqlScriptReviewPage::enter(bool advancing)
 {
-  _sql_editor->set_value(values().get_string("sql_script"));
+  std::string script_file = values().get_string("sql_script_file");
+  if (script_file.empty())
+    _sql_editor->set_value(values().get_string("sql_script"));
+  else
+  {
+    _page_heading.set_text(base::strfmt(_(
+      "The SQL script %s (%.2f MB) will be executed directly from the file, statement by statement.\n"
+      "Only the beginning of the script is shown below. It cannot be changed here.\n"
+      "Note that once applied, these statements may not be revertible without losing some of the data."),
+      script_file.c_str(), base_get_file_size(script_file.c_str()) / 1024.0 / 1024.0));
+
+    _sql_editor->set_features(mforms::FeatureReadOnly, false);
+    _sql_editor->set_value(read_file_preview(script_file));
+    _sql_editor->set_features(mforms::FeatureReadOnly, true);
+  }
   grtui::WizardPage::enter(advancing);
 }
 
@@ -152,6 +244,13 @@ void SqlScriptReviewPage::enter(bool advancing)
 
 bool SqlScriptReviewPage::advance()
 {
+  if (!values().get_string("sql_script_file").empty())
+  {
+    values().gset("default_schema", _schema_selector != NULL ? base::trim(_schema_selector->get_string_value()) : "");
+    values().gset("default_charset", _charset_selector != NULL ? _charset_selector->get_string_value() : "");
+    return grtui::WizardPage::advance();
+  }
+
   std::string sql = base::trim(_sql_editor->get_text(false));
 
   if (sql.empty())
@@ -253,6 +352,22 @@ grt::ValueRef SqlScriptApplyPage::do_execute_sql_script(const std::string &sql_s
 
   apply_sql_script(sql_script);
 
+  return check_execution_result();
+}
+
+
+grt::ValueRef SqlScriptApplyPage::do_execute_sql_script_file(const std::string &path)
+{
+  _form->grtm()->run_once_when_idle(this, boost::bind(&SqlScriptApplyPage::add_log_text, this, "Executing script file:\n"+path+"\n"));
+
+  apply_sql_script_file(path, values().get_string("default_schema"), values().get_string("default_charset"));
+
+  return check_execution_result();
+}
+
+
+grt::ValueRef SqlScriptApplyPage::check_execution_result()
+{
   if (_err_count)
   {
     values().gset("has_errors", 1);
@@ -273,6 +388,13 @@ bool SqlScriptApplyPage::execute_sql_script()
 {
   values().gset("applied", 1);
   values().gset("has_errors", 0);
+  std::string script_file= values().get_string("sql_script_file");
+  if (!script_file.empty())
+  {
+    execute_grt_task(boost::bind(&SqlScriptApplyPage::do_execute_sql_script_file, this, script_file), false);
+    return true;
+  }
+
   std::string sql_script= values().get_string("sql_script");
 
   //apply_sql_script(sql_script);
@@ -352,3 +474,16 @@ bool SqlScriptRunWizard::applied()
 {
   return values().get_int("applied") != 0;
 }
+
+
+/**
+ * Makes the wizard execute the given script file instead of the "sql_script" value. The file is not
+ * loaded as a whole, see SqlScriptApplyPage::apply_sql_script_file. The schemas and character sets
+ * are offered as defaults for running the script.
+ */
+void SqlScriptRunWizard::set_script_file(const std::string &path, const std::vector<std::string> &schemas,
+  const std::vector<std::string> &charsets)
+{
+  values().gset("sql_script_file", path);
+  review_page->add_script_file_options(schemas, charsets);
+}
@@ -50,6 +50,11 @@ private:
   mforms::CodeEditor *_sql_editor;
   mforms::Selector *_algorithm_selector;
   mforms::Selector *_lock_selector;
+  mforms::Selector *_schema_selector;
+  mforms::Selector *_charset_selector;
+
+public:
+  void add_script_file_options(const std::vector<std::string> &schemas, const std::vector<std::string> &charsets);
 };
 
 
@@ -63,12 +68,16 @@ private:
   void abort_exec();
 
   grt::ValueRef do_execute_sql_script(const std::string &sql_script);
+  grt::ValueRef do_execute_sql_script_file(const std::string &path);
+  grt::ValueRef check_execution_result();
 public:
   SqlScriptApplyPage(grtui::WizardForm *form);
   int on_error(long long err_code, const std::string& err_msg, const std::string& err_sql);
   int on_exec_progress(float progress);
   int on_exec_stat(long success_count, long err_count);
   boost::function<void (const std::string &)> apply_sql_script;
+  // Used if the script is given as a file. Parameters: file path, default schema and default character set.
+  boost::function<void (const std::string &, const std::string &, const std::string &)> apply_sql_script_file;
   bool execute_sql_script();
   virtual std::string next_button_caption();
   virtual bool allow_back();
@@ -89,6 +98,9 @@ public:
   bool has_errors();
   bool applied();
 
+  void set_script_file(const std::string &path, const std::vector<std::string> &schemas,
+    const std::vector<std::string> &charsets);
+
   boost::function<void ()> abort_apply;
 
   // Used by the wizard if an option changed.
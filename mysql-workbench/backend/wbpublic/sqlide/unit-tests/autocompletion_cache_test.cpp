@@ -316,4 +316,118 @@ TEST_FUNCTION(28)
   ensure_list_equals("columns sakila.actor.a*", list, sakila_a);
 }
 
+// A bulk refresh of all schemas must give the same results as the per object refreshes.
+TEST_FUNCTION(29)
+{
+  static const char *sakila_a[] = {
+    "actor_id",
+    NULL
+  };
+  static const char *sakila_inv[] = {
+    "inventory_held_by_customer",
+    "inventory_in_stock",
+    NULL
+  };
+  static const char *sakila_c[] = {
+    "customer_create_date",
+    NULL
+  };
+
+  _cache->refresh_schema_objects();
+  g_usleep(2000000);
+
+  std::vector<std::string> list = _cache->get_matching_column_names("sakila", "actor", "a");
+  ensure_list_equals("columns sakila.actor.a*", list, sakila_a);
+
+  list = _cache->get_matching_function_names("sakila", "inv");
+  ensure_list_equals("functions sakila.inv*", list, sakila_inv);
+
+  list = _cache->get_matching_trigger_names("sakila", "customer", "c");
+  ensure_list_equals("triggers sakila.c*", list, sakila_c);
+
+  ensure("schema marked as cached", !_cache->refresh_schema_cache_if_needed("sakila"));
+}
+
+// Lookups ignore letter case in the prefix and the qualifier. Updates only replace the names of the exact schema.
+TEST_FUNCTION(30)
+{
+  static const char *cache_test_ev[] = {
+    "Cache_Event1",
+    "cache_event2",
+    "cache_event3",
+    NULL
+  };
+  static const char *cache_test_updated_ev[] = {
+    "cache_event4", // Names are sorted per schema, schemas by name.
+    "cache_event3",
+    NULL
+  };
+
+  base::StringListPtr events(new std::list<std::string>());
+  events->push_back("other_event");
+  events->push_back("cache_event2");
+  events->push_back("Cache_Event1");
+  _cache->update_events("Cache_Test", events);
+
+  events.reset(new std::list<std::string>());
+  events->push_back("cache_event3");
+  _cache->update_events("cache_test", events);
+
+  std::vector<std::string> list = _cache->get_matching_events("Cache_Test", "CACHE_EV");
+  ensure_list_equals("events Cache_Test.CACHE_EV*", list, cache_test_ev);
+
+  list = _cache->get_matching_events("CACHE_TEST", "cache_ev");
+  ensure_list_equals("events CACHE_TEST.cache_ev*", list, cache_test_ev);
+
+  list = _cache->get_matching_events("", "cache_ev");
+  ensure_list_equals("events *.cache_ev*", list, cache_test_ev);
+
+  events.reset(new std::list<std::string>());
+  events->push_back("cache_event4");
+  _cache->update_events("Cache_Test", events);
+
+  list = _cache->get_matching_events("cache_test", "cache_ev");
+  ensure_list_equals("events cache_test.cache_ev* after update", list, cache_test_updated_ev);
+
+  // Empty names mark a running fetch in the cache db, they must not get into the index on updates either.
+  events.reset(new std::list<std::string>());
+  events->push_back("");
+  events->push_back("cache_event4");
+  _cache->update_events("Cache_Test", events);
+
+  list = _cache->get_matching_events("Cache_Test", "");
+  ensure("empty name in events Cache_Test.*", std::find(list.begin(), list.end(), "") == list.end());
+}
+
+TEST_FUNCTION(31)
+{
+  static const char *fuzzy_test_ev[] = {
+    "fsq", // Exact match first, then by match quality.
+    "fact_sales_q1",
+    "fuzzy_sequence",
+    NULL
+  };
+
+  base::StringListPtr events(new std::list<std::string>());
+  events->push_back("fuzzy_sequence");
+  events->push_back("fact_sales_q1");
+  events->push_back("other_event");
+  events->push_back("fsq");
+  _cache->update_events("fuzzy_test", events);
+
+  _cache->set_fuzzy_matching(true);
+  std::vector<std::string> list = _cache->get_matching_events("fuzzy_test", "FSQ");
+  _cache->set_fuzzy_matching(false);
+  ensure_list_equals("fuzzy events fuzzy_test.FSQ", list, fuzzy_test_ev);
+
+  list = _cache->get_matching_events("fuzzy_test", "FSQ");
+  ensure_equals("prefix lookup after switching fuzzy matching off", list.size(), 1U);
+
+  _cache->add_recent_names("SELECT 'fuzzy_sequence' FROM `fact_sales_q1` -- other_event");
+  ensure_equals("recency of the last used name", _cache->recency_score("FACT_SALES_Q1"), 100);
+  ensure_equals("recency of a name in a string", _cache->recency_score("fuzzy_sequence"), 0);
+  ensure_equals("recency of a name in a comment", _cache->recency_score("other_event"), 0);
+  ensure("recency of a name used before", _cache->recency_score("select") > 0);
+}
+
 END_TESTS
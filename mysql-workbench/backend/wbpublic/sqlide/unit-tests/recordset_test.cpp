@@ -22,10 +22,14 @@
 #endif
 
 #include "sqlide/recordset_cdbc_storage.h"
+#include "sqlide/recordset_text_storage.h"
 #include "sqlide/recordset_be.h"
+#include "sqlide/recordset_column_store.h"
+#include "sqlide/recordset_row_index.h"
 #include "connection_helpers.h"
 #include "cppdbc.h"
 #include "wb_helpers.h"
+#include "base/file_utilities.h"
 
 BEGIN_TEST_DATA_CLASS(recordset)
 public:
@@ -76,4 +80,186 @@ TEST_FUNCTION(2)
 }
 
 
+TEST_FUNCTION(3)
+{
+  // in-memory column store keeps values and nulls as they were fetched
+  std::vector<sqlite::variant_t> column_types;
+  column_types.push_back(int());
+  column_types.push_back(std::string());
+  column_types.push_back(sqlite::blob_ref_t());
+  column_types.push_back(sqlite::null_t());
+
+  Recordset_column_store store(column_types);
+  for (int n= 0; n < 100; ++n)
+  {
+    std::vector<sqlite::variant_t> row;
+    row.push_back(n);
+    row.push_back((n % 3) ? sqlite::variant_t(base::strfmt("row %i", n)) : sqlite::variant_t(sqlite::null_t()));
+    row.push_back(sqlite::blob_ref_t(new sqlite::blob_t(n % 4, 'x')));
+    row.push_back((n == 50) ? sqlite::variant_t(std::string("odd one")) : sqlite::variant_t(sqlite::null_t()));
+    store.add_row(row);
+  }
+
+  ensure_equals("row count", store.row_count(), 100U);
+  ensure_equals("int value", boost::get<int>(store.get(42, 0)), 42);
+  ensure("null text", store.is_null(3, 1));
+  ensure_equals("text value", boost::get<std::string>(store.get(4, 1)), "row 4");
+  ensure_equals("blob size", boost::get<sqlite::blob_ref_t>(store.get(7, 2))->size(), 3U);
+  ensure("empty blob is not null", !store.is_null(4, 2));
+  ensure("null column", store.is_null(49, 3));
+  ensure_equals("value in null column", boost::get<std::string>(store.get(50, 3)), "odd one");
+  ensure_equals("mixed column storage", store.storage_kind(3), Recordset_column_store::VariantStorage);
+}
+
+
+
+TEST_FUNCTION(4)
+{
+  // in-memory sorting and filtering of the column store gives the same order as a stable sort
+  std::vector<sqlite::variant_t> column_types;
+  column_types.push_back(int());
+  column_types.push_back(std::string());
+  column_types.push_back((long double)0);
+
+  Recordset_column_store::Ref store(new Recordset_column_store(column_types));
+  const int row_count= 120000; // enough for several threads
+  for (int n= 0; n < row_count; ++n)
+  {
+    std::vector<sqlite::variant_t> row;
+    row.push_back(n % 7);
+    row.push_back((n % 11) ? sqlite::variant_t(base::strfmt((n % 2) ? "Name %i" : "name %i", n % 13)) : sqlite::variant_t(sqlite::null_t()));
+    row.push_back((long double)(n % 5) / 2);
+    store->add_row(row);
+  }
+
+  ensure("like", Recordset_row_index::like_match("%me 1_", 6, "NAME 12", 7));
+  ensure("like with utf-8 char", Recordset_row_index::like_match("a_c", 3, "a\xc3\xa4" "c", 4));
+  ensure("not like", !Recordset_row_index::like_match("%me 1_", 6, "name 1", 6));
+
+  Recordset_row_index index;
+  std::vector<Recordset_row_index::Sort_column> sort_columns;
+  Recordset_row_index::Sort_column sort_column;
+  sort_column.column= 1;
+  sort_column.direction= 1;
+  sort_column.kind= Recordset_row_index::NocaseTextCompare;
+  sort_columns.push_back(sort_column);
+  sort_column.column= 2;
+  sort_column.direction= -1;
+  sort_column.kind= Recordset_row_index::NumericCompare;
+  sort_columns.push_back(sort_column);
+  index.set_sort_columns(sort_columns);
+
+  // expected order: nulls first, then case insensitive by name, then descending by value, then fetch order
+  std::vector<std::pair<std::string, std::pair<long double, int> > > expected, expected_filtered;
+  for (int n= 0; n < row_count; ++n)
+  {
+    std::string name= (n % 11) ? "1" + base::tolower(base::strfmt("name %i", n % 13)) : "0";
+    expected.push_back(std::make_pair(name, std::make_pair(-(long double)(n % 5) / 2, n)));
+    if (n % 7 == 3)
+      expected_filtered.push_back(expected.back());
+  }
+  std::sort(expected.begin(), expected.end());
+  std::sort(expected_filtered.begin(), expected_filtered.end());
+
+  Recordset_row_index::Rows rows;
+  index.build(store, rows);
+  ensure_equals("row count", rows.size(), expected.size());
+  for (size_t n= 0; n < rows.size(); ++n)
+    ensure_equals("sorted row", (int)rows[n], expected[n].second.second);
+
+  std::map<size_t, std::string> filters;
+  filters[0]= "3";
+  index.set_column_filters(filters);
+  index.build(store, rows);
+  ensure_equals("filtered row count", rows.size(), expected_filtered.size());
+  for (size_t n= 0; n < rows.size(); ++n)
+    ensure_equals("sorted filtered row", (int)rows[n], expected_filtered[n].second.second);
+
+  // a search string narrows the filtered rows further, the sort order stays
+  index.set_search_string("me 12");
+  index.build(store, rows);
+  ensure("search result", !rows.empty());
+  for (size_t n= 0; n < rows.size(); ++n)
+    ensure_equals("search match", boost::get<std::string>(store->get(rows[n], 1)).substr(1), "ame 12");
+}
+
+
+TEST_FUNCTION(5)
+{
+  // native writers of the built-in export formats give the same output as their templates
+  Recordset_cdbc_storage::Ref data_storage(Recordset_cdbc_storage::create(wbt.wb->get_grt_manager()));
+  data_storage->dbms_conn(dbc_conn);
+
+  Recordset::Ref rs = Recordset::create(wbt.wb->get_grt_manager());
+  rs->data_storage(data_storage);
+
+  boost::shared_ptr<sql::Statement> dbc_statement(dbc_conn->ref->createStatement());
+  dbc_statement->execute("select 1 as id, 'say \"hi\", it''s ok' as text, NULL as nothing, 2.5 as num, "
+    "x'00ff41' as bin, 'a;b\\tc\\nd' as special "
+    "union all select 2, '', 'x', -1, convert(NULL, binary), ' lead'");
+
+  boost::shared_ptr<sql::ResultSet> rset(dbc_statement->getResultSet());
+  data_storage->dbc_resultset(rset);
+  rs->reset(true);
+  ensure_equals("row count", rs->row_count(), 2U);
+
+  Recordset_text_storage::storage_types(wbt.wb->get_grt_manager());
+  Recordset_text_storage::register_template_modifiers();
+  const char *formats[] = { "CSV", "CSV_semicolon", "tab", "JSON", "SQL_inserts" };
+  for (size_t i= 0; i < sizeof(formats) / sizeof(formats[0]); ++i)
+  {
+    std::string output[2];
+    for (int native= 0; native < 2; ++native)
+    {
+      std::string path= base::strfmt("recordset_export_%s_%i.txt", formats[i], native);
+      Recordset_text_storage::Ref storage(Recordset_text_storage::create(wbt.wb->get_grt_manager()));
+      storage->data_format(formats[i]);
+      storage->file_path(path);
+      storage->native_writers(native != 0);
+      storage->parameter_value("GENERATE_DATE", "2016-01-01 00:00");
+      storage->parameter_value("TABLE_NAME", "test");
+      storage->serialize(rs);
+
+      gchar *contents= NULL;
+      gsize length= 0;
+      ensure(base::strfmt("%s export written", formats[i]), g_file_get_contents(path.c_str(), &contents, &length, NULL) != 0);
+      output[native]= std::string(contents, length);
+      g_free(contents);
+      base::remove(path);
+    }
+    ensure("native output is not empty", !output[1].empty());
+    ensure_equals(base::strfmt("%s output", formats[i]), output[1], output[0]);
+  }
+}
+
+
+TEST_FUNCTION(6)
+{
+  // direct export from the server, binary columns are written as blobs unless told otherwise
+  Recordset_text_storage::storage_types(wbt.wb->get_grt_manager());
+
+  for (int as_text= 0; as_text < 2; ++as_text)
+  {
+    std::string path= base::strfmt("recordset_direct_export_%i.csv", as_text);
+    Recordset_text_storage::Ref storage(Recordset_text_storage::create(wbt.wb->get_grt_manager()));
+    storage->data_format("CSV");
+    storage->file_path(path);
+
+    boost::shared_ptr<sql::Statement> dbc_statement(dbc_conn->ref->createStatement());
+    boost::shared_ptr<sql::ResultSet> rset(dbc_statement->executeQuery("select 1 as id, convert('abc', binary) as bin, "
+      "NULL as nothing, 'a,b' as text"));
+    ensure_equals("exported rows", storage->serialize_result_set(rset.get(), "", as_text != 0, boost::function<bool (size_t)>()), 1U);
+
+    gchar *contents= NULL;
+    gsize length= 0;
+    ensure("export written", g_file_get_contents(path.c_str(), &contents, &length, NULL) != 0);
+    std::string output(contents, length);
+    g_free(contents);
+    base::remove(path);
+
+    ensure_equals("direct export", output, as_text ? "id,bin,nothing,text\n1,abc,NULL,\"a,b\"\n" : "id,bin,nothing,text\n1,...,NULL,\"a,b\"\n");
+  }
+}
+
+
 END_TESTS
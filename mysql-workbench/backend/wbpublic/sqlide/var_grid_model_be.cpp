@@ -20,10 +20,13 @@
 #include "sqlide_generics_private.h"
 
 #include "var_grid_model_be.h"
+#include "recordset_column_store.h"
+#include "recordset_data_storage.h"
 #include "base/string_utilities.h"
 #include <sqlite/execute.hpp>
 #include <sqlite/query.hpp>
 #include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
 #include "glib/gstdio.h"
 
 
@@ -69,6 +72,7 @@ VarGridModel::VarGridModel(GRTManager *grtm)
 :
 _grtm(grtm),
 _readonly(true),
+_is_fetching(0),
 _is_field_value_truncation_enabled(false),
 _edited_field_row(-1),
 _edited_field_col(-1)
@@ -77,6 +81,8 @@ _edited_field_col(-1)
   {
     grt::DictRef options= DictRef::cast_from(_grtm->get_grt()->get("/wb/options/options"));
     _optimized_blob_fetching= (options.get_int("Recordset:OptimizeBlobFetching", 0) != 0);
+    ssize_t column_store_memory_limit= options.get_int("Recordset:ColumnStoreMemoryLimit", 256); // in MB
+    _column_store_memory_limit= (column_store_memory_limit > 0) ? (size_t)column_store_memory_limit * 1024 * 1024 : 0;
   }
 }
 
@@ -97,6 +103,8 @@ VarGridModel::~VarGridModel()
 void VarGridModel::reset()
 {
   base::RecMutexLock data_mutex UNUSED (_data_mutex);
+  _column_store.reset();
+  _column_store_rows.reset();
   _data_swap_db.reset();
   if (_data_swap_db_path.empty())
   {
@@ -138,10 +146,64 @@ int VarGridModel::floating_point_visible_scale()
 
 boost::shared_ptr<sqlite::connection> VarGridModel::data_swap_db() const
 {
+  boost::shared_ptr<sqlite::connection> data_swap_db;
   if (_grtm->in_main_thread())
-    return (_data_swap_db) ? _data_swap_db : _data_swap_db= create_data_swap_db_connection();
+    data_swap_db= (_data_swap_db) ? _data_swap_db : _data_swap_db= create_data_swap_db_connection();
   else
-    return create_data_swap_db_connection();
+    data_swap_db= create_data_swap_db_connection();
+
+  // whoever asks for the data swap db is going to work with the data stored there,
+  // data still being streamed in can't be moved though
+  if (_column_store && !is_fetching() && data_swap_db)
+    const_cast<VarGridModel*>(this)->spill_column_store(data_swap_db.get());
+
+  return data_swap_db;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Moves the rows held by the column store into the data swap db tables (which must already exist)
+ * and builds the data index for them, keeping the current in-memory sort order and filtering.
+ */
+void VarGridModel::spill_column_store(sqlite::connection *data_swap_db, bool use_transaction)
+{
+  base::RecMutexLock data_mutex UNUSED (_data_mutex);
+
+  boost::shared_ptr<Recordset_column_store> column_store= _column_store;
+  if (!column_store)
+    return;
+
+  {
+    // the caller might already have a transaction open, sqlite doesn't nest them
+    boost::scoped_ptr<sqlide::Sqlite_transaction_guarder> transaction_guarder;
+    if (use_transaction)
+      transaction_guarder.reset(new sqlide::Sqlite_transaction_guarder(data_swap_db, false));
+
+    std::list<boost::shared_ptr<sqlite::command> > insert_commands=
+      Recordset_data_storage::prepare_data_swap_record_add_statement(data_swap_db, column_store->column_count());
+    Recordset_data_storage::add_data_swap_records(insert_commands, *column_store);
+    sqlite::execute(*data_swap_db, "delete from `data_index`", true);
+    if (_column_store_rows)
+    {
+      // ids are assigned starting from 1 in the order of the stored rows
+      sqlite::command insert_data_index_record_statement(*data_swap_db, "insert into `data_index` (`id`) values (?)");
+      for (std::vector<size_t>::const_iterator row= _column_store_rows->begin(); row != _column_store_rows->end(); ++row)
+      {
+        insert_data_index_record_statement.clear();
+        insert_data_index_record_statement % (int)(*row + 1);
+        insert_data_index_record_statement.emit();
+      }
+    }
+    else
+      sqlite::execute(*data_swap_db, "insert into `data_index` (`id`) select `id` from `data` order by `id`", true);
+
+    if (transaction_guarder)
+      transaction_guarder->commit();
+  }
+
+  _column_store.reset();
+  _column_store_rows.reset();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -516,6 +578,38 @@ void VarGridModel::cache_data_frame(RowId center_row, bool force_reload)
 
   _data.clear();
 
+  // rows still kept in memory are served directly from there, the data swap db is empty in that case
+  if (_column_store)
+  {
+    const Recordset_column_store &column_store= *_column_store;
+    const std::vector<size_t> *stored_rows= _column_store_rows.get();
+    const ColumnId stored_column_count= std::min<ColumnId>(column_store.column_count(), _column_count);
+
+    std::vector<bool> blob_columns(_column_count);
+    for (ColumnId col= 0; _column_count > col; ++col)
+      blob_columns[col]= sqlide::is_var_blob(_real_column_types[col]);
+
+    RowId row_end= std::min<RowId>(_data_frame_begin + row_count, stored_rows ? stored_rows->size() : column_store.row_count());
+    _data.reserve(row_count * _column_count);
+    for (RowId row= _data_frame_begin; row < row_end; ++row)
+    {
+      RowId stored_row= stored_rows ? (*stored_rows)[row] : row;
+      for (ColumnId col= 0; col < stored_column_count; ++col)
+      {
+        if (_optimized_blob_fetching && blob_columns[col])
+          _data.push_back(sqlite::null_t());
+        else
+          _data.push_back(column_store.get(stored_row, col));
+      }
+
+      // remaining columns are the auxiliary ones not stored in the data, that is the row `id`, which
+      // the data swap db would assign as autoincrement value starting from 1
+      for (ColumnId col= stored_column_count; col < _column_count; ++col)
+        _data.push_back((int)(stored_row + 1));
+    }
+    return;
+  }
+
   // load data
   {
     boost::shared_ptr<sqlite::connection> data_swap_db= this->data_swap_db();
@@ -31,6 +31,7 @@
 #include <vector>
 
 class Recordset_data_storage;
+class Recordset_column_store;
 
 namespace sqlite
 {
@@ -66,6 +67,7 @@ protected:
 
 public:
   virtual size_t row_count() const { return _row_count; }
+  bool is_fetching() const { return g_atomic_int_get(&_is_fetching) != 0; } // rows are still being added by a streaming fetch
   virtual size_t count();
   virtual size_t get_column_count() const { return _column_count; }
   virtual std::string get_column_caption(ColumnId index);
@@ -134,6 +136,7 @@ protected:
 protected:
   Data _data;
   RowId _row_count;
+  volatile gint _is_fetching; // set by the fetching thread, read by others, so only accessed atomically
   ColumnId _column_count;
   Column_names _column_names;
   Column_types _column_types;
@@ -149,6 +152,23 @@ private:
 private:
   mutable boost::shared_ptr<sqlite::connection> _data_swap_db;
   std::string _data_swap_db_path;
+
+  // Unedited fetched data can be kept in memory instead of the data swap db. It's moved to the
+  // data swap db the first time the latter is requested (e.g. for editing or exporting).
+protected:
+  bool has_column_store() const { return _column_store.get() != NULL; }
+  boost::shared_ptr<Recordset_column_store> column_store() const { return _column_store; }
+  // Stored rows in display order while the column store data is sorted or filtered, null for all rows in fetch order.
+  void set_column_store_rows(const boost::shared_ptr<std::vector<size_t> > &rows) { _column_store_rows= rows; }
+  boost::shared_ptr<std::vector<size_t> > column_store_rows() const { return _column_store_rows; }
+private:
+  void spill_column_store(sqlite::connection *data_swap_db, bool use_transaction= true);
+  mutable boost::shared_ptr<Recordset_column_store> _column_store;
+  boost::shared_ptr<std::vector<size_t> > _column_store_rows;
+public:
+  size_t column_store_memory_limit() const { return _column_store_memory_limit; }
+private:
+  size_t _column_store_memory_limit; // in bytes, 0 - column store is disabled
 public:
   static const int DATA_SWAP_DB_TABLE_MAX_COL_COUNT;
 public:
@@ -1061,6 +1061,13 @@ mforms::View *PreferencesForm::create_editor_page()
                                         "code editor configuration file. With this swich they are always upper-cased instead."));
         subsettings_box->add(upper_case_check, false);
 
+        mforms::CheckBox *fuzzy_check = new_checkbox_option("DbSqlEditor:CodeCompletionFuzzyMatching");
+        fuzzy_check->set_text(_("Use fuzzy matching on completion"));
+        fuzzy_check->set_tooltip(_("List all names containing the typed characters in the same order (e.g. \"fsq\" "
+                                   "finds \"fact_sales_q1\"), best matches and recently used names first. Otherwise "
+                                   "only names starting with the typed text are listed."));
+        subsettings_box->add(fuzzy_check, false);
+
         // Set initial enabled state of sub settings depending on whether code completion is enabled.
         std::string value;
         _wbui->get_wb_options_value(_model.is_valid() ? _model.id() : "", "DbSqlEditor:CodeCompletionEnabled", value);
@@ -1360,6 +1367,10 @@ mforms::View *PreferencesForm::create_model_page()
   top_box->add(table, false, true);
   {
     table->add_checkbox_option("workbench.AutoReopenLastModel", _("Automatically reopen previous model at start"), "");
+
+    table->add_checkbox_option("workbench:ModelSnapshotCache", _("Keep a snapshot next to saved models for faster loading"),
+                               _("Saving a model also stores a binary snapshot of it as <model file>.snapshot.\nOpening the model "
+                                 "then loads the snapshot, unless the model file was changed elsewhere."));
     
 #ifndef __APPLE__
     table->add_checkbox_option("workbench:ForceSWRendering", _("Force use of software based rendering for EER diagrams"), 
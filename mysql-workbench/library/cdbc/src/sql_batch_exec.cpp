@@ -21,14 +21,38 @@
 #include <cppconn/exception.h>
 #include <cppconn/resultset.h>
 #include <memory>
+#include <string.h>
+#include <boost/bind.hpp>
 
 namespace sql
 {
 
+// Upper limit for the size of a multi-statement request, whatever max_allowed_packet allows.
+#define MAX_BATCH_SIZE (16 * 1024 * 1024)
+
+// Room left in a request for the packet header and the command byte.
+#define BATCH_PACKET_RESERVE 1024
+
+#define BATCH_SEPARATOR ";\n"
+
+
 SqlBatchExec::SqlBatchExec()
 :
-_stop_on_error(true)
+_stop_on_error(true),
+_max_batch_size(0),
+_sql_log_enabled(true)
+{
+}
+
+
+static bool next_list_statement(std::list<std::string>::const_iterator &i, const std::list<std::string>::const_iterator &i_end,
+                                size_t &index, size_t count, std::string &statement, float &progress)
 {
+  if (i == i_end)
+    return false;
+  statement= *i++;
+  progress= (float)++index / count;
+  return true;
 }
 
 
@@ -37,6 +61,7 @@ long SqlBatchExec::operator()(sql::Statement *stmt, std::list<std::string> &stat
   _batch_exec_success_count= 0;
   _batch_exec_err_count= 0;
   _sql_log.clear();
+  prepare_batching(stmt);
 
   exec_sql_script(stmt, statements, _batch_exec_err_count);
   if (_batch_exec_err_count && !_failback_statements.empty())
@@ -53,39 +78,187 @@ long SqlBatchExec::operator()(sql::Statement *stmt, std::list<std::string> &stat
 }
 
 
+/**
+ * Executes the statements given by statement_source as they come in, so a script never needs to be
+ * kept in memory as a whole. Progress is reported as given by the source. Failback statements are
+ * not supported here.
+ */
+long SqlBatchExec::operator()(sql::Statement *stmt, const Statement_source &statement_source)
+{
+  _batch_exec_success_count= 0;
+  _batch_exec_err_count= 0;
+  _sql_log.clear();
+  prepare_batching(stmt);
+
+  exec_sql_script(stmt, statement_source, _batch_exec_err_count);
+
+  if (_batch_exec_stat_cb)
+    _batch_exec_stat_cb(_batch_exec_success_count, _batch_exec_err_count);
+
+  return _batch_exec_err_count;
+}
+
+
 void SqlBatchExec::exec_sql_script(sql::Statement *stmt, std::list<std::string> &statements, long &batch_exec_err_count)
+{
+  std::list<std::string>::const_iterator i= statements.begin();
+  size_t index= 0;
+  exec_sql_script(stmt, boost::bind(next_list_statement, boost::ref(i), statements.end(), boost::ref(index),
+    statements.size(), _1, _2), batch_exec_err_count);
+}
+
+
+/**
+ * Determines how big a multi-statement request may get, if batching is enabled.
+ */
+void SqlBatchExec::prepare_batching(sql::Statement *stmt)
+{
+  _max_batch_size= 0;
+  if (!_batchable_statement_check)
+    return;
+
+  size_t max_allowed_packet= 1024 * 1024; // Server default for older versions.
+  try
+  {
+    std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery("SELECT @@max_allowed_packet"));
+    if (rs->next())
+      max_allowed_packet= (size_t)rs->getUInt64(1);
+  }
+  catch (SQLException &)
+  {
+    // Keep the default.
+  }
+
+  if (max_allowed_packet > MAX_BATCH_SIZE)
+    max_allowed_packet= MAX_BATCH_SIZE;
+  if (max_allowed_packet > BATCH_PACKET_RESERVE)
+    _max_batch_size= max_allowed_packet - BATCH_PACKET_RESERVE;
+}
+
+
+void SqlBatchExec::exec_sql_script(sql::Statement *stmt, const Statement_source &statement_source, long &batch_exec_err_count)
 {
   _batch_exec_progress_state= 0;
-  _batch_exec_progress_inc= 1.f / statements.size();
 
-  for (std::list<std::string>::const_iterator i= statements.begin(), i_end= statements.end(); i != i_end; ++i)
+  std::vector<std::string> batch;
+  size_t batch_size= 0;
+  std::string statement;
+  while (statement_source(statement, _batch_exec_progress_state))
   {
-    try
+    bool batchable= _max_batch_size > 0 && _batchable_statement_check(statement);
+    if (!batch.empty() && (!batchable || batch_size + statement.size() > _max_batch_size))
     {
-      _sql_log.push_back(*i);
-      if (stmt->execute(*i))
-        std::auto_ptr<sql::ResultSet> rs(stmt->getResultSet());
-      ++_batch_exec_success_count;
+      if (!exec_statement_batch(stmt, batch, batch_exec_err_count))
+        return;
+      batch.clear();
+      batch_size= 0;
     }
-    catch (SQLException &e)
+
+    if (batchable)
+    {
+      batch.push_back(statement);
+      batch_size+= statement.size() + strlen(BATCH_SEPARATOR);
+    }
+    else if (!exec_statement(stmt, statement, batch_exec_err_count))
+      return;
+  }
+
+  if (!batch.empty())
+    exec_statement_batch(stmt, batch, batch_exec_err_count);
+}
+
+
+/**
+ * Executes a single statement. Returns false if execution of the script must stop.
+ */
+bool SqlBatchExec::exec_statement(sql::Statement *stmt, const std::string &statement, long &batch_exec_err_count)
+{
+  try
+  {
+    if (_sql_log_enabled)
+      _sql_log.push_back(statement);
+    if (stmt->execute(statement))
+      std::auto_ptr<sql::ResultSet> rs(stmt->getResultSet());
+    ++_batch_exec_success_count;
+  }
+  catch (SQLException &e)
+  {
+    handle_error(e, statement, batch_exec_err_count);
+  }
+  if (_batch_exec_progress_cb)
+    _batch_exec_progress_cb(_batch_exec_progress_state);
+
+  return !(batch_exec_err_count && _stop_on_error);
+}
+
+
+/**
+ * Sends the statements as one multi-statement request and walks their results, so success and errors
+ * are counted per statement as if they were executed one by one. The server stops at the first failing
+ * statement, so after an error the remaining statements of the batch are executed singly.
+ * Returns false if execution of the script must stop.
+ */
+bool SqlBatchExec::exec_statement_batch(sql::Statement *stmt, const std::vector<std::string> &batch, long &batch_exec_err_count)
+{
+  if (batch.size() == 1)
+    return exec_statement(stmt, batch.front(), batch_exec_err_count);
+
+  std::string sql;
+  for (std::vector<std::string>::const_iterator i= batch.begin(); i != batch.end(); ++i)
+    sql.append(*i).append(BATCH_SEPARATOR);
+
+  size_t done= 0; // Number of statements whose result was read.
+  try
+  {
+    bool has_result_set= stmt->execute(sql);
+    while (true)
     {
-      ++batch_exec_err_count;
-      if (_error_cb.empty())
-        throw;
-      else
-      {
-        if (&_batch_exec_err_count != &batch_exec_err_count) // applies only to failback scripts
-          _error_cb(-1, "Error when running failback script. Details follow.", "");
-        _error_cb(e.getErrorCode(), e.what(), *i);        
-      }
+      if (has_result_set)
+        std::auto_ptr<sql::ResultSet> rs(stmt->getResultSet());
+      if (_sql_log_enabled)
+        _sql_log.push_back(batch[done]);
+      ++_batch_exec_success_count;
+      if (++done == batch.size())
+        break;
+      has_result_set= stmt->getMoreResults(); // Throws if the next statement failed.
     }
-    _batch_exec_progress_state+= _batch_exec_progress_inc;
+  }
+  catch (SQLException &e)
+  {
+    if (_sql_log_enabled)
+      _sql_log.push_back(batch[done]);
+    handle_error(e, batch[done], batch_exec_err_count);
     if (_batch_exec_progress_cb)
       _batch_exec_progress_cb(_batch_exec_progress_state);
-    
-    if (batch_exec_err_count && _stop_on_error)
-      break;
+    if (_stop_on_error)
+      return false;
+
+    for (size_t i= done + 1; i < batch.size(); ++i)
+      if (!exec_statement(stmt, batch[i], batch_exec_err_count))
+        return false;
+    return true;
   }
+
+  if (_batch_exec_progress_cb)
+    _batch_exec_progress_cb(_batch_exec_progress_state);
+
+  return true;
+}
+
+
+/**
+ * Counts and reports an error of the given statement. Must be called from within a catch block,
+ * as the exception is rethrown if nobody wants to be told about errors.
+ */
+void SqlBatchExec::handle_error(const SQLException &e, const std::string &statement, long &batch_exec_err_count)
+{
+  ++batch_exec_err_count;
+  if (_error_cb.empty())
+    throw;
+
+  if (&_batch_exec_err_count != &batch_exec_err_count) // applies only to failback scripts
+    _error_cb(-1, "Error when running failback script. Details follow.", "");
+  _error_cb(e.getErrorCode(), e.what(), statement);
 }
 
 
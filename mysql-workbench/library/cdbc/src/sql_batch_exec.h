@@ -5,7 +5,9 @@
 #include "cppdbc_public_interface.h"
 #include <cppconn/statement.h>
 #include <cppconn/connection.h>
+#include <cppconn/exception.h>
 #include <list>
+#include <vector>
 #include <string>
 #include <boost/function.hpp>
 
@@ -20,9 +22,19 @@ public:
   SqlBatchExec();
 
 public:
+  // Supplies the statements of a script one at a time. Returns false if there are no more statements,
+  // otherwise sets the statement and the part of the script consumed so far (0..1).
+  typedef boost::function<bool (std::string&, float&)> Statement_source;
+
   long operator()(sql::Statement *stmt, std::list<std::string> &statements);
+  long operator()(sql::Statement *stmt, const Statement_source &statement_source);
 private:
   void exec_sql_script(sql::Statement *stmt, std::list<std::string> &statements, long &batch_exec_err_count);
+  void exec_sql_script(sql::Statement *stmt, const Statement_source &statement_source, long &batch_exec_err_count);
+  bool exec_statement(sql::Statement *stmt, const std::string &statement, long &batch_exec_err_count);
+  bool exec_statement_batch(sql::Statement *stmt, const std::vector<std::string> &batch, long &batch_exec_err_count);
+  void handle_error(const SQLException &e, const std::string &statement, long &batch_exec_err_count);
+  void prepare_batching(sql::Statement *stmt);
 
 public:
   typedef boost::function<int (long long, const std::string&, const std::string&)> Error_cb;
@@ -41,7 +53,6 @@ private:
   long _batch_exec_success_count;
   long _batch_exec_err_count;
   float _batch_exec_progress_state;
-  float _batch_exec_progress_inc;
 
 public:
   void stop_on_error(bool value) { _stop_on_error= value; }
@@ -49,6 +60,17 @@ public:
 private:
   bool _stop_on_error;
 
+public:
+  // Consecutive statements accepted by the check are sent together as one multi-statement request of up to
+  // max_allowed_packet bytes, instead of one round trip per statement. The check must only accept single,
+  // complete statements that return no result set (i.e. DML). Telling those apart needs an SQL splitter
+  // and lexer, which is up to the caller. The connection must allow CLIENT_MULTI_STATEMENTS.
+  typedef boost::function<bool (const std::string&)> Batchable_statement_check;
+  void multi_statement_batching(const Batchable_statement_check &check) { _batchable_statement_check= check; }
+private:
+  Batchable_statement_check _batchable_statement_check;
+  size_t _max_batch_size;
+
 public:
   void failback_statements(const std::list<std::string> &value) { _failback_statements= value; }
   const std::list<std::string> & failback_statements() const { return _failback_statements; }
@@ -57,8 +79,11 @@ private:
 
 public:
   const std::list<std::string> & sql_log() const { return _sql_log; }
+  // Scripts streamed from a file can be of any size, so they should not be logged.
+  void sql_log_enabled(bool value) { _sql_log_enabled= value; }
 private:
   std::list<std::string> _sql_log;
+  bool _sql_log_enabled;
 };
 
 
@@ -20,6 +20,8 @@
 #include "connection_helpers.h"
 #include "grtsqlparser/sql_facade.h"
 
+#include <boost/bind.hpp>
+
 #define DATABASE_TO_USE "USE test"
 
 static bool populate_test_table(std::auto_ptr<sql::Statement> &stmt)
@@ -674,5 +676,79 @@ TEST_FUNCTION(16)
   } 
 }
 
+static int count_batch_error(long long, const std::string&, const std::string &statement, std::list<std::string> &failed)
+{
+  failed.push_back(statement);
+  return 0;
+}
+
+// Deciding which statements can be batched is up to the caller, which has the SQL splitter and lexer at hand
+// (see MySQLStatementSplitter::is_single_statement). The statements below are simple enough.
+static bool is_insert_or_update(const std::string &statement)
+{
+  return statement.compare(0, 7, "INSERT ") == 0 || statement.compare(0, 7, "UPDATE ") == 0;
+}
+
+static int store_batch_stats(long success_count, long error_count, long &successes, long &errors)
+{
+  successes= success_count;
+  errors= error_count;
+  return 0;
+}
+
+// Test multi-statement batching in SqlBatchExec: counts must be exact per statement, also when a
+// statement in the middle of a batch fails.
+TEST_FUNCTION(17)
+{
+  db_mgmt_ConnectionRef connectionProperties(_tester.grt);
+
+  setup_env(_tester.grt, connectionProperties);
+
+  try {
+    sql::DriverManager *dm = sql::DriverManager::getDriverManager();
+    sql::ConnectionWrapper wrapper= dm->getConnection(connectionProperties);
+    ensure("conn is NULL", wrapper.get() != NULL);
+
+    std::auto_ptr<sql::Statement> stmt(wrapper.get()->createStatement());
+    stmt->execute(DATABASE_TO_USE);
+    stmt->execute("DROP TABLE IF EXISTS test_batch");
+    stmt->execute("CREATE TABLE test_batch (id int primary key)");
+
+    std::list<std::string> statements;
+    statements.push_back("INSERT INTO test_batch VALUES (1)");
+    statements.push_back("INSERT INTO test_batch VALUES (2)");
+    statements.push_back("INSERT INTO test_batch VALUES (1)"); // Duplicate key.
+    statements.push_back("INSERT INTO test_batch VALUES (4) /* ; */");
+    statements.push_back("SELECT 1");
+    statements.push_back("INSERT INTO test_batch_missing VALUES (5)"); // Unknown table.
+    statements.push_back("INSERT INTO test_batch VALUES (3)");
+    statements.push_back("UPDATE test_batch SET id = id + 10 WHERE id = 3");
+
+    std::list<std::string> failed;
+    long successes= 0, errors= 0;
+    sql::SqlBatchExec exec;
+    exec.stop_on_error(false);
+    exec.multi_statement_batching(is_insert_or_update);
+    exec.error_cb(boost::bind(count_batch_error, _1, _2, _3, boost::ref(failed)));
+    exec.batch_exec_stat_cb(boost::bind(store_batch_stats, _1, _2, boost::ref(successes), boost::ref(errors)));
+
+    ensure_equals("error count", exec(stmt.get(), statements), 2);
+    ensure_equals("reported successes", successes, 6);
+    ensure_equals("reported errors", errors, 2);
+    ensure_equals("failed statements", failed.size(), 2U);
+    ensure_equals("first failed statement", failed.front(), "INSERT INTO test_batch VALUES (1)");
+    ensure_equals("logged statements", exec.sql_log().size(), statements.size());
+
+    std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery("SELECT SUM(id) FROM test_batch"));
+    ensure("no sum", rs->next());
+    ensure_equals("inserted rows", rs->getInt(1), 1 + 2 + 4 + 13);
+
+    stmt->execute("DROP TABLE test_batch");
+  } catch (sql::SQLException &) {
+    printf("ERR: Caught sql::SQLException\n");
+    throw;
+  }
+}
+
 END_TESTS
 
@@ -305,6 +305,25 @@ namespace grt {
     }
   };
 
+  inline void internal::DictStorage::const_iterator::check_valid() const
+  {
+    if (_generation != _storage->_generation)
+      throw std::logic_error("Dict iterator used after the dict was rehashed or cleared");
+  }
+
+  inline internal::DictStorage::const_iterator::reference internal::DictStorage::const_iterator::operator*() const
+  {
+    check_valid();
+    return _storage->_entries[_index];
+  }
+
+  inline internal::DictStorage::const_iterator::pointer internal::DictStorage::const_iterator::operator->() const
+  {
+    check_valid();
+    return &_storage->_entries[_index];
+  }
+
+
 
   //----------------------------------------------------------------------
   // Object Refs
@@ -902,14 +921,15 @@ namespace grt {
     {
     }
 
+    // Short values share their String instance, see internal::String::get_shared().
     Ref(const std::string &value)
-       : ValueRef(internal::String::get(value))
     {
+      _value = internal::String::get_shared(value);
     }
 
     Ref(const char *value)
-       : ValueRef(internal::String::get(value))
     {
+      _value = internal::String::get_shared(value);
     }
 
     inline operator storage_type () const { return *content(); }
@@ -2619,12 +2639,21 @@ namespace grt {
 
     xmlDocPtr load_xml(const std::string &path);
     void get_xml_metainfo(xmlDocPtr doc, std::string &doctype_ret, std::string &version_ret);
+    bool get_xml_metainfo(const std::string &path, std::string &doctype_ret, std::string &version_ret);
     ValueRef unserialize_xml(xmlDocPtr doc, const std::string &source_path);
 
     std::string serialize_xml_data(const ValueRef &value, const std::string &doctype="", 
       const std::string &version="", bool list_objects_as_links= false);
     ValueRef unserialize_xml_data(const std::string &data);
 
+    // binary snapshots, see internal::SnapshotSerializer
+    void serialize_snapshot(const ValueRef &value, const std::string &path,
+                            const std::string &doctype="", const std::string &version="",
+                            const std::string &source_digest="");
+    ValueRef unserialize_snapshot(const std::string &path, std::string &doctype_ret, std::string &version_ret);
+    bool get_snapshot_metainfo(const std::string &path, std::string &doctype_ret, std::string &version_ret,
+                               std::string &source_digest_ret);
+
     
     // globals
     
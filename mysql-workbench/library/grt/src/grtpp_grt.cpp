@@ -35,6 +35,7 @@
 
 #include "serializer.h"
 #include "unserializer.h"
+#include "snapshot_serializer.h"
 
 DEFAULT_LOG_DOMAIN(DOMAIN_GRT)
 
@@ -625,6 +626,12 @@ void GRT::get_xml_metainfo(xmlDocPtr doc, std::string &doctype_ret, std::string
 }
 
 
+bool GRT::get_xml_metainfo(const std::string &path, std::string &doctype_ret, std::string &version_ret)
+{
+  return internal::Unserializer::get_xmlfile_metainfo(path, doctype_ret, version_ret);
+}
+
+
 ValueRef GRT::unserialize_xml(xmlDocPtr doc, const std::string &source_path)
 {
   internal::Unserializer unser(this, _check_serialized_crc);
@@ -653,6 +660,38 @@ ValueRef GRT::unserialize_xml_data(const std::string &data)
   return internal::Unserializer(this, _check_serialized_crc).unserialize_xmldata(data.data(), data.size());
 }
 
+
+void GRT::serialize_snapshot(const ValueRef &value, const std::string &path,
+                             const std::string &doctype, const std::string &version, const std::string &source_digest)
+{
+  internal::SnapshotSerializer(this).save_to_file(value, path, doctype, version, source_digest);
+}
+
+
+ValueRef GRT::unserialize_snapshot(const std::string &path, std::string &doctype_ret, std::string &version_ret)
+{
+  internal::SnapshotUnserializer unser(this);
+
+  if (!g_file_test(path.c_str(), G_FILE_TEST_EXISTS))
+    throw os_error(path);
+  try
+  {
+    return unser.load_from_file(path, &doctype_ret, &version_ret);
+  }
+  catch (std::exception &exc)
+  {
+    throw grt_runtime_error("Error unserializing GRT snapshot from "+path, exc.what());
+  }
+  return ValueRef();
+}
+
+
+bool GRT::get_snapshot_metainfo(const std::string &path, std::string &doctype_ret, std::string &version_ret,
+                                std::string &source_digest_ret)
+{
+  return internal::SnapshotUnserializer::get_file_metainfo(path, doctype_ret, version_ret, source_digest_ret);
+}
+
 //--------------------------------------------------------------------------------
 
 void GRT::add_module_loader(ModuleLoader *loader)
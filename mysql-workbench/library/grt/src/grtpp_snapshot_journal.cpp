@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "grtpp_snapshot_journal.h"
+#include "snapshot_serializer.h"
+
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <glib.h>
+
+#include "base/log.h"
+#include "base/string_utilities.h"
+#include "base/file_functions.h"
+
+DEFAULT_LOG_DOMAIN(DOMAIN_GRT)
+
+using namespace grt;
+
+#define JOURNAL_FORMAT_VERSION 1
+
+// magic(8) version(4) token length(4)
+#define JOURNAL_HEADER_SIZE 16
+
+// a checkpoint is written instead of a record once the journal gets this big, relative to the snapshot
+#define JOURNAL_COMPACT_RATIO 2
+#define JOURNAL_MAX_RECORDS 100
+
+static const char journal_magic[8]= { 'G', 'R', 'T', 'J', 'R', 'N', 'L', '\0' };
+
+//--------------------------------------------------------------------------------------------------
+
+static void put_u32(std::string &out, uint32_t value)
+{
+  for (int i= 0; i < 4; i++)
+    out.push_back((char)((value >> (i * 8)) & 0xff));
+}
+
+
+static uint32_t get_u32(const unsigned char *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static void write_journal_data(const std::string &path, const char *mode, const std::string &data)
+{
+  FILE *file= base_fopen(path.c_str(), mode);
+  if (!file)
+    throw grt::os_error("Could not open journal file " + path, errno);
+
+  if (fwrite(data.data(), 1, data.size(), file) < data.size() || fflush(file) != 0)
+  {
+    int err= errno;
+    fclose(file);
+    throw grt::os_error("Error writing journal file " + path, err);
+  }
+  fclose(file);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+SnapshotJournal::SnapshotJournal(GRT *grt, const std::string &snapshot_path, const std::string &journal_path)
+  : _grt(grt), _snapshot_path(snapshot_path), _journal_path(journal_path), _snapshot_size(0), _journal_size(0),
+    _record_count(0)
+{
+}
+
+
+/**
+ * Writes a full snapshot of the value and starts a new, empty journal for it.
+ */
+void SnapshotJournal::checkpoint(const ValueRef &value, const std::string &doctype, const std::string &docversion)
+{
+  reset();
+
+  std::string token= base::strfmt("%llx-%08x", (unsigned long long)g_get_real_time(), g_random_int());
+
+  internal::SnapshotSerializer serializer(_grt);
+  serializer.save_to_file(value, _snapshot_path, doctype, docversion, token);
+
+  // the new snapshot makes any existing journal invalid, as its token doesn't match anymore
+  std::string header(journal_magic, sizeof(journal_magic));
+  put_u32(header, JOURNAL_FORMAT_VERSION);
+  put_u32(header, (uint32_t)token.size());
+  header.append(token);
+  write_journal_data(_journal_path, "wb", header);
+
+  serializer.get_written_ids(_known_ids);
+  _snapshot_size= (uint64_t)std::max(base_get_file_size(_snapshot_path.c_str()), 0L);
+  _journal_size= header.size();
+  _token= token;
+}
+
+
+/**
+ * Appends a record with the current contents of the given objects to the journal.
+ * If writing fails, the journal is reset so the next store starts with a checkpoint.
+ */
+void SnapshotJournal::append(const std::vector<ObjectRef> &objects)
+{
+  if (!has_checkpoint())
+    throw std::logic_error("Journal has no checkpoint to append changes to");
+
+  if (objects.empty())
+    return;
+
+  internal::SnapshotSerializer serializer(_grt);
+  std::string record= serializer.serialize_changes(objects, _known_ids, _token);
+
+  std::string data;
+  data.reserve(record.size() + 4);
+  put_u32(data, (uint32_t)record.size());
+  data.append(record);
+
+  try
+  {
+    write_journal_data(_journal_path, "ab", data);
+  }
+  catch (...)
+  {
+    reset();
+    throw;
+  }
+
+  serializer.get_written_ids(_known_ids);
+  _journal_size+= data.size();
+  _record_count++;
+}
+
+
+void SnapshotJournal::reset()
+{
+  _token.clear();
+  _known_ids.clear();
+  _snapshot_size= 0;
+  _journal_size= 0;
+  _record_count= 0;
+}
+
+
+/**
+ * Returns true if the journal got big enough to be replaced by a new checkpoint. The number of
+ * records is also limited, so changes made without undo tracking are eventually stored too.
+ */
+bool SnapshotJournal::needs_compaction() const
+{
+  return _journal_size * JOURNAL_COMPACT_RATIO > _snapshot_size || _record_count >= JOURNAL_MAX_RECORDS;
+}
+
+
+/**
+ * Loads the checkpoint snapshot and applies the records of the journal to it, if there is a journal
+ * for that checkpoint. Records that can't be read end the journal.
+ */
+ValueRef SnapshotJournal::load(GRT *grt, const std::string &snapshot_path, const std::string &journal_path,
+                               std::string &doctype, std::string &docversion)
+{
+  std::string token;
+  if (!internal::SnapshotUnserializer::get_file_metainfo(snapshot_path, doctype, docversion, token))
+    throw std::runtime_error("Invalid or unsupported snapshot file " + snapshot_path);
+
+  internal::SnapshotUnserializer unserializer(grt, true);
+  ValueRef value(unserializer.load_from_file(snapshot_path, &doctype, &docversion));
+
+  gchar *contents= NULL;
+  gsize length= 0;
+  char *local_filename;
+  if ((local_filename= g_filename_from_utf8(journal_path.c_str(), -1, NULL, NULL, NULL)) == NULL)
+    return value;
+  bool found= g_file_get_contents(local_filename, &contents, &length, NULL) != FALSE;
+  g_free(local_filename);
+  if (!found)
+    return value;
+
+  const unsigned char *p= (const unsigned char*)contents;
+  const unsigned char *end= p + length;
+
+  if (length < JOURNAL_HEADER_SIZE || memcmp(p, journal_magic, sizeof(journal_magic)) != 0
+      || get_u32(p + 8) != JOURNAL_FORMAT_VERSION || get_u32(p + 12) > length - JOURNAL_HEADER_SIZE
+      || token != std::string((const char*)p + JOURNAL_HEADER_SIZE, get_u32(p + 12)))
+  {
+    log_warning("Journal %s does not belong to snapshot %s, ignoring it\n", journal_path.c_str(), snapshot_path.c_str());
+    g_free(contents);
+    return value;
+  }
+  p+= JOURNAL_HEADER_SIZE + get_u32(p + 12);
+
+  int records= 0;
+  while (p < end)
+  {
+    if (end - p < 4 || get_u32(p) > (uint64_t)(end - p - 4))
+    {
+      log_warning("Journal %s ends with an incomplete record, ignoring it\n", journal_path.c_str());
+      break;
+    }
+
+    uint32_t size= get_u32(p);
+    try
+    {
+      unserializer.unserialize_data((const char*)p + 4, size, NULL, NULL);
+    }
+    catch (std::exception &exc)
+    {
+      log_warning("Error reading record %i of journal %s: %s\n", records + 1, journal_path.c_str(), exc.what());
+      break;
+    }
+    p+= 4 + size;
+    records++;
+  }
+  g_free(contents);
+
+  log_debug("Applied %i records from journal %s\n", records, journal_path.c_str());
+
+  return value;
+}
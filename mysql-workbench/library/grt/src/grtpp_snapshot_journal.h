@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef _GRTPP_SNAPSHOT_JOURNAL_H_
+#define _GRTPP_SNAPSHOT_JOURNAL_H_
+
+#include "grtpp.h"
+
+#include <vector>
+#include <stdint.h>
+#include <boost/unordered_set.hpp>
+
+namespace grt {
+
+  /**
+   * Stores a value incrementally: a checkpoint is a full snapshot of the value, after which only
+   * the objects that changed are appended to a journal file. Each journal record holds the
+   * changed objects and the objects created since the checkpoint, all other objects are
+   * referenced by id.
+   *
+   * The journal starts with a token that must match the source digest of the checkpoint
+   * snapshot, so a journal left over from an older checkpoint is never applied to a newer one.
+   * A record that was not completely written (e.g. because of a crash) is ignored when loading.
+   */
+  class MYSQLGRT_PUBLIC SnapshotJournal
+  {
+  public:
+    SnapshotJournal(GRT *grt, const std::string &snapshot_path, const std::string &journal_path);
+
+    void checkpoint(const ValueRef &value, const std::string &doctype, const std::string &docversion);
+    void append(const std::vector<ObjectRef> &objects);
+    void reset();
+
+    bool has_checkpoint() const { return !_token.empty(); }
+    bool needs_compaction() const;
+
+    size_t record_count() const { return _record_count; }
+    uint64_t journal_size() const { return _journal_size; }
+
+    static ValueRef load(GRT *grt, const std::string &snapshot_path, const std::string &journal_path,
+                         std::string &doctype, std::string &docversion);
+
+  private:
+    GRT *_grt;
+    std::string _snapshot_path;
+    std::string _journal_path;
+    std::string _token;
+    boost::unordered_set<std::string> _known_ids;
+    uint64_t _snapshot_size;
+    uint64_t _journal_size;
+    size_t _record_count;
+  };
+};
+
+#endif
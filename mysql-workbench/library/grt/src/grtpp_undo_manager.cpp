@@ -214,6 +214,12 @@ void UndoListInsertAction::undo(UndoManager *owner)
 }
 
 
+ObjectRef UndoListInsertAction::changed_object() const
+{
+  return owner_of_list(_list);
+}
+
+
 void UndoListInsertAction::dump(std::ostream &out, int indent) const
 {
   ObjectRef owner= owner_of_list(_list);
@@ -250,6 +256,12 @@ void UndoListReorderAction::undo(UndoManager *owner)
 }
 
 
+ObjectRef UndoListReorderAction::changed_object() const
+{
+  return owner_of_list(_list);
+}
+
+
 void UndoListReorderAction::dump(std::ostream &out, int indent) const
 {
   std::string change(strfmt("[%i]->[%i]", (int) (_oindex == BaseListRef::npos ? -1 : _oindex), 
@@ -289,6 +301,12 @@ void UndoListSetAction::undo(UndoManager *owner)
 }
 
 
+ObjectRef UndoListSetAction::changed_object() const
+{
+  return owner_of_list(_list);
+}
+
+
 void UndoListSetAction::dump(std::ostream &out, int indent) const
 {
   ObjectRef owner= owner_of_list(_list);
@@ -339,6 +357,12 @@ void UndoListRemoveAction::undo(UndoManager *owner)
 }
 
 
+ObjectRef UndoListRemoveAction::changed_object() const
+{
+  return owner_of_list(_list);
+}
+
+
 void UndoListRemoveAction::dump(std::ostream &out, int indent) const
 {
   ObjectRef owner= owner_of_list(_list);
@@ -388,6 +412,12 @@ void UndoDictSetAction::undo(UndoManager *owner)
 }
 
 
+ObjectRef UndoDictSetAction::changed_object() const
+{
+  return owner_of_dict(_dict);
+}
+
+
 void UndoDictSetAction::dump(std::ostream &out, int indent) const
 {
   ObjectRef owner= owner_of_dict(_dict);
@@ -436,6 +466,12 @@ void UndoDictRemoveAction::undo(UndoManager *owner)
 }
 
 
+ObjectRef UndoDictRemoveAction::changed_object() const
+{
+  return owner_of_dict(_dict);
+}
+
+
 void UndoDictRemoveAction::dump(std::ostream &out, int indent) const
 {
   ObjectRef owner= owner_of_dict(_dict);
@@ -617,6 +653,8 @@ UndoManager::UndoManager(GRT *grt)
   _is_redoing= false;
   _undo_limit= 0;
   _blocks= 0;
+  _track_changes= false;
+  _untracked_changes= false;
 }
 
 
@@ -785,11 +823,80 @@ void UndoManager::reset()
     delete *iter;
   _redo_stack.clear();
 
+  // don't keep references to the changed objects, the next user of them has to store everything
+  if (!_changed_objects.empty())
+  {
+    _changed_objects.clear();
+    _untracked_changes= true;
+  }
+
   unlock();
   _changed_signal();
 }
 
 
+/**
+ * Enables collecting the objects changed by the actions passed to add_undo(), including the ones
+ * that are not stored because the undo manager is disabled.
+ */
+void UndoManager::set_change_tracking(bool flag)
+{
+  lock();
+  _track_changes= flag;
+  _changed_objects.clear();
+  _untracked_changes= false;
+  unlock();
+}
+
+
+/**
+ * Moves the objects changed since the last call to the given map (keyed by object id).
+ * Returns false if there were changes that could not be attributed to an object, like a simple
+ * undo action or a change to a list that isn't owned by an object.
+ */
+bool UndoManager::take_changed_objects(std::map<std::string, ObjectRef> &objects)
+{
+  lock();
+  bool complete= !_untracked_changes;
+  objects.insert(_changed_objects.begin(), _changed_objects.end());
+  _changed_objects.clear();
+  _untracked_changes= false;
+  unlock();
+
+  return complete;
+}
+
+
+/**
+ * Returns true if anything changed since change tracking was enabled or the changes were last taken,
+ * whether it could be tracked or not (changes made without undo tracking can't be).
+ */
+bool UndoManager::has_changes_to_take() const
+{
+  lock();
+  bool changed= _track_changes && (_untracked_changes || !_changed_objects.empty());
+  unlock();
+
+  return changed;
+}
+
+
+/**
+ * Called for changes to global values that are made while the GRT doesn't track changes for undo,
+ * so that users of take_changed_objects() know they must store everything.
+ */
+void UndoManager::note_untracked_change()
+{
+  if (!_track_changes || _untracked_changes)
+    return;
+
+  lock();
+  if (_track_changes)
+    _untracked_changes= true;
+  unlock();
+}
+
+
 bool UndoManager::empty() const
 {
   return _undo_stack.empty() && _redo_stack.empty();
@@ -1046,6 +1153,18 @@ void UndoManager::redo()
 
 void UndoManager::add_undo(UndoAction *cmd)
 {
+  if (_track_changes && !dynamic_cast<UndoGroup*>(cmd))
+  {
+    ObjectRef object(cmd->changed_object());
+
+    lock();
+    if (object.is_valid())
+      _changed_objects[object->id()]= object;
+    else
+      _untracked_changes= true;
+    unlock();
+  }
+
   if (_blocks > 0)
   {
     delete cmd;
@@ -24,6 +24,7 @@
 #include "grtpp.h"
 
 #include <deque>
+#include <map>
 #include <boost/signals2.hpp>
 #include <ostream>
 
@@ -43,6 +44,9 @@ public:
   virtual void undo(UndoManager *owner)= 0;
   virtual std::string description() const { return _description; }
 
+  // the object whose contents are modified by the action, if it can be determined
+  virtual ObjectRef changed_object() const { return ObjectRef(); }
+
   virtual void dump(std::ostream &out, int indent=0) const= 0;
 };
 
@@ -81,6 +85,8 @@ public:
   const ObjectRef &get_object() const { return _object; }
   const std::string &get_member() const { return _member; }
 
+  virtual ObjectRef changed_object() const { return _object; }
+
   virtual void dump(std::ostream &out, int indent=0) const;
 };
 
@@ -95,6 +101,7 @@ public:
   UndoListInsertAction(const BaseListRef &list, size_t index= BaseListRef::npos);
 
   virtual void undo(UndoManager *owner);
+  virtual ObjectRef changed_object() const;
 
   virtual void dump(std::ostream &out, int indent=0) const;
 };
@@ -110,6 +117,7 @@ public:
   UndoListSetAction(const BaseListRef &list, size_t index);
 
   virtual void undo(UndoManager *owner);
+  virtual ObjectRef changed_object() const;
   
   virtual void dump(std::ostream &out, int indent=0) const;
 };
@@ -125,6 +133,7 @@ public:
   UndoListReorderAction(const BaseListRef &list, size_t oindex, size_t nindex);
 
   virtual void undo(UndoManager *owner);
+  virtual ObjectRef changed_object() const;
   virtual void dump(std::ostream &out, int indent=0) const;
 };
 
@@ -140,6 +149,7 @@ public:
   UndoListRemoveAction(const BaseListRef &list, size_t index);
 
   virtual void undo(UndoManager *owner);
+  virtual ObjectRef changed_object() const;
   virtual void dump(std::ostream &out, int indent=0) const;
 };
 
@@ -156,6 +166,7 @@ public:
   UndoDictSetAction(const DictRef &dict, const std::string &key);
 
   virtual void undo(UndoManager *owner);
+  virtual ObjectRef changed_object() const;
   virtual void dump(std::ostream &out, int indent=0) const;
 };
 
@@ -171,6 +182,7 @@ public:
   UndoDictRemoveAction(const DictRef &dict, const std::string &key);
 
   virtual void undo(UndoManager *owner);
+  virtual ObjectRef changed_object() const;
   virtual void dump(std::ostream &out, int indent=0) const;
 };
   
@@ -237,6 +249,13 @@ public:
   void reset();
   bool empty() const;
 
+  // collect the objects changed by new undo actions, so that only these have to be stored again
+  void set_change_tracking(bool flag);
+  bool is_tracking_changes() const { return _track_changes; }
+  bool take_changed_objects(std::map<std::string, ObjectRef> &objects);
+  bool has_changes_to_take() const;
+  void note_untracked_change();
+
   bool is_undoing() const { return _is_undoing; }
   bool is_redoing() const { return _is_redoing; }
 
@@ -287,6 +306,10 @@ protected:
   bool _is_undoing;
   bool _is_redoing;
 
+  bool _track_changes;
+  bool _untracked_changes;
+  std::map<std::string, ObjectRef> _changed_objects;
+
   UndoSignal _undo_signal;
   RedoSignal _redo_signal;
   boost::signals2::signal<void ()> _changed_signal;
@@ -25,6 +25,8 @@
 #include "grtpp_undo_manager.h"
 
 #include <glib.h>
+#include <boost/unordered_set.hpp>
+#include <boost/functional/hash.hpp>
 
 #ifdef GRT_LEAK_DETECTOR_ENABLED
 #include <iostream>
@@ -87,6 +89,268 @@ ClassRegistry *ClassRegistry::get_instance()
 }
 
 
+//--------------------------------------------------------------------------------------------------
+
+// Longer strings are rarely repeated (comments, SQL code etc.), they are not worth hashing.
+#define MAX_SHARED_STRING_LENGTH 64
+
+#define VALUE_ARENA_BLOCK_OBJECTS 1024
+
+ValueArena::ValueArena(size_t object_size)
+: _free_list(NULL), _live_objects(0)
+{
+  // Keep the slots pointer aligned, they hold the free list link while unused.
+  _object_size = ((std::max(object_size, sizeof(FreeSlot)) + sizeof(void*) - 1) / sizeof(void*)) * sizeof(void*);
+  _block_size = _object_size * VALUE_ARENA_BLOCK_OBJECTS;
+}
+
+
+void *ValueArena::allocate(size_t size)
+{
+  // Derived classes can be bigger than the class the arena was made for.
+  if (size > _object_size)
+    return ::operator new(size);
+
+  MutexLock lock(_mutex);
+  if (_free_list == NULL)
+  {
+    char *block = (char*)::operator new(_block_size);
+    _blocks.push_back(block);
+    for (size_t i = VALUE_ARENA_BLOCK_OBJECTS; i > 0; --i)
+    {
+      FreeSlot *slot = (FreeSlot*)(block + (i - 1) * _object_size);
+      slot->next = _free_list;
+      _free_list = slot;
+    }
+  }
+
+  FreeSlot *slot = _free_list;
+  _free_list = slot->next;
+  _live_objects++;
+  return slot;
+}
+
+
+void ValueArena::deallocate(void *ptr, size_t size)
+{
+  if (ptr == NULL)
+    return;
+
+  if (size > _object_size)
+  {
+    ::operator delete(ptr);
+    return;
+  }
+
+  MutexLock lock(_mutex);
+  FreeSlot *slot = (FreeSlot*)ptr;
+  slot->next = _free_list;
+  _free_list = slot;
+  _live_objects--;
+}
+
+// The arenas are never destroyed, values can still be released by static destructors at exit.
+static ValueArena &integer_arena()
+{
+  static ValueArena *arena = new ValueArena(sizeof(Integer));
+  return *arena;
+}
+
+static ValueArena &double_arena()
+{
+  static ValueArena *arena = new ValueArena(sizeof(Double));
+  return *arena;
+}
+
+static ValueArena &string_arena()
+{
+  static ValueArena *arena = new ValueArena(sizeof(String));
+  return *arena;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+namespace grt {
+  namespace internal {
+
+    /**
+     * Pool of the short String instances currently alive, so that values repeated all over a model
+     * (data types, charsets, flags, default values and the like) are kept once. The pool doesn't own
+     * its entries, a String removes itself when its last reference goes away.
+     *
+     * Hits are looked up without locking in a table of recently used instances. An entry there may
+     * be stale, so it is only used after taking a reference succeeded and the contents were checked.
+     * That is safe because String instances live in an arena whose memory is never released, so a
+     * stale entry still points to a String slot. Misses and removals lock one of several shards.
+     */
+    class StringPool
+    {
+    public:
+      StringPool() : _fast_hits(0)
+      {
+        for (size_t i = 0; i < RECENT_STRINGS; i++)
+          _recent[i] = NULL;
+      }
+
+      // Returns a retained instance holding the given value.
+      String *get(const std::string &value)
+      {
+        size_t hash = boost::hash<std::string>()(value);
+        volatile gpointer *recent = &_recent[hash % RECENT_STRINGS];
+
+        String *string = (String*)g_atomic_pointer_get(recent);
+        if (string != NULL && string->retain_if_referenced())
+        {
+          if (string->_interned && string->_value == value)
+          {
+            g_atomic_int_inc(&_fast_hits);
+            return string;
+          }
+          string->release();
+        }
+
+        Shard &shard = _shards[hash % POOL_SHARDS];
+        MutexLock lock(shard.mutex);
+
+        Strings::iterator iter = shard.strings.find(value, Hash(), Equal());
+        if (iter != shard.strings.end())
+        {
+          // A string whose last reference was released concurrently can't be revived, it is replaced.
+          if ((*iter)->retain_if_referenced())
+          {
+            shard.hits++;
+            g_atomic_pointer_set(recent, *iter);
+            return *iter;
+          }
+          shard.strings.erase(iter);
+        }
+
+        string = new String(value);
+        string->_interned = true;
+        string->retain();
+        shard.strings.insert(string);
+        g_atomic_pointer_set(recent, string);
+        return string;
+      }
+
+      void remove(String *string)
+      {
+        Shard &shard = _shards[Hash()(string) % POOL_SHARDS];
+        MutexLock lock(shard.mutex);
+
+        Strings::iterator iter = shard.strings.find(string->_value, Hash(), Equal());
+        if (iter != shard.strings.end() && *iter == string)
+          shard.strings.erase(iter);
+      }
+
+      void get_stats(ValueMemoryStats &stats)
+      {
+        stats.intern_hits = g_atomic_int_get(&_fast_hits);
+        for (size_t i = 0; i < POOL_SHARDS; i++)
+        {
+          MutexLock lock(_shards[i].mutex);
+
+          stats.interned_strings += _shards[i].strings.size();
+          stats.intern_hits += _shards[i].hits;
+          for (Strings::const_iterator iter = _shards[i].strings.begin(); iter != _shards[i].strings.end(); ++iter)
+          {
+            size_t size = instance_size((*iter)->_value);
+            base::refcount_t references = (*iter)->refcount();
+
+            stats.interned_bytes += size;
+            if (references > 1)
+            {
+              stats.shared_references += references - 1;
+              stats.bytes_saved += (references - 1) * size;
+            }
+          }
+        }
+      }
+
+    private:
+      struct Hash
+      {
+        size_t operator()(const std::string &value) const { return boost::hash<std::string>()(value); }
+        size_t operator()(const String *string) const { return boost::hash<std::string>()(string->_value); }
+      };
+
+      struct Equal
+      {
+        bool operator()(const String *a, const String *b) const { return a->_value == b->_value; }
+        bool operator()(const std::string &a, const String *b) const { return a == b->_value; }
+        bool operator()(const String *a, const std::string &b) const { return a->_value == b; }
+      };
+
+      typedef boost::unordered_set<String*, Hash, Equal> Strings;
+
+      struct Shard
+      {
+        base::Mutex mutex;
+        Strings strings;
+        size_t hits;
+
+        Shard() : hits(0) {}
+      };
+
+      // Estimate of the memory taken by a separate String instance holding the given value.
+      static size_t instance_size(const std::string &value)
+      {
+        size_t size = sizeof(String);
+        if (value.capacity() >= sizeof(std::string)) // not stored inline
+          size += value.capacity() + 1;
+        return size;
+      }
+
+      enum { RECENT_STRINGS = 4096, POOL_SHARDS = 16 };
+
+      volatile gpointer _recent[RECENT_STRINGS];
+      Shard _shards[POOL_SHARDS];
+      volatile gint _fast_hits;
+    };
+  }
+}
+
+static StringPool &string_pool()
+{
+  // Never destroyed for the same reason as the arenas.
+  static StringPool *pool = new StringPool();
+  return *pool;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ValueMemoryStats::ValueMemoryStats()
+: interned_strings(0), interned_bytes(0), intern_hits(0), shared_references(0), bytes_saved(0),
+  arena_objects(0), arena_bytes(0)
+{
+}
+
+
+std::string ValueMemoryStats::description() const
+{
+  return strfmt("%lu interned strings using %lu KB, %lu pool hits, %lu shared references saving about %lu KB; "
+                "%lu simple values in %lu KB of arena memory",
+                (unsigned long)interned_strings, (unsigned long)(interned_bytes / 1024), (unsigned long)intern_hits,
+                (unsigned long)shared_references, (unsigned long)(bytes_saved / 1024),
+                (unsigned long)arena_objects, (unsigned long)(arena_bytes / 1024));
+}
+
+
+ValueMemoryStats grt::get_value_memory_stats()
+{
+  ValueMemoryStats stats;
+
+  string_pool().get_stats(stats);
+
+  ValueArena *arenas[] = { &integer_arena(), &double_arena(), &string_arena() };
+  for (size_t i = 0; i < sizeof(arenas) / sizeof(arenas[0]); ++i)
+  {
+    stats.arena_objects += arenas[i]->live_objects();
+    stats.arena_bytes += arenas[i]->reserved_bytes();
+  }
+  return stats;
+}
+
 //--------------------------------------------------------------------------------------------------
 
 std::string Integer::debugDescription(const std::string &indentation) const
@@ -106,6 +370,18 @@ Integer::Integer(storage_type value)
 }
 
 
+void *Integer::operator new(size_t size)
+{
+  return integer_arena().allocate(size);
+}
+
+
+void Integer::operator delete(void *ptr, size_t size)
+{
+  integer_arena().deallocate(ptr, size);
+}
+
+
 Integer* Integer::get(storage_type value)
 {
   static Integer* one= (Integer*)((new Integer(1))->retain());
@@ -150,6 +426,18 @@ Double::Double(storage_type value)
 }
 
 
+void *Double::operator new(size_t size)
+{
+  return double_arena().allocate(size);
+}
+
+
+void Double::operator delete(void *ptr, size_t size)
+{
+  double_arena().deallocate(ptr, size);
+}
+
+
 Double* Double::get(storage_type value)
 {
   static Double* one= (Double*)((new Double(1.0))->retain());
@@ -186,8 +474,27 @@ std::string String::toString() const
 }
 
 String::String(const storage_type &value)
-: _value(value)
+: _value(value), _interned(false)
+{
+}
+
+
+String::~String()
+{
+  if (_interned)
+    string_pool().remove(this);
+}
+
+
+void *String::operator new(size_t size)
+{
+  return string_arena().allocate(size);
+}
+
+
+void String::operator delete(void *ptr, size_t size)
 {
+  string_arena().deallocate(ptr, size);
 }
 
 
@@ -201,6 +508,19 @@ String* String::get(const storage_type &value)
 }
 
 
+/**
+ * Returns an already retained String for the value, short values share the instance with all
+ * other strings of the same contents that are currently alive.
+ */
+String* String::get_shared(const storage_type &value)
+{
+  if (!value.empty() && value.size() <= MAX_SHARED_STRING_LENGTH)
+    return string_pool().get(value);
+
+  return (String*)get(value)->retain();
+}
+
+
 bool String::equals(const Value *o) const
 {
   return _value == dynamic_cast<const String*>(o)->_value;
@@ -244,15 +564,18 @@ std::string List::toString() const
   return s;
 }
 
+// Object lists with less items are simply scanned, that's as fast as a lookup.
+#define LIST_INDEX_MIN_ITEMS 32
+
 List::List(GRT *grt, bool allow_null)
-: _grt(grt), _allow_null(allow_null)
+: _grt(grt), _allow_null(allow_null), _index_valid(0), _index_disabled(false)
 {
   _is_global= 0;
 }
 
 
 List::List(GRT *grt, Type content_type, const std::string &content_class, bool allow_null)
-  : _grt(grt), _allow_null(allow_null)
+  : _grt(grt), _allow_null(allow_null), _index_valid(0), _index_disabled(false)
 {
   _content_type.type= content_type;
   _content_type.object_class= content_class;
@@ -279,6 +602,8 @@ void List::set_unchecked(size_t index, const ValueRef &value)
   {
     if (_is_global > 0 && _grt->tracking_changes())
       _grt->get_undo_manager()->add_undo(new UndoListSetAction(this, index));
+    else if (_is_global > 0)
+      _grt->get_undo_manager()->note_untracked_change();
 
     if (_is_global > 0 && _content[index].is_valid())
     {
@@ -290,6 +615,7 @@ void List::set_unchecked(size_t index, const ValueRef &value)
       value.mark_global();
     }
 
+    invalidate_index(index);
     _content[index]= value;
   }
 }
@@ -304,6 +630,8 @@ void List::insert_unchecked(const ValueRef &value, size_t index)
   {
     if (_is_global > 0 && _grt->tracking_changes())
       _grt->get_undo_manager()->add_undo(new UndoListInsertAction(this, index));
+    else if (_is_global > 0)
+      _grt->get_undo_manager()->note_untracked_change();
 
     _content.push_back(value);
   }
@@ -313,7 +641,10 @@ void List::insert_unchecked(const ValueRef &value, size_t index)
   {
     if (_is_global > 0 && _grt->tracking_changes())
       _grt->get_undo_manager()->add_undo(new UndoListInsertAction(this, index));
+    else if (_is_global > 0)
+      _grt->get_undo_manager()->note_untracked_change();
 
+    invalidate_index(index);
     _content.insert(_content.begin()+index, value);
   }
 }
@@ -321,6 +652,15 @@ void List::insert_unchecked(const ValueRef &value, size_t index)
 
 void List::remove(const ValueRef &value)
 {
+  // Indexed lists have no duplicates, so there is at most one item to remove.
+  if (update_index())
+  {
+    size_t i= get_index(value);
+    if (i != npos)
+      List::remove(i);
+    return;
+  }
+
   size_t i= _content.size();
   while (i-- > 0)
   {
@@ -331,7 +671,10 @@ void List::remove(const ValueRef &value)
 
       if (_is_global > 0 && _grt->tracking_changes())
         _grt->get_undo_manager()->add_undo(new UndoListRemoveAction(this, i));
+      else if (_is_global > 0)
+        _grt->get_undo_manager()->note_untracked_change();
 
+      invalidate_index(i);
       _content.erase(_content.begin()+i);
     }
   }
@@ -347,7 +690,10 @@ void List::remove(size_t index)
 
   if (_is_global > 0 && _grt->tracking_changes())
     _grt->get_undo_manager()->add_undo(new UndoListRemoveAction(this, index));
+  else if (_is_global > 0)
+    _grt->get_undo_manager()->note_untracked_change();
 
+  invalidate_index(index);
   _content.erase(_content.begin()+index);
 }
 
@@ -358,6 +704,10 @@ void List::reorder(size_t oi, size_t ni)
 
   if (_is_global > 0 && _grt->tracking_changes())
     _grt->get_undo_manager()->add_undo(new UndoListReorderAction(this, oi, ni));
+  else if (_is_global > 0)
+    _grt->get_undo_manager()->note_untracked_change();
+
+  invalidate_index(std::min(oi, ni));
 
   ValueRef tmp(_content[oi]);
   _content.erase(_content.begin() + oi);
@@ -369,6 +719,15 @@ void List::reorder(size_t oi, size_t ni)
 
 size_t List::get_index(const ValueRef &value)
 {
+  if (update_index())
+  {
+    // Entries of removed items can be left behind, the position is only good if the item is still there.
+    boost::unordered_map<const Value*, size_t>::const_iterator iter= _index.find(value.valueptr());
+    if (iter != _index.end() && iter->second < _content.size() && _content[iter->second].valueptr() == value.valueptr())
+      return iter->second;
+    return npos;
+  }
+
   size_t i= 0;
   for (std::vector<ValueRef>::const_iterator iter= _content.begin();
        iter != _content.end(); ++iter, ++i)
@@ -380,6 +739,69 @@ size_t List::get_index(const ValueRef &value)
 }
 
 
+/**
+ * Called before the item at the given position is changed, removed or something is inserted there.
+ * Entries of the index from that position on are refreshed on the next lookup.
+ */
+void List::invalidate_index(size_t index)
+{
+  if (index < _index_valid)
+  {
+    // Items can only be found at their indexed position, so the entry of the changed one must go now.
+    boost::unordered_map<const Value*, size_t>::iterator iter= _index.find(_content[index].valueptr());
+    if (iter != _index.end() && iter->second == index)
+      _index.erase(iter);
+    _index_valid= index;
+  }
+}
+
+
+/**
+ * Brings the index of object lists up to date. Returns false if the list is not indexed and
+ * has to be scanned.
+ */
+bool List::update_index()
+{
+  if (_content_type.type != ObjectType || _index_disabled)
+    return false;
+
+  if (_content.size() < LIST_INDEX_MIN_ITEMS)
+  {
+    if (!_index.empty())
+    {
+      boost::unordered_map<const Value*, size_t> tmp;
+      _index.swap(tmp);
+    }
+    _index_valid= 0;
+    return false;
+  }
+
+  for (; _index_valid < _content.size(); ++_index_valid)
+  {
+    const Value *value= _content[_index_valid].valueptr();
+    std::pair<boost::unordered_map<const Value*, size_t>::iterator, bool> result=
+      _index.insert(std::make_pair(value, _index_valid));
+
+    if (!result.second)
+    {
+      size_t other= result.first->second;
+      if (other < _index_valid && _content[other].valueptr() == value)
+      {
+        // Lookups have to return the first occurrence of a value, that's left to the scan.
+        boost::unordered_map<const Value*, size_t> tmp;
+        _index.swap(tmp);
+        _index_valid= 0;
+        _index_disabled= true;
+        return false;
+      }
+      result.first->second= _index_valid; // stale entry of a value that was moved or removed
+    }
+  }
+
+  return true;
+}
+
+
 bool List::check_assignable(const ValueRef &value) const
 {
   if (value.is_valid())
@@ -563,6 +985,152 @@ void OwnedList::remove(size_t index)
 
 //--------------------------------------------------------------------------------------------------
 
+// Dicts with up to this many entries are scanned instead of hashed (most dicts are small).
+#define DICT_HASH_MIN_ENTRIES 8
+
+DictStorage::DictStorage()
+: _count(0), _generation(0)
+{
+}
+
+
+DictStorage::~DictStorage()
+{
+}
+
+
+DictStorage::const_iterator DictStorage::find(const std::string &key) const
+{
+  size_t entry = find_entry(key);
+  return const_iterator(this, entry == (size_t)-1 ? _entries.size() : entry);
+}
+
+
+size_t DictStorage::find_entry(const std::string &key) const
+{
+  if (_slots.empty())
+  {
+    for (size_t i = 0; i < _entries.size(); ++i)
+    {
+      if (!_removed[i] && _entries[i].first == key)
+        return i;
+    }
+    return (size_t)-1;
+  }
+
+  // The table is never more than half full, so the probing always ends at a free slot.
+  size_t mask = _slots.size() - 1;
+  for (size_t slot = boost::hash<std::string>()(key) & mask; ; slot = (slot + 1) & mask)
+  {
+    if (_slots[slot] == 0)
+      return (size_t)-1;
+
+    size_t entry = _slots[slot] - 1;
+    if (!_removed[entry] && _entries[entry].first == key)
+      return entry;
+  }
+}
+
+
+void DictStorage::set(const std::string &key, const ValueRef &value)
+{
+  size_t entry = find_entry(key);
+  if (entry != (size_t)-1)
+  {
+    _entries[entry].second = value;
+    return;
+  }
+
+  // Slots of removed entries stay in use until the next rehash.
+  if (_entries.size() + 1 > DICT_HASH_MIN_ENTRIES && (_entries.size() + 1) * 2 > _slots.size())
+    rehash();
+
+  _entries.push_back(value_type(key, value));
+  _removed.push_back(false);
+  _count++;
+
+  if (!_slots.empty())
+  {
+    size_t mask = _slots.size() - 1;
+    size_t slot = boost::hash<std::string>()(key) & mask;
+    while (_slots[slot] != 0)
+      slot = (slot + 1) & mask;
+    _slots[slot] = _entries.size();
+  }
+}
+
+
+void DictStorage::erase(const_iterator iter)
+{
+  if (iter._storage != this)
+    return;
+  iter.check_valid();
+  if (iter._index >= _entries.size() || _removed[iter._index])
+    return;
+
+  // Free the memory of the entry, the entry itself goes away in the next rehash.
+  _removed[iter._index] = true;
+  _entries[iter._index].first.clear();
+  _entries[iter._index].second.clear();
+  _count--;
+}
+
+
+void DictStorage::clear()
+{
+  std::vector<value_type>().swap(_entries);
+  std::vector<bool>().swap(_removed);
+  std::vector<size_t>().swap(_slots);
+  _count = 0;
+  _generation++;
+}
+
+
+/**
+ * Drops removed entries and rebuilds the hash table for one more entry than there is now.
+ */
+void DictStorage::rehash()
+{
+  if (_count < _entries.size())
+  {
+    size_t used = 0;
+    for (size_t i = 0; i < _entries.size(); ++i)
+    {
+      if (_removed[i])
+        continue;
+      if (used != i)
+      {
+        _entries[used].first.swap(_entries[i].first);
+        _entries[used].second = _entries[i].second;
+      }
+      ++used;
+    }
+    _entries.resize(used);
+    _removed.assign(used, false);
+    _generation++;
+  }
+
+  std::vector<size_t>().swap(_slots);
+  if (_entries.size() + 1 <= DICT_HASH_MIN_ENTRIES)
+    return;
+
+  size_t size = 16;
+  while (size < (_entries.size() + 1) * 2)
+    size *= 2;
+  _slots.resize(size, 0);
+
+  size_t mask = size - 1;
+  for (size_t i = 0; i < _entries.size(); ++i)
+  {
+    size_t slot = boost::hash<std::string>()(_entries[i].first) & mask;
+    while (_slots[slot] != 0)
+      slot = (slot + 1) & mask;
+    _slots[slot] = i + 1;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
 std::string Dict::debugDescription(const std::string &indentation) const
 {
   std::string s;
@@ -660,12 +1228,14 @@ void Dict::set(const std::string &key, const ValueRef &value)
   if (!value.is_valid() && !_allow_null)
     throw std::invalid_argument("inserting null value to not null dict");
 
-  storage_type::iterator iter= _content.find(key);
+  storage_type::const_iterator iter= _content.find(key);
 
   if (_is_global > 0)
   {
     if (_grt->tracking_changes())
       _grt->get_undo_manager()->add_undo(new UndoDictSetAction(this, key));
+    else
+      _grt->get_undo_manager()->note_untracked_change();
 
     if (iter != _content.end() && iter->second.is_valid())
       iter->second.unmark_global();
@@ -674,19 +1244,21 @@ void Dict::set(const std::string &key, const ValueRef &value)
       value.mark_global();
   }
 
-  _content[key]= value;
+  _content.set(key, value);
 }
 
 
 void Dict::remove(const std::string &key)
 {
-  storage_type::iterator iter= _content.find(key);
+  storage_type::const_iterator iter= _content.find(key);
   if (iter != _content.end())
   {
     if (_is_global > 0)
     {
       if (_grt->tracking_changes())
         _grt->get_undo_manager()->add_undo(new UndoDictRemoveAction(this, key));
+      else
+        _grt->get_undo_manager()->note_untracked_change();
 
       if (iter->second.is_valid())
         iter->second.unmark_global();
@@ -757,7 +1329,7 @@ void Dict::unmark_global() const
 
 void Dict::reset_references()
 {
-  storage_type::iterator               it = _content.begin();
+  storage_type::const_iterator         it = _content.begin();
   const storage_type::const_iterator last = _content.end();
 
   for (; last != it; ++it )
@@ -1272,6 +1844,8 @@ void Object::owned_member_changed(const std::string &name, const grt::ValueRef &
     }
     if (get_grt()->tracking_changes())
       get_grt()->get_undo_manager()->add_undo(new UndoObjectChangeAction(this, name, ovalue));
+    else
+      get_grt()->get_undo_manager()->note_untracked_change();
   }
   _changed_signal(name, ovalue);
 }
@@ -1281,6 +1855,8 @@ void Object::member_changed(const std::string &name, const grt::ValueRef &ovalue
 {
   if (_is_global && get_grt()->tracking_changes())
     get_grt()->get_undo_manager()->add_undo(new UndoObjectChangeAction(this, name, ovalue));
+  else if (_is_global)
+    get_grt()->get_undo_manager()->note_untracked_change();
   _changed_signal(name, ovalue);
 }
 
@@ -28,6 +28,8 @@
 #endif
 
 #include <boost/signals2.hpp>
+#include <boost/unordered_map.hpp>
+#include <iterator>
 #include "base/threading.h"
 
 #if defined(ENABLE_DEBUG) || defined(_DEBUG)
@@ -43,6 +45,7 @@ namespace grt {
   {
     class Serializer;
     class Unserializer;
+    class StringPool;
   };
 
   //------------------------------------------------------------------------------------------------
@@ -139,9 +142,60 @@ namespace grt {
 
 #endif
 
+  //------------------------------------------------------------------------------------------------
+
+  /*!
+    \brief Memory used by simple values (integers, doubles and strings)
+    Short strings are interned, i.e. live values with the same contents share a single String
+    instance. All simple values are allocated from arenas instead of one heap block each.
+  */
+  struct MYSQLGRT_PUBLIC ValueMemoryStats
+  {
+    size_t interned_strings;      //!< Number of distinct values in the string pool.
+    size_t interned_bytes;        //!< Memory used by the pooled String instances.
+    size_t intern_hits;           //!< Number of string values served from the pool so far.
+    size_t shared_references;     //!< References to pooled strings that would otherwise be separate instances.
+    size_t bytes_saved;           //!< Estimate of the memory currently saved by sharing pooled strings.
+    size_t arena_objects;         //!< Simple values currently allocated from the arenas.
+    size_t arena_bytes;           //!< Memory reserved by the arenas.
+
+    ValueMemoryStats();
+    std::string description() const;
+  };
+
+  MYSQLGRT_PUBLIC ValueMemoryStats get_value_memory_stats();
+
+  //------------------------------------------------------------------------------------------------
+
   namespace internal {
     
     class Object;
+
+    /*!
+      Fixed size allocator for simple values. Objects are carved out of large blocks and freed
+      slots are reused, the blocks themselves are kept until the process ends.
+    */
+    class MYSQLGRT_PUBLIC ValueArena
+    {
+    public:
+      ValueArena(size_t object_size);
+
+      void *allocate(size_t size);
+      void deallocate(void *ptr, size_t size);
+
+      size_t live_objects() const { return _live_objects; }
+      size_t reserved_bytes() const { return _blocks.size() * _block_size; }
+
+    private:
+      struct FreeSlot { FreeSlot *next; };
+
+      base::Mutex _mutex;
+      std::vector<char*> _blocks;
+      FreeSlot *_free_list;
+      size_t _object_size;
+      size_t _block_size;
+      size_t _live_objects;
+    };
   
     class MYSQLGRT_PUBLIC Value
     {
@@ -185,6 +239,19 @@ namespace grt {
       Value() : _refcount(0) {}
       virtual ~Value() {}
 
+      // Takes a reference unless the last one is already gone (for caches not owning their values).
+      bool retain_if_referenced()
+      {
+        for (;;)
+        {
+          base::refcount_t count = g_atomic_int_get(&_refcount);
+          if (count == 0)
+            return false;
+          if (g_atomic_int_compare_and_exchange(&_refcount, count, count + 1))
+            return true;
+        }
+      }
+
     private:
       Value(const Value&) {}
 
@@ -201,6 +268,9 @@ namespace grt {
       Integer(storage_type value);
       static Integer* get(storage_type value);
 
+      static void *operator new(size_t size);
+      static void operator delete(void *ptr, size_t size);
+
       static Type static_type() { return IntegerType; }
       virtual Type get_type() const { return IntegerType; }
       virtual std::string debugDescription(const std::string &indentation = "") const;
@@ -227,6 +297,9 @@ namespace grt {
       Double(storage_type value);
       static Double* get(storage_type value);
 
+      static void *operator new(size_t size);
+      static void operator delete(void *ptr, size_t size);
+
       static Type static_type() { return DoubleType; }
       virtual Type get_type() const { return DoubleType; }
       virtual std::string debugDescription(const std::string &indentation = "") const;
@@ -251,7 +324,12 @@ namespace grt {
       
     public:
       String(const storage_type& value);
+      virtual ~String();
       static String* get(const storage_type& value);
+      static String* get_shared(const storage_type& value);
+
+      static void *operator new(size_t size);
+      static void operator delete(void *ptr, size_t size);
 
       static Type static_type() { return StringType; }
       virtual Type get_type() const { return StringType; }
@@ -267,7 +345,10 @@ namespace grt {
       virtual bool less_than(const Value *) const;
 
     protected:    
+      friend class StringPool;
+
       storage_type _value;
+      bool _interned;
     };
     
     //------------------------------------------------------------------------------------------------
@@ -351,6 +432,9 @@ namespace grt {
       
       virtual ~List();
 
+      void invalidate_index(size_t index);
+      bool update_index();
+
       GRT *_grt;
 
       storage_type _content;
@@ -358,6 +442,12 @@ namespace grt {
       bool _allow_null;
 
       mutable short _is_global;
+
+      // Position of the items of big object lists, to find them without scanning the list.
+      // Only positions below _index_valid are up to date, changes to the list lower that mark.
+      boost::unordered_map<const Value*, size_t> _index;
+      size_t _index_valid;
+      bool _index_disabled; // the list contains duplicates, get_index() has to find the first one
     };
 
     
@@ -381,12 +471,91 @@ namespace grt {
     
 
 
+    //------------------------------------------------------------------------------------------------
+
+    /*!
+      Entries of a Dict. They are kept in insertion order and found through an open addressing hash
+      table (linear probing) that holds their positions. Removed entries are only marked as such, so
+      removing an entry doesn't invalidate iterators. Adding a new key invalidates all iterators when
+      it makes the table grow, since that also drops the removed entries and moves the others, and so
+      does clear(). Using such an iterator throws std::logic_error instead of reading another entry.
+    */
+    class MYSQLGRT_PUBLIC DictStorage
+    {
+    public:
+      typedef std::pair<std::string, ValueRef> value_type;
+
+      class const_iterator
+      {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef DictStorage::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef const value_type &reference;
+
+        const_iterator() : _storage(NULL), _index(0), _generation(0) {}
+
+        inline reference operator*() const;  // defined in grtpp.h, once ValueRef is complete
+        inline pointer operator->() const;
+
+        const_iterator &operator++() { _index = _storage->next_entry(_index + 1); return *this; }
+        const_iterator operator++(int) { const_iterator tmp(*this); ++*this; return tmp; }
+
+        bool operator==(const const_iterator &other) const { return _index == other._index && _storage == other._storage; }
+        bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+      private:
+        friend class DictStorage;
+        const_iterator(const DictStorage *storage, size_t index)
+          : _storage(storage), _index(index), _generation(storage->_generation) {}
+
+        inline void check_valid() const;
+
+        const DictStorage *_storage;
+        size_t _index;
+        size_t _generation; // of the storage when the iterator was made
+      };
+      typedef const_iterator iterator;
+
+      DictStorage();
+      ~DictStorage();
+
+      const_iterator begin() const { return const_iterator(this, next_entry(0)); }
+      const_iterator end() const { return const_iterator(this, _removed.size()); }
+      const_iterator find(const std::string &key) const;
+
+      size_t size() const { return _count; }
+      bool empty() const { return _count == 0; }
+
+      void set(const std::string &key, const ValueRef &value);
+      void erase(const_iterator iter);
+      void clear();
+
+    private:
+      // _removed has an element for each entry, its size is used where _entries can't be used in the header.
+      size_t next_entry(size_t index) const
+      {
+        while (index < _removed.size() && _removed[index])
+          ++index;
+        return index;
+      }
+      size_t find_entry(const std::string &key) const;
+      void rehash();
+
+      std::vector<value_type> _entries;
+      std::vector<bool> _removed;
+      std::vector<size_t> _slots; // entry position + 1, 0 marks a free slot; empty for small dicts
+      size_t _count;
+      size_t _generation; // changes whenever entries are moved, which invalidates iterators
+    };
+
     //------------------------------------------------------------------------------------------------
     
     class MYSQLGRT_PUBLIC Dict : public Value
     {
     public:
-      typedef std::map<std::string, ValueRef> storage_type;
+      typedef DictStorage storage_type;
       typedef storage_type::const_iterator const_iterator;
       typedef storage_type::const_iterator iterator;
 
@@ -0,0 +1,926 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "snapshot_serializer.h"
+
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+
+#include "base/log.h"
+#include "base/string_utilities.h"
+#include "base/file_functions.h"
+
+DEFAULT_LOG_DOMAIN(DOMAIN_GRT)
+
+using namespace grt;
+using namespace grt::internal;
+
+#define SNAPSHOT_FORMAT_VERSION 1
+
+// magic(8) version(4) string_count(4) object_count(4) strings_size(8) objects_size(8) data_size(8)
+// doctype(4) docversion(4) source_digest(4)
+#define SNAPSHOT_HEADER_SIZE 56
+
+static const char snapshot_magic[8]= { 'G', 'R', 'T', 'S', 'N', 'A', 'P', '\0' };
+
+/**
+ * Each value in the data section starts with one of these tags.
+ */
+enum SnapshotTag
+{
+  SnapshotNull= 0,
+  SnapshotInteger,        // zigzag encoded varint
+  SnapshotDouble,         // 8 bytes
+  SnapshotString,         // string index
+  SnapshotList,           // container index, content type, content class, item count, items
+  SnapshotDict,           // container index, content type, content class, item count, key/value pairs
+  SnapshotObject,         // object index, (member name index + 1, value) pairs, 0
+  SnapshotObjectLink,     // id string index
+  SnapshotContainerLink   // container index
+};
+
+//--------------------------------------------------------------------------------------------------
+
+static void put_u32(std::string &out, uint32_t value)
+{
+  for (int i= 0; i < 4; i++)
+    out.push_back((char)((value >> (i * 8)) & 0xff));
+}
+
+
+static void put_u64(std::string &out, uint64_t value)
+{
+  for (int i= 0; i < 8; i++)
+    out.push_back((char)((value >> (i * 8)) & 0xff));
+}
+
+
+static void put_varint(std::string &out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back((char)((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back((char)value);
+}
+
+
+static uint32_t get_u32(const unsigned char *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static uint64_t get_u64(const unsigned char *p)
+{
+  return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+SnapshotSerializer::SnapshotSerializer(GRT *grt)
+  : _grt(grt), _object_count(0), _known_ids(NULL), _store_null_members(false)
+{
+  // index 0 is always the empty string
+  add_string("");
+}
+
+
+uint32_t SnapshotSerializer::add_string(const std::string &str)
+{
+  boost::unordered_map<std::string, uint32_t>::const_iterator iter= _string_index.find(str);
+  if (iter != _string_index.end())
+    return iter->second;
+
+  iter= _string_index.insert(std::make_pair(str, (uint32_t)_strings.size())).first;
+  _strings.push_back(&iter->first);
+  return iter->second;
+}
+
+
+/**
+ * Returns the header and the string table for the data written so far.
+ */
+std::string SnapshotSerializer::build_header(const std::string &doctype, const std::string &docversion,
+                                             const std::string &source_digest)
+{
+  uint32_t doctype_index= add_string(doctype);
+  uint32_t docversion_index= add_string(docversion);
+  uint32_t digest_index= add_string(source_digest);
+
+  uint64_t strings_size= (_strings.size() + 1) * 4;
+  for (std::vector<const std::string*>::const_iterator str= _strings.begin(); str != _strings.end(); ++str)
+    strings_size+= (*str)->size();
+
+  if (strings_size > 0xffffffffU)
+    throw std::runtime_error("Snapshot string table is too big");
+
+  std::string header;
+  header.reserve(SNAPSHOT_HEADER_SIZE + (size_t)strings_size);
+
+  header.append(snapshot_magic, sizeof(snapshot_magic));
+  put_u32(header, SNAPSHOT_FORMAT_VERSION);
+  put_u32(header, (uint32_t)_strings.size());
+  put_u32(header, _object_count);
+  put_u64(header, strings_size);
+  put_u64(header, _object_table.size());
+  put_u64(header, _data.size());
+  put_u32(header, doctype_index);
+  put_u32(header, docversion_index);
+  put_u32(header, digest_index);
+
+  uint32_t offset= 0;
+  for (std::vector<const std::string*>::const_iterator str= _strings.begin(); str != _strings.end(); ++str)
+  {
+    put_u32(header, offset);
+    offset+= (uint32_t)(*str)->size();
+  }
+  put_u32(header, offset);
+
+  for (std::vector<const std::string*>::const_iterator str= _strings.begin(); str != _strings.end(); ++str)
+    header.append(**str);
+
+  return header;
+}
+
+
+std::string SnapshotSerializer::serialize_to_data(const ValueRef &value, const std::string &doctype,
+                                                  const std::string &docversion, const std::string &source_digest)
+{
+  write_value(value, false);
+
+  std::string data= build_header(doctype, docversion, source_digest);
+  data.append(_object_table);
+  data.append(_data);
+
+  return data;
+}
+
+
+/**
+ * Serializes a list with the given objects. Objects in known_ids that are referenced from the
+ * changed ones are written as links, so a change record only contains the changed objects and the
+ * objects created since known_ids was collected. Null members are stored explicitly, so that
+ * members reset to null are also reset when the record is read back.
+ */
+std::string SnapshotSerializer::serialize_changes(const std::vector<ObjectRef> &objects,
+                                                  const boost::unordered_set<std::string> &known_ids,
+                                                  const std::string &source_digest)
+{
+  BaseListRef list(_grt, ObjectType);
+
+  for (std::vector<ObjectRef>::const_iterator object= objects.begin(); object != objects.end(); ++object)
+  {
+    _changed_objects.insert(object->valueptr());
+    list.ginsert(*object);
+  }
+
+  _known_ids= &known_ids;
+  _store_null_members= true;
+  write_value(list, false);
+  _known_ids= NULL;
+  _store_null_members= false;
+
+  std::string data= build_header("", "", source_digest);
+  data.append(_object_table);
+  data.append(_data);
+
+  return data;
+}
+
+
+void SnapshotSerializer::get_written_ids(boost::unordered_set<std::string> &ids) const
+{
+  for (std::vector<uint32_t>::const_iterator index= _written_ids.begin(); index != _written_ids.end(); ++index)
+    ids.insert(*_strings[*index]);
+}
+
+
+/**
+ * Stores a value to a snapshot file. The data is written to a temporary file first, so an
+ * existing snapshot is only replaced once the new one is complete.
+ */
+void SnapshotSerializer::save_to_file(const ValueRef &value, const std::string &path, const std::string &doctype,
+                                      const std::string &docversion, const std::string &source_digest)
+{
+  std::string tmp_path= path + ".tmp";
+
+  write_value(value, false);
+
+  std::string header= build_header(doctype, docversion, source_digest);
+
+  FILE *file= base_fopen(tmp_path.c_str(), "wb");
+  if (!file)
+    throw grt::os_error("Could not create snapshot file " + tmp_path, errno);
+
+  if (fwrite(header.data(), 1, header.size(), file) < header.size()
+      || fwrite(_object_table.data(), 1, _object_table.size(), file) < _object_table.size()
+      || fwrite(_data.data(), 1, _data.size(), file) < _data.size())
+  {
+    int err= errno;
+    fclose(file);
+    base_remove(tmp_path);
+    throw grt::os_error("Error writing snapshot file " + tmp_path, err);
+  }
+  fclose(file);
+
+  base_remove(path);
+  if (base_rename(tmp_path.c_str(), path.c_str()) < 0)
+    throw grt::os_error("Could not rename snapshot file to " + path, errno);
+}
+
+
+/**
+ * Encodes a value and its sub-values. Like the XML serializer, lists, dicts and objects are stored
+ * completely at their first reference and as links on further ones.
+ */
+void SnapshotSerializer::write_value(const ValueRef &value, bool list_objects_as_links)
+{
+  switch (value.type())
+  {
+    case IntegerType:
+    {
+      int64_t i= *IntegerRef::cast_from(value);
+      _data.push_back(SnapshotInteger);
+      put_varint(_data, ((uint64_t)i << 1) ^ (uint64_t)(i >> 63));
+      break;
+    }
+
+    case DoubleType:
+    {
+      double d= *DoubleRef::cast_from(value);
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      _data.push_back(SnapshotDouble);
+      put_u64(_data, bits);
+      break;
+    }
+
+    case StringType:
+      _data.push_back(SnapshotString);
+      put_varint(_data, add_string(**static_cast<internal::String*>(value.valueptr())));
+      break;
+
+    case ListType:
+    {
+      BaseListRef list(BaseListRef::cast_from(value));
+
+      boost::unordered_map<void*, uint32_t>::const_iterator seen= _containers.find(value.valueptr());
+      if (seen != _containers.end())
+      {
+        _data.push_back(SnapshotContainerLink);
+        put_varint(_data, seen->second);
+        break;
+      }
+      uint32_t index= (uint32_t)_containers.size();
+      _containers[value.valueptr()]= index;
+
+      _data.push_back(SnapshotList);
+      put_varint(_data, index);
+      _data.push_back((char)list.content_type());
+      put_varint(_data, add_string(list.content_class_name()));
+      put_varint(_data, list.count());
+
+      for (size_t c= list.count(), i= 0; i < c; i++)
+      {
+        ValueRef item(list.get(i));
+
+        if (!item.is_valid())
+          _data.push_back(SnapshotNull);
+        else if (list_objects_as_links && item.type() == ObjectType)
+        {
+          _data.push_back(SnapshotObjectLink);
+          put_varint(_data, add_string(ObjectRef::cast_from(item)->id()));
+        }
+        else
+          write_value(item, false);
+      }
+      break;
+    }
+
+    case DictType:
+    {
+      DictRef dict(DictRef::cast_from(value));
+
+      boost::unordered_map<void*, uint32_t>::const_iterator seen= _containers.find(value.valueptr());
+      if (seen != _containers.end())
+      {
+        _data.push_back(SnapshotContainerLink);
+        put_varint(_data, seen->second);
+        break;
+      }
+      uint32_t index= (uint32_t)_containers.size();
+      _containers[value.valueptr()]= index;
+
+      // null values are not stored, as in the XML format
+      size_t count= 0;
+      for (Dict::const_iterator iter= dict.begin(); iter != dict.end(); ++iter)
+        if (iter->second.is_valid())
+          count++;
+
+      _data.push_back(SnapshotDict);
+      put_varint(_data, index);
+      _data.push_back((char)dict.content_type());
+      put_varint(_data, add_string(dict.content_class_name()));
+      put_varint(_data, count);
+
+      for (Dict::const_iterator iter= dict.begin(); iter != dict.end(); ++iter)
+      {
+        if (iter->second.is_valid())
+        {
+          put_varint(_data, add_string(iter->first));
+          write_value(iter->second, false);
+        }
+      }
+      break;
+    }
+
+    case ObjectType:
+    {
+      ObjectRef object(ObjectRef::cast_from(value));
+
+      if (_objects.insert(value.valueptr()).second
+          && (!_known_ids || _changed_objects.find(value.valueptr()) != _changed_objects.end()
+              || _known_ids->find(object->id()) == _known_ids->end()))
+        write_object(object);
+      else
+      {
+        _data.push_back(SnapshotObjectLink);
+        put_varint(_data, add_string(object->id()));
+      }
+      break;
+    }
+
+    case UnknownType:
+      _data.push_back(SnapshotNull);
+      break;
+  }
+}
+
+
+void SnapshotSerializer::write_object(const ObjectRef &object)
+{
+  uint32_t id_index= add_string(object->id());
+
+  put_varint(_object_table, add_string(object->class_name()));
+  put_varint(_object_table, id_index);
+  _written_ids.push_back(id_index);
+
+  _data.push_back(SnapshotObject);
+  put_varint(_data, _object_count++);
+
+  object.get_metaclass()->foreach_member(boost::bind(&SnapshotSerializer::write_member, this, _1, object));
+
+  put_varint(_data, 0);
+}
+
+
+bool SnapshotSerializer::write_member(const MetaClass::Member *member, const ObjectRef &object)
+{
+  // don't serialize calculated values
+  if (member->calculated)
+    return true;
+
+  ValueRef value(object->get_member(member->name));
+  if (!value.is_valid())
+  {
+    if (_store_null_members)
+    {
+      put_varint(_data, add_string(member->name) + 1);
+      _data.push_back(SnapshotNull);
+    }
+    return true;
+  }
+
+  put_varint(_data, add_string(member->name) + 1);
+
+  // objects not owned by this one are stored as links, owned lists have their objects stored
+  if (!member->owned_object && value.type() == ObjectType)
+  {
+    _data.push_back(SnapshotObjectLink);
+    put_varint(_data, add_string(ObjectRef::cast_from(value)->id()));
+  }
+  else
+    write_value(value, !member->owned_object);
+
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+SnapshotUnserializer::SnapshotUnserializer(GRT *grt, bool keep_objects)
+  : _grt(grt), _keep_objects(keep_objects), _string_offsets(NULL), _string_data(NULL), _string_count(0), _strings_size(0),
+    _pos(NULL), _end(NULL)
+{
+}
+
+
+bool SnapshotUnserializer::read_header(const char *data, size_t size, Header &header)
+{
+  const unsigned char *p= (const unsigned char*)data;
+
+  if (!data || size < SNAPSHOT_HEADER_SIZE || memcmp(p, snapshot_magic, sizeof(snapshot_magic)) != 0)
+    return false;
+  p+= sizeof(snapshot_magic);
+
+  if (get_u32(p) != SNAPSHOT_FORMAT_VERSION)
+    return false;
+
+  header.string_count= get_u32(p + 4);
+  header.object_count= get_u32(p + 8);
+  header.strings_size= get_u64(p + 12);
+  header.objects_size= get_u64(p + 20);
+  header.data_size= get_u64(p + 28);
+  header.doctype= get_u32(p + 36);
+  header.docversion= get_u32(p + 40);
+  header.source_digest= get_u32(p + 44);
+
+  uint64_t available= size - SNAPSHOT_HEADER_SIZE;
+  if (header.strings_size > available || header.objects_size > available - header.strings_size
+      || header.data_size > available - header.strings_size - header.objects_size)
+    return false;
+
+  return ((uint64_t)header.string_count + 1) * 4 <= header.strings_size;
+}
+
+
+/**
+ * Reads the document type, version and source digest stored in a snapshot file.
+ */
+bool SnapshotUnserializer::get_file_metainfo(const std::string &path, std::string &doctype, std::string &docversion,
+                                             std::string &source_digest)
+{
+  char *local_filename;
+  if ((local_filename= g_filename_from_utf8(path.c_str(), -1, NULL, NULL, NULL)) == NULL)
+    return false;
+  GMappedFile *file= g_mapped_file_new(local_filename, FALSE, NULL);
+  g_free(local_filename);
+  if (!file)
+    return false;
+
+  bool found= false;
+  try
+  {
+    const char *data= g_mapped_file_get_contents(file);
+    Header header;
+    if (read_header(data, g_mapped_file_get_length(file), header))
+    {
+      SnapshotUnserializer unser(NULL);
+      unser.setup_strings(data + SNAPSHOT_HEADER_SIZE, header);
+      doctype= unser.get_string(header.doctype);
+      docversion= unser.get_string(header.docversion);
+      source_digest= unser.get_string(header.source_digest);
+      found= true;
+    }
+  }
+  catch (std::exception &)
+  {
+    found= false;
+  }
+  g_mapped_file_unref(file);
+
+  return found;
+}
+
+
+ValueRef SnapshotUnserializer::load_from_file(const std::string &path, std::string *doctype, std::string *docversion)
+{
+  _source_name= path;
+
+  char *local_filename;
+  if ((local_filename= g_filename_from_utf8(path.c_str(), -1, NULL, NULL, NULL)) == NULL)
+    throw std::runtime_error("can't open snapshot file " + path);
+
+  GError *error= NULL;
+  GMappedFile *file= g_mapped_file_new(local_filename, FALSE, &error);
+  g_free(local_filename);
+  if (!file)
+  {
+    std::string message= error ? error->message : "unknown error";
+    if (error)
+      g_error_free(error);
+    throw std::runtime_error("can't open snapshot file " + path + ": " + message);
+  }
+
+  ValueRef value;
+  try
+  {
+    value= unserialize_data(g_mapped_file_get_contents(file), g_mapped_file_get_length(file), doctype, docversion);
+  }
+  catch (...)
+  {
+    g_mapped_file_unref(file);
+    throw;
+  }
+  g_mapped_file_unref(file);
+
+  return value;
+}
+
+
+ValueRef SnapshotUnserializer::unserialize_data(const char *data, size_t size, std::string *doctype,
+                                                std::string *docversion)
+{
+  Header header;
+
+  if (!read_header(data, size, header))
+    throw std::runtime_error("Invalid or unsupported snapshot data");
+
+  setup_strings(data + SNAPSHOT_HEADER_SIZE, header);
+
+  if (doctype && docversion)
+  {
+    *doctype= get_string(header.doctype);
+    *docversion= get_string(header.docversion);
+  }
+
+  _pos= (const unsigned char*)data + SNAPSHOT_HEADER_SIZE + header.strings_size;
+  _end= _pos + header.objects_size;
+  create_objects(header);
+
+  _end= _pos + header.data_size;
+
+  ValueRef value;
+  try
+  {
+    value= read_value(ValueRef());
+  }
+  catch (...)
+  {
+    _containers.clear();
+    _objects.clear();
+    _invalid_ids.clear();
+    if (!_keep_objects)
+      _object_ids.clear();
+    throw;
+  }
+  _containers.clear();
+  _objects.clear();
+  _invalid_ids.clear();
+  if (!_keep_objects)
+    _object_ids.clear();
+
+  return value;
+}
+
+
+void SnapshotUnserializer::setup_strings(const char *data, const Header &header)
+{
+  _string_count= header.string_count;
+  _string_offsets= (const unsigned char*)data;
+  _string_data= data + ((uint64_t)header.string_count + 1) * 4;
+  _strings_size= header.strings_size - ((uint64_t)header.string_count + 1) * 4;
+}
+
+
+std::string SnapshotUnserializer::get_string(uint32_t index)
+{
+  if (index >= _string_count)
+    throw std::runtime_error("Invalid string reference in snapshot data");
+
+  uint32_t offset= get_u32(_string_offsets + index * 4);
+  uint32_t next= get_u32(_string_offsets + index * 4 + 4);
+  if (next < offset || next > _strings_size)
+    throw std::runtime_error("Invalid string table in snapshot data");
+
+  return std::string(_string_data + offset, next - offset);
+}
+
+
+uint8_t SnapshotUnserializer::read_byte()
+{
+  if (_pos >= _end)
+    throw std::runtime_error("Unexpected end of snapshot data");
+  return *_pos++;
+}
+
+
+uint64_t SnapshotUnserializer::read_varint()
+{
+  uint64_t value= 0;
+  for (int shift= 0; shift < 64; shift+= 7)
+  {
+    uint8_t byte= read_byte();
+    value|= (uint64_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return value;
+  }
+  throw std::runtime_error("Invalid number in snapshot data");
+}
+
+
+uint32_t SnapshotUnserializer::read_string_index()
+{
+  uint64_t index= read_varint();
+  if (index >= _string_count)
+    throw std::runtime_error("Invalid string reference in snapshot data");
+  return (uint32_t)index;
+}
+
+
+/**
+ * Creates all objects listed in the object table, so that links to them can be resolved no matter
+ * where in the data they appear.
+ */
+void SnapshotUnserializer::create_objects(const Header &header)
+{
+  boost::unordered_map<uint32_t, MetaClass*> classes;
+
+  _objects.reserve(header.object_count);
+  for (uint32_t i= 0; i < header.object_count; i++)
+  {
+    uint32_t class_index= read_string_index();
+    uint32_t id_index= read_string_index();
+
+    MetaClass *mc;
+    boost::unordered_map<uint32_t, MetaClass*>::const_iterator iter= classes.find(class_index);
+    if (iter != classes.end())
+      mc= iter->second;
+    else
+    {
+      std::string class_name= get_string(class_index);
+      mc= _grt->get_metaclass(class_name);
+      if (!mc)
+      {
+        log_warning("%s: error unserializing object: struct '%s' unknown", _source_name.c_str(), class_name.c_str());
+        throw std::runtime_error(base::strfmt("error unserializing object (struct '%s' unknown)", class_name.c_str()));
+      }
+      classes[class_index]= mc;
+    }
+
+    std::string id= get_string(id_index);
+    if (id.empty())
+      throw std::runtime_error("missing id in unserialized object");
+
+    if (_keep_objects)
+    {
+      boost::unordered_map<std::string, ObjectRef>::const_iterator existing= _object_ids.find(id);
+      if (existing != _object_ids.end() && existing->second->get_metaclass() == mc)
+      {
+        _objects.push_back(existing->second);
+        continue;
+      }
+    }
+
+    ObjectRef object(mc->allocate());
+    object->__set_id(id);
+
+    _objects.push_back(object);
+    _object_ids[id]= object;
+  }
+}
+
+
+/**
+ * Links to objects that are not part of the snapshot are looked up in the global tree, like the XML
+ * unserializer does.
+ */
+ObjectRef SnapshotUnserializer::resolve_object_link(const std::string &id)
+{
+  boost::unordered_map<std::string, ObjectRef>::const_iterator iter= _object_ids.find(id);
+  if (iter != _object_ids.end())
+    return iter->second;
+
+  if (_invalid_ids.find(id) != _invalid_ids.end())
+    return ObjectRef();
+
+  ObjectRef object(_grt->find_object_by_id(id, "/"));
+  if (object.is_valid())
+    _object_ids[id]= object;
+  else
+  {
+    _invalid_ids.insert(id);
+    log_warning("%s: link '%s' could not be resolved\n", _source_name.c_str(), id.c_str());
+  }
+  return object;
+}
+
+
+void SnapshotUnserializer::register_container(uint32_t index, const ValueRef &value)
+{
+  if (index >= _containers.size())
+    _containers.resize(index + 1);
+  _containers[index]= value;
+}
+
+
+/**
+ * Reads the next value. If the value is a list or dict, it is read into the given container
+ * (the one already created by the owner object) instead of a new one.
+ */
+ValueRef SnapshotUnserializer::read_value(const ValueRef &container)
+{
+  switch (read_byte())
+  {
+    case SnapshotNull:
+      return ValueRef();
+
+    case SnapshotInteger:
+    {
+      uint64_t v= read_varint();
+      return IntegerRef((ssize_t)((int64_t)(v >> 1) ^ -(int64_t)(v & 1)));
+    }
+
+    case SnapshotDouble:
+    {
+      if (_end - _pos < 8)
+        throw std::runtime_error("Unexpected end of snapshot data");
+      uint64_t bits= get_u64(_pos);
+      _pos+= 8;
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      return DoubleRef(d);
+    }
+
+    case SnapshotString:
+      return StringRef(get_string(read_string_index()));
+
+    case SnapshotList:
+      return read_list(container);
+
+    case SnapshotDict:
+      return read_dict(container);
+
+    case SnapshotObject:
+    {
+      uint64_t index= read_varint();
+      if (index >= _objects.size())
+        throw std::runtime_error("Invalid object reference in snapshot data");
+      ObjectRef object(_objects[(size_t)index]);
+      read_object_contents(object);
+      return object;
+    }
+
+    case SnapshotObjectLink:
+      return resolve_object_link(get_string(read_string_index()));
+
+    case SnapshotContainerLink:
+    {
+      uint64_t index= read_varint();
+      if (index >= _containers.size() || !_containers[(size_t)index].is_valid())
+        throw std::runtime_error("Invalid container reference in snapshot data");
+      return _containers[(size_t)index];
+    }
+
+    default:
+      throw std::runtime_error("Invalid value in snapshot data");
+  }
+}
+
+
+ValueRef SnapshotUnserializer::read_list(const ValueRef &container)
+{
+  uint32_t index= (uint32_t)read_varint();
+  uint8_t content_type= read_byte();
+  if (content_type > ObjectType)
+    throw std::runtime_error("Invalid list type in snapshot data");
+  std::string content_class= get_string(read_string_index());
+
+  BaseListRef list;
+  if (container.is_valid() && container.type() == ListType)
+  {
+    // the contents of a list being updated are replaced
+    list= BaseListRef::cast_from(container);
+    if (list.count() > 0)
+      list.remove_all();
+  }
+  else
+    list= BaseListRef(_grt, (Type)content_type, content_class);
+  register_container(index, list);
+
+  // as in the XML unserializer, a list with an item that can't be resolved is dropped
+  bool valid= true;
+  for (uint64_t count= read_varint(); count > 0; --count)
+  {
+    bool null_item= _pos < _end && *_pos == SnapshotNull;
+    ValueRef item(read_value(ValueRef()));
+
+    if (!valid)
+      continue;
+
+    if (null_item)
+    {
+      if (!list->null_allowed())
+        log_warning("%s: Attempt o add null value to %s list", _source_name.c_str(), content_class.c_str());
+    }
+    else if (!item.is_valid())
+    {
+      log_warning("%s: skipping unresolved element in %s list", _source_name.c_str(), content_class.c_str());
+      valid= false;
+      continue;
+    }
+
+    try
+    {
+      list.ginsert(item);
+    }
+    catch (const std::exception &exc)
+    {
+      log_warning("%s: Error inserting %s to list: %s", _source_name.c_str(),
+                  item.debugDescription().c_str(), exc.what());
+      throw;
+    }
+  }
+
+  if (!valid)
+    return ValueRef();
+  return list;
+}
+
+
+ValueRef SnapshotUnserializer::read_dict(const ValueRef &container)
+{
+  uint32_t index= (uint32_t)read_varint();
+  uint8_t content_type= read_byte();
+  if (content_type > ObjectType)
+    throw std::runtime_error("Invalid dict type in snapshot data");
+  std::string content_class= get_string(read_string_index());
+
+  DictRef dict;
+  if (container.is_valid() && container.type() == DictType)
+  {
+    dict= DictRef::cast_from(container);
+    if (dict.count() > 0)
+      dict.reset_entries();
+  }
+  else
+    dict= DictRef(_grt, (Type)content_type, content_class);
+  register_container(index, dict);
+
+  for (uint64_t count= read_varint(); count > 0; --count)
+  {
+    std::string key= get_string(read_string_index());
+    dict.set(key, read_value(ValueRef()));
+  }
+
+  return dict;
+}
+
+
+void SnapshotUnserializer::read_object_contents(const ObjectRef &object)
+{
+  MetaClass *mc= object->get_metaclass();
+
+  for (;;)
+  {
+    uint64_t name_index= read_varint();
+    if (name_index == 0)
+      break;
+    if (name_index > _string_count)
+      throw std::runtime_error("Invalid string reference in snapshot data");
+
+    std::string key= get_string((uint32_t)(name_index - 1));
+
+    if (!object->has_member(key))
+    {
+      log_warning("in %s: %s", object.id().c_str(),
+                  std::string("unserialized snapshot contains invalid member " + object.class_name() + "::" + key).c_str());
+      read_value(ValueRef());
+      continue;
+    }
+
+    // lists and dicts created by the object itself are filled instead of being replaced
+    ValueRef current(object->get_member(key));
+    bool null_value= _pos < _end && *_pos == SnapshotNull;
+    ValueRef value(read_value(current));
+
+    // null is only stored for members of updated objects, which may have a value to reset
+    if (null_value && current.is_valid() && current.type() != ListType && current.type() != DictType)
+    {
+      mc->set_member_internal((internal::Object*)object.valueptr(), key, ValueRef(), true);
+      continue;
+    }
+
+    if (value.is_valid())
+    {
+      try
+      {
+        mc->set_member_internal((internal::Object*)object.valueptr(), key, value, true);
+      }
+      catch (const std::exception &exc)
+      {
+        log_warning("exception setting %s<%s>:%s to %s %s", object.id().c_str(),
+                    object.class_name().c_str(), key.c_str(), value.debugDescription().c_str(), exc.what());
+        throw;
+      }
+    }
+  }
+}
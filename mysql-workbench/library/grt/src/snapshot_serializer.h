@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef _GRTPP_SNAPSHOT_SERIALIZER_H__
+#define _GRTPP_SNAPSHOT_SERIALIZER_H__
+
+#include "grtpp.h"
+
+#include <set>
+#include <vector>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace grt
+{
+  namespace internal
+  {
+    /**
+     * Writes GRT values in the binary snapshot format. A snapshot holds the same data as the XML
+     * written by Serializer, but all strings (ids, member names, class names and values) are stored
+     * once in a string table and referred to by index. All objects are listed in an object table so
+     * they can be created before their contents are read, which makes links to objects that come
+     * later in the data resolvable without a fixup step.
+     *
+     * Layout (all numbers little endian):
+     *   header           magic, format version, section sizes, doctype/version/source digest
+     *   string offsets   uint32 for each string + 1 (end of the last string)
+     *   string data      the strings, not terminated
+     *   object table     class name and id (string indices) for each object
+     *   value data       the value tree, see SnapshotTag
+     *
+     * serialize_changes() writes a list of changed objects instead of a full value tree. Objects
+     * that were already stored (listed in known_ids) are only written as links, unless they are
+     * part of the changed objects themselves.
+     */
+    class SnapshotSerializer
+    {
+    public:
+      SnapshotSerializer(GRT *grt);
+
+      void save_to_file(const ValueRef &value, const std::string &path, const std::string &doctype,
+                        const std::string &docversion, const std::string &source_digest);
+
+      std::string serialize_to_data(const ValueRef &value, const std::string &doctype,
+                                    const std::string &docversion, const std::string &source_digest);
+
+      std::string serialize_changes(const std::vector<ObjectRef> &objects,
+                                    const boost::unordered_set<std::string> &known_ids,
+                                    const std::string &source_digest);
+
+      // ids of the objects that were written completely
+      void get_written_ids(boost::unordered_set<std::string> &ids) const;
+
+    protected:
+      GRT *_grt;
+      boost::unordered_map<std::string, uint32_t> _string_index;
+      std::vector<const std::string*> _strings;
+      boost::unordered_map<void*, uint32_t> _containers;
+      std::set<void*> _objects;
+      std::string _object_table;
+      uint32_t _object_count;
+      std::string _data;
+      std::vector<uint32_t> _written_ids;
+
+      const boost::unordered_set<std::string> *_known_ids;
+      std::set<void*> _changed_objects;
+      bool _store_null_members;
+
+      uint32_t add_string(const std::string &str);
+      std::string build_header(const std::string &doctype, const std::string &docversion,
+                               const std::string &source_digest);
+
+      void write_value(const ValueRef &value, bool list_objects_as_links);
+      void write_object(const ObjectRef &object);
+      bool write_member(const MetaClass::Member *member, const ObjectRef &object);
+    };
+
+
+    /**
+     * Reads a snapshot written by SnapshotSerializer. Files are memory mapped and strings are only
+     * copied out of the mapping when a value is created from them.
+     *
+     * With keep_objects set, the objects read are remembered between calls and data read later
+     * (like the records written by serialize_changes) updates them in place.
+     */
+    class SnapshotUnserializer
+    {
+    public:
+      SnapshotUnserializer(GRT *grt, bool keep_objects= false);
+
+      ValueRef load_from_file(const std::string &path, std::string *doctype, std::string *docversion);
+      ValueRef unserialize_data(const char *data, size_t size, std::string *doctype, std::string *docversion);
+
+      static bool get_file_metainfo(const std::string &path, std::string &doctype, std::string &docversion,
+                                    std::string &source_digest);
+
+    protected:
+      struct Header
+      {
+        uint32_t string_count;
+        uint32_t object_count;
+        uint64_t strings_size;
+        uint64_t objects_size;
+        uint64_t data_size;
+        uint32_t doctype;
+        uint32_t docversion;
+        uint32_t source_digest;
+      };
+
+      GRT *_grt;
+      std::string _source_name;
+      bool _keep_objects;
+
+      const unsigned char *_string_offsets;
+      const char *_string_data;
+      uint32_t _string_count;
+      uint64_t _strings_size;
+
+      const unsigned char *_pos;
+      const unsigned char *_end;
+
+      std::vector<ObjectRef> _objects;
+      boost::unordered_map<std::string, ObjectRef> _object_ids;
+      std::set<std::string> _invalid_ids;
+      std::vector<ValueRef> _containers;
+
+      static bool read_header(const char *data, size_t size, Header &header);
+
+      void setup_strings(const char *data, const Header &header);
+      std::string get_string(uint32_t index);
+
+      uint8_t read_byte();
+      uint64_t read_varint();
+      uint32_t read_string_index();
+
+      void create_objects(const Header &header);
+      ObjectRef resolve_object_link(const std::string &id);
+
+      ValueRef read_value(const ValueRef &container);
+      ValueRef read_list(const ValueRef &container);
+      ValueRef read_dict(const ValueRef &container);
+      void read_object_contents(const ObjectRef &object);
+      void register_container(uint32_t index, const ValueRef &value);
+    };
+  };
+};
+
+#endif
@@ -45,6 +45,144 @@ inline std::string get_content(xmlNodePtr node)
   return tmp;
 }
 
+inline std::string get_prop(xmlTextReaderPtr reader, const char *name)
+{
+  xmlChar *prop= xmlTextReaderGetAttribute(reader, (xmlChar*)name);
+  std::string tmp= prop ? (char*)prop : "";
+  xmlFree(prop);
+  return tmp;
+}
+
+
+static double parse_double(std::string tmp)
+{
+  static char decimal_point= 0;
+
+  // now this is a hack for locales that treat . as a thousand separator instead of
+  // decimal. 1st find out what is used as decimal point, then hackup the string to parse if 
+  // needed
+  if (decimal_point == 0)
+  {
+    char buf[4];
+    snprintf(buf, sizeof(buf) - 1, "%.1f", 0.0); // 0.0
+    decimal_point= buf[1];
+  }
+
+  if (decimal_point != '.')
+  {
+    // serializer always saves using . as decimal
+    std::string::size_type dot= tmp.find('.');
+    if (dot != std::string::npos)
+      tmp[dot]= decimal_point;
+  }
+  return strtod(tmp.c_str(), NULL);
+}
+
+
+static void throw_parse_error()
+{
+  xmlErrorPtr error= xmlGetLastError();
+  if (error)
+    throw std::runtime_error(base::strfmt("Could not parse XML data. Line %d, %s", error->line, error->message));
+  throw std::runtime_error("Could not parse XML data");
+}
+
+
+/**
+ * Advances the reader to the next node, throwing on parse errors and on a premature end of the data.
+ */
+static void read_node(xmlTextReaderPtr reader)
+{
+  int ret= xmlTextReaderRead(reader);
+  if (ret == 1)
+    return;
+
+  if (ret == 0)
+    throw std::runtime_error(base::strfmt("Could not parse XML data. Line %d, unexpected end of data",
+                                          xmlTextReaderGetParserLineNumber(reader)));
+  throw_parse_error();
+}
+
+
+/**
+ * Moves to the next child element of the element at the given depth. Returns false once the end of
+ * that element is reached. Child elements must be read completely before calling this again.
+ */
+static bool next_child_element(xmlTextReaderPtr reader, int depth)
+{
+  for (;;)
+  {
+    read_node(reader);
+    switch (xmlTextReaderNodeType(reader))
+    {
+      case XML_READER_TYPE_ELEMENT:
+        return true;
+      case XML_READER_TYPE_END_ELEMENT:
+        if (xmlTextReaderDepth(reader) <= depth)
+          return false;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+
+/**
+ * Reads the text content of the current element (like xmlNodeGetContent) and leaves the reader at
+ * its end. Also used to skip elements that are not of interest.
+ */
+static std::string read_content(xmlTextReaderPtr reader)
+{
+  std::string text;
+
+  if (xmlTextReaderIsEmptyElement(reader))
+    return text;
+
+  int depth= xmlTextReaderDepth(reader);
+  for (;;)
+  {
+    read_node(reader);
+    switch (xmlTextReaderNodeType(reader))
+    {
+      case XML_READER_TYPE_TEXT:
+      case XML_READER_TYPE_CDATA:
+      case XML_READER_TYPE_WHITESPACE:
+      case XML_READER_TYPE_SIGNIFICANT_WHITESPACE:
+      {
+        const xmlChar *value= xmlTextReaderConstValue(reader);
+        if (value)
+          text.append((const char*)value);
+        break;
+      }
+      case XML_READER_TYPE_END_ELEMENT:
+        if (xmlTextReaderDepth(reader) <= depth)
+          return text;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+
+/**
+ * Moves to the first element of the document, i.e. the root element. Returns false if there is none.
+ */
+static bool read_root_element(xmlTextReaderPtr reader)
+{
+  for (;;)
+  {
+    int ret= xmlTextReaderRead(reader);
+    if (ret == 0)
+      return false;
+    if (ret < 0)
+      throw_parse_error();
+    if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT)
+      return true;
+  }
+}
+
 
 
 internal::Unserializer::Unserializer(GRT *grt, bool check_crc)
@@ -63,6 +201,22 @@ ValueRef internal::Unserializer::find_cached(const std::string &id)
 }
 
 
+/**
+ * Looks for a linked object that is not part of the unserialized data in the global tree.
+ */
+ObjectRef internal::Unserializer::find_global_object(const std::string &id)
+{
+  ObjectRef object(_grt->find_object_by_id(id, "/"));
+
+  if (object.is_valid())
+    _cache[object->id()]= object;
+  else
+    _invalid_cache.insert(id);
+
+  return object;
+}
+
+
 xmlDocPtr internal::Unserializer::load_xmldoc(const std::string &path)
 {
   xmlDocPtr doc;
@@ -113,17 +267,69 @@ void internal::Unserializer::get_xmldoc_metainfo(xmlDocPtr doc, std::string &doc
 }
 
 
+/**
+ * Reads the document type and version of a GRT XML file, without reading more than its root element.
+ */
+bool internal::Unserializer::get_xmlfile_metainfo(const std::string &path, std::string &doctype, std::string &docversion)
+{
+  char *local_filename;
+  if ((local_filename= g_filename_from_utf8(path.c_str(), -1, NULL, NULL, NULL)) == NULL)
+    return false;
+  xmlTextReaderPtr reader= xmlReaderForFile(local_filename, NULL, 0);
+  g_free(local_filename);
+  if (!reader)
+    return false;
+
+  bool found= false;
+  try
+  {
+    if ((found= read_root_element(reader)))
+    {
+      doctype= get_prop(reader, "document_type");
+      docversion= get_prop(reader, "version");
+    }
+  }
+  catch (std::exception &)
+  {
+    found= false;
+  }
+  xmlFreeTextReader(reader);
+
+  return found;
+}
+
+
+/**
+ * Unserializes a GRT XML file in a single pass, without loading it into a DOM tree first.
+ */
 ValueRef internal::Unserializer::load_from_xml(const std::string &path, std::string *doctype, std::string *docversion)
 {
-  xmlDocPtr doc= load_xmldoc(path);
+  xmlTextReaderPtr reader;
 
-  ValueRef value= unserialize_xmldoc(doc, path);
+  _source_name= path;
 
-  if (doctype && docversion)
-    get_xmldoc_metainfo(doc, *doctype, *docversion);
+  char *local_filename;
+  if ((local_filename= g_filename_from_utf8(path.c_str(),-1,NULL,NULL,NULL)) == NULL)
+    throw std::runtime_error("can't open XML file "+path);
+  reader= xmlReaderForFile(local_filename, NULL, 0);
+  g_free(local_filename);
+
+  if (!reader)
+    throw std::runtime_error("can't open XML file "+path);
+
+  ValueRef value;
+  try
+  {
+    value= read_xml_document(reader, doctype, docversion);
+  }
+  catch (...)
+  {
+    xmlFreeTextReader(reader);
+    _pending_links.clear();
+    throw;
+  }
+  xmlFreeTextReader(reader);
 
-  xmlFreeDoc(doc);
-  
   return value;
 }
 
@@ -226,13 +432,7 @@ ValueRef internal::Unserializer::traverse_xml_recreating_tree(xmlNodePtr node)
       // check if the object was loaded in the 1st step
       
       // if the linked object is not in the current tree, look for it in the global tree
-      ObjectRef object(_grt->find_object_by_id(link_id, "/"));
-
-      if (object.is_valid())
-        _cache[object->id()]= object;
-      else
-        _invalid_cache.insert(link_id);
-      value= object;
+      value= find_global_object(link_id);
 
       if (!value.is_valid() /*&& get_prop(node, "key") != "owner"*/)
         log_warning("%s:%i: link '%s' <%s %s> key=%s could not be resolved\n", 
@@ -261,30 +461,8 @@ ValueRef internal::Unserializer::traverse_xml_recreating_tree(xmlNodePtr node)
     break;
       
   case DoubleType:
-  {
-    std::string tmp= get_content(node);
-    static char decimal_point= 0;
-
-    // now this is a hack for locales that treat . as a thousand separator instead of
-    // decimal. 1st find out what is used as decimal point, then hackup the string to parse if 
-    // needed
-    if (decimal_point == 0)
-    {
-      char buf[4];
-      snprintf(buf, sizeof(buf) - 1, "%.1f", 0.0); // 0.0
-      decimal_point= buf[1];
-    }
-
-    if (decimal_point != '.')
-    {
-      // serializer always saves using . as decimal
-      std::string::size_type dot= tmp.find('.');
-      if (dot != std::string::npos)
-        tmp[dot]= decimal_point;
-    }
-    value= DoubleRef(strtod(tmp.c_str(), NULL));
+    value= DoubleRef(parse_double(get_content(node)));
     break;
-  }
 
   case StringType:
     value= StringRef(get_content(node));
@@ -430,35 +608,39 @@ ValueRef internal::Unserializer::traverse_xml_recreating_tree(xmlNodePtr node)
 
 ObjectRef internal::Unserializer::unserialize_object_step1(xmlNodePtr node)
 {
-  MetaClass *gstruct;
-  std::string id;
-  
   std::string prop= get_prop(node, "type");
   if (prop != "object")
     throw std::runtime_error("error unserializing object (unexpected type)");
   
-  prop= get_prop(node, "struct-name");
-  if (prop.empty())
+  return create_object(get_prop(node, "struct-name"), get_prop(node, "id"), get_prop(node, "struct-checksum"),
+                       node->line);
+}
+
+
+ObjectRef internal::Unserializer::create_object(const std::string &struct_name, const std::string &id,
+                                                const std::string &checksum, int line)
+{
+  MetaClass *gstruct;
+
+  if (struct_name.empty())
     throw std::runtime_error("error unserializing object (missing struct-name)");
   
-  gstruct= _grt->get_metaclass(prop);
+  gstruct= _grt->get_metaclass(struct_name);
   if (!gstruct)
   {
     log_warning("%s:%i: error unserializing object: struct '%s' unknown",
-              _source_name.c_str(), node->line,
-              prop.c_str());
-    throw std::runtime_error(base::strfmt("error unserializing object (struct '%s' unknown)", prop.c_str()));
+              _source_name.c_str(), line,
+              struct_name.c_str());
+    throw std::runtime_error(base::strfmt("error unserializing object (struct '%s' unknown)", struct_name.c_str()));
   }
 
-  id= get_prop(node, "id");
   if (id.empty())
     throw std::runtime_error("missing id in unserialized object");
   
-  prop= get_prop(node, "struct-checksum");
-  if (!prop.empty())
+  if (!checksum.empty())
   {
-    unsigned int checksum= (unsigned int)strtol(prop.c_str(), NULL, 0);
-    if (_check_serialized_crc && checksum != gstruct->crc32())
+    unsigned int crc= (unsigned int)strtol(checksum.c_str(), NULL, 0);
+    if (_check_serialized_crc && crc != gstruct->crc32())
     {
       log_warning("current checksum of struct of serialized object %s (%s) differs from the one when it was saved",
                 id.c_str(), gstruct->name().c_str());
@@ -488,12 +670,26 @@ ObjectRef internal::Unserializer::unserialize_object_step2(xmlNodePtr node)
 }
 
 
+void internal::Unserializer::set_object_member(const ObjectRef &object, const std::string &key, const ValueRef &value)
+{
+  try 
+  {
+    object->get_metaclass()->set_member_internal((internal::Object*)object.valueptr(), key, value, true);
+  }
+  catch (const std::exception &exc) 
+  {
+    log_warning("exception setting %s<%s>:%s to %s %s", object.id().c_str(),
+    object.class_name().c_str(), key.c_str(), value.debugDescription().c_str(), exc.what());
+    throw;
+  }
+}
+
+
 void internal::Unserializer::unserialize_object_contents(const ObjectRef &object, xmlNodePtr node)
 {
   std::string prop;
   // load values
   xmlNodePtr child;
-  MetaClass *mc= object->get_metaclass();
 
   child= node->children;
   while (child)
@@ -535,18 +731,7 @@ void internal::Unserializer::unserialize_object_contents(const ObjectRef &object
             throw;
           }
           if (sub_value.is_valid())
-          {
-            try 
-            {
-              mc->set_member_internal((internal::Object*)object.valueptr(), key, sub_value, true);
-            }
-            catch (const std::exception &exc) 
-            {
-              log_warning("exception setting %s<%s>:%s to %s %s", object.id().c_str(),
-              object.class_name().c_str(), key.c_str(), sub_value.debugDescription().c_str(), exc.what());
-              throw;
-            }
-          }
+            set_object_member(object, key, sub_value);
         }
       }
     }
@@ -555,33 +740,438 @@ void internal::Unserializer::unserialize_object_contents(const ObjectRef &object
 }
 
 
-bool internal::Unserializer::update_grt_document(xmlDocPtr doc)
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * The streaming counterpart of unserialize_xmldoc. Objects are created and filled as soon as their
+ * element is read. Links to objects that come later in the data can't be resolved at that point;
+ * they are collected per container and stored once the whole value has been read, see
+ * resolve_pending_links.
+ */
+ValueRef internal::Unserializer::read_xml_document(xmlTextReaderPtr reader, std::string *doctype,
+                                                   std::string *docversion)
 {
-  return true;
+  ValueRef value;
+
+  if (!read_root_element(reader))
+    return value;
+
+  if (doctype && docversion)
+  {
+    *doctype= get_prop(reader, "document_type");
+    *docversion= get_prop(reader, "version");
+  }
+
+  if (xmlTextReaderIsEmptyElement(reader))
+    return value;
+
+  int depth= xmlTextReaderDepth(reader);
+  while (next_child_element(reader, depth))
+  {
+    if (xmlStrcmp(xmlTextReaderConstName(reader), (xmlChar*)"value") == 0)
+    {
+      std::string link_id;
+      value= read_xml_value(reader, link_id);
+      resolve_pending_links();
+      break;
+    }
+    read_content(reader);
+  }
+
+  return value;
 }
 
 
+/**
+ * Reads the value or link element the reader is at, leaving the reader at its end. If the element is
+ * a link to an object not read yet, an invalid value is returned and link_id is set to its id.
+ */
+ValueRef internal::Unserializer::read_xml_value(xmlTextReaderPtr reader, std::string &link_id)
+{
+  const xmlChar *name= xmlTextReaderConstName(reader);
 
+  link_id.clear();
 
+  if (xmlStrcmp(name, (xmlChar*)"link") == 0)
+  {
+    std::string node_type= get_prop(reader, "type");
+    std::string id= read_content(reader);
+    ValueRef value= find_cached(id);
 
-ValueRef internal::Unserializer::unserialize_xmldata(const char *data, size_t size)
+    if (!value.is_valid())
+    {
+      if (node_type.empty() || node_type != "object")
+        log_warning("%s: link of type '%s' could not be resolved during unserialized", _source_name.c_str(), node_type.c_str());
+      else
+        link_id= id;
+    }
+    return value;
+  }
+  else if (xmlStrcmp(name, (xmlChar*)"value") != 0)
+  {
+    read_content(reader);
+    return ValueRef();
+  }
+
+  std::string node_type= get_prop(reader, "type");
+  if (node_type.empty())
+    throw std::runtime_error(std::string("Node '").append((char*)name).append("' in xml doesn't have a type property"));
+
+  ValueRef value;
+
+  switch (str_to_type(node_type))
+  {
+  case IntegerType:
+    value= IntegerRef(strtol(read_content(reader).c_str(), NULL, 0));
+    break;
+
+  case DoubleType:
+    value= DoubleRef(parse_double(read_content(reader)));
+    break;
+
+  case StringType:
+    value= StringRef(read_content(reader));
+    break;
+
+  case DictType:
+  {
+    DictRef dict;
+
+    // check if the dictionary was already created
+    std::string ptr= get_prop(reader, "_ptr_");
+    if (!ptr.empty())
+      value= find_cached(ptr);
+
+    if (!value.is_valid())
+    {
+      std::string prop= get_prop(reader, "content-type");
+      if (!prop.empty())
+      {
+        Type content_type= str_to_type(prop);
+        if (content_type != UnknownType)
+          value= dict= DictRef(_grt, content_type, get_prop(reader, "content-struct-name"));
+        else
+          throw std::runtime_error("Error parsing XML. Invalid type "+prop);
+      }
+      else
+        value= dict= DictRef(_grt);
+
+      if (!ptr.empty())
+        _cache[ptr]= value;
+    }
+    else
+      dict= DictRef::cast_from(value);
+
+    read_xml_dict(reader, dict);
+    break;
+  }
+
+  case ListType:
+  {
+    Type content_type= str_to_type(get_prop(reader, "content-type"));
+    std::string cclass_name= get_prop(reader, "content-struct-name");
+    BaseListRef list;
+
+    // look up for this ptr, in case the owner object already has created this list
+    std::string ptr= get_prop(reader, "_ptr_");
+    if (!ptr.empty())
+      value= find_cached(ptr);
+
+    if (!value.is_valid())
+    {
+      value= list= BaseListRef(_grt, content_type, cclass_name);
+      if (!ptr.empty())
+        _cache[ptr]= value;
+    }
+    else
+      list= BaseListRef::cast_from(value);
+
+    if (!read_xml_list(reader, list))
+      value.clear();
+    break;
+  }
+
+  case ObjectType:
+  {
+    int line= xmlTextReaderGetParserLineNumber(reader);
+    ObjectRef object(create_object(get_prop(reader, "struct-name"), get_prop(reader, "id"),
+                                   get_prop(reader, "struct-checksum"), line));
+
+    // cache the object right away, links from inside its own contents (like owner) point back to it
+    _cache[object->id()]= object;
+    read_xml_object_contents(reader, object);
+    value= object;
+    break;
+  }
+
+  case UnknownType:
+    read_content(reader);
+    break;
+  }
+
+  return value;
+}
+
+
+void internal::Unserializer::read_xml_dict(xmlTextReaderPtr reader, DictRef dict)
+{
+  if (xmlTextReaderIsEmptyElement(reader))
+    return;
+
+  PendingLinks *pending= NULL;
+  int depth= xmlTextReaderDepth(reader);
+  while (next_child_element(reader, depth))
+  {
+    std::string key= get_prop(reader, "key");
+    if (key.empty())
+    {
+      read_content(reader);
+      continue;
+    }
+
+    int line= xmlTextReaderGetParserLineNumber(reader);
+    std::string link_id;
+    ValueRef sub_value= read_xml_value(reader, link_id);
+
+    // once a value has to wait for its link to be resolved, all that follow wait too to keep their order
+    if (!pending && !link_id.empty())
+      pending= add_pending_links(dict);
+
+    if (pending)
+    {
+      PendingItem item= { key, sub_value, link_id, line };
+      pending->items.push_back(item);
+    }
+    else
+      dict.set(key, sub_value);
+  }
+}
+
+
+/**
+ * Reads the items of a list. Returns false if the list had to be dropped because of an invalid item.
+ */
+bool internal::Unserializer::read_xml_list(xmlTextReaderPtr reader, BaseListRef list)
 {
-  xmlDocPtr doc = xmlReadMemory(data, (int)size, NULL, NULL, XML_PARSE_NOENT);
+  if (xmlTextReaderIsEmptyElement(reader))
+    return true;
 
-  if (!doc)
+  bool valid= true;
+  PendingLinks *pending= NULL;
+  int depth= xmlTextReaderDepth(reader);
+  while (next_child_element(reader, depth))
   {
-    xmlErrorPtr error= xmlGetLastError();
+    if (!valid)
+    {
+      read_content(reader);
+      continue;
+    }
+
+    int line= xmlTextReaderGetParserLineNumber(reader);
+    ValueRef sub_value;
+    std::string link_id;
+
+    if (xmlStrcmp(xmlTextReaderConstName(reader), (xmlChar*)"null") == 0)
+    {
+      read_content(reader);
+      if (!list->null_allowed())
+      {
+        log_warning("%s: Attempt o add null value to %s list", _source_name.c_str(),
+                    list.content_class_name().c_str());
+      }
+    }
+    else
+    {
+      std::string name= (const char*)xmlTextReaderConstName(reader);
+      sub_value= read_xml_value(reader, link_id);
 
-    if (error) 
-      throw std::runtime_error(base::strfmt("Could not parse XML data. Line %d, %s",
-                                            error->line, error->message));
+      if (!sub_value.is_valid() && link_id.empty())
+      {
+        //error!
+        log_warning("%s: skipping element '%s' in unserialized document, line %i",
+                    _source_name.c_str(), name.c_str(), line);
+        valid= false;
+        continue;
+      }
+    }
+
+    if (!pending && !link_id.empty())
+      pending= add_pending_links(list);
+
+    if (pending)
+    {
+      PendingItem item= { "", sub_value, link_id, line };
+      pending->items.push_back(item);
+    }
     else
-      throw std::runtime_error("Could not parse XML data");
+    {
+      try
+      {
+        list.ginsert(sub_value);
+      }
+      catch (const std::exception &exc)
+      {
+        log_warning("%s: Error inserting %s to list: %s", _source_name.c_str(),
+                    sub_value.debugDescription().c_str(), exc.what());
+        throw;
+      }
+    }
+  }
+
+  return valid;
+}
+
+
+void internal::Unserializer::read_xml_object_contents(xmlTextReaderPtr reader, const ObjectRef &object)
+{
+  if (xmlTextReaderIsEmptyElement(reader))
+    return;
+
+  int depth= xmlTextReaderDepth(reader);
+  while (next_child_element(reader, depth))
+  {
+    std::string key= get_prop(reader, "key");
+    if (key.empty())
+    {
+      read_content(reader);
+      continue;
+    }
+
+    if (!object->has_member(key))
+    {
+      log_warning("in %s: %s", object.id().c_str(),
+                  std::string("unserialized XML contains invalid member "+object.class_name()+"::"+key).c_str());
+      read_content(reader);
+      continue;
+    }
+
+    // 1st check if the value is a container and if it has already been created
+    // if so, insert it to the unserialize cache for reuse by read_xml_value
+    ValueRef sub_value= object->get_member(key);
+    if (sub_value.is_valid())
+    {
+      std::string ptr= get_prop(reader, "_ptr_");
+      if (!ptr.empty())
+        _cache[ptr]= sub_value;
+    }
+
+    int line= xmlTextReaderGetParserLineNumber(reader);
+    std::string link_id;
+    try
+    {
+      sub_value= read_xml_value(reader, link_id);
+    }
+    catch (grt::null_value &exc)
+    {
+      log_warning("%s in %s:%s %s", exc.what(), object->class_name().c_str(), key.c_str(), object->id().c_str());
+      throw;
+    }
+
+    if (!link_id.empty())
+    {
+      PendingItem item= { key, ValueRef(), link_id, line };
+      add_pending_links(object)->items.push_back(item);
+    }
+    else if (sub_value.is_valid())
+      set_object_member(object, key, sub_value);
+  }
+}
+
+
+internal::Unserializer::PendingLinks *internal::Unserializer::add_pending_links(const ValueRef &container)
+{
+  _pending_links.push_back(PendingLinks());
+  _pending_links.back().container= container;
+  return &_pending_links.back();
+}
+
+
+/**
+ * Stores the values that were waiting for links to objects after them in the data. Links that are
+ * still unknown are looked up in the global tree, like in unserialize_xmldoc.
+ */
+void internal::Unserializer::resolve_pending_links()
+{
+  for (std::list<PendingLinks>::iterator pending= _pending_links.begin(); pending != _pending_links.end(); ++pending)
+  {
+    bool dropped= false;
+    for (std::vector<PendingItem>::iterator item= pending->items.begin(); item != pending->items.end() && !dropped; ++item)
+    {
+      ValueRef value= item->value;
+
+      if (!item->link_id.empty())
+      {
+        value= find_cached(item->link_id);
+        if (!value.is_valid() && _invalid_cache.find(item->link_id) == _invalid_cache.end())
+        {
+          value= find_global_object(item->link_id);
+          if (!value.is_valid())
+            log_warning("%s:%i: link '%s' key=%s could not be resolved\n",
+                        _source_name.c_str(), item->line, item->link_id.c_str(), item->key.c_str());
+        }
+      }
+
+      switch (pending->container.type())
+      {
+      case ObjectType:
+        if (value.is_valid())
+          set_object_member(ObjectRef::cast_from(pending->container), item->key, value);
+        break;
+
+      case DictType:
+        DictRef::cast_from(pending->container).set(item->key, value);
+        break;
+
+      case ListType:
+        if (!value.is_valid() && !item->link_id.empty())
+        {
+          // the rest of the list is dropped, as unserialize_xmldoc does
+          log_warning("%s: skipping element 'link' in unserialized document, line %i",
+                      _source_name.c_str(), item->line);
+          dropped= true;
+          break;
+        }
+        BaseListRef::cast_from(pending->container).ginsert(value);
+        break;
+
+      default:
+        break;
+      }
+    }
   }
+  _pending_links.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool internal::Unserializer::update_grt_document(xmlDocPtr doc)
+{
+  return true;
+}
+
 
-  ValueRef value= unserialize_xmldoc(doc);
 
-  xmlFreeDoc(doc);
+
+
+ValueRef internal::Unserializer::unserialize_xmldata(const char *data, size_t size)
+{
+  xmlTextReaderPtr reader= xmlReaderForMemory(data, (int)size, NULL, NULL, XML_PARSE_NOENT);
+
+  if (!reader)
+    throw_parse_error();
+
+  ValueRef value;
+  try
+  {
+    value= read_xml_document(reader, NULL, NULL);
+  }
+  catch (...)
+  {
+    xmlFreeTextReader(reader);
+    _pending_links.clear();
+    throw;
+  }
+  xmlFreeTextReader(reader);
 
   return value;
 }
@@ -1,5 +1,5 @@
 /* 
- * Copyright (c) 2007, 2013, Oracle and/or its affiliates. All rights reserved.
+ * Copyright (c) 2007, 2016, Oracle and/or its affiliates. All rights reserved.
  *
  * This program is free software; you can redistribute it and/or
  * modify it under the terms of the GNU General Public License as
@@ -21,7 +21,9 @@
 #define _GRTPP_UNSERIALIZER_H__
 
 #include "grtpp.h"
+#include <libxml/xmlreader.h>
 #include <set>
+#include <list>
 
 namespace grt
 {
@@ -38,15 +40,33 @@ namespace grt
       static xmlDocPtr load_xmldoc(const std::string &path);
       xmlDocPtr load_grt_xmldoc(const std::string &path);
       static void get_xmldoc_metainfo(xmlDocPtr doc, std::string &doctype, std::string &docversion);
+      static bool get_xmlfile_metainfo(const std::string &path, std::string &doctype, std::string &docversion);
       ValueRef unserialize_xmldoc(xmlDocPtr doc, const std::string &source_path= "");
 
       ValueRef unserialize_xmldata(const char *data, size_t size);
 
     protected:
+      // Values of a container that refer to objects not read yet. They are stored
+      // once the whole document has been read (see resolve_pending_links).
+      struct PendingItem
+      {
+        std::string key;
+        ValueRef value;
+        std::string link_id;
+        int line;
+      };
+
+      struct PendingLinks
+      {
+        ValueRef container;
+        std::vector<PendingItem> items;
+      };
+
       GRT *_grt;
       std::string _source_name;
       std::map<std::string, ValueRef > _cache;
       std::set<std::string> _invalid_cache;
+      std::list<PendingLinks> _pending_links;
       bool _check_serialized_crc;
 
       bool update_grt_document(xmlDocPtr doc);
@@ -61,6 +81,18 @@ namespace grt
       void unserialize_object_contents(const ObjectRef &object, xmlNodePtr node);
       
       ValueRef find_cached(const std::string &id);
+      ObjectRef find_global_object(const std::string &id);
+
+      ObjectRef create_object(const std::string &struct_name, const std::string &id, const std::string &checksum, int line);
+      void set_object_member(const ObjectRef &object, const std::string &key, const ValueRef &value);
+
+      ValueRef read_xml_document(xmlTextReaderPtr reader, std::string *doctype, std::string *docversion);
+      ValueRef read_xml_value(xmlTextReaderPtr reader, std::string &link_id);
+      void read_xml_dict(xmlTextReaderPtr reader, DictRef dict);
+      bool read_xml_list(xmlTextReaderPtr reader, BaseListRef list);
+      void read_xml_object_contents(xmlTextReaderPtr reader, const ObjectRef &object);
+      PendingLinks *add_pending_links(const ValueRef &container);
+      void resolve_pending_links();
     };
   };
 };
@@ -17,9 +17,12 @@
  * 02110-1301  USA
  */
 
+#include <fstream>
+
 #include "testgrt.h"
 #include "grt_test_utility.h"
 #include "structs.test.h"
+#include "grtpp_snapshot_journal.h"
 #include "grtdb/db_object_helpers.h"
 #include "grts/structs.db.mysql.h"
 
@@ -185,6 +188,187 @@ TEST_FUNCTION(5)
 }
 
 
+TEST_FUNCTION(6)
+{
+  // links to objects that come later in the data are resolved once the whole document is read
+
+  static const std::string filename("forward_link_test.xml");
+  {
+    std::ofstream f(filename.c_str());
+    f << "<?xml version=\"1.0\"?>\n"
+      << "<data grt_format=\"2.0\">\n"
+      << " <value type=\"list\" content-type=\"object\">\n"
+      << "  <value type=\"object\" struct-name=\"test.Book\" id=\"book1\">\n"
+      << "   <value type=\"string\" key=\"title\">the book1</value>\n"
+      << "   <link type=\"object\" struct-name=\"test.Publisher\" key=\"publisher\">pub1</link>\n"
+      << "   <value type=\"list\" content-type=\"object\" content-struct-name=\"test.Author\" key=\"authors\">\n"
+      << "    <link type=\"object\">author1</link>\n"
+      << "    <value type=\"object\" struct-name=\"test.Author\" id=\"author2\"/>\n"
+      << "   </value>\n"
+      << "  </value>\n"
+      << "  <value type=\"object\" struct-name=\"test.Publisher\" id=\"pub1\"/>\n"
+      << "  <value type=\"object\" struct-name=\"test.Author\" id=\"author1\"/>\n"
+      << " </value>\n"
+      << "</data>\n";
+  }
+
+  ObjectListRef list(ObjectListRef::cast_from(grt.unserialize(filename)));
+  test_BookRef book(test_BookRef::cast_from(list[0]));
+
+  ensure("publisher", book->publisher().valueptr() == list[1].valueptr());
+  ensure_equals("authors", book->authors().count(), 2U);
+  ensure("author order", book->authors()[0].valueptr() == list[2].valueptr());
+  ensure_equals("author2", book->authors()[1]->id(), "author2");
+
+  // the DOM based unserializer must produce the same tree
+  xmlDocPtr doc= grt.load_xml(filename);
+  ValueRef dom_list(grt.unserialize_xml(doc, filename));
+  xmlFreeDoc(doc);
+  grt_ensure_equals("streamed vs DOM", list, dom_list, true);
+}
+
+
+TEST_FUNCTION(7)
+{
+  // binary snapshots must give the same tree as XML, including shared and linked objects
+
+  static const std::string filename("snapshot_test.snapshot");
+
+  ObjectListRef list(&grt);
+  test_BookRef book(&grt);
+  test_PublisherRef publisher(&grt);
+  test_AuthorRef author(&grt);
+
+  author->name("the author");
+  publisher->name("<publisher>");
+  book->title("the book");
+  book->pages(-123);
+  book->price(12.345);
+  book->publisher(publisher);
+  book->authors().insert(author);
+  book->extras().set("extra_string", StringRef("some text"));
+  book->extras().set("extra_obj", author);
+
+  list.insert(book);
+  list.insert(author);
+  list.insert(publisher);
+
+  grt.serialize_snapshot(list, filename, "test document", "1.0", "digest");
+
+  std::string doctype, version, digest;
+  ensure("metainfo", grt.get_snapshot_metainfo(filename, doctype, version, digest));
+  ensure_equals("doctype", doctype, "test document");
+  ensure_equals("digest", digest, "digest");
+
+  ObjectListRef result(ObjectListRef::cast_from(grt.unserialize_snapshot(filename, doctype, version)));
+  ensure_equals("version", version, "1.0");
+  grt_ensure_equals("snapshot", result, list, true);
+
+  test_BookRef result_book(test_BookRef::cast_from(result[0]));
+  ensure("shared author", result_book->authors()[0].valueptr() == result[1].valueptr());
+  ensure("linked publisher", result_book->publisher().valueptr() == result[2].valueptr());
+}
+
+
+TEST_FUNCTION(8)
+{
+  // applying a journal to its checkpoint must give the current tree
+
+  static const std::string snapshot_name("journal_test.snapshot");
+  static const std::string journal_name("journal_test.journal");
+
+  ObjectListRef list(&grt);
+  test_BookRef book(&grt);
+  test_PublisherRef publisher(&grt);
+  test_AuthorRef author(&grt);
+
+  author->name("the author");
+  book->title("the book");
+  book->publisher(publisher);
+  book->authors().insert(author);
+
+  list.insert(book);
+  list.insert(publisher);
+
+  SnapshotJournal journal(&grt, snapshot_name, journal_name);
+  journal.checkpoint(list, "test document", "1.0");
+  ensure("checkpoint", journal.has_checkpoint());
+
+  // a changed member, a member reset to null and a new owned object
+  test_AuthorRef new_author(&grt);
+  new_author->name("new author");
+  book->title("changed title");
+  book->publisher(test_PublisherRef());
+  book->authors().insert(new_author);
+
+  std::vector<ObjectRef> changes;
+  changes.push_back(book);
+  journal.append(changes);
+
+  // an object added by an earlier record is updated in place
+  new_author->name("renamed author");
+  changes.clear();
+  changes.push_back(new_author);
+  journal.append(changes);
+  ensure_equals("records", journal.record_count(), 2U);
+
+  // an incomplete record at the end is ignored
+  {
+    std::ofstream out(journal_name.c_str(), std::ios::out | std::ios::app | std::ios::binary);
+    out.write("\xff\x00\x00\x00GRT", 7);
+  }
+
+  std::string doctype, version;
+  ObjectListRef result(ObjectListRef::cast_from(SnapshotJournal::load(&grt, snapshot_name, journal_name,
+                                                                      doctype, version)));
+  ensure_equals("doctype", doctype, "test document");
+  ensure_equals("version", version, "1.0");
+  grt_ensure_equals("journal", result, list, true);
+
+  test_BookRef result_book(test_BookRef::cast_from(result[0]));
+  ensure_equals("updated author", *result_book->authors()[1]->name(), "renamed author");
+  ensure("publisher reset", !result_book->publisher().is_valid());
+
+  // a new checkpoint invalidates the records written for the previous one
+  journal.checkpoint(list, "test document", "1.0");
+  ensure_equals("no records", journal.record_count(), 0U);
+}
+
+
+TEST_FUNCTION(9)
+{
+  // changes made without undo tracking can't be journaled, but must still be noticed
+
+  ObjectListRef list(&grt);
+  test_BookRef book(&grt);
+  list.insert(book);
+  list.mark_global();
+
+  UndoManager *um= grt.get_undo_manager();
+  um->set_change_tracking(true);
+  ensure("nothing changed", !um->has_changes_to_take());
+
+  grt.start_tracking_changes();
+  book->title("tracked title");
+  grt.stop_tracking_changes();
+  ensure("tracked change", um->has_changes_to_take());
+
+  std::map<std::string, ObjectRef> changes;
+  ensure("tracked changes are complete", um->take_changed_objects(changes));
+  ensure_equals("changed objects", changes.size(), 1U);
+  ensure("changes taken", !um->has_changes_to_take());
+
+  book->title("untracked title");
+  ensure("untracked change", um->has_changes_to_take());
+
+  changes.clear();
+  ensure("untracked changes are incomplete", !um->take_changed_objects(changes));
+
+  um->set_change_tracking(false);
+  list.unmark_global();
+}
+
+
 #ifdef badtest
 TEST_FUNCTION(5)
 {
@@ -17,13 +17,20 @@
  * 02110-1301  USA
  */
 
+#define VERBOSE_OUTPUT 0
+
 #include <grtpp_util.h>
+#include "base/string_utilities.h"
+#include "base/util_functions.h"
 
 #include "testgrt.h"
 #include "structs.test.h"
 #include "grt_values_test_data.h"
 #include "grt_test_utility.h"
 
+#include <algorithm>
+#include <iostream>
+
 BEGIN_TEST_DATA_CLASS(grt_value)
 public:
   GRT grt;
@@ -789,7 +796,8 @@ TEST_FUNCTION(35)
   DictRef dv(&grt);
   IntegerRef iv[10]= {0,1,2,3,4,5,6,7,8,9};
   StringRef sv[10]= {"_0","_1","_2","_3","_4","_5","_6","_7","_8","_9"};
-  StringRef k[10]= {"_0","_1","_2","_3","_4","_5","_6","_7","_8","_9"};
+  // Plain strings for the keys, equal StringRefs would share the instances of sv.
+  std::string k[10]= {"_0","_1","_2","_3","_4","_5","_6","_7","_8","_9"};
   ObjectRef obj(grt.create_object<grt::internal::Object>("test.Book"));
 
   ensure_equals("initial size == 0", dv.count(), 0U);
@@ -893,4 +901,204 @@ TEST_FUNCTION(36)
 
 }
 
+TEST_FUNCTION(37)
+{ // shared strings
+  std::string long_value(100, 'x');
+
+  StringRef s1("shared value test");
+  StringRef s2(std::string("shared value test"));
+  StringRef l1(long_value), l2(long_value);
+
+  ensure("short values share the instance", s1.valueptr() == s2.valueptr());
+  ensure_equals("shared refcount", s1.refcount(), 2);
+  ensure("long values are separate", l1.valueptr() != l2.valueptr());
+  ensure_equals("long value refcount", l1.refcount(), 1);
+
+  ValueMemoryStats stats = get_value_memory_stats();
+  ensure("pool stats", stats.interned_strings > 0 && stats.shared_references > 0 && stats.intern_hits > 0);
+  ensure("arena stats", stats.arena_objects >= 4 && stats.arena_bytes > 0);
+
+  // Once the last reference is gone the value is dropped from the pool and created again.
+  s1.clear();
+  s2.clear();
+  StringRef s3("shared value test");
+  ensure_equals("new instance refcount", s3.refcount(), 1);
+  ensure_equals("new instance value", *s3, "shared value test");
+}
+
+TEST_FUNCTION(38)
+{
+  // Dict entries are found by key and iterated in insertion order.
+  DictRef dict(&grt);
+
+  for (int i= 0; i < 1000; i++)
+    dict.set(base::strfmt("key%i", 999 - i), IntegerRef(i));
+
+  ensure_equals("count", dict.count(), 1000U);
+  for (int i= 0; i < 1000; i++)
+    ensure_equals("lookup", *IntegerRef::cast_from(dict.get(base::strfmt("key%i", 999 - i))), i);
+  ensure("missing key", !dict.has_key("key1000"));
+
+  int n= 0;
+  for (DictRef::const_iterator iter= dict.begin(); iter != dict.end(); ++iter, ++n)
+    ensure_equals("insertion order", iter->first, base::strfmt("key%i", 999 - n));
+
+  // Overwriting a value keeps its position, removed keys come back at the end.
+  dict.set("key999", IntegerRef(-1));
+  ensure_equals("overwritten value stays first", dict.begin()->first, "key999");
+  dict.remove("key999");
+  dict.set("key999", IntegerRef(-2));
+  ensure_equals("count after reinsert", dict.count(), 1000U);
+  ensure_equals("removed key", dict.begin()->first, "key998");
+
+  // Removing the entries while iterating (as replace_contents does).
+  DictRef::const_iterator iter= dict.begin(), current;
+  while (iter != dict.end())
+  {
+    current= iter;
+    ++iter;
+    if (*IntegerRef::cast_from(current->second) % 2 == 0)
+      dict.remove(current->first);
+  }
+  ensure_equals("count after removal", dict.count(), 500U);
+  for (int i= 0; i < 1000; i++)
+    ensure_equals("lookup after removal", dict.has_key(base::strfmt("key%i", 999 - i)), i % 2 == 1);
+
+  dict.reset_entries();
+  ensure_equals("count after reset", dict.count(), 0U);
+  ensure("empty iteration", dict.begin() == dict.end());
+}
+
+TEST_FUNCTION(39)
+{
+  // get_index and remove(value) on indexed object lists.
+  ListRef<internal::Object> list(&grt);
+  std::vector<ObjectRef> objects;
+
+  for (int i= 0; i < 200; i++)
+  {
+    objects.push_back(grt.create_object<internal::Object>("test.Book"));
+    list.insert(objects.back());
+  }
+  ObjectRef other(grt.create_object<internal::Object>("test.Book"));
+
+  for (size_t i= 0; i < objects.size(); i++)
+    ensure_equals("get_index", list.get_index(objects[i]), i);
+  ensure_equals("get_index of missing object", list.get_index(other), (size_t)BaseListRef::npos);
+
+  list.insert(other, 0);
+  ensure_equals("get_index after insert", list.get_index(objects[10]), 11U);
+
+  list.remove(other);
+  list.remove(objects[50]);
+  ensure_equals("count after remove", list.count(), 199U);
+  ensure_equals("get_index of removed object", list.get_index(objects[50]), (size_t)BaseListRef::npos);
+  ensure_equals("get_index after remove", list.get_index(objects[51]), 50U);
+
+  list.reorder(0, 100);
+  ensure_equals("get_index after reorder", list.get_index(objects[0]), 100U);
+  ensure_equals("get_index after reorder", list.get_index(objects[1]), 0U);
+
+  list.set(5, other);
+  ensure_equals("get_index after set", list.get_index(other), 5U);
+  ensure_equals("get_index of replaced object", list.get_index(objects[6]), (size_t)BaseListRef::npos);
+
+  // Duplicates make the list fall back to a scan, which finds the first occurrence.
+  list.insert(objects[30]);
+  ensure_equals("get_index with duplicates", list.get_index(objects[30]), 29U);
+  list.remove(objects[30]);
+  ensure_equals("remove with duplicates", list.get_index(objects[30]), (size_t)BaseListRef::npos);
+}
+
+TEST_FUNCTION(40)
+{
+  // Micro benchmark: a map against the dict and a linear scan against get_index.
+  // Timings are only printed with VERBOSE_OUTPUT, they depend too much on the machine to be checked.
+  const int key_count= 100000;
+  std::vector<std::string> keys;
+  for (int i= 0; i < key_count; i++)
+    keys.push_back(base::strfmt("column_%i", i));
+
+#if VERBOSE_OUTPUT
+  double start= base::timestamp();
+#endif
+  std::map<std::string, ValueRef> map;
+  for (int i= 0; i < key_count; i++)
+    map[keys[i]]= IntegerRef(i);
+  size_t found= 0;
+  for (int i= 0; i < key_count; i++)
+    found+= map.find(keys[(i * 7) % key_count]) != map.end();
+  ensure_equals("map lookups", found, (size_t)key_count);
+#if VERBOSE_OUTPUT
+  std::cout << "std::map: " << key_count << " inserts and lookups in " << base::timestamp() - start << "s" << std::endl;
+  start= base::timestamp();
+#endif
+
+  DictRef dict(&grt);
+  for (int i= 0; i < key_count; i++)
+    dict.set(keys[i], IntegerRef(i));
+  found= 0;
+  for (int i= 0; i < key_count; i++)
+    found+= dict.has_key(keys[(i * 7) % key_count]);
+  ensure_equals("dict lookups", found, (size_t)key_count);
+#if VERBOSE_OUTPUT
+  std::cout << "Dict: " << key_count << " inserts and lookups in " << base::timestamp() - start << "s" << std::endl;
+#endif
+
+  const int object_count= 20000;
+  ListRef<internal::Object> list(&grt);
+  for (int i= 0; i < object_count; i++)
+    list.insert(grt.create_object<internal::Object>("test.Book"));
+
+#if VERBOSE_OUTPUT
+  start= base::timestamp();
+#endif
+  size_t sum= 0;
+  for (int i= 0; i < object_count; i+= 10)
+  {
+    ObjectRef object(list[i]);
+    sum+= std::find(list.content().raw_begin(), list.content().raw_end(), object) - list.content().raw_begin();
+  }
+#if VERBOSE_OUTPUT
+  std::cout << "List scan: " << object_count / 10 << " lookups in " << base::timestamp() - start << "s" << std::endl;
+  start= base::timestamp();
+#endif
+
+  size_t indexed_sum= 0;
+  for (int i= 0; i < object_count; i+= 10)
+    indexed_sum+= list.get_index(list[i]);
+  ensure_equals("get_index results", indexed_sum, sum);
+#if VERBOSE_OUTPUT
+  std::cout << "List index: " << object_count / 10 << " lookups in " << base::timestamp() - start << "s" << std::endl;
+#endif
+}
+
+TEST_FUNCTION(41)
+{
+  // Iterators made before the dict compacts its removed entries must not be used afterwards.
+  DictRef dict(&grt);
+  for (int i= 0; i < 100; i++)
+    dict.set(base::strfmt("key%i", i), IntegerRef(i));
+  for (int i= 0; i < 50; i++)
+    dict.remove(base::strfmt("key%i", i));
+
+  DictRef::const_iterator iter= dict.begin();
+  ensure_equals("first entry", iter->first, "key50");
+
+  // Enough new keys to make the table grow, which drops the removed entries.
+  for (int i= 100; i < 300; i++)
+    dict.set(base::strfmt("key%i", i), IntegerRef(i));
+  ensure_equals("count", dict.count(), 250U);
+  ensure_equals("new iterator", dict.begin()->first, "key50");
+
+  try
+  {
+    *iter;
+    fail("stale dict iterator was usable");
+  }
+  catch (std::logic_error &)
+  {
+  }
+}
+
 END_TESTS
@@ -336,8 +336,10 @@ bool GtkCanvas::redraw(GdkEventExpose *ev)
 
     static const char *debug_canvas= getenv("DEBUG_CANVAS");
     if (debug_canvas)
-      printf("rendertime= %.4f (%.1ffps)\n", (tv2.tv_sec - tv.tv_sec) + (tv2.tv_usec - tv.tv_usec)/1000000.0,
-             1.0/((tv2.tv_sec - tv.tv_sec) + (tv2.tv_usec - tv.tv_usec)/1000000.0));
+      printf("rendertime= %.4f (%.1ffps), %i items painted, %.1f repaints/s\n",
+             (tv2.tv_sec - tv.tv_sec) + (tv2.tv_usec - tv.tv_usec)/1000000.0,
+             1.0/((tv2.tv_sec - tv.tv_sec) + (tv2.tv_usec - tv.tv_usec)/1000000.0),
+             (int)_canvas->get_painted_item_count(), _canvas->get_fps());
   }
 
   return true;
@@ -64,12 +64,20 @@ void AreaGroup::repaint_contents(const Rect &localClipArea, bool direct)
       cr->translate(get_position());
     }
 
-    for (std::list<CanvasItem*>::reverse_iterator iter= _contents.rbegin(); 
-         iter != _contents.rend(); ++iter)
+    std::vector<CanvasItem*> items;
+    get_contents_in(localClipArea, items);
+
+    size_t painted= 0;
+    for (std::vector<CanvasItem*>::const_iterator iter= items.begin(); iter != items.end(); ++iter)
     {
       if ((*iter)->get_visible() && (*iter)->intersects(localClipArea))
+      {
         (*iter)->repaint(localClipArea, direct);
+        painted++;
+      }
     }
+    _layer->get_view()->bookkeep_painted_items(painted);
+
     if (_layer->get_view()->has_gl() && !direct)
     {
       glMatrixMode(GL_MODELVIEW);
@@ -137,6 +137,8 @@ void CanvasItem::set_bounds(const Rect &rect)
     _size= rect.size;
   
   //  _bounds_changed_signal.emit(obounds);
+    if (_parent)
+      _parent->child_bounds_changed(this, obounds);
   
     update_handles();
   }
@@ -153,6 +155,8 @@ void CanvasItem::set_position(const Point &pos)
     _pos= pos.round();
   
     _bounds_changed_signal(obounds);
+    if (_parent)
+      _parent->child_bounds_changed(this, obounds);
   
     update_handles();
   }
@@ -168,6 +172,8 @@ void CanvasItem::set_size(const Size &size)
     _size= size;
 
     _bounds_changed_signal(obounds);
+    if (_parent)
+      _parent->child_bounds_changed(this, obounds);
   
     update_handles();
   }
@@ -302,6 +308,8 @@ void CanvasItem::set_fixed_size(const Size &size)
   _fixed_size= size;
   _size= size;
   _bounds_changed_signal(obounds);
+  if (_parent)
+    _parent->child_bounds_changed(this, obounds);
   set_needs_relayout();
 }
 
@@ -302,6 +302,9 @@ protected:
   virtual bool on_double_click(CanvasItem *target, const base::Point &point, MouseButton button, EventState state);
 
   virtual bool on_drag_handle(ItemHandle *handle, const base::Point &pos, bool dragging);
+
+  // Called on the parent whenever position or size of one of its direct children change.
+  virtual void child_bounds_changed(CanvasItem *item, const base::Rect &obounds) {}
 };
 
 
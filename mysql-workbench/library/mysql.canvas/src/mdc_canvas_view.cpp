@@ -56,7 +56,8 @@ struct CanvasAutoLock
 };
 
 CanvasView::CanvasView(int width, int height)
-  : _fps(0), _total_item_cache_mem(0), _last_click_info(3)
+  : _fps(0), _last_repaint_time(0), _fps_period_start(0), _fps_period_frames(0), _painted_item_count(0),
+    _total_item_cache_mem(0), _last_click_info(3)
 {  
   base::threading_init();
 
@@ -90,6 +91,7 @@ CanvasView::CanvasView(int width, int height)
 
   _repaint_lock= 0;
   _repaints_missed= 0;
+  _missed_repaint_all= false;
   _ui_lock= 0;
 
   _printout_mode= false;
@@ -220,7 +222,10 @@ void CanvasView::unlock_redraw()
 
   if (_repaint_lock == 0 && _repaints_missed > 0)
   {
-    queue_repaint();
+    if (_missed_repaint_all)
+      queue_repaint();
+    else
+      queue_repaint(_missed_repaint_area);
   }
 }
 
@@ -581,9 +586,33 @@ static bool is_line(CanvasItem *item)
 }
 
 
+/**
+ * Lines are only indexed for crossings while hops are drawn. So when turning hops on, all lines are indexed
+ * (and get their hops) and when turning them off the index and all hops are dropped.
+ */
 void CanvasView::set_draws_line_hops(bool flag)
 {
+  if (_line_hop_rendering == flag)
+    return;
+
   _line_hop_rendering= flag;
+  if (flag)
+  {
+    std::list<CanvasItem*> lines= get_items_bounded_by(Rect(Point(0, 0), get_total_view_size()), std::ptr_fun(is_line));
+    for (std::list<CanvasItem*>::const_iterator iter= lines.begin(); iter != lines.end(); ++iter)
+      update_line_crossings(static_cast<Line*>(*iter));
+  }
+  else
+  {
+    for (std::map<Line*, std::set<Line*> >::const_iterator iter= _line_crossings.begin(); iter != _line_crossings.end(); ++iter)
+    {
+      for (std::set<Line*>::const_iterator other= iter->second.begin(); other != iter->second.end(); ++other)
+        iter->first->unmark_crossings(*other);
+    }
+    _line_crossings.clear();
+    _line_segment_counts.clear();
+    _line_segments.reset(_line_segments.area());
+  }
   queue_repaint();
 }
 
@@ -592,28 +621,169 @@ void CanvasView::update_line_crossings(Line *line)
 {
   if (!_line_hop_rendering)
     return;
-  
-  // get the lines in the same bounding box
 
-  std::list<CanvasItem*> items= get_items_bounded_by(line->get_root_bounds(),
-                                                     std::ptr_fun(is_line));
+  // The index is subdivided over the view area, so re-add everything if that changed.
+  if (_line_segments.area().size != get_total_view_size())
+  {
+    std::map<Line*, size_t> lines;
+    lines.swap(_line_segment_counts);
+    _line_segments.reset(Rect(Point(0, 0), get_total_view_size()));
+
+    std::vector<Rect> bounds;
+    for (std::map<Line*, size_t>::const_iterator iter= lines.begin(); iter != lines.end(); ++iter)
+      index_line_segments(iter->first, bounds);
+  }
+
+  std::vector<Rect> bounds;
+  index_line_segments(line, bounds);
 
-  std::list<CanvasItem*>::iterator iter= items.begin();
+  // get the lines with a segment touching one of the line's segments
+  std::vector<LineSegment> segments;
+  for (std::vector<Rect>::const_iterator iter= bounds.begin(); iter != bounds.end(); ++iter)
+    _line_segments.query(*iter, segments);
 
-  // check if the line crosses with anything under it
-  for (; iter != items.end() && *iter != line; ++iter)
+  std::set<Line*> crossings;
+  for (std::vector<LineSegment>::const_iterator iter= segments.begin(); iter != segments.end(); ++iter)
   {
-    line->mark_crossings(static_cast<Line*>(*iter));
+    if (iter->first != line && is_line(iter->first) && iter->first->get_layer()->visible())
+      crossings.insert(iter->first);
   }
-  
-  if (iter != items.end())
-    ++iter; // skip the line itself
 
-  // then check if anything over it crosses the line
-  for (; iter != items.end(); ++iter)
+  // lines which don't touch the line anymore only need their hops removed
+  std::set<Line*> &previous= _line_crossings[line];
+  for (std::set<Line*>::const_iterator iter= previous.begin(); iter != previous.end(); ++iter)
+  {
+    if (crossings.find(*iter) == crossings.end())
+    {
+      (*iter)->unmark_crossings(line);
+      line->unmark_crossings(*iter);
+      _line_crossings[*iter].erase(line);
+    }
+  }
+
+  // the line below gets the hop
+  for (std::set<Line*>::const_iterator iter= crossings.begin(); iter != crossings.end(); ++iter)
+  {
+    if (is_stacked_above(*iter, line))
+    {
+      (*iter)->unmark_crossings(line);
+      line->mark_crossings(*iter);
+    }
+    else
+    {
+      line->unmark_crossings(*iter);
+      (*iter)->mark_crossings(line);
+    }
+    _line_crossings[*iter].insert(line);
+  }
+  previous.swap(crossings);
+}
+
+
+/**
+ * Forgets about the given line (which is about to be deleted) and removes the hops other lines have over it.
+ */
+void CanvasView::remove_line_crossings(Line *line)
+{
+  unindex_line_segments(line);
+
+  std::map<Line*, std::set<Line*> >::iterator crossings= _line_crossings.find(line);
+  if (crossings == _line_crossings.end())
+    return;
+
+  for (std::set<Line*>::const_iterator iter= crossings->second.begin(); iter != crossings->second.end(); ++iter)
   {
-    static_cast<Line*>(*iter)->mark_crossings(line);
+    if (!_destroying)
+      (*iter)->unmark_crossings(line);
+    _line_crossings[*iter].erase(line);
   }
+  _line_crossings.erase(crossings);
+}
+
+
+/**
+ * Replaces the segments of the line in the crossings index by its current ones and returns their bounds.
+ */
+void CanvasView::index_line_segments(Line *line, std::vector<Rect> &bounds)
+{
+  unindex_line_segments(line);
+  bounds.clear();
+
+  size_t count= line->count_vertices();
+  if (count < 2)
+    return;
+
+  // vertices are in the coordinates of the line's parent
+  Point origin= line->get_root_position() - line->get_position();
+  Point p1= line->get_vertex(0) + origin;
+
+  for (size_t i= 1; i < count; i++)
+  {
+    Point p2= line->get_vertex(i) + origin;
+    Rect rect(Point(std::min(p1.x, p2.x), std::min(p1.y, p2.y)), Point(std::max(p1.x, p2.x), std::max(p1.y, p2.y)));
+
+    _line_segments.insert(LineSegment(line, i - 1), rect);
+    bounds.push_back(rect);
+    p1= p2;
+  }
+  _line_segment_counts[line]= count - 1;
+}
+
+
+void CanvasView::unindex_line_segments(Line *line)
+{
+  std::map<Line*, size_t>::iterator iter= _line_segment_counts.find(line);
+  if (iter != _line_segment_counts.end())
+  {
+    for (size_t i= 0; i < iter->second; i++)
+      _line_segments.remove(LineSegment(line, i));
+    _line_segment_counts.erase(iter);
+  }
+}
+
+
+/**
+ * Tells whether item is stacked above other, which is the order get_items_bounded_by() returns them in:
+ * front layers first and within a layer the top of each group first, followed by the contents of a group.
+ */
+bool CanvasView::is_stacked_above(CanvasItem *item, CanvasItem *other)
+{
+  if (item->get_layer() != other->get_layer())
+  {
+    for (LayerList::const_iterator iter= _layers.begin(); iter != _layers.end(); ++iter)
+    {
+      if (*iter == item->get_layer())
+        return true;
+      if (*iter == other->get_layer())
+        return false;
+    }
+    return false;
+  }
+
+  // find the ancestors of both that are in the same group
+  std::vector<CanvasItem*> item_path, other_path;
+  for (CanvasItem *i= item; i; i= i->get_parent())
+    item_path.push_back(i);
+  for (CanvasItem *i= other; i; i= i->get_parent())
+    other_path.push_back(i);
+
+  std::vector<CanvasItem*>::const_reverse_iterator i1= item_path.rbegin(), i2= other_path.rbegin();
+  if (*i1 != *i2)
+    return false;
+  while (i1 != item_path.rend() && i2 != other_path.rend() && *i1 == *i2)
+  {
+    ++i1;
+    ++i2;
+  }
+
+  // a group comes before its contents
+  if (i1 == item_path.rend() || i2 == other_path.rend())
+    return i1 == item_path.rend();
+
+  Group *group= dynamic_cast<Group*>((*i1)->get_parent());
+  if (!group)
+    return false;
+  return group->get_stack_position(*i1) < group->get_stack_position(*i2);
 }
 
 
@@ -808,7 +978,9 @@ void CanvasView::repaint_area(const Rect &aBounds, int wx, int wy, int ww, int w
 
   CanvasAutoLock lock(this);
   Rect clip;
+  gint64 start= g_get_monotonic_time();
 
+  _painted_item_count= 0;
   begin_repaint(wx, wy, ww, wh);
   if (has_gl())
     glGetError(); // Resets error flag.
@@ -855,6 +1027,25 @@ void CanvasView::repaint_area(const Rect &aBounds, int wx, int wy, int ww, int w
   _cairo->restore();
 
   end_repaint();
+
+  update_repaint_stats(start);
+}
+
+
+void CanvasView::update_repaint_stats(gint64 start)
+{
+  gint64 now= g_get_monotonic_time();
+
+  _last_repaint_time= (now - start) / 1000000.0;
+
+  if (_fps_period_frames == 0)
+    _fps_period_start= start;
+  _fps_period_frames++;
+  if (now - _fps_period_start >= 1000000)
+  {
+    _fps= _fps_period_frames * 1000000.0 / (now - _fps_period_start);
+    _fps_period_frames= 0;
+  }
 }
 
 
@@ -863,10 +1054,12 @@ void CanvasView::queue_repaint()
   if (_repaint_lock > 0)
   {
     _repaints_missed++;
+    _missed_repaint_all= true;
     return;
   }
 
   _repaints_missed= 0;
+  _missed_repaint_all= false;
 
 //  _needs_repaint= true;
 
@@ -880,7 +1073,16 @@ void CanvasView::queue_repaint(const Rect &bounds)
 {
   if (_repaint_lock > 0)
   {
-    _repaints_missed++;
+    // Only the damaged area needs a repaint once unlocked, not the whole view.
+    if (_repaints_missed++ == 0)
+      _missed_repaint_area= bounds;
+    else
+    {
+      _missed_repaint_area= Rect(Point(std::min(_missed_repaint_area.left(), bounds.left()),
+                                       std::min(_missed_repaint_area.top(), bounds.top())),
+                                 Point(std::max(_missed_repaint_area.right(), bounds.right()),
+                                       std::max(_missed_repaint_area.bottom(), bounds.bottom())));
+    }
     return;
   }
 
@@ -26,6 +26,7 @@
 #include "mdc_events.h"
 #include "mdc_canvas_item.h"
 #include "mdc_selection.h"
+#include "mdc_quad_tree.h"
 #include "base/threading.h"
 
 #ifndef _WIN32
@@ -177,6 +178,7 @@ public:
   Selection::ContentType get_selected_items();
 
   void update_line_crossings(Line *line);
+  void remove_line_crossings(Line *line);
 
   virtual bool initialize();
 
@@ -208,8 +210,12 @@ public:
   void enable_debug(bool flag) { _debug= flag; }
   inline bool debug_enabled() { return _debug; }
 
+  // Repaint statistics, for benchmarking. The fps value is averaged over periods of at least a second.
   double get_fps() { return _fps; }
+  double get_last_repaint_time() { return _last_repaint_time; } // in seconds
+  size_t get_painted_item_count() { return _painted_item_count; } // items painted by the last repaint
   inline void bookkeep_cache_mem(int amount) { _total_item_cache_mem+= amount; }
+  inline void bookkeep_painted_items(size_t count) { _painted_item_count+= count; }
 
   void paint_item_cache(CairoCtx *cr, double x, double y, cairo_surface_t *cached_item, double alpha=1.0);
 
@@ -224,6 +230,8 @@ protected:
   int _ui_lock;
   int _repaint_lock;
   int _repaints_missed;
+  bool _missed_repaint_all;
+  base::Rect _missed_repaint_area; // union of the areas queued while repaints were locked
 
   FontSpec _default_font;
 
@@ -251,10 +259,21 @@ protected:
   bool _printout_mode;
   bool _line_hop_rendering;
 
+  // Segments of the lines drawing hops (in root coordinates), to find the lines crossing a changed line
+  // without checking all lines in its bounding box.
+  typedef std::pair<Line*, size_t> LineSegment;
+  QuadTree<LineSegment> _line_segments;
+  std::map<Line*, size_t> _line_segment_counts;
+  std::map<Line*, std::set<Line*> > _line_crossings; // lines that may have hops with the key line, in either direction
+
   bool _destroying;
   bool _debug;
 
   double _fps;
+  double _last_repaint_time;
+  gint64 _fps_period_start;
+  int _fps_period_frames;
+  size_t _painted_item_count;
 
   size_t _total_item_cache_mem;
   
@@ -273,6 +292,10 @@ protected:
   virtual void end_repaint()= 0;
 
   void repaint_area(const base::Rect &rect, int wx, int wy, int ww, int wh);
+  void index_line_segments(Line *line, std::vector<base::Rect> &bounds);
+  void unindex_line_segments(Line *line);
+  bool is_stacked_above(CanvasItem *item, CanvasItem *other);
+  void update_repaint_stats(gint64 start);
 
   void update_offsets();
   void apply_transformations();
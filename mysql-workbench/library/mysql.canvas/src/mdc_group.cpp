@@ -29,6 +29,9 @@
 using namespace mdc;
 using namespace base;
 
+// Groups with fewer items just check each of them on repaint, which is cheaper than maintaining an index.
+#define MIN_INDEXED_CONTENTS 50
+
 Group::Group(Layer *layer)
 : Layouter(layer)
 {
@@ -36,6 +39,8 @@ Group::Group(Layer *layer)
   _activated= false;
 #endif
   _freeze_bounds_updates= 0;
+  _contents_index_valid= false;
+  _stack_positions_valid= false;
   
   set_accepts_focus(true);
   set_accepts_selection(true);  
@@ -73,15 +78,99 @@ void Group::repaint(const Rect &clipArea, bool direct)
     cr->restore();
   }
 
+  std::vector<CanvasItem*> items;
+  get_contents_in(clipRect, items);
+
+  size_t painted= 0;
   cr->save();
   cr->translate(get_position());
-  for (std::list<CanvasItem*>::reverse_iterator iter= _contents.rbegin(); 
-       iter != _contents.rend(); ++iter)
+  for (std::vector<CanvasItem*>::const_iterator iter= items.begin(); iter != items.end(); ++iter)
   {
     if ((*iter)->get_visible() && (*iter)->intersects(clipRect))
+    {
       (*iter)->repaint(clipRect, false);
+      painted++;
+    }
   }
   cr->restore();
+  _layer->get_view()->bookkeep_painted_items(painted);
+}
+
+
+/**
+ * Returns the direct children whose bounds intersect the given rect (in the coordinates of this group),
+ * ordered from the bottom to the top of the stack, i.e. in painting order.
+ */
+void Group::get_contents_in(const Rect &rect, std::vector<CanvasItem*> &items)
+{
+  if (_contents.size() < MIN_INDEXED_CONTENTS)
+  {
+    for (std::list<CanvasItem*>::reverse_iterator iter= _contents.rbegin(); iter != _contents.rend(); ++iter)
+    {
+      if (bounds_intersect((*iter)->get_bounds(), rect))
+        items.push_back(*iter);
+    }
+    return;
+  }
+
+  // The index is subdivided over the group area, so it has to follow size changes (e.g. a resized view).
+  if (!_contents_index_valid || _contents_index.area().size != get_size())
+    rebuild_contents_index();
+  if (!_stack_positions_valid)
+    update_stack_positions();
+
+  std::vector<CanvasItem*> found;
+  _contents_index.query(rect, found);
+
+  std::vector<std::pair<size_t, CanvasItem*> > stacked;
+  stacked.reserve(found.size());
+  for (std::vector<CanvasItem*>::const_iterator iter= found.begin(); iter != found.end(); ++iter)
+    stacked.push_back(std::make_pair(_content_info[*iter].stack_position, *iter));
+
+  // Highest position is the bottom of the stack, which must be painted first.
+  std::sort(stacked.rbegin(), stacked.rend());
+  for (std::vector<std::pair<size_t, CanvasItem*> >::const_iterator iter= stacked.begin(); iter != stacked.end(); ++iter)
+    items.push_back(iter->second);
+}
+
+
+void Group::rebuild_contents_index()
+{
+  _contents_index.reset(Rect(Point(0, 0), get_size()));
+  for (std::list<CanvasItem*>::const_iterator iter= _contents.begin(); iter != _contents.end(); ++iter)
+    _contents_index.insert(*iter, (*iter)->get_bounds());
+  _contents_index_valid= true;
+}
+
+
+void Group::update_stack_positions()
+{
+  size_t position= 0;
+  for (std::list<CanvasItem*>::const_iterator iter= _contents.begin(); iter != _contents.end(); ++iter)
+    _content_info[*iter].stack_position= position++;
+  _stack_positions_valid= true;
+}
+
+
+/**
+ * Returns the position of the given direct child in the stack, 0 being the top.
+ */
+size_t Group::get_stack_position(CanvasItem *item)
+{
+  if (!_stack_positions_valid)
+    update_stack_positions();
+
+  std::map<CanvasItem*, ItemInfo>::const_iterator iter= _content_info.find(item);
+  if (iter == _content_info.end())
+    throw std::invalid_argument("item is not part of the group");
+  return iter->second.stack_position;
+}
+
+
+void Group::child_bounds_changed(CanvasItem *item, const Rect &obounds)
+{
+  if (_contents_index_valid && _contents_index.contains(item))
+    _contents_index.update(item, item->get_bounds());
 }
 
 
@@ -102,6 +191,9 @@ void Group::add(CanvasItem *item)
   item->set_parent(this);
 
   _contents.push_front(item);
+  _stack_positions_valid= false;
+  if (_contents_index_valid)
+    _contents_index.insert(item, item->get_bounds());
   update_bounds();
 
   if (select)
@@ -123,6 +215,8 @@ void Group::remove(CanvasItem *item)
   
   item->set_parent(0);
   _contents.remove(item);
+  _contents_index.remove(item);
+  _stack_positions_valid= false;
   update_bounds();
 }
 
@@ -296,12 +390,14 @@ CanvasItem *Group::get_item_at(const Point &point)
 void Group::raise_item(CanvasItem *item, CanvasItem *above)
 {
   restack_up(_contents, item, above);
+  _stack_positions_valid= false;
 }
 
 
 void Group::lower_item(CanvasItem *item)
 {
   restack_down(_contents, item);
+  _stack_positions_valid= false;
 }
 
 
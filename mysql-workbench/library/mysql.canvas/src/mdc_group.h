@@ -21,6 +21,7 @@
 #define _MDC_GROUP_H_
 
 #include "mdc_layouter.h"
+#include "mdc_quad_tree.h"
 
 BEGIN_MDC_DECLS
 
@@ -39,6 +40,8 @@ public:
   bool has_item(CanvasItem *item);
   std::list<CanvasItem*> &get_contents() { return _contents; };
   bool empty() const { return _contents.empty(); };
+  void get_contents_in(const base::Rect &rect, std::vector<CanvasItem*> &items);
+  size_t get_stack_position(CanvasItem *item);
 
   virtual void foreach(const boost::function<void (CanvasItem*)> &slot);
 
@@ -64,6 +67,7 @@ protected:
   struct ItemInfo
   {
     boost::signals2::connection connection;
+    size_t stack_position; // 0 is the top of the stack, only updated for lookups in _contents_index
   };
     
   // front of list is top stack
@@ -71,11 +75,21 @@ protected:
 
   std::map<CanvasItem*, ItemInfo> _content_info;
   int _freeze_bounds_updates;
+
+  // Bounds of the contents, built on demand for groups with many items (e.g. the root area of big diagrams)
+  // so repainting a small area doesn't need to check every item.
+  QuadTree<CanvasItem*> _contents_index;
+  bool _contents_index_valid;
+  bool _stack_positions_valid;
 #ifdef no_group_activate
   bool _activated;
 #endif
 
   virtual void update_bounds();
+  virtual void child_bounds_changed(CanvasItem *item, const base::Rect &obounds);
+
+  void rebuild_contents_index();
+  void update_stack_positions();
   
   void focus_changed(bool f, CanvasItem *item);
 #ifdef no_group_activate
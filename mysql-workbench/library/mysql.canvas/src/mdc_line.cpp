@@ -119,6 +119,8 @@ Line::Line(Layer *layer, LineLayouter *layouter)
 
 Line::~Line()
 {
+  get_view()->remove_line_crossings(this);
+
   delete _layouter;
 }
 
@@ -839,12 +841,7 @@ void Line::mark_crossings(Line *line)
   //remove any hops we could have on it
   if(line->_segments.size()<2)
   {
-    size_t i= 0; 
-    while (i < _segments.size()) 
-      if (_segments[i].hop == line) 
-        _segments.erase(_segments.begin()+i); 
-      else 
-        i++; 
+    unmark_crossings(line);
     return;
   }
 
@@ -903,6 +900,27 @@ void Line::mark_crossings(Line *line)
 }
 
 
+/**
+ * Removes the hops over the given line, e.g. when it doesn't cross this line anymore.
+ */
+void Line::unmark_crossings(Line *line)
+{
+  size_t count= _segments.size();
+  size_t i= 0;
+
+  while (i < _segments.size())
+  {
+    if (_segments[i].hop == line)
+      _segments.erase(_segments.begin() + i);
+    else
+      i++;
+  }
+
+  if (_segments.size() != count)
+    set_needs_render();
+}
+
+
 void Line::update_bounds()
 {
   if (_vertices.size() <= 1)
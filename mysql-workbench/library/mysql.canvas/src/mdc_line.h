@@ -130,6 +130,7 @@ public:
   bool get_hops_crossings() const { return _hop_crossings; }
 
   virtual void mark_crossings(Line *line);
+  void unmark_crossings(Line *line);
   
   virtual void create_handles(InteractionLayer *ilayer);
   virtual void update_handles();
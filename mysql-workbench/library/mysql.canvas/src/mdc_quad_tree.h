@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef _MDC_QUAD_TREE_H_
+#define _MDC_QUAD_TREE_H_
+
+#include "mdc_common.h"
+
+namespace mdc {
+
+/**
+ * Spatial index of values by their bounds, for looking up everything touching a given area without
+ * visiting all values.
+ *
+ * Each value is kept in the smallest node that fully contains its bounds, so values never need to be
+ * split or duplicated and moving one only relocates that single entry. Values lying (partially) outside
+ * of the indexed area are kept in the root node, i.e. the index stays correct for them, just not faster.
+ * Bounds touch each other with the same inclusive edges bounds_intersect() uses.
+ */
+template<class T>
+  class QuadTree
+{
+public:
+  QuadTree(const base::Rect &area= base::Rect(), int max_depth= 8)
+    : _root(new Node(area, 0)), _max_depth(max_depth)
+  {
+  }
+
+  ~QuadTree()
+  {
+    delete _root;
+  }
+
+  /**
+   * Removes all values and sets the area that is subdivided for the values added afterwards.
+   */
+  void reset(const base::Rect &area)
+  {
+    delete _root;
+    _root= new Node(area, 0);
+    _nodes.clear();
+  }
+
+  const base::Rect &area() const { return _root->area; }
+  size_t size() const { return _nodes.size(); }
+  bool contains(const T &value) const { return _nodes.find(value) != _nodes.end(); }
+
+  void insert(const T &value, const base::Rect &bounds)
+  {
+    if (contains(value))
+      update(value, bounds);
+    else
+    {
+      Node *node= node_for(bounds);
+      node->entries.push_back(Entry(value, bounds));
+      _nodes[value]= node;
+    }
+  }
+
+  void remove(const T &value)
+  {
+    typename std::map<T, Node*>::iterator iter= _nodes.find(value);
+    if (iter != _nodes.end())
+    {
+      iter->second->erase(value);
+      _nodes.erase(iter);
+    }
+  }
+
+  void update(const T &value, const base::Rect &bounds)
+  {
+    typename std::map<T, Node*>::iterator iter= _nodes.find(value);
+    if (iter == _nodes.end())
+    {
+      insert(value, bounds);
+      return;
+    }
+
+    Node *node= node_for(bounds);
+    if (node == iter->second)
+      node->set_bounds(value, bounds);
+    else
+    {
+      iter->second->erase(value);
+      node->entries.push_back(Entry(value, bounds));
+      iter->second= node;
+    }
+  }
+
+  /**
+   * Appends all values whose bounds intersect the given rect to result, in no particular order.
+   */
+  void query(const base::Rect &rect, std::vector<T> &result) const
+  {
+    query(_root, rect, result);
+  }
+
+private:
+  struct Entry
+  {
+    T value;
+    base::Rect bounds;
+
+    Entry(const T &v, const base::Rect &b) : value(v), bounds(b) {}
+  };
+
+  struct Node
+  {
+    base::Rect area;
+    int depth;
+    std::vector<Entry> entries;
+    Node *children[4];
+
+    Node(const base::Rect &a, int d)
+      : area(a), depth(d)
+    {
+      children[0]= children[1]= children[2]= children[3]= 0;
+    }
+
+    ~Node()
+    {
+      for (int i= 0; i < 4; i++)
+        delete children[i];
+    }
+
+    void erase(const T &value)
+    {
+      for (typename std::vector<Entry>::iterator iter= entries.begin(); iter != entries.end(); ++iter)
+      {
+        if (iter->value == value)
+        {
+          // Order doesn't matter, so avoid moving all following entries.
+          *iter= entries.back();
+          entries.pop_back();
+          break;
+        }
+      }
+    }
+
+    void set_bounds(const T &value, const base::Rect &bounds)
+    {
+      for (typename std::vector<Entry>::iterator iter= entries.begin(); iter != entries.end(); ++iter)
+      {
+        if (iter->value == value)
+        {
+          iter->bounds= bounds;
+          break;
+        }
+      }
+    }
+  };
+
+  Node *_root;
+  int _max_depth;
+  std::map<T, Node*> _nodes; // the node each value is stored in
+
+  static bool encloses(const base::Rect &outer, const base::Rect &inner)
+  {
+    return inner.left() >= outer.left() && inner.right() <= outer.right() &&
+      inner.top() >= outer.top() && inner.bottom() <= outer.bottom();
+  }
+
+  static bool touches(const base::Rect &r1, const base::Rect &r2)
+  {
+    return r1.right() >= r2.left() && r1.left() <= r2.right() && r1.bottom() >= r2.top() && r1.top() <= r2.bottom();
+  }
+
+  Node *node_for(const base::Rect &bounds)
+  {
+    Node *node= _root;
+
+    if (!encloses(node->area, bounds))
+      return node;
+
+    while (node->depth < _max_depth)
+    {
+      double half_width= node->area.width() / 2;
+      double half_height= node->area.height() / 2;
+      int quadrant;
+
+      if (bounds.right() <= node->area.left() + half_width)
+        quadrant= 0;
+      else if (bounds.left() >= node->area.left() + half_width)
+        quadrant= 1;
+      else
+        break;
+
+      if (bounds.bottom() <= node->area.top() + half_height)
+        ;
+      else if (bounds.top() >= node->area.top() + half_height)
+        quadrant+= 2;
+      else
+        break;
+
+      if (!node->children[quadrant])
+      {
+        base::Rect area(node->area.left() + (quadrant & 1 ? half_width : 0),
+                        node->area.top() + (quadrant & 2 ? half_height : 0),
+                        half_width, half_height);
+        node->children[quadrant]= new Node(area, node->depth + 1);
+      }
+      node= node->children[quadrant];
+    }
+    return node;
+  }
+
+  static void query(const Node *node, const base::Rect &rect, std::vector<T> &result)
+  {
+    for (typename std::vector<Entry>::const_iterator iter= node->entries.begin(); iter != node->entries.end(); ++iter)
+    {
+      if (touches(iter->bounds, rect))
+        result.push_back(iter->value);
+    }
+
+    for (int i= 0; i < 4; i++)
+    {
+      if (node->children[i] && touches(node->children[i]->area, rect))
+        query(node->children[i], rect, result);
+    }
+  }
+
+  QuadTree(const QuadTree&);
+  QuadTree &operator= (const QuadTree&);
+};
+
+};
+
+#endif /* _MDC_QUAD_TREE_H_ */
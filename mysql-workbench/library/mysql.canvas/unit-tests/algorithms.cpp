@@ -19,11 +19,47 @@
 
 #include "mdc.h"
 #include "mdc_algorithms.h"
+#include "mdc_quad_tree.h"
+#include "mdc_canvas_view_image.h"
 #include "wb_helpers.h"
 
 using namespace mdc;
 using namespace base;
 
+// straight line that tells which lines it hops over
+class HopLine : public Line
+{
+public:
+  HopLine(Layer *layer) : Line(layer) {}
+
+  void set_points(const Point &p1, const Point &p2)
+  {
+    std::vector<Point> points;
+    points.push_back(p1);
+    points.push_back(p2);
+    set_vertices(points);
+    get_view()->update_line_crossings(this);
+  }
+
+  bool hops_over(Line *line) const
+  {
+    for (std::vector<SegmentPoint>::const_iterator iter= _segments.begin(); iter != _segments.end(); ++iter)
+    {
+      if (iter->hop == line)
+        return true;
+    }
+    return false;
+  }
+};
+
+class HopView : public ImageCanvasView
+{
+public:
+  HopView() : ImageCanvasView(1000, 1000) {}
+
+  using CanvasView::is_stacked_above;
+};
+
 BEGIN_TEST_DATA_CLASS(canvas_algorithms)
 END_TEST_DATA_CLASS
 
@@ -79,5 +115,85 @@ TEST_FUNCTION(2) // rect intersection with line
 }
 
 
+TEST_FUNCTION(3) // spatial index, compared to checking all bounds
+{
+  QuadTree<int> tree(Rect(0, 0, 1000, 1000));
+  std::vector<Rect> bounds;
+
+  srand(1);
+  for (int i= 0; i < 500; i++)
+  {
+    // some bounds stick out of the indexed area and some span the center lines
+    bounds.push_back(Rect(rand() % 1100 - 50, rand() % 1100 - 50, rand() % 200, rand() % 200));
+    tree.insert(i, bounds.back());
+  }
+  for (int i= 0; i < 500; i+= 3)
+  {
+    bounds[i].pos= Point(rand() % 1000, rand() % 1000);
+    tree.update(i, bounds[i]);
+  }
+  for (int i= 0; i < 500; i+= 7)
+    tree.remove(i);
+  ensure_equals("index size", tree.size(), (size_t)428);
+
+  for (int q= 0; q < 50; q++)
+  {
+    Rect area(rand() % 1000, rand() % 1000, rand() % 300, rand() % 300);
+    std::vector<int> found;
+    std::vector<int> expected;
+
+    tree.query(area, found);
+    for (int i= 0; i < 500; i++)
+    {
+      if (i % 7 != 0 && bounds_intersect(bounds[i], area))
+        expected.push_back(i);
+    }
+    std::sort(found.begin(), found.end());
+    ensure("query result", found == expected);
+  }
+}
+
+
+
+TEST_FUNCTION(4) // line crossings index
+{
+  HopView view;
+  view.initialize();
+  view.set_draws_line_hops(false); // as for a new diagram with the default options
+
+  Layer *layer= view.get_current_layer();
+  HopLine *lower= new HopLine(layer);
+  layer->add_item(lower);
+  lower->set_points(Point(100, 500), Point(900, 500));
+  HopLine *upper= new HopLine(layer);
+  layer->add_item(upper);
+  upper->set_points(Point(500, 100), Point(500, 900));
+
+  ensure("stacked above", view.is_stacked_above(upper, lower));
+  ensure("stacked below", !view.is_stacked_above(lower, upper));
+  ensure("no hops while disabled", !lower->hops_over(upper) && !upper->hops_over(lower));
+
+  // lines that exist already are indexed once hops are turned on
+  view.set_draws_line_hops(true);
+  ensure("lower line hops", lower->hops_over(upper));
+  ensure("upper line doesn't hop", !upper->hops_over(lower));
+
+  // a line that doesn't cross anymore has its hops removed
+  upper->set_points(Point(50, 100), Point(50, 400));
+  ensure("hop removed", !lower->hops_over(upper));
+  upper->set_points(Point(500, 100), Point(500, 900));
+  ensure("hop back", lower->hops_over(upper));
+
+  // the hop moves to the other line when the stacking changes
+  layer->get_root_area_group()->raise_item(lower);
+  ensure("raised line stacked above", view.is_stacked_above(lower, upper));
+  lower->set_points(Point(100, 500), Point(900, 500));
+  ensure("hop moved", upper->hops_over(lower) && !lower->hops_over(upper));
+
+  view.set_draws_line_hops(false);
+  ensure("hops dropped", !upper->hops_over(lower) && !lower->hops_over(upper));
+}
+
+
 
 END_TESTS
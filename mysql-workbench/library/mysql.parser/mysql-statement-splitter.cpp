@@ -0,0 +1,627 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <stdexcept>
+#include <algorithm>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "base/string_utilities.h"
+#include "base/file_functions.h"
+
+#include "mysql-statement-splitter.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define USE_SSE2 1
+  #include <emmintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #endif
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+#ifdef USE_SSE2
+
+static inline int first_bit(int mask)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (int)index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns the first position in the given range with a character that needs attention by the splitter
+ * (a comment, quote or DELIMITER keyword start or the first delimiter char) or end if there is none.
+ * have_content is set if any of the characters skipped is not whitespace.
+ */
+static const unsigned char *find_special_char(const unsigned char *position, const unsigned char *end,
+  unsigned char delimiter_char, bool &have_content)
+{
+#ifdef USE_SSE2
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i dash = _mm_set1_epi8('-');
+  const __m128i hash = _mm_set1_epi8('#');
+  const __m128i double_quote = _mm_set1_epi8('"');
+  const __m128i single_quote = _mm_set1_epi8('\'');
+  const __m128i back_tick = _mm_set1_epi8('`');
+  const __m128i lower_d = _mm_set1_epi8('d');
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+  const __m128i delimiter = _mm_set1_epi8((char)delimiter_char);
+  const __m128i non_space = _mm_set1_epi8(' ' + 1);
+
+  while (end - position >= 16)
+  {
+    __m128i block = _mm_loadu_si128((const __m128i *)position);
+
+    __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, slash), _mm_cmpeq_epi8(block, dash));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, hash));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, double_quote));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, single_quote));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, back_tick));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(_mm_or_si128(block, case_bit), lower_d));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, delimiter));
+    int hit_mask = _mm_movemask_epi8(hits);
+
+    // Unsigned compare: a byte is > ' ' if it is the maximum of itself and ' ' + 1.
+    int content_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(block, non_space), block));
+
+    if (hit_mask != 0)
+    {
+      int index = first_bit(hit_mask);
+      if ((content_mask & ((1 << index) - 1)) != 0)
+        have_content = true;
+      return position + index;
+    }
+
+    if (content_mask != 0)
+      have_content = true;
+    position += 16;
+  }
+#endif
+
+  while (position < end)
+  {
+    switch (*position)
+    {
+      case '/':
+      case '-':
+      case '#':
+      case '"':
+      case '\'':
+      case '`':
+      case 'd':
+      case 'D':
+        return position;
+
+      default:
+        if (*position == delimiter_char)
+          return position;
+        if (*position > ' ')
+          have_content = true;
+        ++position;
+    }
+  }
+  return end;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns the position of the closing quote char or the next escape char, whichever comes first,
+ * or end if there is none.
+ */
+static const unsigned char *find_quote_or_escape(const unsigned char *position, const unsigned char *end,
+  unsigned char quote)
+{
+#ifdef USE_SSE2
+  const __m128i quotes = _mm_set1_epi8((char)quote);
+  const __m128i escapes = _mm_set1_epi8('\\');
+
+  while (end - position >= 16)
+  {
+    __m128i block = _mm_loadu_si128((const __m128i *)position);
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quotes), _mm_cmpeq_epi8(block, escapes)));
+    if (mask != 0)
+      return position + first_bit(mask);
+    position += 16;
+  }
+#endif
+
+  while (position < end && *position != quote && *position != '\\')
+    ++position;
+  return position;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static const unsigned char *find_char(const unsigned char *position, const unsigned char *end, unsigned char c)
+{
+  const void *result = memchr(position, c, end - position);
+  return result == NULL ? end : (const unsigned char *)result;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static const unsigned char *skip_leading_whitespace(const unsigned char *head, const unsigned char *tail)
+{
+  while (head < tail && *head <= ' ')
+    head++;
+  return head;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+MySQLStatementSplitter::MySQLStatementSplitter(const char *text, size_t length, const std::string &initial_delimiter,
+  const std::string &line_break)
+  : _file(NULL), _text((const unsigned char *)text), _end((const unsigned char *)text + length),
+    _initial_delimiter(initial_delimiter.empty() ? ";" : initial_delimiter), _line_break(line_break)
+{
+  reset();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+MySQLStatementSplitter::~MySQLStatementSplitter()
+{
+  if (_file != NULL)
+    g_mapped_file_unref(_file);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Creates a splitter for the content of the given file, which is mapped into memory instead of
+ * being read, so even very large scripts can be split with little memory use.
+ * The caller is responsible for freeing the returned splitter.
+ */
+MySQLStatementSplitter *MySQLStatementSplitter::open_file(const std::string &path,
+  const std::string &initial_delimiter, const std::string &line_break)
+{
+  char *local_filename = g_filename_from_utf8(path.c_str(), -1, NULL, NULL, NULL);
+  if (local_filename == NULL)
+    throw std::runtime_error("Error converting file name " + path);
+
+  GError *error = NULL;
+  GMappedFile *file = g_mapped_file_new(local_filename, FALSE, &error);
+  g_free(local_filename);
+  if (file == NULL)
+  {
+    std::string message = error != NULL ? error->message : "unknown error";
+    if (error != NULL)
+      g_error_free(error);
+    throw std::runtime_error("Could not open file " + path + ": " + message);
+  }
+
+  MySQLStatementSplitter *splitter = new MySQLStatementSplitter(g_mapped_file_get_contents(file),
+    g_mapped_file_get_length(file), initial_delimiter, line_break);
+  splitter->_file = file;
+  return splitter;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns true if the text is exactly one statement, which ends where the text ends when the delimiter
+ * is appended. That is not the case if the text contains the delimiter itself (outside of quotes and
+ * comments) or a DELIMITER command, or if it ends within a quote or comment, which would swallow
+ * the appended delimiter.
+ */
+bool MySQLStatementSplitter::is_single_statement(const char *text, size_t length, const std::string &delimiter)
+{
+  std::string terminated(text, length);
+  terminated += delimiter;
+
+  MySQLStatementSplitter splitter(terminated.c_str(), terminated.size(), delimiter);
+  size_t start, statement_length;
+  if (!splitter.next(start, statement_length) || start + statement_length != length)
+    return false;
+  return !splitter.next(start, statement_length);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Starts over at the beginning of the text.
+ */
+void MySQLStatementSplitter::reset()
+{
+  _delimiter = _initial_delimiter;
+  _head = _text;
+  _tail = _text;
+  _have_content = false;
+  _done = _text == NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Continues splitting at the given position (which must be the start of a statement, e.g. the end of
+ * a range returned before) using the given delimiter.
+ */
+void MySQLStatementSplitter::seek(size_t position, const std::string &delimiter)
+{
+  _delimiter = delimiter;
+  _head = _text + std::min(position, text_length());
+  _tail = _head;
+  _have_content = false;
+  _done = _text == NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool MySQLStatementSplitter::is_line_break(const unsigned char *position) const
+{
+  if (_line_break.empty() || (size_t)(_end - position) < _line_break.size())
+    return false;
+  return memcmp(position, _line_break.c_str(), _line_break.size()) == 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns the start of the next line break at or after the given position or the text end if there is none.
+ */
+const unsigned char *MySQLStatementSplitter::find_line_break(const unsigned char *position) const
+{
+  if (_line_break.empty())
+    return _end;
+
+  while (true)
+  {
+    position = find_char(position, _end, _line_break[0]);
+    if (position == _end || is_line_break(position))
+      return position;
+    ++position;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Determines the next statement, returning its start offset and length in the text.
+ * Leading whitespace and comments are not part of a statement (except for hidden commands),
+ * the delimiter isn't either. DELIMITER commands are handled internally and not returned.
+ * Returns false if there are no more statements.
+ */
+bool MySQLStatementSplitter::next(size_t &start, size_t &length)
+{
+  if (_done)
+    return false;
+
+  const unsigned char *keyword = (const unsigned char *)"delimiter";
+
+  const unsigned char *head = _head;
+  const unsigned char *tail = _tail;
+  const unsigned char *end = _end;
+  bool have_content = _have_content;
+  bool found = false;
+
+  while (!found && tail < end)
+  {
+    switch (*tail)
+    {
+      case '/': // Possible multi line comment or hidden (conditional) command.
+        if (tail + 1 < end && *(tail + 1) == '*')
+        {
+          tail += 2;
+          bool is_hidden_command = tail < end && *tail == '!';
+          while (true)
+          {
+            tail = find_char(tail, end, '*');
+            if (tail == end) // Unfinished comment.
+              break;
+
+            if (++tail < end && *tail == '/')
+            {
+              tail++; // Skip the slash too.
+              break;
+            }
+          }
+
+          if (!is_hidden_command && !have_content)
+            head = tail; // Skip over the comment.
+        }
+        else
+          tail++;
+
+        break;
+
+      case '-': // Possible single line comment.
+      {
+        const unsigned char *end_char = tail + 2;
+        if (end_char < end && *(tail + 1) == '-' &&
+          (*end_char == ' ' || *end_char == '\t' || is_line_break(end_char)))
+        {
+          // Skip everything until the end of the line.
+          tail = find_line_break(end_char);
+          if (!have_content)
+            head = tail;
+        }
+        else
+          tail++;
+
+        break;
+      }
+
+      case '#': // MySQL single line comment.
+        tail = find_line_break(tail);
+        if (!have_content)
+          head = tail;
+        break;
+
+      case '"':
+      case '\'':
+      case '`': // Quoted string/id. Skip this in a local loop.
+      {
+        have_content = true;
+        unsigned char quote = *tail++;
+        while (true)
+        {
+          tail = find_quote_or_escape(tail, end, quote);
+          if (tail == end)
+            break;
+
+          if (*tail == quote)
+          {
+            tail++; // Skip trailing quote char.
+            break;
+          }
+
+          // Skip any escaped character too.
+          tail += 2;
+          if (tail > end)
+            tail = end;
+        }
+
+        break;
+      }
+
+      case 'd':
+      case 'D':
+      {
+        have_content = true;
+
+        // Possible start of the keyword DELIMITER. Must be at the start of the text or a character,
+        // which is not part of a regular MySQL identifier (0-9, A-Z, a-z, _, $, \u0080-\uffff).
+        unsigned char previous = tail > _text ? *(tail - 1) : 0;
+        bool is_identifier_char = previous >= 0x80
+          || (previous >= '0' && previous <= '9')
+          || ((previous | 0x20) >= 'a' && (previous | 0x20) <= 'z')
+          || previous == '$'
+          || previous == '_';
+        if (tail == _text || !is_identifier_char)
+        {
+          bool is_keyword = end - tail > 9 && *(tail + 9) == ' ';
+          for (int i = 1; is_keyword && i < 9; ++i)
+            is_keyword = (*(tail + i) | 0x20) == keyword[i];
+
+          if (is_keyword)
+          {
+            // Delimiter keyword found. Get the new delimiter (everything until the end of the line).
+            tail += 9;
+            const unsigned char *run = find_line_break(tail + 1);
+            _delimiter = base::trim(std::string((const char *)tail, run - tail));
+
+            // Skip over the delimiter statement and any following line breaks.
+            while (is_line_break(run))
+              run++;
+            tail = run;
+            head = tail;
+          }
+          else
+            tail++;
+        }
+        else
+          tail++;
+
+        break;
+      }
+
+      default:
+        // Anything else is plain text, which we can skip quickly up to the next char of interest.
+        if (*tail > ' ')
+          have_content = true;
+        tail = find_special_char(tail + 1, end, _delimiter.empty() ? 0 : _delimiter[0], have_content);
+        break;
+    }
+
+    if (tail < end && !_delimiter.empty() && *tail == (unsigned char)_delimiter[0])
+    {
+      // Found possible start of the delimiter. Check if it really is.
+      size_t count = _delimiter.size();
+      if (count == 1 || ((size_t)(end - tail) >= count && memcmp(tail, _delimiter.c_str(), count) == 0))
+      {
+        // Trim the statement and check if it is not empty before returning the range.
+        head = skip_leading_whitespace(head, tail);
+        if (head < tail)
+        {
+          start = head - _text;
+          length = tail - head;
+          found = true;
+        }
+        tail += count;
+        head = tail;
+        have_content = false;
+      }
+    }
+  }
+
+  if (!found)
+  {
+    // Return remaining text as last statement.
+    _done = true;
+    head = skip_leading_whitespace(head, tail);
+    if (head < tail)
+    {
+      start = head - _text;
+      length = tail - head;
+      found = true;
+    }
+  }
+
+  _head = head;
+  _tail = tail;
+  _have_content = have_content;
+
+  return found;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+MySQLScriptReader::MySQLScriptReader(const std::string &path, const std::string &initial_delimiter,
+  const std::string &line_break, size_t window_size)
+  : _file_size(0), _eof(false), _window(NULL), _window_size(window_size > 0 ? window_size : 1), _filled(0),
+    _window_offset(0), _consumed(0), _delimiter(initial_delimiter.empty() ? ";" : initial_delimiter),
+    _line_break(line_break), _splitter(NULL)
+{
+  _file = base_fopen(path.c_str(), "rb");
+  if (_file == NULL)
+    throw std::runtime_error("Could not open file " + path + ": " + g_strerror(errno));
+
+  GStatBuf stat_buffer;
+  char *local_filename = g_filename_from_utf8(path.c_str(), -1, NULL, NULL, NULL);
+  if (local_filename != NULL && g_stat(local_filename, &stat_buffer) == 0)
+    _file_size = stat_buffer.st_size;
+  g_free(local_filename);
+
+  _window = (char *)g_malloc(_window_size);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+MySQLScriptReader::~MySQLScriptReader()
+{
+  delete _splitter;
+  g_free(_window);
+  fclose(_file);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Moves the part of the window that was not consumed yet to its start and reads more data behind it.
+ * The window is enlarged if there's no room left (a statement larger than the window).
+ * Splitting starts over at the first unconsumed char.
+ */
+bool MySQLScriptReader::fill_window()
+{
+  // The last consumed char is kept, as the splitter looks at it when it finds a DELIMITER keyword.
+  if (_consumed > 1)
+  {
+    size_t keep = _consumed - 1;
+    memmove(_window, _window + keep, _filled - keep);
+    _window_offset += keep;
+    _filled -= keep;
+    _consumed = 1;
+  }
+
+  if (_filled == _window_size)
+  {
+    _window_size *= 2;
+    _window = (char *)g_realloc(_window, _window_size);
+  }
+
+  size_t requested = _window_size - _filled;
+  size_t count = fread(_window + _filled, 1, requested, _file);
+  if (count < requested)
+  {
+    if (ferror(_file))
+      throw std::runtime_error(std::string("Error reading script file: ") + g_strerror(errno));
+    _eof = true;
+  }
+
+  // Remove a UTF-8 BOM at the start of the file, it's not part of the first statement.
+  if (_window_offset == 0 && _filled == 0 && count >= 3 && memcmp(_window, "\xef\xbb\xbf", 3) == 0)
+  {
+    count -= 3;
+    memmove(_window, _window + 3, count);
+    _window_offset = 3;
+  }
+  _filled += count;
+
+  delete _splitter;
+  _splitter = new MySQLStatementSplitter(_window, _filled, _delimiter, _line_break);
+  _splitter->seek(_consumed, _delimiter);
+
+  return count > 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns the next statement from the file. The returned text points into the read window and stays
+ * valid until the next call. Returns false at the end of the file.
+ */
+bool MySQLScriptReader::next(const char *&statement, size_t &length)
+{
+  if (_splitter == NULL)
+    fill_window();
+
+  while (true)
+  {
+    size_t start;
+    if (_splitter->next(start, length))
+    {
+      // A statement reaching up to the end of the window might continue in the file,
+      // unless the file end was reached already.
+      if (start + length < _filled || _eof)
+      {
+        statement = _window + start;
+        _consumed = _splitter->position();
+        _delimiter = _splitter->delimiter();
+        return true;
+      }
+    }
+    else if (_eof)
+    {
+      _consumed = _filled;
+      return false;
+    }
+
+    // Whatever is left in the window is incomplete. Get more data and split it again.
+    fill_window();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool MySQLScriptReader::next(std::string &statement)
+{
+  const char *text;
+  size_t length;
+  if (!next(text, length))
+    return false;
+
+  statement.assign(text, length);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "mysql-parser-common.h"
+
+typedef struct _GMappedFile GMappedFile;
+
+/**
+ * Splits SQL text into single statements, handling quotes, comments and DELIMITER commands.
+ * Statements are determined on demand by next(), so a caller can start working on the first
+ * statement without waiting for the entire text to be scanned. The text is never copied, ranges
+ * refer to the original text (or the mapped file, see open_file()).
+ *
+ * Plain text between the interesting characters is skipped in blocks (using SSE2 where available).
+ */
+class MYSQL_PARSER_PUBLIC_FUNC MySQLStatementSplitter
+{
+public:
+  MySQLStatementSplitter(const char *text, size_t length, const std::string &initial_delimiter = ";",
+    const std::string &line_break = "\n");
+  ~MySQLStatementSplitter();
+
+  static MySQLStatementSplitter *open_file(const std::string &path, const std::string &initial_delimiter = ";",
+    const std::string &line_break = "\n");
+  static bool is_single_statement(const char *text, size_t length, const std::string &delimiter = ";");
+
+  bool next(size_t &start, size_t &length);
+  void reset();
+  void seek(size_t position, const std::string &delimiter);
+
+  const char *text() const { return (const char *)_text; };
+  size_t text_length() const { return _end - _text; };
+  size_t position() const { return _tail - _text; };
+  const std::string &delimiter() const { return _delimiter; };
+
+private:
+  GMappedFile *_file;
+  const unsigned char *_text;
+  const unsigned char *_end;
+  std::string _initial_delimiter;
+  std::string _delimiter;
+  std::string _line_break;
+
+  const unsigned char *_head;
+  const unsigned char *_tail;
+  bool _have_content; // Set when anything else but comments were found for the current statement.
+  bool _done;
+
+  MySQLStatementSplitter(const MySQLStatementSplitter &);
+  MySQLStatementSplitter &operator = (const MySQLStatementSplitter &);
+
+  bool is_line_break(const unsigned char *position) const;
+  const unsigned char *find_line_break(const unsigned char *position) const;
+};
+
+/**
+ * Reads statements from a script file of any size. The file is read through a window of limited size,
+ * which only grows if a single statement doesn't fit into it, so memory use does not depend on the
+ * size of the file. Statements are split (using MySQLStatementSplitter) as they are needed.
+ */
+class MYSQL_PARSER_PUBLIC_FUNC MySQLScriptReader
+{
+public:
+  MySQLScriptReader(const std::string &path, const std::string &initial_delimiter = ";",
+    const std::string &line_break = "\n", size_t window_size = 16 * 1024 * 1024);
+  ~MySQLScriptReader();
+
+  bool next(const char *&statement, size_t &length);
+  bool next(std::string &statement);
+
+  uint64_t file_size() const { return _file_size; };
+  uint64_t bytes_consumed() const { return _window_offset + _consumed; };
+
+private:
+  FILE *_file;
+  uint64_t _file_size;
+  bool _eof;
+
+  char *_window;
+  size_t _window_size;
+  size_t _filled;         // Number of bytes in the window.
+  uint64_t _window_offset; // Position of the window in the file.
+  size_t _consumed;       // Offset in the window after the last returned statement (or DELIMITER command).
+
+  std::string _delimiter;
+  std::string _line_break;
+  MySQLStatementSplitter *_splitter;
+
+  MySQLScriptReader(const MySQLScriptReader &);
+  MySQLScriptReader &operator = (const MySQLScriptReader &);
+
+  bool fill_window();
+};
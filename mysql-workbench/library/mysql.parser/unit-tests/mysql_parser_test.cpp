@@ -23,9 +23,12 @@
 
 #include "grtsqlparser/sql_facade.h"
 #include "mysql-parser.h"
+#include "mysql-statement-splitter.h"
+#include "mysql-scanner.h"
 
 
 #include <boost/assign/list_of.hpp>
+#include <boost/scoped_ptr.hpp>
 
 // This file contains unit tests for the sql facade based statement splitter and the ANTLR based parser.
 // These are low level tests. There's another set of high level tests (see test_mysql_sql_parser.cpp).
@@ -892,6 +895,149 @@ TEST_FUNCTION(40)
   }
 }
 
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Statement splitter on quotes, comments and delimiter changes. Blocks of plain text longer
+ * than the scan width make sure the vectorized skip is involved too.
+ */
+TEST_FUNCTION(45)
+{
+  std::string padding(40, 'x');
+  std::string sql = "select '" + padding + ";\\';';\n"
+    "-- comment;\n"
+    "/* comment; */ select `a;b` from t" + padding + ";\n"
+    "/*!50100 select 1 */;\n"
+    "delimiter $$\n"
+    "create procedure p() begin select 1; select \"$$\"; end$$\n"
+    "DELIMITER ;\n"
+    "select 2 # trailing comment; here\n;"
+    "select 3";
+
+  const char *expected[] = {
+    "select '" "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" ";\\';'",
+    "select `a;b` from txxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx",
+    "/*!50100 select 1 */",
+    "create procedure p() begin select 1; select \"$$\"; end",
+    "select 2 # trailing comment; here\n",
+    "select 3"
+  };
+
+  MySQLStatementSplitter splitter(sql.c_str(), sql.size());
+  size_t start, length;
+  size_t count = 0;
+  while (splitter.next(start, length))
+  {
+    ensure("45.1", count < sizeof(expected) / sizeof(expected[0]));
+    ensure_equals("45.2", sql.substr(start, length), expected[count]);
+    ++count;
+  }
+  ensure_equals("45.3", count, sizeof(expected) / sizeof(expected[0]));
+  ensure_equals("45.4", splitter.delimiter(), ";");
+
+  // A mapped file must give the same ranges as its content in memory.
+  const char *file_name = "data/db/sakila-db/sakila-data.sql";
+  gchar *contents = NULL;
+  gsize size = 0;
+  ensure("45.5", g_file_get_contents(file_name, &contents, &size, NULL) == TRUE);
+
+  MySQLStatementSplitter memory_splitter(contents, size);
+  boost::scoped_ptr<MySQLStatementSplitter> file_splitter(MySQLStatementSplitter::open_file(file_name));
+  ensure_equals("45.6", file_splitter->text_length(), size);
+
+  size_t file_start, file_length;
+  count = 0;
+  while (memory_splitter.next(start, length))
+  {
+    ensure("45.7", file_splitter->next(file_start, file_length));
+    ensure_equals("45.8", file_start, start);
+    ensure_equals("45.9", file_length, length);
+    ++count;
+  }
+  ensure("45.10", !file_splitter->next(file_start, file_length));
+  ensure("45.11", count > 0);
+  g_free(contents);
+}
+
+/**
+ * Reading a script file through a small window must give the same statements as splitting the
+ * entire file at once.
+ */
+TEST_FUNCTION(50)
+{
+  const char *file_name = "data/db/sakila-db/sakila-schema.sql";
+  gchar *contents = NULL;
+  gsize size = 0;
+  ensure("50.1", g_file_get_contents(file_name, &contents, &size, NULL) == TRUE);
+
+  MySQLStatementSplitter splitter(contents, size);
+  MySQLScriptReader reader(file_name, ";", "\n", 4096);
+  ensure_equals("50.2", reader.file_size(), (uint64_t)size);
+
+  size_t start, length;
+  std::string statement;
+  size_t count = 0;
+  while (splitter.next(start, length))
+  {
+    ensure("50.3", reader.next(statement));
+    ensure_equals("50.4", statement, std::string(contents + start, length));
+    ++count;
+  }
+  ensure("50.5", !reader.next(statement));
+  ensure_equals("50.6", reader.bytes_consumed(), (uint64_t)size);
+  ensure("50.7", count > 0);
+  g_free(contents);
+}
+
+static MySQLQueryType query_type(MySQLQueryIdentifier &identifier, const char *text)
+{
+  return identifier.getQueryType(text, strlen(text), true);
+}
+
+/**
+ * Statements from a script are sent together in one request only if they are single DML statements,
+ * which the SQL editor determines with is_single_statement() and the query identifier.
+ */
+TEST_FUNCTION(55)
+{
+  const char *single[] = {
+    "insert into t values (1)",
+    "insert into t values ('a;b', \"c;\\\";\", `d;`)",
+    "/* leading; */ insert into t values (1)",
+    "insert into t values (1) /* ; */",
+    "insert into t values (1) -- comment\n",
+    "/*!40000 insert into t values (1) */"
+  };
+  for (size_t i = 0; i < sizeof(single) / sizeof(single[0]); ++i)
+    ensure(base::strfmt("55.1 %s", single[i]), MySQLStatementSplitter::is_single_statement(single[i], strlen(single[i])));
+
+  const char *not_single[] = {
+    "",
+    "insert into t values (1); insert into t values (2)",
+    "insert into t values ('unterminated",
+    "insert into t values (1) -- comment",
+    "insert into t values (1) # comment",
+    "insert into t values (1) /* unterminated",
+    "delimiter $$\ninsert into t values (1)"
+  };
+  for (size_t i = 0; i < sizeof(not_single) / sizeof(not_single[0]); ++i)
+    ensure(base::strfmt("55.2 %s", not_single[i]),
+      !MySQLStatementSplitter::is_single_statement(not_single[i], strlen(not_single[i])));
+
+  // With a different delimiter, semicolons are part of the statement.
+  std::string text = "insert into t values (1); insert into t values (2)";
+  ensure("55.3", MySQLStatementSplitter::is_single_statement(text.c_str(), text.size(), "$$"));
+
+  std::set<std::string> charsets;
+  MySQLQueryIdentifier identifier(50610, "", charsets);
+  ensure_equals("55.4", query_type(identifier, "/* c */ INSERT INTO t VALUES (1)"), QtInsert);
+  ensure_equals("55.5", query_type(identifier, "replace t values (1)"), QtReplace);
+  ensure_equals("55.6", query_type(identifier, "update t set a = 1"), QtUpdate);
+  ensure_equals("55.7", query_type(identifier, "delete from t"), QtDelete);
+  ensure_equals("55.8", query_type(identifier, "select * from t"), QtSelect);
+  ensure_equals("55.9", query_type(identifier, "call p()"), QtCall);
+}
+
 // TODO: create tests for restricted content parsing (e.g. routines only, views only etc.).
 
 END_TESTS;
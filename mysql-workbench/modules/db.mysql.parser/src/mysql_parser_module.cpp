@@ -17,6 +17,8 @@
  * 02110-1301  USA
  */
 
+#include <algorithm>
+
 #if defined(_WIN32) || defined(__APPLE__)
   #include <unordered_set>
 #else
@@ -29,6 +31,7 @@
 #include "base/string_utilities.h"
 #include "base/util_functions.h"
 #include "base/log.h"
+#include "base/threading.h"
 
 #include "grtpp_util.h"
 
@@ -37,6 +40,7 @@
 #include "mysql-parser.h"
 #include "mysql-syntax-check.h"
 #include "mysql-scanner.h"
+#include "mysql-statement-splitter.h"
 #include "mysql-recognition-types.h"
 
 #include "objimpl/wrapper/parser_ContextReference_impl.h"
@@ -4371,6 +4375,139 @@ size_t MySQLParserServicesImpl::checkSqlSyntax(ParserContext::Ref context, const
 
 //--------------------------------------------------------------------------------------------------
 
+// Statements each thread should get at least, to make starting it worth the effort.
+#define MIN_STATEMENTS_PER_CHECK_THREAD 16
+#define MAX_CHECK_THREADS 8
+
+/**
+ * Shared state of a parallel syntax check. Threads take the next unchecked statement until all are done,
+ * errors are collected per statement so no locking is needed.
+ */
+struct SyntaxCheckBatch
+{
+  const char *sql;
+  const std::vector<std::pair<size_t, size_t> > *ranges;
+  MySQLQueryType type;
+  bool *stop;
+
+  volatile gint next_range;
+  std::vector<std::vector<ParserErrorEntry> > errors;
+};
+
+struct SyntaxCheckThread
+{
+  SyntaxCheckBatch *batch;
+  MySQLSyntaxChecker *checker;
+};
+
+static void run_syntax_checks(SyntaxCheckBatch *batch, MySQLSyntaxChecker *checker)
+{
+  while (!*batch->stop)
+  {
+    gint index = g_atomic_int_add(&batch->next_range, 1);
+    if (index >= (gint)batch->ranges->size())
+      break;
+
+    const std::pair<size_t, size_t> &range = (*batch->ranges)[index];
+    checker->parse(batch->sql + range.first, range.second, true, batch->type);
+
+    const std::vector<MySQLParserErrorInfo> &error_info = checker->error_info();
+    for (std::vector<MySQLParserErrorInfo>::const_iterator error_iterator = error_info.begin();
+      error_iterator != error_info.end(); ++error_iterator)
+    {
+      ParserErrorEntry entry = { error_iterator->message, error_iterator->charOffset + range.first,
+        error_iterator->line, error_iterator->length };
+      batch->errors[index].push_back(entry);
+    }
+  }
+}
+
+static gpointer syntax_check_thread(gpointer data)
+{
+  SyntaxCheckThread *thread = (SyntaxCheckThread *)data;
+  try
+  {
+    run_syntax_checks(thread->batch, thread->checker);
+  }
+  catch (std::exception &e)
+  {
+    log_error("Exception in syntax check thread: %s\n", e.what());
+  }
+  return NULL;
+}
+
+static bool compare_error_position(const ParserErrorEntry &lhs, const ParserErrorEntry &rhs)
+{
+  return lhs.position < rhs.position;
+}
+
+/**
+ * Checks the syntax of all statements given by their ranges in sql. Statements are independent, so
+ * larger batches are distributed over several threads, each using its own syntax checker from the
+ * context's pool. Errors (with positions relative to sql) are returned ordered by position.
+ * Returns the error count.
+ * The stop flag is not reset here: a stop requested after the statements were split must also end
+ * the check that follows (the flag is cleared when splitting starts a new processing cycle).
+ */
+size_t MySQLParserServicesImpl::checkSqlSyntaxBatch(ParserContext::Ref context, const char *sql,
+  const std::vector<std::pair<size_t, size_t> > &ranges, MySQLQueryType type,
+  std::vector<ParserErrorEntry> &errors)
+{
+  SyntaxCheckBatch batch;
+  batch.sql = sql;
+  batch.ranges = &ranges;
+  batch.type = type;
+  batch.stop = &_stop;
+  batch.next_range = 0;
+  batch.errors.resize(ranges.size());
+
+  size_t thread_count = std::min((size_t)g_get_num_processors(), ranges.size() / MIN_STATEMENTS_PER_CHECK_THREAD);
+  thread_count = std::min(thread_count, (size_t)MAX_CHECK_THREADS);
+
+  // The calling thread takes part with the context's main checker.
+  std::vector<SyntaxCheckThread> workers(thread_count > 1 ? thread_count - 1 : 0);
+  std::vector<GThread *> threads;
+  for (size_t i = 0; i < workers.size(); ++i)
+  {
+    workers[i].batch = &batch;
+    workers[i].checker = context->pooled_syntax_checker(i);
+
+    GError *error = NULL;
+    GThread *thread = base::create_thread(syntax_check_thread, &workers[i], &error, "Syntax check");
+    if (thread == NULL)
+    {
+      log_warning("Could not create syntax check thread: %s\n", error != NULL ? error->message : "unknown error");
+      if (error != NULL)
+        g_error_free(error);
+      break;
+    }
+    threads.push_back(thread);
+  }
+
+  run_syntax_checks(&batch, context->syntax_checker());
+
+  for (std::vector<GThread *>::iterator iterator = threads.begin(); iterator != threads.end(); ++iterator)
+    g_thread_join(*iterator);
+
+  size_t count = 0;
+  for (std::vector<std::vector<ParserErrorEntry> >::const_iterator iterator = batch.errors.begin();
+    iterator != batch.errors.end(); ++iterator)
+    count += iterator->size();
+
+  size_t first_new = errors.size();
+  errors.reserve(first_new + count);
+  for (std::vector<std::vector<ParserErrorEntry> >::const_iterator iterator = batch.errors.begin();
+    iterator != batch.errors.end(); ++iterator)
+    errors.insert(errors.end(), iterator->begin(), iterator->end());
+
+  // Ranges are usually ordered already, but the result must be in any case.
+  std::stable_sort(errors.begin() + first_new, errors.end(), compare_error_position);
+
+  return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 /**
 * Helper to collect text positions to references of the given schema.
 * We only come here if there was no syntax error.
@@ -4548,30 +4685,6 @@ size_t MySQLParserServicesImpl::renameSchemaReferences(ParserContext::Ref contex
 
 //--------------------------------------------------------------------------------------------------
 
-static const unsigned char* skip_leading_whitespace(const unsigned char *head, const unsigned char *tail)
-{
-  while (head < tail && *head <= ' ')
-    head++;
-  return head;
-}
-
-//--------------------------------------------------------------------------------------------------
-
-bool is_line_break(const unsigned char *head, const unsigned char *line_break)
-{
-  if (*line_break == '\0')
-    return false;
-
-  while (*head != '\0' && *line_break != '\0' && *head == *line_break)
-  {
-    head++;
-    line_break++;
-  }
-  return *line_break == '\0';
-}
-
-//--------------------------------------------------------------------------------------------------
-
 grt::BaseListRef MySQLParserServicesImpl::getSqlStatementRanges(const std::string &sql)
 {
   grt::BaseListRef list(get_grt());
@@ -4601,184 +4714,11 @@ size_t MySQLParserServicesImpl::determineStatementRanges(const char *sql, size_t
   const std::string &line_break)
 {
   _stop = false;
-  std::string delimiter = initial_delimiter.empty() ? ";" : initial_delimiter;
-  const unsigned char *delimiter_head = (unsigned char*)delimiter.c_str();
-
-  const unsigned char keyword[] = "delimiter";
-
-  const unsigned char *head = (unsigned char *)sql;
-  const unsigned char *tail = head;
-  const unsigned char *end = head + length;
-  const unsigned char *new_line = (unsigned char*)line_break.c_str();
-  bool have_content = false; // Set when anything else but comments were found for the current statement.
-
-  while (!_stop && tail < end)
-  {
-    switch (*tail)
-    {
-    case '/': // Possible multi line comment or hidden (conditional) command.
-      if (*(tail + 1) == '*')
-      {
-        tail += 2;
-        bool is_hidden_command = (*tail == '!');
-        while (true)
-        {
-          while (tail < end && *tail != '*')
-            tail++;
-          if (tail == end) // Unfinished comment.
-            break;
-          else
-          {
-            if (*++tail == '/')
-            {
-              tail++; // Skip the slash too.
-              break;
-            }
-          }
-        }
-
-        if (!is_hidden_command && !have_content)
-          head = tail; // Skip over the comment.
-      }
-      else
-        tail++;
-
-      break;
-
-    case '-': // Possible single line comment.
-    {
-      const unsigned char *end_char = tail + 2;
-      if (*(tail + 1) == '-' && (*end_char == ' ' || *end_char == '\t' || is_line_break(end_char, new_line)))
-      {
-        // Skip everything until the end of the line.
-        tail += 2;
-        while (tail < end && !is_line_break(tail, new_line))
-          tail++;
-        if (!have_content)
-          head = tail;
-      }
-      else
-        tail++;
-
-      break;
-    }
-
-    case '#': // MySQL single line comment.
-      while (tail < end && !is_line_break(tail, new_line))
-        tail++;
-      if (!have_content)
-        head = tail;
-      break;
-
-    case '"':
-    case '\'':
-    case '`': // Quoted string/id. Skip this in a local loop.
-    {
-      have_content = true;
-      char quote = *tail++;
-      while (tail < end && *tail != quote)
-      {
-        // Skip any escaped character too.
-        if (*tail == '\\')
-          tail++;
-        tail++;
-      }
-      if (*tail == quote)
-        tail++; // Skip trailing quote char to if one was there.
-
-      break;
-    }
-
-    case 'd':
-    case 'D':
-    {
-      have_content = true;
-
-      // Possible start of the keyword DELIMITER. Must be at the start of the text or a character,
-      // which is not part of a regular MySQL identifier (0-9, A-Z, a-z, _, $, \u0080-\uffff).
-      unsigned char previous = tail > (unsigned char *)sql ? *(tail - 1) : 0;
-      bool is_identifier_char = previous >= 0x80
-        || (previous >= '0' && previous <= '9')
-        || ((previous | 0x20) >= 'a' && (previous | 0x20) <= 'z')
-        || previous == '$'
-        || previous == '_';
-      if (tail == (unsigned char *)sql || !is_identifier_char)
-      {
-        const unsigned char *run = tail + 1;
-        const unsigned char *kw = keyword + 1;
-        int count = 9;
-        while (count-- > 1 && (*run++ | 0x20) == *kw++)
-          ;
-        if (count == 0 && *run == ' ')
-        {
-          // Delimiter keyword found. Get the new delimiter (everything until the end of the line).
-          tail = run++;
-          while (run < end && !is_line_break(run, new_line))
-            run++;
-          delimiter = base::trim(std::string((char *)tail, run - tail));
-          delimiter_head = (unsigned char*)delimiter.c_str();
-
-          // Skip over the delimiter statement and any following line breaks.
-          while (is_line_break(run, new_line))
-            run++;
-          tail = run;
-          head = tail;
-        }
-        else
-          tail++;
-      }
-      else
-        tail++;
-
-      break;
-    }
-
-    default:
-      if (*tail > ' ')
-        have_content = true;
-      tail++;
-      break;
-    }
-
-    if (*tail == *delimiter_head)
-    {
-      // Found possible start of the delimiter. Check if it really is.
-      size_t count = delimiter.size();
-      if (count == 1)
-      {
-        // Most common case. Trim the statement and check if it is not empty before adding the range.
-        head = skip_leading_whitespace(head, tail);
-        if (head < tail)
-          ranges.push_back(std::make_pair<size_t, size_t>(head - (unsigned char *)sql, tail - head));
-        head = ++tail;
-        have_content = false;
-      }
-      else
-      {
-        const unsigned char *run = tail + 1;
-        const unsigned char *del = delimiter_head + 1;
-        while (count-- > 1 && (*run++ == *del++))
-          ;
-
-        if (count == 0)
-        {
-          // Multi char delimiter is complete. Tail still points to the start of the delimiter.
-          // Run points to the first character after the delimiter.
-          head = skip_leading_whitespace(head, tail);
-          if (head < tail)
-            ranges.push_back(std::make_pair<size_t, size_t>(head - (unsigned char *)sql, tail - head));
-          tail = run;
-          head = run;
-          have_content = false;
-        }
-      }
-    }
-  }
 
-  // Add remaining text to the range list.
-  head = skip_leading_whitespace(head, tail);
-  if (head < tail)
-    ranges.push_back(std::make_pair<size_t, size_t>(head - (unsigned char *)sql, tail - head));
+  MySQLStatementSplitter splitter(sql, length, initial_delimiter, line_break);
+  size_t start, statement_length;
+  while (!_stop && splitter.next(start, statement_length))
+    ranges.push_back(std::make_pair(start, statement_length));
 
   return 0;
 }
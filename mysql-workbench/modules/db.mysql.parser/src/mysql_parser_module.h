@@ -192,6 +192,9 @@ public:
   size_t doSyntaxCheck(parser_ContextReferenceRef context_ref, const std::string &sql, const std::string &type);
   virtual size_t checkSqlSyntax(parser::ParserContext::Ref context, const char *sql,
     size_t length, MySQLQueryType type);
+  virtual size_t checkSqlSyntaxBatch(parser::ParserContext::Ref context, const char *sql,
+    const std::vector<std::pair<size_t, size_t> > &ranges, MySQLQueryType type,
+    std::vector<parser::ParserErrorEntry> &errors);
 
   size_t doSchemaRefRename(parser_ContextReferenceRef context_ref, db_mysql_CatalogRef catalog,
     const std::string old_name, const std::string new_name);
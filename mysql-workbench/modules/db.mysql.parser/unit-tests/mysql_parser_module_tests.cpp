@@ -203,4 +203,68 @@ TEST_FUNCTION(95)
 // other_administrative_statement
 // utility_statement
 
+// Batch syntax checks must give the same results as checking each statement on its own.
+TEST_FUNCTION(100)
+{
+  const char *file_name = "data/db/sakila-db/sakila-data.sql";
+  ensure(base::strfmt("Statements file '%s' does not exist.", file_name),
+    g_file_test(file_name, G_FILE_TEST_EXISTS) == TRUE);
+
+  gchar *contents = NULL;
+  gsize size = 0;
+  GError *error = NULL;
+  g_file_get_contents(file_name, &contents, &size, &error);
+  ensure("Error loading sql file", error == NULL);
+
+  // Add enough small statements (some of them with errors) to make the batch use several threads.
+  std::string sql(contents, size);
+  g_free(contents);
+  for (int i = 0; i < 500; ++i)
+  {
+    if (i % 7 == 0)
+      sql += "\nselect * from actor where actor_id = ;";
+    else
+      sql += base::strfmt("\nselect * from actor where actor_id = %i;", i);
+  }
+
+  std::vector<std::pair<size_t, size_t> > ranges;
+  _services->determineStatementRanges(sql.c_str(), sql.size(), ";", ranges);
+
+  std::vector<ParserErrorEntry> expected;
+  for (std::vector<std::pair<size_t, size_t> >::const_iterator iterator = ranges.begin(); iterator != ranges.end(); ++iterator)
+  {
+    if (_services->checkSqlSyntax(_context, sql.c_str() + iterator->first, iterator->second, QtUnknown) > 0)
+    {
+      std::vector<ParserErrorEntry> errors = _context->get_errors_with_offset(iterator->first, true);
+      expected.insert(expected.end(), errors.begin(), errors.end());
+    }
+  }
+
+  std::vector<ParserErrorEntry> errors;
+  size_t error_count = _services->checkSqlSyntaxBatch(_context, sql.c_str(), ranges, QtUnknown, errors);
+
+  ensure_equals("100.1", error_count, errors.size());
+  ensure_equals("100.2", errors.size(), expected.size());
+  ensure("100.3", expected.size() >= 500 / 7);
+  for (size_t i = 0; i < errors.size(); ++i)
+  {
+    ensure_equals("100.4", errors[i].position, expected[i].position);
+    ensure_equals("100.5", errors[i].length, expected[i].length);
+    ensure_equals("100.6", errors[i].message, expected[i].message);
+  }
+
+  // A stop requested before the batch starts must not get lost.
+  _services->stopProcessing();
+  errors.clear();
+  error_count = _services->checkSqlSyntaxBatch(_context, sql.c_str(), ranges, QtUnknown, errors);
+  ensure_equals("100.7", error_count, 0U);
+
+  // Splitting starts a new processing cycle, which clears the stop request again.
+  ranges.clear();
+  _services->determineStatementRanges(sql.c_str(), sql.size(), ";", ranges);
+  errors.clear();
+  error_count = _services->checkSqlSyntaxBatch(_context, sql.c_str(), ranges, QtUnknown, errors);
+  ensure_equals("100.8", errors.size(), expected.size());
+}
+
 END_TESTS
@@ -311,10 +311,14 @@ class DataMigrator(object):
 
         if self._options.get("TruncateTargetTables", False):
             args.append("--truncate-target")
+        if self._options.get("UseLoadDataLocalInfile", False):
+            args.append("--load-data-local-infile")
         if self._options.get("DebugTableCopy", False):
             args.append("--log-level=debug3")
 
         args.append("--thread-count=" + str(num_processes));
+        if "chunkSize" in self._options:
+            args.append("--chunk-size=" + str(self._options["chunkSize"]))
         args.append('--source-rdbms-type=%s' % self._src_conn_object.driver.owner.name)
 
         if 'defaultCharSet' in self._src_conn_object.parameterValues.keys():
@@ -28,6 +28,7 @@
 #include "base/log.h"
 #include "base/string_utilities.h"
 #include "base/sqlstring.h"
+#include "base/util_functions.h"
 
 #include "copytable.h"
 #include "converter.h"
@@ -46,6 +47,13 @@ DEFAULT_LOG_DOMAIN("copytable");
 
 #define TMP_TRIGGER_TABLE "wb_tmp_triggers"
 
+// Limits of the row buffer ring between the fetch and insert stages of a table copy
+#define PIPELINE_MEMORY_LIMIT (64 * 1024 * 1024)
+#define PIPELINE_MAX_ROWS 10000
+
+// Interval in seconds for reporting stage throughput while copying a table
+#define STAGE_STATS_INTERVAL 10
+
 #if defined(MYSQL_VERSION_MAJOR) && defined(MYSQL_VERSION_MINOR) && defined(MYSQL_VERSION_PATCH)
 #define MYSQL_CHECK_VERSION(major,minor,micro) \
     (MYSQL_VERSION_MAJOR > (major) || \
@@ -137,6 +145,17 @@ static const char *odbc_type_to_name(SQLSMALLINT type)
   }
 }
 
+static bool parse_integer(const char *value, long long &result)
+{
+  if (value == NULL || *value == '\0')
+    return false;
+
+  char *end = NULL;
+  errno = 0;
+  result = strtoll(value, &end, 10);
+  return errno == 0 && end != value && *end == '\0';
+}
+
 std::string QueryBuilder::build_query()
 {
   std::string q;
@@ -465,6 +484,135 @@ void RowBuffer::send_blob_data(const char *data, size_t length)
   _send_blob_data(_current_field, data, length);
 }
 
+
+size_t RowBuffer::memory_size() const
+{
+  size_t size = sizeof(*this) + capacity() * sizeof(MYSQL_BIND);
+  for (std::vector<MYSQL_BIND>::const_iterator field = begin(); field != end(); ++field)
+    size += field->buffer_length;
+  return size;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+RowBufferRing::RowBufferRing(boost::function<RowBuffer* ()> create_buffer, size_t max_buffers, size_t memory_limit)
+: _queued_bytes(0), _memory_limit(memory_limit), _finished(false), _aborted(false)
+{
+  // the ring holds as many rows as fit in memory_limit, but at least 2 so that both stages can work at the same time.
+  // Buffers grow when blobs are fetched into them, so the bytes actually queued are limited in get_free() as well
+  RowBuffer *buffer = create_buffer();
+  _buffers.push_back(buffer);
+
+  size_t count = memory_limit / std::max(buffer->memory_size(), (size_t)1);
+  count = std::max((size_t)2, std::min(count, max_buffers));
+
+  try
+  {
+    while (_buffers.size() < count)
+      _buffers.push_back(create_buffer());
+  }
+  catch (...)
+  {
+    for (std::vector<RowBuffer*>::iterator iter = _buffers.begin(); iter != _buffers.end(); ++iter)
+      delete *iter;
+    throw;
+  }
+  _free.assign(_buffers.begin(), _buffers.end());
+}
+
+RowBufferRing::~RowBufferRing()
+{
+  for (std::vector<RowBuffer*>::iterator iter = _buffers.begin(); iter != _buffers.end(); ++iter)
+    delete *iter;
+}
+
+// The fetch stage waits for a free buffer, and for the insert stage to drain the queue while it holds more than
+// the memory limit (a single row over the limit is still queued, so that the copy can't stall)
+bool RowBufferRing::must_wait_free() const
+{
+  return !_aborted && (_free.empty() || (_queued_bytes > _memory_limit && !_filled.empty()));
+}
+
+// Returns a buffer to fetch a row into, NULL if the insert stage aborted
+RowBuffer *RowBufferRing::get_free(double &wait_time)
+{
+  base::MutexLock lock(_mutex);
+
+  if (must_wait_free())
+  {
+    double start = base::timestamp();
+    while (must_wait_free())
+      _cond.wait(_mutex);
+    wait_time += base::timestamp() - start;
+  }
+
+  if (_aborted)
+    return NULL;
+
+  RowBuffer *buffer = _free.front();
+  _free.pop_front();
+  return buffer;
+}
+
+void RowBufferRing::put_filled(RowBuffer *buffer)
+{
+  // blobs fetched into the buffer may have resized its field buffers
+  size_t size = buffer->memory_size();
+
+  base::MutexLock lock(_mutex);
+  _queued_bytes += size;
+  _filled.push_back(buffer);
+  _filled_sizes.push_back(size);
+  _cond.broadcast();
+}
+
+// Returns the next fetched row, NULL once all rows were handed out or the fetch stage aborted
+RowBuffer *RowBufferRing::get_filled(double &wait_time)
+{
+  base::MutexLock lock(_mutex);
+
+  if (_filled.empty() && !_finished && !_aborted)
+  {
+    double start = base::timestamp();
+    while (_filled.empty() && !_finished && !_aborted)
+      _cond.wait(_mutex);
+    wait_time += base::timestamp() - start;
+  }
+
+  if (_aborted || _filled.empty())
+    return NULL;
+
+  RowBuffer *buffer = _filled.front();
+  _filled.pop_front();
+  _queued_bytes -= _filled_sizes.front();
+  _filled_sizes.pop_front();
+  _cond.broadcast();
+  return buffer;
+}
+
+void RowBufferRing::put_free(RowBuffer *buffer)
+{
+  base::MutexLock lock(_mutex);
+  _free.push_back(buffer);
+  _cond.broadcast();
+}
+
+// Called by the fetch stage when there are no more rows
+void RowBufferRing::finish()
+{
+  base::MutexLock lock(_mutex);
+  _finished = true;
+  _cond.broadcast();
+}
+
+// Called by either stage on error, makes the other stage stop
+void RowBufferRing::abort()
+{
+  base::MutexLock lock(_mutex);
+  _aborted = true;
+  _cond.broadcast();
+}
+
 // -------------------------------------------------------------------------------------------------
 
 CopyDataSource::CopyDataSource()
@@ -857,6 +1005,8 @@ size_t ODBCCopyDataSource::count_rows(const std::string &schema, const std::stri
         q = base::strfmt("SELECT %s(*) FROM %s.%s WHERE %s AND %s", countStr.c_str(), schema.c_str(), table.c_str(), start_expr.c_str(), end_expr.c_str());
       else
         q = base::strfmt("SELECT %s(*) FROM %s.%s WHERE %s", countStr.c_str(), schema.c_str(), table.c_str(), start_expr.c_str());
+      if (spec.resume && last_pkeys.size())
+        q += base::strfmt(" AND (%s)", get_where_condition(pk_columns, last_pkeys).c_str());
       break;
     }
     case CopyCount:
@@ -890,6 +1040,39 @@ size_t ODBCCopyDataSource::count_rows(const std::string &schema, const std::stri
 }
 
 
+bool ODBCCopyDataSource::get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                                       long long &min_value, long long &max_value)
+{
+  SQLHSTMT stmt;
+  SQLRETURN ret;
+  if (!SQL_SUCCEEDED(ret = SQLAllocHandle(SQL_HANDLE_STMT, _dbc, &stmt)))
+    throw ConnectionError("SQLAllocHandle", ret, SQL_HANDLE_DBC, _dbc);
+
+  std::string q = base::strfmt("SELECT MIN(%s), MAX(%s) FROM %s.%s", key.c_str(), key.c_str(), schema.c_str(), table.c_str());
+  log_debug("Executing query: %s\n", q.c_str());
+  if (!SQL_SUCCEEDED(ret = SQLExecDirect(stmt, (SQLCHAR*)q.c_str(), SQL_NTS)))
+  {
+    ConnectionError err("SQLExecDirect("+q+")", ret, SQL_HANDLE_STMT, stmt);
+    SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+    throw err;
+  }
+
+  // values are fetched as text, so that non integer keys can be told apart
+  char min_buffer[64], max_buffer[64];
+  SQLLEN min_length = 0, max_length = 0;
+  bool result = false;
+  if (SQL_SUCCEEDED(SQLFetch(stmt)) &&
+      SQL_SUCCEEDED(SQLGetData(stmt, 1, SQL_C_CHAR, min_buffer, sizeof(min_buffer), &min_length)) &&
+      SQL_SUCCEEDED(SQLGetData(stmt, 2, SQL_C_CHAR, max_buffer, sizeof(max_buffer), &max_length)) &&
+      min_length != SQL_NULL_DATA && max_length != SQL_NULL_DATA)
+    result = parse_integer(min_buffer, min_value) && parse_integer(max_buffer, max_value);
+
+  SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+
+  return result;
+}
+
+
 boost::shared_ptr<std::vector<ColumnInfo> > ODBCCopyDataSource::begin_select_table(const std::string &schema, const std::string &table,
                                                                                    const std::vector<std::string> &pk_columns,
                                                                                    const std::string &select_expression,
@@ -1363,6 +1546,8 @@ size_t MySQLCopyDataSource::count_rows(const std::string &schema, const std::str
         q = base::strfmt("SELECT count(*) FROM %s WHERE %s AND %s", table.c_str(), start_expr.c_str(), end_expr.c_str());
       else
         q = base::strfmt("SELECT count(*) FROM %s WHERE %s", table.c_str(), start_expr.c_str());
+      if (spec.resume && last_pkeys.size())
+        q += base::strfmt(" AND (%s)", get_where_condition(pk_columns, last_pkeys).c_str());
       break;
     }
     case CopyCount:
@@ -1403,6 +1588,30 @@ size_t MySQLCopyDataSource::count_rows(const std::string &schema, const std::str
   return count;
 }
 
+bool MySQLCopyDataSource::get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                                        long long &min_value, long long &max_value)
+{
+  std::string q = base::strfmt("USE %s", schema.c_str());
+
+  if (mysql_query(&_mysql, q.data()) < 0)
+    throw ConnectionError("mysql_query("+q+")", &_mysql);
+
+  q = base::strfmt("SELECT MIN(%s), MAX(%s) FROM %s", key.c_str(), key.c_str(), table.c_str());
+  if (mysql_query(&_mysql, q.data()) != 0)
+    throw ConnectionError("mysql_query("+q+")", &_mysql);
+
+  MYSQL_RES *result;
+  if ((result = mysql_use_result(&_mysql)) == NULL)
+    throw ConnectionError("MySQL query", &_mysql);
+
+  MYSQL_ROW row = mysql_fetch_row(result);
+  bool ret_val = row && parse_integer(row[0], min_value) && parse_integer(row[1], max_value);
+
+  mysql_free_result(result);
+
+  return ret_val;
+}
+
 boost::shared_ptr<std::vector<ColumnInfo> > MySQLCopyDataSource::begin_select_table(const std::string &schema, const std::string &table,
                                                                                     const std::vector<std::string> &pk_columns,
                                                                                     const std::string &select_expression,
@@ -1645,7 +1854,8 @@ void MySQLCopyDataTarget::init()
   }
 }
 
-std::vector<std::string> MySQLCopyDataTarget::get_last_pkeys(const std::vector<std::string> &pk_columns, const std::string &schema, const std::string &table)
+std::vector<std::string> MySQLCopyDataTarget::get_last_pkeys(const std::vector<std::string> &pk_columns, const std::string &schema, const std::string &table,
+                                                             const std::string &where_condition)
 {
   std::vector<std::string> ret;
   std::string order_by_cond;
@@ -1659,7 +1869,12 @@ std::vector<std::string> MySQLCopyDataTarget::get_last_pkeys(const std::vector<s
       order_by_cond += ",";
   }
 
-  const std::string q = base::strfmt("SELECT %s FROM %s.%s ORDER BY %s LIMIT 0,1", boost::algorithm::join(pk_columns, ", ").c_str(), schema.c_str(), table.c_str(), order_by_cond.c_str());
+  std::string where_cond;
+  if (!where_condition.empty())
+    where_cond = base::strfmt(" WHERE %s", where_condition.c_str());
+
+  const std::string q = base::strfmt("SELECT %s FROM %s.%s%s ORDER BY %s LIMIT 0,1", boost::algorithm::join(pk_columns, ", ").c_str(), schema.c_str(), table.c_str(),
+                                     where_cond.c_str(), order_by_cond.c_str());
   if (mysql_query(&_mysql, q.data()) != 0)
       throw ConnectionError("mysql_query(" + q + ")", &_mysql);
 
@@ -1908,11 +2123,13 @@ enum enum_field_types MySQLCopyDataTarget::field_type_to_ps_param_type(enum enum
 MySQLCopyDataTarget::MySQLCopyDataTarget(const std::string &hostname, int port,
                     const std::string &username, const std::string &password,
                     const std::string &socket, bool use_cleartext_plugin, const std::string &app_name,
-                    const std::string &incoming_charset, const std::string &source_rdbms_type)
+                    const std::string &incoming_charset, const std::string &source_rdbms_type,
+                    bool use_load_data)
 : _insert_stmt(NULL), _max_allowed_packet(1000000), _max_long_data_size(1000000),// 1M default
 _row_buffer(NULL), _major_version(0), _minor_version(0), _build_version(0),
 _use_bulk_inserts(true), _bulk_insert_buffer(this), _bulk_insert_record(this),
-  _bulk_insert_batch(0), _source_rdbms_type(source_rdbms_type)
+  _bulk_insert_batch(0), _source_rdbms_type(source_rdbms_type),
+  _use_load_data(use_load_data), _load_data_active(false), _load_data_offset(0), _load_data_rows(0)
 {
   std::string host = hostname;
   _truncate = false;
@@ -1970,6 +2187,11 @@ _use_bulk_inserts(true), _bulk_insert_buffer(this), _bulk_insert_record(this),
 #endif
 #endif
 
+  if (_use_load_data)
+  {
+    unsigned int local_infile = 1;
+    mysql_options(&_mysql, MYSQL_OPT_LOCAL_INFILE, &local_infile);
+  }
 
   if (!mysql_real_connect(&_mysql, hostname.c_str(), username.c_str(), password.c_str(), NULL, port, socket.c_str(),
                           CLIENT_COMPRESS))
@@ -1979,6 +2201,12 @@ _use_bulk_inserts(true), _bulk_insert_buffer(this), _bulk_insert_record(this),
   }
   log_info("Connection to MySQL opened\n");
 
+  // Our handler stays installed for the whole connection, so the server can never read local files
+  // through it: it only serves rows while load_data() is running
+  if (_use_load_data)
+    mysql_set_local_infile_handler(&_mysql, &MySQLCopyDataTarget::local_infile_init, &MySQLCopyDataTarget::local_infile_read,
+                                   &MySQLCopyDataTarget::local_infile_end, &MySQLCopyDataTarget::local_infile_error, this);
+
   init();
 }
 
@@ -2015,8 +2243,16 @@ void MySQLCopyDataTarget::get_generated_columns(const std::string &schema, const
   mysql_free_result(result);
 }
 
+void MySQLCopyDataTarget::truncate_table(const std::string &schema, const std::string &table)
+{
+  log_info("Truncating table %s.%s\n", schema.c_str(), table.c_str());
+  if (mysql_query(&_mysql, base::strfmt("TRUNCATE %s.%s", schema.c_str(), table.c_str()).c_str()) != 0)
+    log_warning("Error executing TRUNCATE %s.%s: %s\n",
+                schema.c_str(), table.c_str(), mysql_error(&_mysql));
+}
+
 void MySQLCopyDataTarget::set_target_table(const std::string &schema, const std::string &table,
-                                           boost::shared_ptr<std::vector<ColumnInfo> > columns)
+                                           boost::shared_ptr<std::vector<ColumnInfo> > columns, bool allow_truncate)
 {
   _schema = schema;
   _table = table;
@@ -2094,13 +2330,9 @@ void MySQLCopyDataTarget::set_target_table(const std::string &schema, const std:
   else
     throw ConnectionError("mysql_stmt_init", &_mysql);
 
-  if (_truncate)
-  {
-    log_info("Truncating table %s.%s\n", schema.c_str(), table.c_str());
-    if (mysql_query(&_mysql, base::strfmt("TRUNCATE %s.%s", schema.c_str(), table.c_str()).c_str()) != 0)
-      log_warning("Error executing TRUNCATE %s.%s: %s\n",
-                  schema.c_str(), table.c_str(), mysql_error(&_mysql));
-  }
+  // chunks of a table are copied after the table was truncated once
+  if (_truncate && allow_truncate)
+    truncate_table(schema, table);
 
   // TODO: Bulk inserts should be disabled when a single record can be bigger than the max_packet_size
   _use_bulk_inserts = true;
@@ -2135,7 +2367,7 @@ void MySQLCopyDataTarget::begin_inserts()
   if (_row_buffer)
     delete _row_buffer;
 
-  _row_buffer = new RowBuffer(_columns, boost::bind(&MySQLCopyDataTarget::send_long_data, this, _1, _2, _3), _max_allowed_packet);
+  _row_buffer = create_row_buffer();
 
   if (!_use_bulk_inserts)
   {
@@ -2191,9 +2423,18 @@ int MySQLCopyDataTarget::end_inserts(bool flush)
 }
 
 int MySQLCopyDataTarget::do_insert(bool final)
+{
+  return do_insert(*_row_buffer, final);
+}
+
+int MySQLCopyDataTarget::do_insert(RowBuffer &row_buffer, bool final)
 {
   int ret_val = 0;
 
+  // the prepared insert statement is bound to our own row buffer
+  if (!_use_bulk_inserts && &row_buffer != _row_buffer)
+    throw std::logic_error("Rows from other row buffers can only be inserted with bulk inserts");
+
   if (_use_bulk_inserts)
   {
     bool add_comma = true;
@@ -2222,7 +2463,7 @@ int MySQLCopyDataTarget::do_insert(bool final)
     if (!final)
     {
       // Formats the next record into _bulk_insert_record
-      if (format_bulk_record())
+      if (format_bulk_record(row_buffer))
       {
         // Next record + 1 as the comma also counts
         if (_bulk_insert_buffer.space_left() >= (_bulk_insert_record.length + ( add_comma? 1:0)))
@@ -2270,212 +2511,467 @@ int MySQLCopyDataTarget::do_insert(bool final)
   return ret_val;
 }
 
-bool MySQLCopyDataTarget::format_bulk_record()
-{
-  bool ret_val = true;
-  _bulk_insert_record.append("(", 1);
+// -------------------------------------------------------------------------------------------------
 
-  for(size_t index = 0; ret_val && index < _row_buffer->size() - 1; index++)
+std::string MySQLCopyDataTarget::load_data_query()
+{
+  // Columns that need a conversion are read into user variables and assigned in the SET clause
+  std::string columns, conversions;
+  for (size_t index = 0; index < _columns->size(); ++index)
   {
-    ret_val = append_bulk_column(index);
-    _bulk_insert_record.append(",", 1);
-  }
+    const ColumnInfo &column = (*_columns)[index];
+    std::string name = base::sqlstring("!", 0) << column.target_name;
+    std::string variable = base::strfmt("@wb_col%li", (long)index);
 
-  if (ret_val)
-  {
-    ret_val = append_bulk_column(_row_buffer->size() - 1);
+    if (!columns.empty())
+      columns.append(", ");
 
-    if (ret_val)
-      ret_val = _bulk_insert_record.append(")", 1);
+    if (column.target_type == MYSQL_TYPE_GEOMETRY || column.target_type == MYSQL_TYPE_BIT)
+    {
+      columns.append(variable);
+      conversions.append(conversions.empty() ? " SET " : ", ").append(name).append(" = ");
+      if (column.target_type == MYSQL_TYPE_GEOMETRY)
+        conversions.append(base::strfmt("GeomFromText(%s)", variable.c_str()));
+      else
+        conversions.append(base::strfmt("CAST(%s AS UNSIGNED)", variable.c_str()));
+    }
+    else
+      columns.append(name);
   }
 
-  return ret_val;
+  // The data comes in the charset the server expects from this connection (see init())
+  std::string charset = _incoming_data_charset.empty() ? "utf8" : _incoming_data_charset;
+
+  return base::strfmt("LOAD DATA LOCAL INFILE 'wbcopytables' INTO TABLE %s.%s CHARACTER SET %s "
+                      "FIELDS TERMINATED BY '\\t' ESCAPED BY '\\\\' LINES TERMINATED BY '\\n' (%s)%s",
+                      _schema.c_str(), _table.c_str(), charset.c_str(), columns.c_str(), conversions.c_str());
 }
 
-bool MySQLCopyDataTarget::append_bulk_column(size_t col_index)
+static void append_load_data_escaped(std::string &line, const char *data, size_t length)
 {
-  std::string data;
-  bool ret_val = true;
+  for (const char *end = data + length; data < end; ++data)
+  {
+    switch (*data)
+    {
+      case '\\': line.append("\\\\", 2); break;
+      case '\t': line.append("\\t", 2); break;
+      case '\n': line.append("\\n", 2); break;
+      case '\r': line.append("\\r", 2); break;
+      case '\0': line.append("\\0", 2); break;
+      default: line.push_back(*data); break;
+    }
+  }
+}
 
-  if (*(*_row_buffer)[col_index].is_null)
-    ret_val = _bulk_insert_record.append("NULL", 4);
-  else
+/*
+* format_value : formats the numeric, BIT and temporal values of rows as text, for both bulk inserts and LOAD DATA.
+* Parameters:
+* - field : the (non NULL) value to format
+* - value : output parameter, the formatted value
+* - is_temporal : output parameter, set for date and time values, which must be quoted in SQL
+*
+* Remarks : Returns false for the types whose data is sent as it is (strings, decimals, blobs, geometry)
+*           and for the types not supported yet, which the callers handle themselves.
+*/
+bool MySQLCopyDataTarget::format_value(const MYSQL_BIND &field, std::string &value, bool &is_temporal)
+{
+  is_temporal = false;
+  switch (field.buffer_type)
+  {
+  case MYSQL_TYPE_TINY:
+    if (field.is_unsigned)
+      value = base::strfmt("%u", *(unsigned char*)field.buffer);
+    else
+      value = base::strfmt("%d", *(char*)field.buffer);
+    return true;
+  case MYSQL_TYPE_SHORT:
+  case MYSQL_TYPE_YEAR:
+    if (field.is_unsigned)
+      value = base::strfmt("%u", *(unsigned short*)field.buffer);
+    else
+      value = base::strfmt("%d", *(short*)field.buffer);
+    return true;
+  case MYSQL_TYPE_INT24:
+  case MYSQL_TYPE_LONG:
+    if (field.is_unsigned)
+      value = base::strfmt("%u", *(unsigned int*)field.buffer);
+    else
+      value = base::strfmt("%i", *(int*)field.buffer);
+    return true;
+  case MYSQL_TYPE_LONGLONG:
+    if (field.is_unsigned)
+      value = base::strfmt("%llu", *(unsigned long long int*)field.buffer);
+    else
+      value = base::strfmt("%lli", *(long long int*)field.buffer);
+    return true;
+  case MYSQL_TYPE_FLOAT:
+    value = base::strfmt("%f", *(float*)field.buffer);
+    return true;
+  case MYSQL_TYPE_DOUBLE:
+    value = base::strfmt("%f", *(double*)field.buffer);
+    return true;
+  case MYSQL_TYPE_BIT:
   {
-    switch((*_row_buffer)[col_index].buffer_type)
+    // As managed as string, an additional byte is added to the length, so
+    // we remove that here to know the real legth in bytes
+    std::div_t length= std::div(field.buffer_length - 1, 8);
+
+    if (length.rem)
+      ++length.quot;
+
+    // the bytes come most significant first, a BIT(64) value needs all 64 bits of uval
+    unsigned long long uval = 0;
+    unsigned int shift = 0;
+
+    for (int index = 1; index <= length.quot; index++ )
     {
-    case MYSQL_TYPE_NULL:
-      ret_val = _bulk_insert_record.append("NULL", 4);
-      break;
-    case MYSQL_TYPE_TINY:
-      if ((*_row_buffer)[col_index].is_unsigned)
-      {
-        unsigned char *val_char = (unsigned char *)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%u", *val_char);
-      }
-      else
-      {
-        char *val_char = (char *)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%d", *val_char);
-      }
-      ret_val = _bulk_insert_record.append(data.data(), data.length());
-      break;
-    case MYSQL_TYPE_SHORT:
-    case MYSQL_TYPE_YEAR:
-      if ((*_row_buffer)[col_index].is_unsigned)
-      {
-        unsigned short *val_short = (unsigned short *)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%u", *val_short);
-      }
+      uval += (unsigned long long)(((unsigned char*)field.buffer)[length.quot - index]) << shift;
+      shift += 8;
+    }
+    value = base::strfmt("%llu", uval);
+    return true;
+  }
+  case MYSQL_TYPE_TIME:
+  case MYSQL_TYPE_DATE:
+  case MYSQL_TYPE_NEWDATE:
+  case MYSQL_TYPE_DATETIME:
+  case MYSQL_TYPE_TIMESTAMP:
+  {
+    MYSQL_TIME *ts = (MYSQL_TIME*)field.buffer;
+    bool fractional_seconds = _major_version >= 6
+      || (_major_version == 5 && _minor_version >= 7)
+      || (_major_version == 5 && _minor_version == 6 && _build_version >= 4);
+
+    is_temporal = true;
+    switch (ts->time_type)
+    {
+    case MYSQL_TIMESTAMP_DATETIME:
+      if (fractional_seconds)
+        value = base::strfmt("%04d-%02d-%02d %02d:%02d:%02d.%06lu", ts->year, ts->month, ts->day,
+                             ts->hour, ts->minute, ts->second, ts->second_part);
       else
-      {
-        short *val_short = (short *)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%d", *val_short);
-      }
-      ret_val = _bulk_insert_record.append(data.data(), data.length());
+        value = base::strfmt("%04d-%02d-%02d %02d:%02d:%02d", ts->year, ts->month, ts->day,
+                             ts->hour, ts->minute, ts->second);
       break;
-    case MYSQL_TYPE_INT24:
-    case MYSQL_TYPE_LONG:
-      if ((*_row_buffer)[col_index].is_unsigned)
-      {
-        unsigned int *val_int = (unsigned int *)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%u", *val_int);
-      }
-      else
-      {
-        int *val_int = (int *)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%i", *val_int);
-      }
-      ret_val = _bulk_insert_record.append(data.data(), data.length());
+    case MYSQL_TIMESTAMP_DATE:
+      value = base::strfmt("%04d-%02d-%02d", ts->year, ts->month, ts->day);
       break;
-    case MYSQL_TYPE_LONGLONG:
-      if ((*_row_buffer)[col_index].is_unsigned)
-      {
-        unsigned long long int *val_llint = (unsigned long long int*)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%llu", *val_llint);
-      }
+    case MYSQL_TIMESTAMP_TIME:
+      if (fractional_seconds)
+        value = base::strfmt("%02d:%02d:%02d.%06lu", ts->hour, ts->minute, ts->second, ts->second_part);
       else
-      {
-        long long int *val_llint = (long long int *)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%lli", *val_llint);
-      }
-      ret_val = _bulk_insert_record.append(data.data(), data.length());
-      break;
-    case MYSQL_TYPE_FLOAT:
-      {
-        float *val_float = (float*)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%f", *val_float);
-        ret_val = _bulk_insert_record.append(data.data(), data.length());
-      }
+        value = base::strfmt("%02d:%02d:%02d", ts->hour, ts->minute, ts->second);
       break;
-    case MYSQL_TYPE_DOUBLE:
-      {
-        double *val_double = (double*)(*_row_buffer)[col_index].buffer;
-        data = base::strfmt("%f", *val_double);
-        ret_val = _bulk_insert_record.append(data.data(), data.length());
-      }
+    default:
+      value.clear();
       break;
-    case MYSQL_TYPE_BIT:
-    {
-      // As managed as string, an additional byte is added to the length, so
-      // we remove that here to know the real legth in bytes
-      std::div_t length= std::div((*_row_buffer)[col_index].buffer_length - 1, 8);
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
 
-      if (length.rem)
-        ++length.quot;
+/*
+* format_load_data_row : formats a row as a line of the tab separated data read by LOAD DATA.
+*
+* Remarks : Values are formatted by format_value like for bulk inserts, but without quotes and with the
+*           escaping of LOAD DATA (\N for NULL, backslash escapes for tabs, newlines etc.).
+*           Throws for the types that can't be formatted yet, which fails the table.
+*/
+void MySQLCopyDataTarget::format_load_data_row(RowBuffer &row_buffer, std::string &line)
+{
+  std::string value;
+  bool is_temporal;
 
-      unsigned long long uval = 0;
-      unsigned int shift = 0;
+  for (size_t col_index = 0; col_index < row_buffer.size(); ++col_index)
+  {
+    MYSQL_BIND &field(row_buffer[col_index]);
 
-      for (int index = 1; index <= length.quot; index++ )
-      {
-        uval += (((unsigned char*)(*_row_buffer)[col_index].buffer)[length.quot - index]) << shift;
-        shift += 8;
-      }
+    if (col_index > 0)
+      line.push_back('\t');
 
-      std::string numeric_value = base::strfmt("%llu", uval);
+    if (field.buffer_type == MYSQL_TYPE_NULL || *field.is_null)
+    {
+      line.append("\\N", 2);
+      continue;
+    }
 
-      ret_val = _bulk_insert_record.append(numeric_value.data(), numeric_value.length());
-      break;
+    if (format_value(field, value, is_temporal))
+    {
+      line.append(value);
+      continue;
     }
+
+    switch (field.buffer_type)
+    {
     case MYSQL_TYPE_DECIMAL:
     case MYSQL_TYPE_NEWDECIMAL:
-      ret_val = _bulk_insert_record.append_escaped((char*)(*_row_buffer)[col_index].buffer, *(*_row_buffer)[col_index].length);
-      break;
     case MYSQL_TYPE_VAR_STRING:
     case MYSQL_TYPE_VARCHAR:
     case MYSQL_TYPE_STRING:
     case MYSQL_TYPE_ENUM:
     case MYSQL_TYPE_SET:
-    //case MYSQL_TYPE_JSON:
-      _bulk_insert_record.append("'", 1);
-      ret_val = _bulk_insert_record.append_escaped((char*)(*_row_buffer)[col_index].buffer, *(*_row_buffer)[col_index].length);
-      _bulk_insert_record.append("'", 1);
-      break;
-    case MYSQL_TYPE_TIME:
-    case MYSQL_TYPE_DATE:
-    case MYSQL_TYPE_NEWDATE:
-    case MYSQL_TYPE_DATETIME:
-    case MYSQL_TYPE_TIMESTAMP:
-      {
-        MYSQL_TIME *ts = (MYSQL_TIME*)(*_row_buffer)[col_index].buffer;
-        switch(ts->time_type)
-        {
-        case MYSQL_TIMESTAMP_DATETIME:
-          if (_major_version >= 6
-              || (_major_version == 5 && _minor_version >= 7)
-              || (_major_version == 5 && _minor_version == 6 && _build_version >= 4))
-            data = base::strfmt("'%04d-%02d-%02d %02d:%02d:%02d.%06lu'",
-                         ts->year, ts->month, ts->day,
-                         ts->hour, ts->minute, ts->second,
-                         ts->second_part);
-          else
-            data = base::strfmt("'%04d-%02d-%02d %02d:%02d:%02d'",
-                                   ts->year, ts->month, ts->day,
-                                   ts->hour, ts->minute, ts->second);
-          break;
-        case MYSQL_TIMESTAMP_DATE:
-          data = base::strfmt("'%04d-%02d-%02d'",
-                         ts->year, ts->month, ts->day);
-          break;
-        case MYSQL_TIMESTAMP_TIME:
-          if (_major_version >= 6
-                        || (_major_version == 5 && _minor_version >= 7)
-                        || (_major_version == 5 && _minor_version == 6 && _build_version >= 4))
-            data = base::strfmt("'%02d:%02d:%02d.%06lu'",
-                                ts->hour, ts->minute, ts->second, ts->second_part);
-          else
-            data = base::strfmt("'%02d:%02d:%02d'",
-                                            ts->hour, ts->minute, ts->second);
-          break;
-        default:
-          data = "''";
-          break;
-        }
-
-        ret_val = _bulk_insert_record.append(data.data(), data.length());
-      }
-      break;
     case MYSQL_TYPE_BLOB:
     case MYSQL_TYPE_TINY_BLOB:
     case MYSQL_TYPE_MEDIUM_BLOB:
     case MYSQL_TYPE_LONG_BLOB:
-      _bulk_insert_record.append("'", 1);
-      ret_val = _bulk_insert_record.append_escaped((char*)(*_row_buffer)[col_index].buffer, *(*_row_buffer)[col_index].length);
-      _bulk_insert_record.append("'", 1);
+    case MYSQL_TYPE_GEOMETRY:
+      append_load_data_escaped(line, (char*)field.buffer, *field.length);
       break;
+    default:
+      // Writing \N would silently load NULL instead of the real value
+      throw std::runtime_error(base::strfmt("Unsupported data type %s (%i) of column %s for LOAD DATA",
+                                            (*_columns)[col_index].source_type.c_str(), (int)field.buffer_type,
+                                            (*_columns)[col_index].source_name.c_str()));
+    }
+  }
+  line.push_back('\n');
+}
 
-#if MYSQL_VERSION_ID > 50600
-      case MYSQL_TYPE_TIMESTAMP2:
-      case MYSQL_TYPE_DATETIME2:
-      case MYSQL_TYPE_TIME2:
-#endif
-        // TODO: implement handling
-        break;
+int MySQLCopyDataTarget::local_infile_init(void **ptr, const char *filename, void *userdata)
+{
+  MySQLCopyDataTarget *self = (MySQLCopyDataTarget*)userdata;
+  *ptr = self;
+
+  if (!self->_load_data_active)
+  {
+    self->_load_data_error = base::strfmt("Refusing unexpected request for local file %s", filename);
+    return 1;
+  }
+  return 0;
+}
+
+int MySQLCopyDataTarget::local_infile_read(void *ptr, char *buf, unsigned int buf_len)
+{
+  MySQLCopyDataTarget *self = (MySQLCopyDataTarget*)ptr;
+  unsigned int copied = 0;
+
+  try
+  {
+    while (copied < buf_len)
+    {
+      if (self->_load_data_offset >= self->_load_data_pending.size())
+      {
+        self->_load_data_pending.clear();
+        self->_load_data_offset = 0;
+
+        RowBuffer *row = self->_load_data_next_row();
+        if (!row)
+          break; // end of data
+
+        try
+        {
+          self->format_load_data_row(*row, self->_load_data_pending);
+        }
+        catch (...)
+        {
+          self->_load_data_release_row(row);
+          throw;
+        }
+        self->_load_data_release_row(row);
+        self->_load_data_rows++;
+      }
+
+      size_t length = std::min((size_t)(buf_len - copied), self->_load_data_pending.size() - self->_load_data_offset);
+      memcpy(buf + copied, self->_load_data_pending.data() + self->_load_data_offset, length);
+      copied += (unsigned int)length;
+      self->_load_data_offset += length;
+    }
+  }
+  catch (std::exception &e)
+  {
+    // exceptions must not pass through the client library
+    self->_load_data_error = e.what();
+    return -1;
+  }
+
+  return (int)copied;
+}
+
+void MySQLCopyDataTarget::local_infile_end(void *ptr)
+{
+  MySQLCopyDataTarget *self = (MySQLCopyDataTarget*)ptr;
+  if (self)
+  {
+    self->_load_data_pending.clear();
+    self->_load_data_offset = 0;
+  }
+}
+
+int MySQLCopyDataTarget::local_infile_error(void *ptr, char *error_msg, unsigned int error_msg_len)
+{
+  MySQLCopyDataTarget *self = (MySQLCopyDataTarget*)ptr;
+  if (self && error_msg_len > 0)
+  {
+    strncpy(error_msg, self->_load_data_error.c_str(), error_msg_len - 1);
+    error_msg[error_msg_len - 1] = 0;
+  }
+  return 2000; // CR_UNKNOWN_ERROR
+}
+
+/*
+* load_data : streams rows into the current target table with LOAD DATA LOCAL INFILE.
+* Parameters:
+* - next_row : returns the next row to load, NULL when there are no more rows
+* - release_row : called once a row returned by next_row was formatted
+*
+* Remarks : The rows are formatted as tab separated text while the server reads the "file", so
+*           nothing is written to disk. Returns the number of rows loaded by the server, or -1 if
+*           the server does not allow LOAD DATA LOCAL INFILE, in which case no rows were read and
+*           bulk inserts are used from then on. Throws if the server skipped rows or raised warnings.
+*/
+long long MySQLCopyDataTarget::load_data(boost::function<RowBuffer* ()> next_row, boost::function<void (RowBuffer*)> release_row)
+{
+  if (!_use_load_data)
+    return -1;
+
+  _load_data_next_row = next_row;
+  _load_data_release_row = release_row;
+  _load_data_pending.clear();
+  _load_data_offset = 0;
+  _load_data_rows = 0;
+  _load_data_error.clear();
+  _load_data_active = true;
+
+  std::string q = load_data_query();
+  log_debug("Executing query: %s\n", q.c_str());
+  int rc = mysql_real_query(&_mysql, q.data(), (unsigned long)q.length());
+
+  _load_data_active = false;
+  _load_data_next_row.clear();
+  _load_data_release_row.clear();
+
+  if (rc != 0)
+  {
+    unsigned int error = mysql_errno(&_mysql);
+    // 1148 (ER_NOT_ALLOWED_COMMAND) and 3948 (ER_CLIENT_LOCAL_FILES_DISABLED) are sent before any data is read
+    if (_load_data_rows == 0 && (error == 1148 || error == 3948))
+    {
+      log_warning("LOAD DATA LOCAL INFILE is not allowed by the target server, using INSERT statements instead: %s\n",
+                  mysql_error(&_mysql));
+      _use_load_data = false;
+      return -1;
+    }
+    if (!_load_data_error.empty())
+      throw std::runtime_error("Loading Data: " + _load_data_error);
+    throw ConnectionError("Loading Data", &_mysql);
+  }
+
+  // LOAD DATA LOCAL works like IGNORE: rows with duplicate keys are skipped and bad values are changed
+  // with just a warning, where the INSERT statements would fail. So anything like that fails the table.
+  long long loaded = (long long)mysql_affected_rows(&_mysql);
+  if (loaded != _load_data_rows || mysql_warning_count(&_mysql) > 0)
+  {
+    const char *info = mysql_info(&_mysql);
+    std::string message = base::strfmt("%lli of %lli rows loaded into %s.%s (%s)", loaded, _load_data_rows,
+                                       _schema.c_str(), _table.c_str(), info ? info : "");
+    log_error("Loading data: %s\n", message.c_str());
+    throw std::runtime_error("Loading Data: " + message + load_data_warnings());
+  }
+  return loaded;
+}
+
+// Returns the first warnings raised by the last LOAD DATA, to explain why it failed
+std::string MySQLCopyDataTarget::load_data_warnings()
+{
+  std::string q = "SHOW WARNINGS LIMIT 5";
+  if (mysql_real_query(&_mysql, q.data(), (unsigned long)q.length()) != 0)
+    return "";
+
+  MYSQL_RES *result;
+  if ((result = mysql_use_result(&_mysql)) == NULL)
+    return "";
+
+  std::string warnings;
+  MYSQL_ROW row;
+  while ((row = mysql_fetch_row(result)))
+  {
+    log_error("LOAD DATA %s %s: %s\n", row[0], row[1], row[2]);
+    warnings.append(warnings.empty() ? ": " : "; ").append(row[2] ? row[2] : "");
+  }
+  mysql_free_result(result);
+
+  return warnings;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool MySQLCopyDataTarget::format_bulk_record(RowBuffer &row_buffer)
+{
+  bool ret_val = true;
+  _bulk_insert_record.append("(", 1);
+
+  for(size_t index = 0; ret_val && index < row_buffer.size() - 1; index++)
+  {
+    ret_val = append_bulk_column(row_buffer, index);
+    _bulk_insert_record.append(",", 1);
+  }
+
+  if (ret_val)
+  {
+    ret_val = append_bulk_column(row_buffer, row_buffer.size() - 1);
+
+    if (ret_val)
+      ret_val = _bulk_insert_record.append(")", 1);
+  }
+
+  return ret_val;
+}
+
+bool MySQLCopyDataTarget::append_bulk_column(RowBuffer &row_buffer, size_t col_index)
+{
+  MYSQL_BIND &field(row_buffer[col_index]);
+  std::string data;
+  bool is_temporal;
+  bool ret_val = true;
+
+  if (field.buffer_type == MYSQL_TYPE_NULL || *field.is_null)
+    ret_val = _bulk_insert_record.append("NULL", 4);
+  else if (format_value(field, data, is_temporal))
+  {
+    if (is_temporal)
+      data = "'" + data + "'";
+    ret_val = _bulk_insert_record.append(data.data(), data.length());
+  }
+  else
+  {
+    switch(field.buffer_type)
+    {
+    case MYSQL_TYPE_DECIMAL:
+    case MYSQL_TYPE_NEWDECIMAL:
+      ret_val = _bulk_insert_record.append_escaped((char*)field.buffer, *field.length);
+      break;
+    case MYSQL_TYPE_VAR_STRING:
+    case MYSQL_TYPE_VARCHAR:
+    case MYSQL_TYPE_STRING:
+    case MYSQL_TYPE_ENUM:
+    case MYSQL_TYPE_SET:
+    //case MYSQL_TYPE_JSON:
+    case MYSQL_TYPE_BLOB:
+    case MYSQL_TYPE_TINY_BLOB:
+    case MYSQL_TYPE_MEDIUM_BLOB:
+    case MYSQL_TYPE_LONG_BLOB:
+      _bulk_insert_record.append("'", 1);
+      ret_val = _bulk_insert_record.append_escaped((char*)field.buffer, *field.length);
+      _bulk_insert_record.append("'", 1);
+      break;
+
+#if MYSQL_VERSION_ID > 50600
+      case MYSQL_TYPE_TIMESTAMP2:
+      case MYSQL_TYPE_DATETIME2:
+      case MYSQL_TYPE_TIME2:
+#endif
+        // TODO: implement handling
+        break;
       case MYSQL_TYPE_GEOMETRY:
         _bulk_insert_record.append("GeomFromText('");
-        ret_val = _bulk_insert_record.append_escaped((char*)(*_row_buffer)[col_index].buffer, *(*_row_buffer)[col_index].length);
+        ret_val = _bulk_insert_record.append_escaped((char*)field.buffer, *field.length);
         _bulk_insert_record.append("')");
         break;
+      default:
+        break;
     }
   }
 
@@ -2487,6 +2983,12 @@ RowBuffer &MySQLCopyDataTarget::row_buffer()
   return *_row_buffer;
 }
 
+// Creates an additional row buffer for the current target table, rows in it can be inserted with bulk inserts
+RowBuffer *MySQLCopyDataTarget::create_row_buffer()
+{
+  return new RowBuffer(_columns, boost::bind(&MySQLCopyDataTarget::send_long_data, this, _1, _2, _3), _max_allowed_packet);
+}
+
 long long MySQLCopyDataTarget::get_max_value(const std::string &key)
 {
   std::string q = base::sqlstring("SELECT max(!) FROM !.!", 0) << key << _schema << _table;
@@ -2738,6 +3240,13 @@ void TaskQueue::add_task(const TableParam& task)
   _tasks.push_back(task);
 }
 
+// Adds tasks to the head of the queue, so that idle workers pick them up before the remaining tables
+void TaskQueue::add_priority_tasks(const std::vector<TableParam>& tasks)
+{
+  base::MutexLock  lock(_task_mutex);
+  _tasks.insert(_tasks.begin(), tasks.begin(), tasks.end());
+}
+
 bool TaskQueue::get_task(TableParam& task)
 {
   bool ret_val = false;
@@ -2754,13 +3263,15 @@ bool TaskQueue::get_task(TableParam& task)
   return ret_val;
 }
 
-CopyDataTask::CopyDataTask(const std::string name, CopyDataSource*psource, MySQLCopyDataTarget* ptarget, TaskQueue* ptasks, bool show_progress):
+CopyDataTask::CopyDataTask(const std::string name, CopyDataSource*psource, MySQLCopyDataTarget* ptarget, TaskQueue* ptasks, bool show_progress,
+                           long long chunk_size):
 _source(psource),
 _target(ptarget)
 {
   _name = name;
   _tasks = ptasks;
   _show_progress = show_progress;
+  _chunk_size = chunk_size;
 
   _thread = base::create_thread(&CopyDataTask::thread_func, this);
 }
@@ -2773,73 +3284,206 @@ gpointer CopyDataTask::thread_func(gpointer data)
 
   while (self->_tasks->get_task(tparam))
   {
+    // big tables are put back in the queue as key range chunks, which all workers can copy concurrently
+    if (self->_chunk_size > 0 && !tparam.chunk_state && self->split_table(tparam))
+      continue;
+
     self->copy_table(tparam);
   }
 
   return NULL;
 }
 
+/*
+* split_table : splits a table in chunks of about _chunk_size rows and queues a task for each of them.
+* Parameters:
+* - task : the task copying the whole table
+*
+* Remarks : Only tables with a single column integer PK are split, the chunks are ranges of the PK
+*           values. When resuming, each chunk continues from the last PK copied in its own range,
+*           so only the unfinished ranges are copied again.
+*           Returns false if the table must be copied as a whole.
+*/
+bool CopyDataTask::split_table(const TableParam &task)
+{
+  if (task.copy_spec.type != CopyAll || task.copy_spec.max_count > 0 ||
+      task.source_pk_columns.size() != 1 || task.target_pk_columns.size() != 1)
+    return false;
+
+  long long total = 0, min_key = 0, max_key = 0;
+  try
+  {
+    CopySpec spec = task.copy_spec;
+    spec.resume = false;
+    total = _source->count_rows(task.source_schema, task.source_table, task.source_pk_columns, spec, std::vector<std::string>());
+    if (total <= _chunk_size)
+      return false;
+
+    // negative range ends have a special meaning in CopyRange specs
+    if (!_source->get_key_range(task.source_schema, task.source_table, task.source_pk_columns[0], min_key, max_key) || min_key < 0)
+    {
+      log_info("Table %s.%s can't be split in chunks, its PK is not a non negative integer\n", task.source_schema.c_str(), task.source_table.c_str());
+      return false;
+    }
+  }
+  catch (std::exception &e)
+  {
+    log_warning("Could not split table %s.%s in chunks, copying it as a whole: %s\n", task.source_schema.c_str(), task.source_table.c_str(), e.what());
+    return false;
+  }
+
+  unsigned long long key_span = (unsigned long long)(max_key - min_key) + 1;
+  unsigned long long chunk_count = (total + _chunk_size - 1) / _chunk_size;
+  if (chunk_count > key_span)
+    chunk_count = key_span;
+  if (chunk_count < 2)
+    return false;
+  unsigned long long key_step = key_span / chunk_count;
+
+  if (_target->get_truncate())
+    _target->truncate_table(task.target_schema, task.target_table);
+
+  boost::shared_ptr<TableChunkState> state(new TableChunkState((int)chunk_count, total));
+  std::vector<TableParam> chunks;
+  for (unsigned long long index = 0; index < chunk_count; index++)
+  {
+    TableParam chunk = task;
+    chunk.chunk_state = state;
+    chunk.copy_spec.type = CopyRange;
+    chunk.copy_spec.range_key = task.source_pk_columns[0];
+    chunk.copy_spec.range_start = min_key + (long long)(index * key_step);
+    chunk.copy_spec.range_end = (index == chunk_count - 1) ? max_key : chunk.copy_spec.range_start + (long long)key_step - 1;
+    chunk.copy_spec.row_count = 0;
+    chunks.push_back(chunk);
+  }
+
+  // the table progress must only cover what is left to copy, the same rows each chunk counts for itself
+  if (task.copy_spec.resume)
+  {
+    try
+    {
+      long long remaining = 0;
+      for (std::vector<TableParam>::const_iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk)
+        remaining += _source->count_rows(chunk->source_schema, chunk->source_table, chunk->source_pk_columns, chunk->copy_spec,
+                                         get_resume_keys(*chunk));
+      state->total_rows = remaining;
+    }
+    catch (std::exception &e)
+    {
+      log_warning("Could not count the rows left to copy from %s.%s, progress will refer to the whole table: %s\n",
+                  task.source_schema.c_str(), task.source_table.c_str(), e.what());
+    }
+  }
+
+  log_info("Copying table %s.%s in %i chunks of about %lli rows\n", task.source_schema.c_str(), task.source_table.c_str(),
+           (int)chunk_count, _chunk_size);
+  _tasks->add_priority_tasks(chunks);
+
+  return true;
+}
+
+/*
+* get_resume_keys : returns the PK of the last row already copied to the target, where copying the task must resume from.
+*
+* Remarks : A chunk resumes from the last row copied in its own key range.
+*/
+std::vector<std::string> CopyDataTask::get_resume_keys(const TableParam &task)
+{
+  std::string range_condition;
+  if (task.chunk_state)
+    range_condition = base::strfmt("%s >= %lli AND %s <= %lli", task.target_pk_columns[0].c_str(), task.copy_spec.range_start,
+                                   task.target_pk_columns[0].c_str(), task.copy_spec.range_end);
+  return _target->get_last_pkeys(task.target_pk_columns, task.target_schema, task.target_table, range_condition);
+}
+
 void CopyDataTask::copy_table(const TableParam &task)
 {
   boost::shared_ptr<std::vector<ColumnInfo> > columns;
 
   long long i = 0, total = 0;
   int inserted_records;
+  std::string error;
+  bool failed = false;
 
   time_t start = time(NULL);
   try
   {
     std::vector<std::string> last_pkeys;
     if (task.copy_spec.resume)
-      last_pkeys = _target->get_last_pkeys(task.target_pk_columns, task.target_schema, task.target_table);
+      last_pkeys = get_resume_keys(task);
     total = _source->count_rows(task.source_schema, task.source_table, task.source_pk_columns, task.copy_spec, last_pkeys);
     columns = _source->begin_select_table(task.source_schema, task.source_table, task.source_pk_columns, task.select_expression, task.copy_spec, last_pkeys);
 
-    printf("BEGIN:%s.%s:Copying %li columns of %lli rows from table %s.%s\n",
-           task.target_schema.c_str(), task.target_table.c_str(),
-           (long)columns->size(), total,
-           task.source_schema.c_str(), task.source_table.c_str());
-    fflush(stdout);
+    if (task.chunk_state)
+      begin_chunk(task, columns->size());
+    else
+    {
+      printf("BEGIN:%s.%s:Copying %li columns of %lli rows from table %s.%s\n",
+             task.target_schema.c_str(), task.target_table.c_str(),
+             (long)columns->size(), total,
+             task.source_schema.c_str(), task.source_table.c_str());
+      fflush(stdout);
+    }
 
     _target->set_get_field_lengths_from_target(_source->get_get_field_lengths_from_target());
 
-    _target->set_target_table(task.target_schema, task.target_table, columns);
+    _target->set_target_table(task.target_schema, task.target_table, columns, !task.chunk_state);
 
     _source->set_bulk_inserts(_target->bulk_inserts());
 
     _target->begin_inserts();
-    while (_source->fetch_row(_target->row_buffer()))
+    if (_target->bulk_inserts())
+      copy_rows_pipelined(task, i, total);
+    else
     {
-      inserted_records = _target->do_insert();
-      i += inserted_records;
+      while (_source->fetch_row(_target->row_buffer()))
+      {
+        inserted_records = _target->do_insert();
+        i += inserted_records;
 
-      if (_show_progress && inserted_records)
-        report_progress(task.target_schema, task.target_table, i, total);
+        if (inserted_records)
+          update_progress(task, inserted_records, i, total);
 
-      _target->row_buffer().clear();
+        _target->row_buffer().clear();
 
-      if ((task.copy_spec.type == CopyCount && i >= task.copy_spec.row_count) ||
-          (task.copy_spec.max_count > 0 && i >= task.copy_spec.max_count))
-        break;
-    }
+        if ((task.copy_spec.type == CopyCount && i >= task.copy_spec.row_count) ||
+            (task.copy_spec.max_count > 0 && i >= task.copy_spec.max_count))
+          break;
+      }
 
-    inserted_records = _target->end_inserts();
-    i += inserted_records;
+      inserted_records = _target->end_inserts();
+      i += inserted_records;
 
-    if (_show_progress && inserted_records)
-    {
-      report_progress(task.target_schema, task.target_table, i, total);
+      if (inserted_records)
+        update_progress(task, inserted_records, i, total);
     }
 
     _source->end_select_table();
   }
   catch (std::exception &e)
   {
-    printf("ERROR:%s.%s:%s\n",
-           task.target_schema.c_str(), task.target_table.c_str(), e.what());
-    fflush(stdout);
+    // an ERROR line ends the table for the caller, so failed chunks only report it with the table result
+    if (task.chunk_state)
+      log_error("Error copying %s.%s in range %lli-%lli: %s\n", task.target_schema.c_str(), task.target_table.c_str(),
+                task.copy_spec.range_start, task.copy_spec.range_end, e.what());
+    else
+    {
+      printf("ERROR:%s.%s:%s\n",
+             task.target_schema.c_str(), task.target_table.c_str(), e.what());
+      fflush(stdout);
+    }
     _target->end_inserts(false);
     _source->end_select_table();
+    error = e.what();
+    failed = true;
+  }
+
+  if (task.chunk_state)
+  {
+    if (failed && error.empty())
+      error = "Unknown error";
+    end_chunk(task, i, total, error);
+    return;
   }
 
   time_t end = time(NULL);
@@ -2853,12 +3497,306 @@ void CopyDataTask::copy_table(const TableParam &task)
   fflush(stdout);
 }
 
+// State and stage counters of the insert stage, shared with the fetch stage running in the task thread
+struct CopyDataTask::InsertStage
+{
+  CopyDataTask *owner;
+  const TableParam &task;
+  RowBufferRing &ring;
+  long long total;
+
+  base::Mutex mutex;
+  long long inserted;
+  double insert_time;
+  double wait_time;
+  std::string error;
+  double last_row_time;
+
+  InsertStage(CopyDataTask *o, const TableParam &t, RowBufferRing &r, long long tot)
+  : owner(o), task(t), ring(r), total(tot), inserted(0), insert_time(0), wait_time(0), last_row_time(0) {}
+
+  RowBuffer *next_load_data_row();
+};
+
+// Feeds LOAD DATA LOCAL INFILE with the fetched rows, rows handed to the server are reported as inserted
+RowBuffer *CopyDataTask::InsertStage::next_load_data_row()
+{
+  double waited = 0;
+  double start = base::timestamp();
+  RowBuffer *row = ring.get_filled(waited);
+
+  long long current;
+  {
+    base::MutexLock lock(mutex);
+    // time since the previous row was handed out went into formatting and sending data
+    insert_time += start - last_row_time;
+    wait_time += waited;
+    current = row ? ++inserted : inserted;
+  }
+  last_row_time = base::timestamp();
+  int step = std::max(owner->_target->get_bulk_insert_batch_size(), 1);
+  if (row && current % step == 0)
+    owner->update_progress(task, step, current, total);
+  return row;
+}
+
+/*
+* insert_thread_func : insert stage of a pipelined table copy.
+*
+* Remarks : Takes the rows fetched by the task thread from the row buffer ring, formats them into
+*           bulk inserts and sends these to the target server. The buffers are handed back to the
+*           fetch stage as soon as their row is formatted.
+*/
+gpointer CopyDataTask::insert_thread_func(gpointer data)
+{
+  InsertStage *stage = (InsertStage*)data;
+  MySQLCopyDataTarget *target = stage->owner->_target.get();
+
+  mysql_thread_init();
+  try
+  {
+    if (target->load_data_infile())
+    {
+      double start = stage->last_row_time = base::timestamp();
+      long long loaded = target->load_data(boost::bind(&InsertStage::next_load_data_row, stage),
+                                           boost::bind(&RowBufferRing::put_free, &stage->ring, _1));
+      if (loaded >= 0)
+      {
+        // load_data() fails if the server skipped rows, so all streamed rows were loaded; report the
+        // rest of the progress, only whole steps were reported while streaming
+        int step = std::max(target->get_bulk_insert_batch_size(), 1);
+        long long reported = (loaded / step) * step;
+        if (loaded > reported)
+          stage->owner->update_progress(stage->task, (int)(loaded - reported), loaded, stage->total);
+        log_debug("Loaded %lli rows into %s.%s in %.2fs\n", loaded, stage->task.target_schema.c_str(),
+                  stage->task.target_table.c_str(), base::timestamp() - start);
+        mysql_thread_end();
+        return NULL;
+      }
+      // LOAD DATA is not allowed by the server and no rows were consumed, go on with bulk inserts
+    }
+
+    double wait_time = 0;
+    RowBuffer *row;
+    while ((row = stage->ring.get_filled(wait_time)) != NULL)
+    {
+      double start = base::timestamp();
+      int inserted_records;
+      try
+      {
+        inserted_records = target->do_insert(*row, false);
+      }
+      catch (...)
+      {
+        stage->ring.put_free(row);
+        throw;
+      }
+      stage->ring.put_free(row);
+
+      long long inserted;
+      {
+        base::MutexLock lock(stage->mutex);
+        stage->insert_time += base::timestamp() - start;
+        stage->wait_time = wait_time;
+        inserted = (stage->inserted += inserted_records);
+      }
+      if (inserted_records)
+        stage->owner->update_progress(stage->task, inserted_records, inserted, stage->total);
+    }
+
+    double start = base::timestamp();
+    int inserted_records = target->end_inserts();
+    {
+      base::MutexLock lock(stage->mutex);
+      stage->insert_time += base::timestamp() - start;
+      stage->wait_time = wait_time;
+      stage->inserted += inserted_records;
+    }
+    if (inserted_records)
+      stage->owner->update_progress(stage->task, inserted_records, stage->inserted, stage->total);
+  }
+  catch (std::exception &e)
+  {
+    base::MutexLock lock(stage->mutex);
+    stage->error = e.what();
+    stage->ring.abort();
+  }
+  mysql_thread_end();
+
+  return NULL;
+}
+
+/*
+* copy_rows_pipelined : copies the rows of the selected table with separate fetch and insert stages.
+* Parameters:
+* - task : the table being copied
+* - copied : output parameter, the number of rows inserted in the target table
+* - total : the number of rows expected, for progress reports
+*
+* Remarks : The task thread fetches rows from the source into a bounded ring of row buffers while
+*           a second thread formats and sends the bulk inserts, so the source and target servers
+*           work at the same time. At most about PIPELINE_MEMORY_LIMIT bytes of fetched rows are queued.
+*/
+void CopyDataTask::copy_rows_pipelined(const TableParam &task, long long &copied, long long total)
+{
+  size_t max_rows = std::min((size_t)PIPELINE_MAX_ROWS, (size_t)std::max(_target->get_bulk_insert_batch_size(), 1) * 4);
+  RowBufferRing ring(boost::bind(&MySQLCopyDataTarget::create_row_buffer, _target.get()), max_rows, PIPELINE_MEMORY_LIMIT);
+  log_debug("Copying %s.%s through a ring of %li row buffers\n", task.target_schema.c_str(), task.target_table.c_str(), (long)ring.size());
+
+  InsertStage stage(this, task, ring, total);
+  GThread *insert_thread = base::create_thread(&CopyDataTask::insert_thread_func, &stage);
+
+  long long fetched = 0;
+  double fetch_time = 0, fetch_wait_time = 0;
+  time_t last_report = time(NULL);
+  try
+  {
+    RowBuffer *row;
+    while ((row = ring.get_free(fetch_wait_time)) != NULL)
+    {
+      row->clear();
+
+      double start = base::timestamp();
+      bool has_row;
+      try
+      {
+        has_row = _source->fetch_row(*row);
+      }
+      catch (...)
+      {
+        ring.put_free(row);
+        throw;
+      }
+      fetch_time += base::timestamp() - start;
+
+      if (!has_row)
+      {
+        ring.put_free(row);
+        break;
+      }
+      ring.put_filled(row);
+      fetched++;
+
+      if ((task.copy_spec.type == CopyCount && fetched >= task.copy_spec.row_count) ||
+          (task.copy_spec.max_count > 0 && fetched >= task.copy_spec.max_count))
+        break;
+
+      if (_show_progress && time(NULL) - last_report >= STAGE_STATS_INTERVAL)
+      {
+        report_stage_stats(task, fetched, fetch_time, fetch_wait_time, stage);
+        last_report = time(NULL);
+      }
+    }
+    ring.finish();
+  }
+  catch (...)
+  {
+    ring.abort();
+    g_thread_join(insert_thread);
+    copied = stage.inserted;
+    throw;
+  }
+
+  g_thread_join(insert_thread);
+  copied = stage.inserted;
+
+  if (_show_progress)
+    report_stage_stats(task, fetched, fetch_time, fetch_wait_time, stage);
+
+  if (!stage.error.empty())
+    throw std::runtime_error(stage.error);
+}
+
+// The first chunk of a table that starts copying reports the beginning of the whole table
+void CopyDataTask::begin_chunk(const TableParam &task, size_t column_count)
+{
+  TableChunkState &state = *task.chunk_state;
+  base::MutexLock lock(state.mutex);
+
+  if (state.started)
+    return;
+  state.started = true;
+
+  printf("BEGIN:%s.%s:Copying %li columns of %lli rows from table %s.%s in %i key range chunks\n",
+         task.target_schema.c_str(), task.target_table.c_str(),
+         (long)column_count, state.total_rows,
+         task.source_schema.c_str(), task.source_table.c_str(), state.chunk_count);
+  fflush(stdout);
+}
+
+// The last chunk of a table that finishes reports the result for the whole table
+void CopyDataTask::end_chunk(const TableParam &task, long long copied, long long total, const std::string &error)
+{
+  TableChunkState &state = *task.chunk_state;
+  base::MutexLock lock(state.mutex);
+
+  if (!error.empty())
+    state.last_error = error;
+  if (!error.empty() || copied != total)
+  {
+    log_error("Failed copying %lli rows of %s.%s in range %lli-%lli\n", total - copied,
+              task.target_schema.c_str(), task.target_table.c_str(), task.copy_spec.range_start, task.copy_spec.range_end);
+    state.failed_chunks++;
+    state.failed_rows += total - copied;
+  }
+  state.finished_rows += copied;
+
+  if (--state.pending_chunks > 0)
+    return;
+
+  time_t end = time(NULL);
+  if (state.failed_chunks > 0)
+    printf("ERROR:%s.%s:Failed copying %lli rows (%i of %i key range chunks failed)%s%s\n",
+           task.target_schema.c_str(), task.target_table.c_str(), state.failed_rows, state.failed_chunks, state.chunk_count,
+           state.last_error.empty() ? "" : ": ", state.last_error.c_str());
+  else
+    printf("END:%s.%s:Finished copying %lli rows in %im%02is\n",
+           task.target_schema.c_str(), task.target_table.c_str(), state.finished_rows,
+           (int)((end-state.start) / 60), (int)((end-state.start) % 60));
+  fflush(stdout);
+}
+
+// Progress of chunks is reported as the sum of all the chunks of the table
+void CopyDataTask::update_progress(const TableParam &task, int inserted_records, long long current, long long total)
+{
+  if (task.chunk_state)
+  {
+    TableChunkState &state = *task.chunk_state;
+    base::MutexLock lock(state.mutex);
+    state.copied_rows += inserted_records;
+    if (_show_progress)
+      report_progress(task.target_schema, task.target_table, state.copied_rows, state.total_rows);
+  }
+  else if (_show_progress)
+    report_progress(task.target_schema, task.target_table, current, total);
+}
+
 void CopyDataTask::report_progress(const std::string &schema, const std::string &table, long long current, long long total)
 {
   printf("PROGRESS:%s.%s:%lli:%lli\n", schema.c_str(), table.c_str(), current, total);
   fflush(stdout);
 }
 
+// Reports rows/s of the fetch and insert stages, the time a stage spent waiting for the other shows the bottleneck
+void CopyDataTask::report_stage_stats(const TableParam &task, long long fetched, double fetch_time, double fetch_wait_time,
+                                      InsertStage &stage)
+{
+  long long inserted;
+  double insert_time, insert_wait_time;
+  {
+    base::MutexLock lock(stage.mutex);
+    inserted = stage.inserted;
+    insert_time = stage.insert_time;
+    insert_wait_time = stage.wait_time;
+  }
+
+  printf("STAGES:%s.%s:fetch %lli rows in %.1fs (%.0f rows/s, waited %.1fs), insert %lli rows in %.1fs (%.0f rows/s, waited %.1fs)\n",
+         task.target_schema.c_str(), task.target_table.c_str(),
+         fetched, fetch_time, fetch_time > 0 ? fetched / fetch_time : 0.0, fetch_wait_time,
+         inserted, insert_time, insert_time > 0 ? inserted / insert_time : 0.0, insert_wait_time);
+  fflush(stdout);
+}
+
 
 CopyDataTask::~CopyDataTask()
 {
@@ -26,8 +26,10 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <vector>
+#include <deque>
 #include <set>
 #include <map>
 #include <string>
@@ -145,6 +147,40 @@ public:
 
   bool check_if_blob();
   void send_blob_data(const char *data, size_t length);
+
+  size_t memory_size() const;
+};
+
+
+// Bounded ring of row buffers, passing fetched rows from the fetch stage to the insert stage of a table copy
+class RowBufferRing
+{
+  std::vector<RowBuffer*> _buffers;
+  std::deque<RowBuffer*> _free;
+  std::deque<RowBuffer*> _filled;
+  std::deque<size_t> _filled_sizes;
+  size_t _queued_bytes; // size of the filled buffers waiting for the insert stage
+  size_t _memory_limit;
+  base::Mutex _mutex;
+  base::Cond _cond;
+  bool _finished;
+  bool _aborted;
+
+  bool must_wait_free() const;
+
+public:
+  RowBufferRing(boost::function<RowBuffer* ()> create_buffer, size_t max_buffers, size_t memory_limit);
+  ~RowBufferRing();
+
+  size_t size() const { return _buffers.size(); }
+
+  RowBuffer *get_free(double &wait_time);
+  void put_filled(RowBuffer *buffer);
+  RowBuffer *get_filled(double &wait_time);
+  void put_free(RowBuffer *buffer);
+
+  void finish();
+  void abort();
 };
 
 
@@ -170,6 +206,27 @@ struct CopySpec
 };
 
 
+// State shared by the tasks copying the PK range chunks of a single table
+struct TableChunkState
+{
+  base::Mutex mutex;
+  int chunk_count;
+  int pending_chunks;
+  bool started;
+  long long total_rows; // rows left to copy in the whole table, as counted before splitting it
+  long long copied_rows; // as reported by the progress of the chunks
+  long long finished_rows; // copied by the chunks that ended
+  long long failed_rows;
+  int failed_chunks;
+  std::string last_error; // reported with the table result, chunk errors alone don't end the table
+  time_t start;
+
+  TableChunkState(int count, long long total)
+  : chunk_count(count), pending_chunks(count), started(false), total_rows(total), copied_rows(0), finished_rows(0),
+    failed_rows(0), failed_chunks(0), start(time(NULL)) {}
+};
+
+
 struct TableParam
 {
   std::string source_schema;
@@ -180,6 +237,7 @@ struct TableParam
   std::vector<std::string> source_pk_columns;
   std::vector<std::string> target_pk_columns;
   CopySpec copy_spec;
+  boost::shared_ptr<TableChunkState> chunk_state; // set if the task copies a chunk of a table
 };
 
 class CopyDataSource
@@ -209,6 +267,9 @@ public:
 
   virtual size_t count_rows(const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
                             const CopySpec &spec, const std::vector<std::string> &last_pkeys) = 0;
+  // Gets the lowest and highest value of an integer key column, returns false if the values are not integers
+  virtual bool get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                             long long &min_value, long long &max_value) { return false; }
   virtual boost::shared_ptr<std::vector<ColumnInfo> > begin_select_table(const std::string &schema, const std::string &table,
                                                                          const std::vector<std::string> &pk_columns,
                                                                          const std::string &select_expression,
@@ -255,6 +316,8 @@ public:
 public:
   virtual size_t count_rows(const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
                             const CopySpec &spec, const std::vector<std::string> &last_pkeys);
+  virtual bool get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                             long long &min_value, long long &max_value);
   virtual boost::shared_ptr<std::vector<ColumnInfo> > begin_select_table(const std::string &schema, const std::string &table,
                                                                          const std::vector<std::string> &pk_columns,
                                                                          const std::string &select_expression,
@@ -278,6 +341,8 @@ public:
 
   virtual size_t count_rows(const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
                             const CopySpec &spec, const std::vector<std::string> &last_pkeys);
+  virtual bool get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                             long long &min_value, long long &max_value);
   virtual boost::shared_ptr<std::vector<ColumnInfo> > begin_select_table(const std::string &schema, const std::string &table,
                                                                          const std::vector<std::string> &pk_columns,
                                                                          const std::string &select_expression,
@@ -334,11 +399,30 @@ class MySQLCopyDataTarget
   int _bulk_insert_batch;
   std::string _source_rdbms_type;
 
+  // Variables used for LOAD DATA LOCAL INFILE, rows are pulled from _load_data_next_row by the local infile handler
+  bool _use_load_data;
+  bool _load_data_active;
+  boost::function<RowBuffer* ()> _load_data_next_row;
+  boost::function<void (RowBuffer*)> _load_data_release_row;
+  std::string _load_data_pending;
+  size_t _load_data_offset;
+  long long _load_data_rows;
+  std::string _load_data_error;
+
+  static int local_infile_init(void **ptr, const char *filename, void *userdata);
+  static int local_infile_read(void *ptr, char *buf, unsigned int buf_len);
+  static void local_infile_end(void *ptr);
+  static int local_infile_error(void *ptr, char *error_msg, unsigned int error_msg_len);
+  std::string load_data_query();
+  std::string load_data_warnings();
+  void format_load_data_row(RowBuffer &row_buffer, std::string &line);
+  bool format_value(const MYSQL_BIND &field, std::string &value, bool &is_temporal);
+
   MYSQL_RES * get_server_value(const std::string& variable);
   void get_server_value(const std::string& variable, std::string &value);
   void get_server_value(const std::string& variable, unsigned long &value);
-  bool format_bulk_record();
-  bool append_bulk_column(size_t col_index);
+  bool format_bulk_record(RowBuffer &row_buffer);
+  bool append_bulk_column(RowBuffer &row_buffer, size_t col_index);
 
   void get_server_version();
   bool is_mysql_version_at_least(const int _major, const int _minor, const int _build);
@@ -354,7 +438,8 @@ public:
   MySQLCopyDataTarget(const std::string &hostname, int port,
                       const std::string &username, const std::string &password,
                       const std::string &socket, bool use_cleartext_plugin, const std::string &app_name,
-                      const std::string &incoming_charset, const std::string &source_rdbms_type);
+                      const std::string &incoming_charset, const std::string &source_rdbms_type,
+                      bool use_load_data = false);
 
   ~MySQLCopyDataTarget();
 
@@ -364,7 +449,9 @@ public:
   void set_truncate(bool flag);
 
   void set_target_table(const std::string &schema, const std::string &table,
-                        boost::shared_ptr<std::vector<ColumnInfo> > columns);
+                        boost::shared_ptr<std::vector<ColumnInfo> > columns, bool allow_truncate = true);
+  void truncate_table(const std::string &schema, const std::string &table);
+  bool get_truncate() { return _truncate; }
   long long get_max_value(const std::string &key);
 
   bool bulk_inserts() { return _use_bulk_inserts; }
@@ -373,9 +460,15 @@ public:
   bool get_get_field_lengths_from_target() { return _get_field_lengths_from_target; }
   void set_get_field_lengths_from_target(bool value) { _get_field_lengths_from_target = value; }
 
+  int get_bulk_insert_batch_size() { return _bulk_insert_batch; }
+
   void begin_inserts();
   int end_inserts(bool flush = true);
   int do_insert(bool final = false);
+  int do_insert(RowBuffer &row_buffer, bool final);
+
+  bool load_data_infile() { return _use_load_data; }
+  long long load_data(boost::function<RowBuffer* ()> next_row, boost::function<void (RowBuffer*)> release_row);
 
   void restore_triggers(std::set<std::string> &schemas);
   void backup_triggers(std::set<std::string> &schemas);
@@ -383,9 +476,11 @@ public:
   void get_triggers_for_schema(const std::string &schema, std::map<std::string, std::string>& triggers);
   bool get_trigger_definitions_for_schema(const std::string &schema, std::map<std::string, std::string>& triggers);
   void drop_trigger_backups(const std::string& schema);
-  std::vector<std::string> get_last_pkeys(const std::vector<std::string> &pk_columns, const std::string &schema, const std::string &table);
+  std::vector<std::string> get_last_pkeys(const std::vector<std::string> &pk_columns, const std::string &schema, const std::string &table,
+                                          const std::string &where_condition = "");
 
   RowBuffer &row_buffer();
+  RowBuffer *create_row_buffer();
 };
 
 class TaskQueue
@@ -396,6 +491,7 @@ private:
 public:
   TaskQueue();
   void add_task(const TableParam& task);
+  void add_priority_tasks(const std::vector<TableParam>& tasks);
   bool get_task(TableParam& task);
 
   size_t size() { return _tasks.size(); }
@@ -410,17 +506,30 @@ private:
   boost::scoped_ptr<MySQLCopyDataTarget> _target;
   TaskQueue *_tasks;
   bool _show_progress;
+  long long _chunk_size;
 
   GThread *_thread;
 
+  struct InsertStage;
+
   static gpointer thread_func(gpointer data);
+  static gpointer insert_thread_func(gpointer data);
 
+  bool split_table(const TableParam &task);
+  std::vector<std::string> get_resume_keys(const TableParam &task);
   void copy_table(const TableParam &task);
+  void copy_rows_pipelined(const TableParam &task, long long &copied, long long total);
+  void begin_chunk(const TableParam &task, size_t column_count);
+  void end_chunk(const TableParam &task, long long copied, long long total, const std::string &error);
 
+  void update_progress(const TableParam &task, int inserted_records, long long current, long long total);
   void report_progress(const std::string &schema, const std::string &table, long long current, long long total);
+  void report_stage_stats(const TableParam &task, long long fetched, double fetch_time, double fetch_wait_time,
+                          InsertStage &stage);
 
 public:
-  CopyDataTask(const std::string name, CopyDataSource*psource, MySQLCopyDataTarget* ptarget, TaskQueue *ptasks, bool show_progress);
+  CopyDataTask(const std::string name, CopyDataSource*psource, MySQLCopyDataTarget* ptarget, TaskQueue *ptasks, bool show_progress,
+               long long chunk_size = 0);
   ~CopyDataTask();
   void wait() { g_thread_join(_thread); }
 };
@@ -164,6 +164,7 @@ static void show_help()
   printf("--target-password=<password>\n");
   printf("--force-utf8-for-source\n");
   printf("--truncate-target\n");
+  printf("--load-data-local-infile\n");
   printf("--progress\n");
   printf("--count-only\n");
   printf("--jobs-from-stdin\n");
@@ -180,6 +181,7 @@ static void show_help()
   printf("--log-file=<file_path>\n");
   printf("--log-level=<level>\n");
   printf("--thread-count=<count>\n");
+  printf("--chunk-size=<rows>\n");
   printf("--bulk-insert-batch-size=<size>\n");
   printf("--disable-triggers-on=<schema>\n");
   printf("--reenable-triggers-on=<schema>\n");
@@ -285,6 +287,7 @@ int main(int argc, char **argv)
   bool count_only = false;
   bool check_types_only = false;
   bool truncate_target = false;
+  bool load_data_local_infile = false;
   bool show_progress = false;
   bool abort_on_oversized_blobs = false;
   bool disable_triggers = false;
@@ -294,6 +297,7 @@ int main(int argc, char **argv)
   int thread_count = 1;
   long long bulk_insert_batch = 100;
   long long max_count = 0;
+  long long chunk_size = -1; // not set, defaults according to the thread count
 
   std::string table_file;
 
@@ -337,6 +341,8 @@ int main(int argc, char **argv)
       show_progress = true;
     else if (strcmp(argv[i], "--truncate-target") == 0)
       truncate_target = true;
+    else if (strcmp(argv[i], "--load-data-local-infile") == 0)
+      load_data_local_infile = true;
     else if (strcmp(argv[i], "--count-only") == 0)
     {
       // Count only will be allowed only if one of the trigger
@@ -380,6 +386,12 @@ int main(int argc, char **argv)
       if (thread_count < 1)
         thread_count = 1;
     }
+    else if (check_arg_with_value(argv, i, "--chunk-size", argval, true))
+    {
+      chunk_size = base::atoi<long long>(argval, 0ll);
+      if (chunk_size < 0)
+        chunk_size = 0;
+    }
     else if (check_arg_with_value(argv, i, "--bulk-insert-batch-size", argval, true))
     {
       bulk_insert_batch = base::atoi<int>(argval, 0);
@@ -555,6 +567,10 @@ int main(int argc, char **argv)
     i++;
   }
 
+  // Big tables are split in PK ranges by default when several threads are available to copy them
+  if (chunk_size < 0)
+    chunk_size = thread_count > 1 ? 1000000 : 0;
+
   // Creates the log to the target file if any, if not
   // uses std_error
   base::Logger logger(true, log_file);
@@ -760,7 +776,8 @@ int main(int argc, char **argv)
         else
           psource = new PythonCopyDataSource(source_connstring, source_password);
 
-        ptarget = new MySQLCopyDataTarget(target_host, target_port, target_user, target_password, target_socket, target_use_cleartext_plugin, app_name, source_charset, source_rdbms_type);
+        ptarget = new MySQLCopyDataTarget(target_host, target_port, target_user, target_password, target_socket, target_use_cleartext_plugin, app_name, source_charset, source_rdbms_type,
+                                          load_data_local_infile);
 
         psource->set_max_blob_chunk_size(ptarget->get_max_allowed_packet());
         psource->set_max_parameter_size((unsigned long)ptarget->get_max_long_data_size());
@@ -777,7 +794,7 @@ int main(int argc, char **argv)
         }
         else
         {
-          threads.push_back(new CopyDataTask(base::strfmt("Task %d", index + 1), psource, ptarget, &tables, show_progress));
+          threads.push_back(new CopyDataTask(base::strfmt("Task %d", index + 1), psource, ptarget, &tables, show_progress, chunk_size));
         }
       }
 
@@ -35,6 +35,7 @@ typedef int ssize_t;
 
 #include <errno.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <vector>
 #include <set>
@@ -42,6 +43,7 @@ typedef int ssize_t;
 #include <string>
 #include <stdexcept>
 #include <list>
+#include <deque>
 #include <vector>
 #include <sstream>
 #include <typeinfo>
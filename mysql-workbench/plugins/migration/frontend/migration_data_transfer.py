@@ -118,6 +118,10 @@ class SetupMainView(WizardPage):
         self._truncate_db.set_text("Truncate target tables (i.e. delete contents) before copying data")
         self.options_box.add(self._truncate_db, False, True)
 
+        self._load_data = mforms.newCheckBox()
+        self._load_data.set_text("Stream rows with LOAD DATA LOCAL INFILE instead of INSERT statements (local_infile must be enabled in the target server, tables with rows the server skips or changes are reported as failed)")
+        self.options_box.add(self._load_data, False, True)
+
         hbox = mforms.newBox(True)
         hbox.set_spacing(16)
         hbox.add(mforms.newLabel("Worker tasks"), False, True)
@@ -132,6 +136,20 @@ class SetupMainView(WizardPage):
         hbox.add(l, False, True)
         self.options_box.add(hbox, False, True)
 
+        hbox = mforms.newBox(True)
+        hbox.set_spacing(16)
+        hbox.add(mforms.newLabel("Rows per chunk"), False, True)
+        self._chunk_size = mforms.newTextEntry()
+        self._chunk_size.set_value("1000000")
+        self._chunk_size.set_size(80, -1)
+        hbox.add(self._chunk_size, False, True)
+        l = mforms.newImageBox()
+        l.set_image(mforms.App.get().get_resource_path("mini_notice.png"))
+        l.set_tooltip("Tables with more rows than this and a single column integer primary key are split in ranges of about this "+
+          "many rows, so that several worker tasks can copy them at the same time.\n0 disables splitting. Default value 1000000.")
+        hbox.add(l, False, True)
+        self.options_box.add(hbox, False, True)
+
         self._debug_copy = mforms.newCheckBox()
         self._debug_copy.set_text("Enable debug output for table copy")
         self.options_box.add(self._debug_copy, False, True)
@@ -176,6 +194,15 @@ All tables are copied by default.""")
             mforms.Utilities.show_error("Invalid Value", "Worker thread count must be a number larger than 0.", "OK", "", "")
             return
         self.main.plan.state.dataBulkTransferParams["workerCount"] = count
+        i = self._chunk_size.get_string_value()
+        try:
+            chunk_size = int(i)
+            if chunk_size < 0:
+                raise Exception("Bad value")
+        except Exception:
+            mforms.Utilities.show_error("Invalid Value", "Rows per chunk must be a number, 0 to not split tables.", "OK", "", "")
+            return
+        self.main.plan.state.dataBulkTransferParams["chunkSize"] = chunk_size
         #if self.dump_to_file.get_active():
         #   self.main.plan.state.dataBulkTransferParams["GenerateDumpScript"] = self.dump_to_file_entry.get_string_value()
         #else:
@@ -197,6 +224,7 @@ All tables are copied by default.""")
         self.main.plan.state.dataBulkTransferParams["LiveDataCopy"] = 1 if self._copy_db.get_active() else 0
         self.main.plan.state.dataBulkTransferParams["DebugTableCopy"] = 1 if self._debug_copy.get_active() else 0
         self.main.plan.state.dataBulkTransferParams["TruncateTargetTables"] = 1 if self._truncate_db.get_active() else 0
+        self.main.plan.state.dataBulkTransferParams["UseLoadDataLocalInfile"] = 1 if self._load_data.get_active() else 0
 
         for key in self.main.plan.state.dataBulkTransferParams.keys():
             if key.endswith(":rangeKey"):
@@ -503,7 +531,9 @@ class TransferMainView(WizardProgressPage):
         path = self.main.plan.state.dataBulkTransferParams["GenerateCopyScript"]
         debug_table_copy = self.main.plan.state.dataBulkTransferParams["DebugTableCopy"]
         truncate_target_tables = self.main.plan.state.dataBulkTransferParams["TruncateTargetTables"]
+        load_data_local_infile = self.main.plan.state.dataBulkTransferParams.get("UseLoadDataLocalInfile", 0)
         worker_count = self.main.plan.state.dataBulkTransferParams["workerCount"]
+        chunk_size = self.main.plan.state.dataBulkTransferParams.get("chunkSize", 1000000)
         f = open(path, "w+")
 
         if sys.platform == "win32":
@@ -539,10 +569,13 @@ IF [%arg_source_password%] == [] (
 )
 """)
             f.write("set arg_worker_count=%d\n" % worker_count)
+            f.write("set arg_chunk_size=%d\n" % chunk_size)
             f.write("REM Uncomment the following options according to your needs\n")
             f.write("\n")
             f.write("REM Whether target tables should be truncated before copy\n")
             f.write( ("" if truncate_target_tables else "REM ") + "set arg_truncate_target=--truncate-target\n")
+            f.write("REM Whether rows should be loaded with LOAD DATA LOCAL INFILE instead of INSERT statements\n")
+            f.write( ("" if load_data_local_infile else "REM ") + "set arg_load_data=--load-data-local-infile\n")
             #f.write("REM Copy tables incrementally. Useful for updating table contents after an initial migration\n")
             #f.write("REM set arg_incremental_copy=--incremental-copy\n")
             f.write("REM Enable debugging output\n")
@@ -573,7 +606,7 @@ IF [%arg_source_password%] == [] (
             for arg in self._transferer.helper_basic_arglist(True):
                 f.write(' %s' % arg)
             f.write(' --source-password="%arg_source_password%" --target-password="%arg_target_password%" --table-file="%table_file%"')
-            f.write(' --thread-count=%arg_worker_count% %arg_truncate_target% %arg_debug_output%')
+            f.write(' --thread-count=%arg_worker_count% --chunk-size=%arg_chunk_size% %arg_truncate_target% %arg_load_data% %arg_debug_output%')
             f.write("\n\n")
             f.write("REM Removes the file with the table definitions\n")
             f.write("DEL %s\n" % filename)
@@ -587,10 +620,13 @@ if [ -z "$arg_source_password" ] && [ -z "$arg_target_password" ] ; then
 fi
 """)
             f.write("arg_worker_count=%d\n" % worker_count)
+            f.write("arg_chunk_size=%d\n" % chunk_size)
             f.write("# Uncomment the following options according to your needs\n")
             f.write("\n")
             f.write("# Whether target tables should be truncated before copy\n")
             f.write( ("" if truncate_target_tables else "# ") + "arg_truncate_target=--truncate-target\n")
+            f.write("# Whether rows should be loaded with LOAD DATA LOCAL INFILE instead of INSERT statements\n")
+            f.write( ("" if load_data_local_infile else "# ") + "arg_load_data=--load-data-local-infile\n")
             #f.write("# Copy tables incrementally. Useful for updating table contents after an initial migration\n")
             #f.write("#arg_incremental_copy=--incremental-copy\n")
             f.write("# Enable debugging output\n")
@@ -600,7 +636,7 @@ fi
             for arg in self._transferer.helper_basic_arglist(True):
                 f.write(' %s' % arg)
             f.write(' --source-password="$arg_source_password" --target-password="$arg_target_password"')
-            f.write(' --thread-count=$arg_worker_count $arg_truncate_target $arg_debug_output')
+            f.write(' --thread-count=$arg_worker_count --chunk-size=$arg_chunk_size $arg_truncate_target $arg_load_data $arg_debug_output')
 
             for table in self._working_set.values():
                 opt = "--table '%s' '%s' '%s' '%s' '%s' '%s' '%s'" % (table["source_schema"], 